@@ -10,6 +10,15 @@
   #define KR_ENGINE_API
 #endif
 
+// SIMD
+// ====
+// Use with EZ_ENABLED(KR_SIMD_SSE2).
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define KR_SIMD_SSE2 EZ_ON
+#else
+  #define KR_SIMD_SSE2 EZ_OFF
+#endif
+
 namespace kr
 {
   using ::std::swap;
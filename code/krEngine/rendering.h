@@ -1,7 +1,20 @@
 #include<krEngine/rendering/extraction.h>
+#include<krEngine/rendering/indexBuffer.h>
 #include<krEngine/rendering/renderer.h>
+#include<krEngine/rendering/rendererStats.h>
+#include<krEngine/rendering/samplerCache.h>
 #include<krEngine/rendering/shader.h>
+#include<krEngine/rendering/shaderBatch.h>
+#include<krEngine/rendering/shaderPreprocessor.h>
+#include<krEngine/rendering/shaderVariantCache.h>
 #include<krEngine/rendering/sprite.h>
 #include<krEngine/rendering/texture.h>
+#include<krEngine/rendering/textureCache.h>
+#include<krEngine/rendering/textureCompression.h>
+#include<krEngine/rendering/textureCooking.h>
+#include<krEngine/rendering/vertexArrayCache.h>
 #include<krEngine/rendering/vertexBuffer.h>
+#include<krEngine/rendering/vertexBufferPool.h>
+#include<krEngine/rendering/vertexFormats.h>
+#include<krEngine/rendering/vertexLayout.h>
 #include<krEngine/rendering/window.h>
@@ -6,11 +6,30 @@ class ezCamera;
 
 namespace kr
 {
+  /// \brief Where an extracted item ends up in the final image.
+  struct DrawOrder
+  {
+    /// \brief Items on higher layers are always in front of items on lower layers.
+    ezUInt8 layer = 0;
+
+    /// \brief Depth within the layer in the range [0, 1], where 0 is in front.
+    float depth = 0.0f;
+
+    DrawOrder() = default;
+    explicit DrawOrder(ezUInt8 layer, float depth = 0.0f) : layer(layer), depth(depth) {}
+  };
+
   KR_ENGINE_API void extract(Renderer::Extractor& e,
                              const ezCamera& cam,
                              float aspectRatio);
 
+  /// \brief Extracts \a sprite for rendering.
+  ///
+  /// Opaque sprites are drawn front-to-back with depth testing.
+  /// Translucent sprites are drawn afterwards, back-to-front within each layer.
+  /// Items with an equal draw order keep the order in which they were extracted.
   KR_ENGINE_API void extract(Renderer::Extractor& e,
                              const Sprite& sprite,
-                             Transform2D transform);
+                             Transform2D transform,
+                             DrawOrder order = DrawOrder());
 }
@@ -0,0 +1,75 @@
+#pragma once
+#include <krEngine/rendering/implementation/textureFormats.h>
+
+#include <Foundation/Strings/PathUtils.h>
+
+namespace kr
+{
+  // Cooked Texture Files (*.krtex)
+  // ==============================
+  //
+  // A CookedTextureHeader, followed by one CookedSubImage per sub-image, followed by the pixel data.
+  // Sub-images are ordered by mip level, then array index, then face,
+  // which is the order in which they are uploaded.
+  // The pixel data is laid out exactly as glTexSubImage* and glCompressedTexSubImage* expect it,
+  // so it can be handed to OpenGL straight from a memory mapping.
+  // All values are little endian.
+
+  struct CookedTextureHeader
+  {
+    /// \brief Always "KRTX".
+    char magic[4];
+    ezUInt32 version;
+
+    /// \brief The ezImageFormat::Enum the pixel data was cooked from.
+    ezUInt32 imageFormat;
+
+    ezUInt32 glTarget;
+    ezUInt32 glInternalFormat;
+    ezUInt32 glFormat;
+    ezUInt32 glType;
+    ezUInt32 isCompressed;
+
+    ezUInt32 width;
+    ezUInt32 height;
+    ezUInt32 numMipLevels;
+    ezUInt32 numFaces;
+    ezUInt32 numArrayIndices;
+    ezUInt32 numSubImages;
+
+    /// \brief Number of bytes of pixel data of all sub-images, without padding.
+    ezUInt64 byteCount;
+  };
+
+  struct CookedSubImage
+  {
+    /// \brief Offset from the start of the file, aligned to CookedTextureDataAlignment.
+    ezUInt64 offset;
+    ezUInt32 byteCount;
+    ezUInt32 width;
+    ezUInt32 height;
+    ezUInt32 padding;
+  };
+
+  static_assert(sizeof(CookedTextureHeader) % 8 == 0, "Sub-image table must stay aligned.");
+  static_assert(sizeof(CookedSubImage) == 24, "Unexpected padding.");
+
+  const ezUInt32 CookedTextureVersion = 1;
+  const ezUInt32 CookedTextureDataAlignment = 16;
+
+  inline bool isCookedTextureFileName(const char* fileName)
+  {
+    return ezPathUtils::HasExtension(fileName, "krtex");
+  }
+
+  /// \brief Checks whether \a pData holds a complete and consistent cooked texture.
+  ///
+  /// The GL enums stored in the file are only accepted if they are the ones
+  /// toGlTextureFormat() and glTextureTargetOf() pick for the stored image format and shape,
+  /// and every sub-image has to hold at least as many bytes as its dimensions and format require.
+  /// \param out_glFormat The format to upload the pixel data with.
+  /// \return The sub-image table on success, nullptr otherwise.
+  const CookedSubImage* validateCookedTexture(const ezUInt8* pData,
+                                              ezUInt64 byteCount,
+                                              GlTextureFormat& out_glFormat);
+}
@@ -1,36 +1,557 @@
 #include <krEngine/rendering/implementation/extractionDetails.h>
 #include <krEngine/rendering/implementation/opelGlCheck.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
+#include <krEngine/rendering/implementation/shaderVariantCacheImpl.h>
+#include <krEngine/rendering/vertexArrayCache.h>
 
-void kr::draw(SpriteData& sprite,
+// Looked up in the multi-draw sprite shader.
+static const kr::ShaderUniformName u_view("u_view");
+static const kr::ShaderUniformName u_projection("u_projection");
+static const kr::ShaderUniformName u_texture("u_texture");
+
+namespace
+{
+  /// \brief Vertex of the static quad all sprites of a batch are instances of. Matches spriteArray.vs.
+  struct QuadVertex
+  {
+    /// \brief From (0, 0) to (1, 1), in triangle strip order like the vertices of a sprite.
+    ezVec2 corner;
+  };
+
+  /// \brief Per-instance data of a sprite drawn as part of a batch. Matches spriteArray.vs.
+  struct BatchInstance
+  {
+    /// \brief Origin, rotation and normalized depth.
+    ezVec4 transform;
+
+    /// \brief Untransformed position of the first (xy) and the last (zw) vertex of the quad.
+    ezVec4 bounds;
+
+    kr::UNorm16x2 firstTexCoords;
+    kr::UNorm16x2 lastTexCoords;
+
+    /// \brief Layer of the texture array.
+    float layer;
+
+    kr::UNorm8x4 color;
+  };
+
+  /// \brief Per-instance data of a sprite drawn with a multi-draw call. Matches sprite.vs with KR_MULTI_DRAW.
+  struct DrawData
+  {
+    /// \brief Origin, rotation and normalized depth.
+    ezVec4 transform;
+
+    ezColor color;
+  };
+
+  /// \brief Layout of a command in GL_DRAW_INDIRECT_BUFFER, as defined by glMultiDrawArraysIndirect.
+  struct DrawArraysIndirectCommand
+  {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+  };
+
+  struct SpriteBatches
+  {
+    // Texture Array Batches
+    // =====================
+
+    /// \brief Refilled for every batch. Keeps its capacity across frames.
+    ezDynamicArray<BatchInstance> instances;
+
+    /// \brief Holds the 4 vertices of the static quad. Created once.
+    GLuint hQuadBuffer = 0;
+    GLuint hInstanceBuffer = 0;
+
+    // Multi-Draw
+    // ==========
+    // All of these are refilled for every run and keep their capacity across frames.
+
+    ezDynamicArray<DrawArraysIndirectCommand> commands;
+    ezDynamicArray<DrawData> drawData;
+
+    /// \brief The GL buffer holding the vertices of each command.
+    ezDynamicArray<GLuint> commandBuffers;
+
+    GLuint hCommandBuffer = 0;
+    GLuint hDrawDataBuffer = 0;
+
+    // Default Shaders
+    // ===============
+    // Looked up once instead of for every run. See lookUpDefaultShaders().
+
+    bool areShadersLookedUp = false;
+
+    /// \brief The shader variant cache generation they were looked up in.
+    ezUInt32 shaderGeneration = 0;
+
+    kr::Borrowed<kr::ShaderProgram> pDefaultShader;
+    kr::Borrowed<kr::ShaderProgram> pMultiDrawShader;
+
+    /// \brief Resolved for this GL program of pMultiDrawShader, since a reload may move the attributes.
+    GLuint hMultiDrawProgram = 0;
+    GLuint hMultiDrawVertexArray = 0;
+
+    kr::ShaderUniform uTexture;
+    kr::ShaderUniform uView;
+    kr::ShaderUniform uProjection;
+  };
+}
+
+KR_BEGIN_VERTEX_LAYOUT(DrawData)
+  KR_VERTEX_ATTRIBUTE("vs_drawTransform", transform),
+  KR_VERTEX_ATTRIBUTE("vs_drawColor",     color)
+KR_END_VERTEX_LAYOUT
+
+KR_BEGIN_VERTEX_LAYOUT(QuadVertex)
+  KR_VERTEX_ATTRIBUTE("vs_corner", corner)
+KR_END_VERTEX_LAYOUT
+
+KR_BEGIN_VERTEX_LAYOUT(BatchInstance)
+  KR_VERTEX_ATTRIBUTE("vs_transform",      transform),
+  KR_VERTEX_ATTRIBUTE("vs_bounds",         bounds),
+  KR_VERTEX_ATTRIBUTE("vs_firstTexCoords", firstTexCoords),
+  KR_VERTEX_ATTRIBUTE("vs_lastTexCoords",  lastTexCoords),
+  KR_VERTEX_ATTRIBUTE("vs_layer",          layer),
+  KR_VERTEX_ATTRIBUTE("vs_color",          color)
+KR_END_VERTEX_LAYOUT
+
+static SpriteBatches* g_pBatches;
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, SpriteBatches)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core",
+    "ShaderVariantCache",
+    "VertexArrayCache"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pBatches = new (m_mem_batches) SpriteBatches();
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // Borrowed from the shader variant cache, which frees its programs at this point as well.
+    g_pBatches->uTexture = kr::ShaderUniform();
+    g_pBatches->uView = kr::ShaderUniform();
+    g_pBatches->uProjection = kr::ShaderUniform();
+    g_pBatches->pDefaultShader = kr::Borrowed<kr::ShaderProgram>();
+    g_pBatches->pMultiDrawShader = kr::Borrowed<kr::ShaderProgram>();
+    g_pBatches->areShadersLookedUp = false;
+    g_pBatches->hMultiDrawProgram = 0;
+    g_pBatches->hMultiDrawVertexArray = 0;
+
+    // The buffers belong to the GL context,
+    // which is usually gone by the time the core shuts down.
+    if (g_pBatches->hQuadBuffer != 0)
+    {
+      glCheck(glDeleteBuffers(1, &g_pBatches->hQuadBuffer));
+      glCheck(glDeleteBuffers(1, &g_pBatches->hInstanceBuffer));
+      g_pBatches->hQuadBuffer = 0;
+      g_pBatches->hInstanceBuffer = 0;
+    }
+
+    if (g_pBatches->hCommandBuffer != 0)
+    {
+      glCheck(glDeleteBuffers(1, &g_pBatches->hCommandBuffer));
+      glCheck(glDeleteBuffers(1, &g_pBatches->hDrawDataBuffer));
+      g_pBatches->hCommandBuffer = 0;
+      g_pBatches->hDrawDataBuffer = 0;
+    }
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    g_pBatches->~SpriteBatches();
+    g_pBatches = nullptr;
+  }
+
+private:
+  ezUInt8 m_mem_batches[sizeof(SpriteBatches)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+static int compareIdentity(const void* lhs, const void* rhs)
+{
+  if (lhs < rhs)
+    return -1;
+  if (rhs < lhs)
+    return 1;
+  return 0;
+}
+
+int kr::compareState(const SpriteData& lhs, const SpriteData& rhs)
+{
+  // We only care about identity here, so comparing the ownership data is enough.
+  int result = compareIdentity(lhs.pShader.pData, rhs.pShader.pData);
+  if (result == 0)
+    result = compareIdentity(lhs.pTexture.pData, rhs.pTexture.pData);
+  if (result == 0)
+    result = compareIdentity(lhs.pSampler.pData, rhs.pSampler.pData);
+  return result;
+}
+
+/// \brief Draws all \a sprites as instances of a static quad with a single draw call.
+/// \note Expects the shared state to be bound already.
+static void drawBatch(ezArrayPtr<kr::ExtractionData*> sprites)
+{
+  using namespace kr;
+
+  auto& batches = *g_pBatches;
+  auto& instances = batches.instances;
+  instances.Clear();
+
+  // Build Instances
+  // ===============
+  for (ezUInt32 i = 0; i < sprites.GetCount(); ++i)
+  {
+    EZ_ASSERT_DEV(sprites[i]->type == ExtractionDataType::Sprite, "Invalid run of sprites.");
+    auto& sprite = *static_cast<SpriteData*>(sprites[i]);
+
+    // The vertices are set up at the first frame boundary after the sprite was set up.
+    if (sprite.pVertexBuffer == nullptr)
+      continue;
+
+    // The shader interpolates between the first and the last vertex, which are opposite corners.
+    auto& firstVertex = sprite.vertices[0];
+    auto& lastVertex = sprite.vertices[3];
+
+    auto& instance = instances.ExpandAndGetRef();
+    instance.transform.Set(sprite.transform.position.x,
+                           sprite.transform.position.y,
+                           sprite.transform.rotation.GetRadian(),
+                           toNormalizedDepth(sprite.order));
+    instance.bounds.Set(firstVertex.pos.x, firstVertex.pos.y, lastVertex.pos.x, lastVertex.pos.y);
+    instance.firstTexCoords = firstVertex.texCoords;
+    instance.lastTexCoords = lastVertex.texCoords;
+    instance.layer = float(sprite.textureLayer);
+    instance.color.set(sprite.color);
+  }
+
+  if (instances.IsEmpty())
+    return;
+
+  // Upload
+  // ======
+  if (batches.hQuadBuffer == 0)
+  {
+    const QuadVertex quad[] = { { ezVec2(0, 0) }, { ezVec2(0, 1) }, { ezVec2(1, 0) }, { ezVec2(1, 1) } };
+
+    glCheck(glGenBuffers(1, &batches.hQuadBuffer));
+    glCheck(glGenBuffers(1, &batches.hInstanceBuffer));
+    glCheck(glBindBuffer(GL_ARRAY_BUFFER, batches.hQuadBuffer));
+    glCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW));
+    currentFrameStats().bufferBytesUploaded += sizeof(quad);
+  }
+
+  glCheck(glBindBuffer(GL_ARRAY_BUFFER, batches.hInstanceBuffer));
+
+  // Orphan the previous contents, so we don't wait for earlier draws using them.
+  const auto byteCount = instances.GetCount() * sizeof(BatchInstance);
+  glCheck(glBufferData(GL_ARRAY_BUFFER, byteCount, nullptr, GL_STREAM_DRAW));
+  glCheck(glBufferSubData(GL_ARRAY_BUFFER, 0, byteCount, instances.GetData()));
+  glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  currentFrameStats().bufferBytesUploaded += byteCount;
+
+  // Vertex Format
+  // =============
+  // The quad comes from binding point 0, the sprites from binding point 1 once per instance.
+  // Batches of different shaders may have their attributes at different locations.
+  auto& first = *static_cast<SpriteData*>(sprites[0]);
+  ezHybridArray<ResolvedVertexAttribute, 8> attributes;
+  ezHybridArray<ResolvedVertexAttribute, 8> instanceAttributes;
+  resolveVertexLayout(first.pShader, vertexLayoutOf<QuadVertex>(), attributes);
+  resolveVertexLayout(first.pShader, vertexLayoutOf<BatchInstance>(), instanceAttributes);
+
+  for (auto& attribute : instanceAttributes)
+  {
+    attribute.binding = 1;
+    attribute.divisor = 1;
+    attributes.PushBack(attribute);
+  }
+
+  auto hVertexArray = VertexArrayCache::get(ezArrayPtr<const ResolvedVertexAttribute>(attributes.GetData(), attributes.GetCount()));
+  if (hVertexArray == 0)
+    return;
+
+  // Draw
+  // ====
+  VertexArrayCache::bind(hVertexArray, batches.hQuadBuffer, sizeof(QuadVertex), 0);
+  glCheck(glBindVertexBuffer(1, batches.hInstanceBuffer, 0, sizeof(BatchInstance)));
+  KR_ON_SCOPE_EXIT
+  {
+    glCheck(glBindVertexArray(0));
+    ++currentFrameStats().numVertexArrayChanges;
+  };
+
+  const auto numInstances = instances.GetCount();
+  glCheck(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(numInstances)));
+
+  auto& stats = currentFrameStats();
+  ++stats.numDrawCalls;
+  stats.numPrimitives += 2 * numInstances;
+}
+
+/// \brief Looks up the default sprite shaders, unless that was done since the last change to the shader variant cache.
+///
+/// A program that fails to build is not looked up again before the next change either,
+/// so the failure is reported only once.
+static void lookUpDefaultShaders(SpriteBatches& batches)
+{
+  using namespace kr;
+
+  const auto generation = getShaderVariantGeneration();
+  if (batches.areShadersLookedUp && batches.shaderGeneration == generation)
+    return;
+
+  batches.areShadersLookedUp = true;
+  batches.shaderGeneration = generation;
+  batches.pDefaultShader = Sprite::getDefaultShader();
+  batches.pMultiDrawShader = Sprite::getDefaultMultiDrawShader();
+  batches.hMultiDrawProgram = 0;
+}
+
+/// \brief Resolves the vertex array and the uniforms of the multi-draw shader, unless its GL program is unchanged.
+/// \return false if the vertex array cannot be created.
+static bool resolveMultiDrawState(SpriteBatches& batches)
+{
+  using namespace kr;
+
+  auto& pShader = batches.pMultiDrawShader;
+  if (batches.hMultiDrawProgram == pShader->getGlHandle())
+    return batches.hMultiDrawVertexArray != 0;
+
+  batches.hMultiDrawProgram = pShader->getGlHandle();
+
+  // The quads come from binding point 0, the draw data from binding point 1 once per instance.
+  ezHybridArray<ResolvedVertexAttribute, 8> attributes;
+  ezHybridArray<ResolvedVertexAttribute, 8> instanceAttributes;
+  resolveVertexLayout(pShader, vertexLayoutOf<krSpriteVertex>(), attributes);
+  resolveVertexLayout(pShader, vertexLayoutOf<DrawData>(), instanceAttributes);
+
+  for (auto& attribute : instanceAttributes)
+  {
+    attribute.binding = 1;
+    attribute.divisor = 1;
+    attributes.PushBack(attribute);
+  }
+
+  batches.hMultiDrawVertexArray = VertexArrayCache::get(ezArrayPtr<const ResolvedVertexAttribute>(attributes.GetData(), attributes.GetCount()));
+
+  batches.uTexture = shaderUniformOf(pShader, u_texture);
+  batches.uView = shaderUniformOf(pShader, u_view);
+  batches.uProjection = shaderUniformOf(pShader, u_projection);
+
+  return batches.hMultiDrawVertexArray != 0;
+}
+
+/// \brief Draws \a sprites using the default shader with one glMultiDrawArraysIndirect call per vertex buffer page.
+/// \return false if the sprites have to be drawn one by one, because they use another shader.
+/// \note The context is at least GL 4.3, which has multi-draw indirect and base instances.
+static bool drawMultiple(ezArrayPtr<kr::ExtractionData*> sprites,
+                         const ezMat4& viewMatrix,
+                         const ezMat4& projectionMatrix)
+{
+  using namespace kr;
+
+  auto& first = *static_cast<SpriteData*>(sprites[0]);
+  auto& batches = *g_pBatches;
+
+  lookUpDefaultShaders(batches);
+
+  if (batches.pDefaultShader == nullptr ||
+      compareIdentity(first.pShader.pData, batches.pDefaultShader.pData) != 0)
+  {
+    return false;
+  }
+
+  auto& pShader = batches.pMultiDrawShader;
+  if (pShader == nullptr)
+    return false;
+
+  // Without a vertex array, the sprites are drawn one by one.
+  if (!resolveMultiDrawState(batches))
+    return false;
+  auto& commands = batches.commands;
+  auto& drawData = batches.drawData;
+  auto& commandBuffers = batches.commandBuffers;
+  commands.Clear();
+  drawData.Clear();
+  commandBuffers.Clear();
+
+  // Build Commands
+  // ==============
+  for (ezUInt32 i = 0; i < sprites.GetCount(); ++i)
+  {
+    EZ_ASSERT_DEV(sprites[i]->type == ExtractionDataType::Sprite, "Invalid run of sprites.");
+    auto& sprite = *static_cast<SpriteData*>(sprites[i]);
+
+    // The vertex buffer is created at the first frame boundary after the sprite was set up.
+    if (sprite.pVertexBuffer == nullptr)
+      continue;
+
+    auto& command = commands.ExpandAndGetRef();
+    command.count = 4;
+    command.instanceCount = 1;
+    command.first = sprite.pVertexBuffer->getBaseVertex(sizeof(krSpriteVertex));
+    command.baseInstance = drawData.GetCount();
+
+    auto& data = drawData.ExpandAndGetRef();
+    data.transform.Set(sprite.transform.position.x,
+                       sprite.transform.position.y,
+                       sprite.transform.rotation.GetRadian(),
+                       toNormalizedDepth(sprite.order));
+    data.color = sprite.color;
+
+    commandBuffers.PushBack(sprite.pVertexBuffer->m_glHandle);
+  }
+
+  if (commands.IsEmpty())
+    return true;
+
+  // Upload
+  // ======
+  if (batches.hCommandBuffer == 0)
+  {
+    glCheck(glGenBuffers(1, &batches.hCommandBuffer));
+    glCheck(glGenBuffers(1, &batches.hDrawDataBuffer));
+  }
+
+  // Orphan the previous contents, so we don't wait for earlier draws using them.
+  const auto commandByteCount = commands.GetCount() * sizeof(DrawArraysIndirectCommand);
+  glCheck(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batches.hCommandBuffer));
+  glCheck(glBufferData(GL_DRAW_INDIRECT_BUFFER, commandByteCount, nullptr, GL_STREAM_DRAW));
+  glCheck(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandByteCount, commands.GetData()));
+  KR_ON_SCOPE_EXIT{ glCheck(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0)); };
+
+  const auto drawDataByteCount = drawData.GetCount() * sizeof(DrawData);
+  glCheck(glBindBuffer(GL_ARRAY_BUFFER, batches.hDrawDataBuffer));
+  glCheck(glBufferData(GL_ARRAY_BUFFER, drawDataByteCount, nullptr, GL_STREAM_DRAW));
+  glCheck(glBufferSubData(GL_ARRAY_BUFFER, 0, drawDataByteCount, drawData.GetData()));
+  glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+  auto& stats = currentFrameStats();
+  stats.bufferBytesUploaded += commandByteCount + drawDataByteCount;
+
+  // Set Shared State
+  // ================
+  TextureSlot textureSlot(0);
+
+  KR_RAII_BIND_SHADER(pShader);
+  KR_RAII_BIND_SAMPLER(first.pSampler, textureSlot);
+  KR_RAII_BIND_TEXTURE_2D(first.pTexture, textureSlot);
+
+  uploadData(batches.uTexture, textureSlot);
+  uploadData(batches.uView, viewMatrix);
+  uploadData(batches.uProjection, projectionMatrix);
+
+  // Submit
+  // ======
+  // The commands keep the order of the sprites, but each GL buffer needs its own call.
+  ezUInt32 runBegin = 0;
+  while (runBegin < commands.GetCount())
+  {
+    auto hBuffer = commandBuffers[runBegin];
+    ezUInt32 runEnd = runBegin + 1;
+    while (runEnd < commands.GetCount() && commandBuffers[runEnd] == hBuffer)
+    {
+      ++runEnd;
+    }
+
+    VertexArrayCache::bind(batches.hMultiDrawVertexArray, hBuffer, sizeof(krSpriteVertex), 0);
+    glCheck(glBindVertexBuffer(1, batches.hDrawDataBuffer, 0, sizeof(DrawData)));
+
+    // Sprite quads are triangle strips.
+    auto pOffset = reinterpret_cast<const void*>(static_cast<size_t>(runBegin * sizeof(DrawArraysIndirectCommand)));
+    glCheck(glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, pOffset, static_cast<GLsizei>(runEnd - runBegin), 0));
+
+    // Each command draws a quad.
+    ++stats.numDrawCalls;
+    stats.numPrimitives += 2 * (runEnd - runBegin);
+
+    runBegin = runEnd;
+  }
+
+  glCheck(glBindVertexArray(0));
+  ++stats.numVertexArrayChanges;
+
+  return true;
+}
+
+void kr::draw(ezArrayPtr<ExtractionData*> sprites,
               const ezMat4& viewMatrix,
               const ezMat4& projectionMatrix)
 {
-  EZ_LOG_BLOCK("Drawing Sprite");
+  EZ_LOG_BLOCK("Drawing Sprites");
+
+  if (sprites.GetCount() == 0)
+    return;
+
+  auto& first = *static_cast<SpriteData*>(sprites[0]);
 
   // If there is no shader, we cannot draw.
-  if (sprite.pShader == nullptr)
+  if (first.pShader == nullptr)
   {
     ezLog::Warning("No shader to draw with.");
     return;
   }
 
+  if (drawMultiple(sprites, viewMatrix, projectionMatrix))
+    return;
+
   TextureSlot textureSlot(0);
 
-  // Set Active Shader
-  // =================
-  KR_RAII_BIND_SHADER(sprite.pShader);
-  KR_RAII_BIND_VERTEX_BUFFER(sprite.pVertexBuffer, sprite.pShader);
-  KR_RAII_BIND_SAMPLER(sprite.pSampler, textureSlot);
-  KR_RAII_BIND_TEXTURE_2D(sprite.pTexture, textureSlot);
+  // Set Shared State
+  // ================
+  KR_RAII_BIND_SHADER(first.pShader);
+  KR_RAII_BIND_SAMPLER(first.pSampler, textureSlot);
+  KR_RAII_BIND_TEXTURE_2D(first.pTexture, textureSlot);
 
-  // Update Uniforms
-  // ===============
-  uploadData(sprite.uColor, sprite.color);
-  uploadData(sprite.uTexture, textureSlot);
-  uploadData(sprite.uOrigin, sprite.transform.position);
-  uploadData(sprite.uRotation, sprite.transform.rotation);
-  uploadData(sprite.uViewMatrix, viewMatrix);
-  uploadData(sprite.uProjectionMatrix, projectionMatrix);
-
-  glCheck(glDrawArrays((GLenum)sprite.pVertexBuffer->getPrimitive(), 0, 4));
+  uploadData(first.uTexture, textureSlot);
+  uploadData(first.uViewMatrix, viewMatrix);
+  uploadData(first.uProjectionMatrix, projectionMatrix);
+
+  // Sprites using a texture array only differ in their per-vertex data.
+  if (first.pTexture != nullptr && first.pTexture->isArray())
+  {
+    drawBatch(sprites);
+    return;
+  }
+
+  // Draw Each Sprite
+  // ================
+  for (ezUInt32 i = 0; i < sprites.GetCount(); ++i)
+  {
+    EZ_ASSERT_DEV(sprites[i]->type == ExtractionDataType::Sprite, "Invalid run of sprites.");
+    auto& sprite = *static_cast<SpriteData*>(sprites[i]);
+
+    // The vertex buffer is created at the first frame boundary after the sprite was set up.
+    if (sprite.pVertexBuffer == nullptr)
+      continue;
+
+    KR_RAII_BIND_VERTEX_BUFFER(sprite.pVertexBuffer, sprite.pShader);
+
+    uploadData(sprite.uColor, sprite.color);
+    uploadData(sprite.uOrigin, sprite.transform.position);
+    uploadData(sprite.uRotation, sprite.transform.rotation);
+
+    // Custom shaders are not required to support depth.
+    if (sprite.uDepth.isValid())
+    {
+      uploadData(sprite.uDepth, toNormalizedDepth(sprite.order));
+    }
+
+    // Pooled vertex buffers start somewhere within their GL buffer.
+    auto baseVertex = sprite.pVertexBuffer->getBaseVertex(sizeof(krSpriteVertex));
+    glCheck(glDrawArrays((GLenum)sprite.pVertexBuffer->getPrimitive(), static_cast<GLint>(baseVertex), 4));
+
+    // A quad as a triangle strip.
+    auto& stats = currentFrameStats();
+    ++stats.numDrawCalls;
+    stats.numPrimitives += 2;
+  }
 }
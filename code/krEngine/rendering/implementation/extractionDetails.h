@@ -3,6 +3,7 @@
 #include <krEngine/rendering/vertexBuffer.h>
 #include <krEngine/rendering/texture.h>
 #include <krEngine/rendering/sprite.h>
+#include <krEngine/rendering/extraction.h>
 
 namespace kr
 {
@@ -19,8 +20,23 @@ namespace kr
 
     ExtractionDataType type;
     size_t byteCount;
+
+    DrawOrder order;
+
+    /// \brief Translucent items are blended and drawn after all opaque items.
+    bool isTranslucent = true;
   };
 
+  /// \brief Maps \a order to a single depth value in [0, 1), where 0 is in front.
+  ///
+  /// Each layer gets a slot of 1/256. The depth within the layer is scaled to stay
+  /// inside that slot, so the back of a layer never meets the front of the layer behind it.
+  inline float toNormalizedDepth(DrawOrder order)
+  {
+    const float depth = ezMath::Clamp(order.depth, 0.0f, 1.0f) * (255.0f / 256.0f);
+    return (float(255 - order.layer) + depth) / 256.0f;
+  }
+
   //////////////////////////////////////////////////////////////////////////
 
   // Camera
@@ -42,14 +58,30 @@ namespace kr
     ShaderUniform uColor;
     ShaderUniform uOrigin;
     ShaderUniform uRotation;
+    ShaderUniform uDepth;
     ShaderUniform uViewMatrix;
     ShaderUniform uProjectionMatrix;
 
     Transform2D transform;
     ezColor color;
+
+    /// \brief Untransformed quad of the sprite. Used to draw sprites with a texture array in batches.
+    krSpriteVertex vertices[4];
+    ezUInt32 textureLayer;
   };
 
-  void draw(SpriteData& sprite,
+  /// \brief Orders sprites by the state they need bound (shader, texture and sampler).
+  /// \return A negative value if \a lhs comes first, a positive value if \a rhs comes first,
+  ///         and 0 if both can be drawn with the same state.
+  int compareState(const SpriteData& lhs, const SpriteData& rhs);
+
+  /// \brief Draws a run of sprites that all share the same state.
+  ///
+  /// If the shared texture is an array, all sprites are drawn with a single draw call.
+  /// Sprites using the default shader are drawn with a single multi-draw call per vertex buffer page,
+  /// where glMultiDrawArraysIndirect is available.
+  /// \see compareState
+  void draw(ezArrayPtr<ExtractionData*> sprites,
             const ezMat4& viewMatrix,
             const ezMat4& projectionMatrix);
 }
@@ -0,0 +1,236 @@
+#include <krEngine/rendering/indexBuffer.h>
+#include <krEngine/rendering/implementation/opelGlCheck.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
+
+namespace
+{
+  struct IndexBufferData
+  {
+    kr::Owned<kr::IndexBuffer> pQuads;
+
+    /// \brief Number of quads the indices in pQuads cover.
+    ezUInt32 numQuads = 0;
+  };
+}
+
+static IndexBufferData* g_pIndexBufferData;
+static bool g_initialized = false;
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, IndexBuffers)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pIndexBufferData = new (m_mem_data) IndexBufferData();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // The buffer belongs to the GL context,
+    // which is usually gone by the time the core shuts down.
+    auto& pQuads = g_pIndexBufferData->pQuads;
+    if (pQuads.data.refCount > 0)
+    {
+      // The borrowers point into the owner, so we cannot free it.
+      ezLog::Error("The shared quad index buffer is still borrowed %u times. Leaking it.",
+                   static_cast<ezUInt32>(pQuads.data.refCount));
+      pQuads.yieldOwnership();
+    }
+
+    pQuads = nullptr;
+    g_pIndexBufferData->numQuads = 0;
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    g_pIndexBufferData->~IndexBufferData();
+    g_pIndexBufferData = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_data[sizeof(IndexBufferData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+kr::Owned<kr::IndexBuffer> kr::IndexBuffer::create(BufferUsage usage, IndexType type)
+{
+  GLuint handle;
+  glGenBuffers(1, &handle);
+
+  if (handle == 0)
+  {
+    // Failure
+    // =======
+
+    ezLog::Warning("Failed to create OpenGL index buffer. "
+                   "Did you forget to create a rendering context?");
+    return nullptr;
+  }
+
+  // Success
+  // =======
+
+  IndexBuffer* pIndexBuffer = EZ_DEFAULT_NEW(IndexBuffer);
+  pIndexBuffer->m_glHandle = handle;
+  pIndexBuffer->m_usage = usage;
+  pIndexBuffer->m_type = type;
+  return own(pIndexBuffer, [](IndexBuffer* ptr){ EZ_DEFAULT_DELETE(ptr); });
+}
+
+kr::IndexBuffer::~IndexBuffer()
+{
+  glCheck(glDeleteBuffers(1, &m_glHandle));
+  m_glHandle = 0;
+}
+
+static ezResult upload(kr::Borrowed<kr::IndexBuffer> pIndexBuffer,
+                       kr::IndexType type,
+                       ezUInt32 count,
+                       ezUInt32 byteCount,
+                       const void* bytes)
+{
+  using namespace kr;
+
+  EZ_LOG_BLOCK("Upload Index Buffer Data");
+
+  if (pIndexBuffer == nullptr)
+  {
+    ezLog::Warning("Invalid index buffer object.");
+    return EZ_FAILURE;
+  }
+
+  auto handle = pIndexBuffer->m_glHandle;
+  auto usage = static_cast<GLenum>(pIndexBuffer->getUsage());
+
+  EZ_ASSERT_DEBUG(glIsBuffer(handle) == GL_TRUE, "Invalid index buffer");
+
+  // The element array binding is part of the vertex array state,
+  // so make sure we don't change the index buffer of whatever is bound.
+  GLint hPreviousVao = 0;
+  glCheck(glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &hPreviousVao));
+  glCheck(glBindVertexArray(0));
+
+  glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle));
+  glCheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)byteCount, bytes, usage));
+  glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+  if (bytes != nullptr)
+    currentFrameStats().bufferBytesUploaded += byteCount;
+
+  glCheck(glBindVertexArray(static_cast<GLuint>(hPreviousVao)));
+
+  pIndexBuffer->m_type = type;
+  pIndexBuffer->m_count = count;
+
+  return EZ_SUCCESS;
+}
+
+ezResult kr::uploadData(Borrowed<IndexBuffer> pIndexBuffer,
+                        ezArrayPtr<const ezUInt16> indices)
+{
+  return upload(move(pIndexBuffer), IndexType::UInt16,
+                indices.GetCount(),                    // count
+                indices.GetCount() * sizeof(ezUInt16), // byteCount
+                indices.GetPtr());                     // bytes
+}
+
+ezResult kr::uploadData(Borrowed<IndexBuffer> pIndexBuffer,
+                        ezArrayPtr<const ezUInt32> indices)
+{
+  return upload(move(pIndexBuffer), IndexType::UInt32,
+                indices.GetCount(),                    // count
+                indices.GetCount() * sizeof(ezUInt32), // byteCount
+                indices.GetPtr());                     // bytes
+}
+
+ezResult kr::attachIndexBuffer(Borrowed<VertexBuffer> pVertBuffer,
+                               Borrowed<const IndexBuffer> pIndexBuffer)
+{
+  if (pVertBuffer == nullptr)
+  {
+    ezLog::Warning("Vertex buffer is nullptr. Aborting.");
+    return EZ_FAILURE;
+  }
+
+  // The vertex array objects are shared with other vertex buffers,
+  // so the index buffer is bound along with them in bind().
+  pVertBuffer->m_pIndexBuffer = pIndexBuffer;
+
+  return EZ_SUCCESS;
+}
+
+// Shared Quads
+// ============
+
+/// \brief Fills \a out_indices with the indices of \a numQuads quads.
+template<typename TIndex>
+static void generateQuadIndices(ezUInt32 numQuads, ezDynamicArray<TIndex>& out_indices)
+{
+  out_indices.SetCountUninitialized(6 * numQuads);
+
+  auto pIndex = out_indices.GetData();
+  for (ezUInt32 i = 0; i < numQuads; ++i)
+  {
+    auto first = 4 * i;
+    *pIndex++ = static_cast<TIndex>(first + 0);
+    *pIndex++ = static_cast<TIndex>(first + 1);
+    *pIndex++ = static_cast<TIndex>(first + 2);
+    *pIndex++ = static_cast<TIndex>(first + 2);
+    *pIndex++ = static_cast<TIndex>(first + 1);
+    *pIndex++ = static_cast<TIndex>(first + 3);
+  }
+}
+
+kr::Borrowed<kr::IndexBuffer> kr::IndexBuffer::getQuads(ezUInt32 numQuads)
+{
+  EZ_ASSERT_DEV(g_initialized, "IndexBuffers subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  auto& data = *g_pIndexBufferData;
+
+  if (data.pQuads == nullptr)
+  {
+    data.pQuads = create(BufferUsage::StaticDraw, IndexType::UInt16);
+    if (data.pQuads == nullptr)
+      return nullptr;
+  }
+
+  if (numQuads <= data.numQuads)
+    return borrow(data.pQuads);
+
+  // Grow in powers of two, so a slowly growing number of quads does not upload every frame.
+  ezUInt32 newNumQuads = ezMath::Max(data.numQuads, 256u);
+  while (newNumQuads < numQuads)
+  {
+    newNumQuads *= 2;
+  }
+
+  // 16 bit indices can address 16384 quads.
+  const ezUInt32 maxNumQuads16 = 65536 / 4;
+
+  ezResult result = EZ_SUCCESS;
+  if (newNumQuads <= maxNumQuads16)
+  {
+    ezDynamicArray<ezUInt16> indices;
+    generateQuadIndices(newNumQuads, indices);
+    result = uploadData(data.pQuads, ezArrayPtr<const ezUInt16>(indices.GetData(), indices.GetCount()));
+  }
+  else
+  {
+    ezDynamicArray<ezUInt32> indices;
+    generateQuadIndices(newNumQuads, indices);
+    result = uploadData(data.pQuads, ezArrayPtr<const ezUInt32>(indices.GetData(), indices.GetCount()));
+  }
+
+  if (result.Failed())
+    return nullptr;
+
+  data.numQuads = newNumQuads;
+  return borrow(data.pQuads);
+}
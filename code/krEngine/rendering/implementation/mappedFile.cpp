@@ -0,0 +1,101 @@
+#include <krEngine/rendering/implementation/mappedFile.h>
+
+#if EZ_ENABLED(EZ_PLATFORM_WINDOWS)
+  #include <Windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+ezResult kr::MappedFile::open(const char* absolutePath)
+{
+  close();
+
+#if EZ_ENABLED(EZ_PLATFORM_WINDOWS)
+  auto hFile = CreateFileA(absolutePath, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+  {
+    ezLog::Warning("Unable to open file for mapping: %s", absolutePath);
+    return EZ_FAILURE;
+  }
+  m_hFile = hFile;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+  {
+    ezLog::Warning("Unable to map empty file: %s", absolutePath);
+    close();
+    return EZ_FAILURE;
+  }
+
+  m_hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_hMapping == nullptr)
+  {
+    ezLog::Warning("Unable to create file mapping: %s", absolutePath);
+    close();
+    return EZ_FAILURE;
+  }
+
+  m_pData = static_cast<const ezUInt8*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+  m_byteCount = static_cast<ezUInt64>(size.QuadPart);
+#else
+  m_fileDescriptor = ::open(absolutePath, O_RDONLY);
+  if (m_fileDescriptor < 0)
+  {
+    ezLog::Warning("Unable to open file for mapping: %s", absolutePath);
+    return EZ_FAILURE;
+  }
+
+  struct stat info;
+  if (fstat(m_fileDescriptor, &info) != 0 || info.st_size == 0)
+  {
+    ezLog::Warning("Unable to map empty file: %s", absolutePath);
+    close();
+    return EZ_FAILURE;
+  }
+
+  auto pData = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+  if (pData != MAP_FAILED)
+  {
+    m_pData = static_cast<const ezUInt8*>(pData);
+  }
+  m_byteCount = static_cast<ezUInt64>(info.st_size);
+#endif
+
+  if (m_pData == nullptr)
+  {
+    ezLog::Warning("Unable to map file: %s", absolutePath);
+    close();
+    return EZ_FAILURE;
+  }
+
+  return EZ_SUCCESS;
+}
+
+void kr::MappedFile::close()
+{
+#if EZ_ENABLED(EZ_PLATFORM_WINDOWS)
+  if (m_pData)
+    UnmapViewOfFile(m_pData);
+  if (m_hMapping)
+    CloseHandle(m_hMapping);
+  if (m_hFile)
+    CloseHandle(m_hFile);
+
+  m_hMapping = nullptr;
+  m_hFile = nullptr;
+#else
+  if (m_pData)
+    munmap(const_cast<ezUInt8*>(m_pData), m_byteCount);
+  if (m_fileDescriptor >= 0)
+    ::close(m_fileDescriptor);
+
+  m_fileDescriptor = -1;
+#endif
+
+  m_pData = nullptr;
+  m_byteCount = 0;
+}
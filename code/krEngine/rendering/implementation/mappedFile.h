@@ -0,0 +1,37 @@
+#pragma once
+
+namespace kr
+{
+  /// \brief Read-only memory mapping of a whole file.
+  class MappedFile
+  {
+  public: // *** Construction
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+  public: // *** Runtime
+    /// \param absolutePath Path in the native filesystem, not an ezFileSystem path.
+    ezResult open(const char* absolutePath);
+    void close();
+
+  public: // *** Accessors
+    bool isOpen() const { return m_pData != nullptr; }
+    const ezUInt8* getData() const { return m_pData; }
+    ezUInt64 getByteCount() const { return m_byteCount; }
+
+  private: // *** Data
+    const ezUInt8* m_pData = nullptr;
+    ezUInt64 m_byteCount = 0;
+
+#if EZ_ENABLED(EZ_PLATFORM_WINDOWS)
+    void* m_hFile = nullptr;
+    void* m_hMapping = nullptr;
+#else
+    int m_fileDescriptor = -1;
+#endif
+
+  private: // *** Type Constraints
+    MappedFile(const MappedFile&) = delete;        ///< No copy.
+    void operator =(const MappedFile&) = delete;   ///< No assignment.
+  };
+}
@@ -1,5 +1,40 @@
 #include <krEngine/rendering/implementation/opelGlCheck.h>
 
+// Our GLEW version does not know KHR_parallel_shader_compile yet.
+using MaxShaderCompilerThreadsFunc = void (APIENTRY*)(GLuint count);
+
+/// \brief Lets the driver compile shaders with as many threads as it likes.
+/// \return false if the driver does not support it.
+static bool enableParallelShaderCompile()
+{
+  GLint numExtensions = 0;
+  glCheck(glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions));
+
+  const char* functionName = nullptr;
+  for (GLint i = 0; i < numExtensions && functionName == nullptr; ++i)
+  {
+    auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension == nullptr)
+      continue;
+
+    if (ezStringUtils::IsEqual(extension, "GL_KHR_parallel_shader_compile"))
+      functionName = "glMaxShaderCompilerThreadsKHR";
+    else if (ezStringUtils::IsEqual(extension, "GL_ARB_parallel_shader_compile"))
+      functionName = "glMaxShaderCompilerThreadsARB";
+  }
+
+  if (functionName == nullptr)
+    return false;
+
+  auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsFunc>(wglGetProcAddress(functionName));
+  if (maxShaderCompilerThreads == nullptr)
+    return false;
+
+  maxShaderCompilerThreads(0xFFFFFFFF);
+  glCheckLastError();
+  return true;
+}
+
 static ezResult destroyOpenGLContext(kr::WindowImpl& window)
 {
   EZ_LOG_BLOCK("Renderer Destroying OpenGL Context");
@@ -16,6 +51,7 @@ static ezResult destroyOpenGLContext(kr::WindowImpl& window)
     wglMakeCurrent(nullptr, nullptr);
     wglDeleteContext(window.m_hRC);
     window.m_hRC = nullptr;
+    kr::setParallelShaderCompileEnabled(false);
   }
 
   if (window.m_hDC)
@@ -124,6 +160,8 @@ static ezResult createOpenGLContext(kr::WindowImpl& window)
 
   ezLog::Success("Initialized GLEW version %s", glewGetString(GLEW_VERSION));
 
+  kr::setParallelShaderCompileEnabled(enableParallelShaderCompile());
+
   return EZ_SUCCESS;
 
 failure:
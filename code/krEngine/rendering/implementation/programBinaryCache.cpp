@@ -0,0 +1,230 @@
+#include <krEngine/rendering/shader.h>
+#include <krEngine/rendering/implementation/programBinaryCache.h>
+#include <krEngine/rendering/implementation/opelGlCheck.h>
+
+#include <Foundation/IO/FileSystem/FileReader.h>
+#include <Foundation/IO/FileSystem/FileWriter.h>
+#include <Foundation/Algorithm/Hashing.h>
+
+namespace
+{
+  /// \brief Layout of a cached program binary file (*.krprog). Followed by the binary itself.
+  struct ProgramBinaryHeader
+  {
+    char magic[4];
+    ezUInt32 version;
+    ezUInt64 key;
+    ezUInt32 binaryFormat;
+    ezUInt32 byteCount;
+  };
+
+  struct ProgramBinaryCacheData
+  {
+    /// \brief ezFileSystem path the files are written to. Empty if the cache is disabled.
+    ezStringBuilder directory;
+    kr::ProgramBinaryCacheStats stats;
+  };
+}
+
+static const ezUInt32 ProgramBinaryVersion = 1;
+
+static ProgramBinaryCacheData* g_pCache;
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, ProgramBinaryCache)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pCache = new (m_mem_cache) ProgramBinaryCacheData();
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    g_pCache->~ProgramBinaryCacheData();
+    g_pCache = nullptr;
+  }
+
+private:
+  ezUInt8 m_mem_cache[sizeof(ProgramBinaryCacheData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+static void fileNameOf(kr::ProgramBinaryKey key, ezStringBuilder& out_fileName)
+{
+  out_fileName.Format("%s%08x%08x.krprog",
+                      g_pCache->directory.GetData(),
+                      static_cast<ezUInt32>(key >> 32),
+                      static_cast<ezUInt32>(key & 0xFFFFFFFF));
+}
+
+static const char* glString(GLenum name)
+{
+  auto value = reinterpret_cast<const char*>(glGetString(name));
+  return value ? value : "";
+}
+
+/// \brief Appends the length and the bytes of \a part.
+/// \note With the length in front, no two different sequences of parts produce the same bytes,
+///       which joining them with a separator cannot guarantee.
+static void appendKeyPart(ezDynamicArray<ezUInt8>& keySource, const char* part)
+{
+  const ezUInt32 byteCount = ezStringUtils::GetStringElementCount(part);
+
+  auto pLength = reinterpret_cast<const ezUInt8*>(&byteCount);
+  keySource.PushBackRange(ezArrayPtr<const ezUInt8>(pLength, sizeof(byteCount)));
+  keySource.PushBackRange(ezArrayPtr<const ezUInt8>(reinterpret_cast<const ezUInt8*>(part), byteCount));
+}
+
+kr::ProgramBinaryKey kr::computeProgramBinaryKey(ezStringView vsSource, ezStringView fsSource)
+{
+  // A driver update may change the binary format, so the driver is part of the key.
+  ezDynamicArray<ezUInt8> keySource;
+  appendKeyPart(keySource, glString(GL_VENDOR));
+  appendKeyPart(keySource, glString(GL_RENDERER));
+  appendKeyPart(keySource, glString(GL_VERSION));
+  appendKeyPart(keySource, ezStringBuilder(vsSource).GetData());
+  appendKeyPart(keySource, ezStringBuilder(fsSource).GetData());
+
+  // Two differently seeded 32 bit hashes make collisions unlikely enough for a cache.
+  auto low = ezHashing::MurmurHash(keySource.GetData(), keySource.GetCount(), 0);
+  auto high = ezHashing::MurmurHash(keySource.GetData(), keySource.GetCount(), 0x6B72);
+  return (static_cast<ezUInt64>(high) << 32) | low;
+}
+
+bool kr::isProgramBinaryCacheEnabled()
+{
+  if (g_pCache->directory.IsEmpty())
+    return false;
+
+  if (!GLEW_ARB_get_program_binary)
+    return false;
+
+  GLint numFormats = 0;
+  glCheck(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats));
+  return numFormats > 0;
+}
+
+GLuint kr::loadProgramBinary(ProgramBinaryKey key)
+{
+  auto& stats = g_pCache->stats;
+
+  ezStringBuilder fileName;
+  fileNameOf(key, fileName);
+
+  // Read the File
+  // =============
+  ProgramBinaryHeader header;
+  ezDynamicArray<ezUInt8> binary;
+  {
+    ezFileReader file;
+    if (file.Open(fileName).Failed())
+    {
+      ++stats.numMisses;
+      return 0;
+    }
+
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        !ezMemoryUtils::IsEqual(header.magic, "KRPB", 4) ||
+        header.version != ProgramBinaryVersion ||
+        header.key != key)
+    {
+      ezLog::Warning("Ignoring invalid program binary '%s'.", fileName.GetData());
+      ++stats.numMisses;
+      return 0;
+    }
+
+    // Check before allocating, a corrupt header must not make us allocate gigabytes.
+    if (header.byteCount > file.GetFileSize() - sizeof(header))
+    {
+      ezLog::Warning("Program binary '%s' is truncated.", fileName.GetData());
+      ++stats.numMisses;
+      return 0;
+    }
+
+    binary.SetCount(header.byteCount);
+    if (file.ReadBytes(binary.GetData(), header.byteCount) != header.byteCount)
+    {
+      ezLog::Warning("Program binary '%s' is truncated.", fileName.GetData());
+      ++stats.numMisses;
+      return 0;
+    }
+  }
+
+  // Hand It to the Driver
+  // =====================
+  auto hProgram = glCreateProgram();
+  glCheckLastError();
+
+  glCheck(glProgramBinary(hProgram, header.binaryFormat, binary.GetData(), header.byteCount));
+
+  // The driver may reject binaries anytime, e.g. after an update that kept the version string.
+  GLint status = GL_FALSE;
+  glCheck(glGetProgramiv(hProgram, GL_LINK_STATUS, &status));
+  if (status != GL_TRUE)
+  {
+    glCheck(glDeleteProgram(hProgram));
+    ++stats.numRejected;
+    return 0;
+  }
+
+  ++stats.numHits;
+  return hProgram;
+}
+
+void kr::storeProgramBinary(ProgramBinaryKey key, GLuint hProgram)
+{
+  GLint byteCount = 0;
+  glCheck(glGetProgramiv(hProgram, GL_PROGRAM_BINARY_LENGTH, &byteCount));
+  if (byteCount <= 0)
+    return;
+
+  ezDynamicArray<ezUInt8> binary;
+  binary.SetCount(byteCount);
+
+  GLenum binaryFormat = 0;
+  glCheck(glGetProgramBinary(hProgram, byteCount, &byteCount, &binaryFormat, binary.GetData()));
+
+  ProgramBinaryHeader header;
+  ezMemoryUtils::ZeroFill(&header);
+  ezMemoryUtils::Copy(header.magic, "KRPB", 4);
+  header.version = ProgramBinaryVersion;
+  header.key = key;
+  header.binaryFormat = binaryFormat;
+  header.byteCount = static_cast<ezUInt32>(byteCount);
+
+  ezStringBuilder fileName;
+  fileNameOf(key, fileName);
+
+  ezFileWriter file;
+  if (file.Open(fileName).Failed() ||
+      file.WriteBytes(&header, sizeof(header)).Failed() ||
+      file.WriteBytes(binary.GetData(), header.byteCount).Failed())
+  {
+    ezLog::Warning("Failed to write program binary '%s'.", fileName.GetData());
+    return;
+  }
+
+  ++g_pCache->stats.numStored;
+}
+
+void kr::setProgramBinaryCacheDirectory(ezStringView directory)
+{
+  g_pCache->directory = directory;
+}
+
+ezStringView kr::getProgramBinaryCacheDirectory()
+{
+  return g_pCache->directory;
+}
+
+kr::ProgramBinaryCacheStats kr::getProgramBinaryCacheStats()
+{
+  return g_pCache->stats;
+}
+
+void kr::resetProgramBinaryCacheStats()
+{
+  g_pCache->stats = ProgramBinaryCacheStats();
+}
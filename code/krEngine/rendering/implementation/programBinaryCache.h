@@ -0,0 +1,24 @@
+#pragma once
+
+namespace kr
+{
+  /// \brief Identifies a program binary. Covers the sources of all stages and the driver.
+  using ProgramBinaryKey = ezUInt64;
+
+  /// \brief Computes the key of the program with the given sources for the current driver.
+  /// \note Requires a current GL context.
+  ProgramBinaryKey computeProgramBinaryKey(ezStringView vsSource, ezStringView fsSource);
+
+  /// \brief Whether program binaries are stored and loaded at all.
+  ///
+  /// Requires a cache directory and driver support for at least one binary format.
+  bool isProgramBinaryCacheEnabled();
+
+  /// \brief Creates a program from the cached binary with the given \a key.
+  /// \return 0 if there is no such binary or the driver rejected it.
+  GLuint loadProgramBinary(ProgramBinaryKey key);
+
+  /// \brief Stores the binary of the linked program \a hProgram with the given \a key.
+  /// \pre The program was linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+  void storeProgramBinary(ProgramBinaryKey key, GLuint hProgram);
+}
@@ -1,19 +1,26 @@
 #include <krEngine/rendering/renderer.h>
 #include <krEngine/rendering/extraction.h>
 #include <krEngine/rendering/window.h>
+#include <krEngine/rendering/shader.h>
 
 #include <krEngine/rendering/implementation/windowImpl.h>
 #include <krEngine/rendering/implementation/opelGlCheck.h>
 #include <krEngine/rendering/implementation/extractionBuffer.h>
 #include <krEngine/rendering/implementation/extractionDetails.h>
+#include <krEngine/rendering/implementation/spriteUpdateQueue.h>
+#include <krEngine/rendering/implementation/textureImpl.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
 
 #include <CoreUtils/Graphics/Camera.h>
 
+#include <algorithm>
+
 namespace
 {
   using ExtractionAllocator = ezAllocator<ezMemoryPolicies::ezAlignedHeapAllocation,
                                           ezMemoryTrackingFlags::All>;
 
+  using DrawList = ezDynamicArray<kr::ExtractionData*>;
 }
 
 // Globals
@@ -25,6 +32,9 @@ static kr::ExtractionBuffer* g_pReadBuffer;
 static kr::ExtractionBuffer* g_pWriteBuffer;
 static kr::Renderer::ExtractionEvent g_ExtractionEvent;
 
+static DrawList* g_pOpaqueItems;
+static DrawList* g_pTranslucentItems;
+
 static bool g_isCameraSetForCurrentFrame = false;
 static ezMat4 g_view;
 static ezMat4 g_projection;
@@ -59,6 +69,9 @@ namespace kr
     ezUInt8 m_mem_readBuffer[sizeof(ExtractionBuffer)];
     ezUInt8 m_mem_writeBuffer[sizeof(ExtractionBuffer)];
 
+    ezUInt8 m_mem_opaqueItems[sizeof(DrawList)];
+    ezUInt8 m_mem_translucentItems[sizeof(DrawList)];
+
     ON_CORE_STARTUP
     {
       g_pReadBuffer = new (m_mem_readBuffer) ExtractionBuffer(&m_extractionAllocator);
@@ -67,6 +80,9 @@ namespace kr
       g_pWriteBuffer = new (m_mem_writeBuffer) ExtractionBuffer(&m_extractionAllocator);
       g_pReadBuffer->setMode(ExtractionBuffer::Mode::WriteOnly);
 
+      g_pOpaqueItems = new (m_mem_opaqueItems) DrawList();
+      g_pTranslucentItems = new (m_mem_translucentItems) DrawList();
+
       g_view.SetIdentity();
       g_projection.SetIdentity();
 
@@ -93,6 +109,12 @@ namespace kr
       g_projection.SetIdentity();
       g_view.SetIdentity();
 
+      g_pTranslucentItems->~DrawList();
+      g_pTranslucentItems = nullptr;
+
+      g_pOpaqueItems->~DrawList();
+      g_pOpaqueItems = nullptr;
+
       g_pWriteBuffer->~ExtractionBuffer();
       g_pWriteBuffer = nullptr;
 
@@ -117,34 +139,182 @@ namespace kr
   }
 }
 
-static void renderExtractionData(ezUInt8* current, ezUInt8* max)
+/// \brief Orders items by type first, then by the state they need bound.
+static int compareExtractionState(const kr::ExtractionData& lhs, const kr::ExtractionData& rhs)
 {
   using namespace kr;
 
-  while(current < max)
+  if (lhs.type != rhs.type)
+    return lhs.type < rhs.type ? -1 : 1;
+
+  switch(lhs.type)
   {
-    // Only special `ExtractionData` can be allocated with our buffers.
-    auto data = reinterpret_cast<ExtractionData*>(current);
+  case ExtractionDataType::Sprite:
+    return compareState(static_cast<const SpriteData&>(lhs),
+                        static_cast<const SpriteData&>(rhs));
+  default:
+    EZ_REPORT_FAILURE("Unknown extraction data type.");
+    break;
+  }
+
+  return 0;
+}
+
+/// \brief Opaque items are depth tested, so we are free to reorder them.
+///
+/// Front-most layers come first to reduce overdraw.
+/// Within a layer, items are grouped by state to get long runs,
+/// which are then drawn front-to-back.
+static bool isDrawnBeforeOpaque(const kr::ExtractionData* pLhs, const kr::ExtractionData* pRhs)
+{
+  if (pLhs->order.layer != pRhs->order.layer)
+    return pLhs->order.layer > pRhs->order.layer;
+
+  auto stateOrder = compareExtractionState(*pLhs, *pRhs);
+  if (stateOrder != 0)
+    return stateOrder < 0;
+
+  return pLhs->order.depth < pRhs->order.depth;
+}
+
+/// \brief Translucent items have to be drawn back-to-front within each layer.
+/// \note Used with a stable sort, so equal items keep their extraction order.
+static bool isDrawnBeforeTranslucent(const kr::ExtractionData* pLhs, const kr::ExtractionData* pRhs)
+{
+  if (pLhs->order.layer != pRhs->order.layer)
+    return pLhs->order.layer < pRhs->order.layer;
+
+  return pLhs->order.depth > pRhs->order.depth;
+}
+
+/// \brief Draws the given sorted \a items, binding shared state only once per run.
+static void renderItems(DrawList& items)
+{
+  using namespace kr;
+
+  ezUInt32 runBegin = 0;
+  while (runBegin < items.GetCount())
+  {
+    // Find the end of the run of items that share the same state.
+    auto pFirst = items[runBegin];
+    ezUInt32 runEnd = runBegin + 1;
+    while (runEnd < items.GetCount() && compareExtractionState(*pFirst, *items[runEnd]) == 0)
+    {
+      ++runEnd;
+    }
+
+    auto run = ezArrayPtr<ExtractionData*>(items.GetData() + runBegin, runEnd - runBegin);
 
     // See what type the data is,
     // then call a specialized function that processes the data.
-    switch(data->type)
+    switch(pFirst->type)
     {
     case ExtractionDataType::Sprite:
-    {
-      auto& sprite = *static_cast<SpriteData*>(data);
-      draw(sprite, g_view, g_projection);
-      sprite.~SpriteData();
-    }
+      draw(run, g_view, g_projection);
       break;
     default:
       EZ_REPORT_FAILURE("Unknown extraction data type.");
       break;
     }
 
+    runBegin = runEnd;
+  }
+}
+
+static void renderExtractionData(ezUInt8* begin, ezUInt8* max)
+{
+  using namespace kr;
+
+  auto& opaqueItems = *g_pOpaqueItems;
+  auto& translucentItems = *g_pTranslucentItems;
+  auto& stats = currentFrameStats();
+
+  // Gather and Sort the Data
+  // ========================
+  auto sortStart = ezTime::Now();
+
+  opaqueItems.Clear();
+  translucentItems.Clear();
+
+  for (auto current = begin; current < max;)
+  {
+    // Only special `ExtractionData` can be allocated with our buffers.
+    auto data = reinterpret_cast<ExtractionData*>(current);
+
+    if (data->isTranslucent)
+      translucentItems.PushBack(data);
+    else
+      opaqueItems.PushBack(data);
+
+    ++stats.numExtractedItems;
+    switch(data->type)
+    {
+    case ExtractionDataType::Sprite:
+      ++stats.numExtractedSprites;
+      break;
+    default:
+      break;
+    }
+
     EZ_ASSERT_DEV(current + data->byteCount <= max, "Must never exceed max!");
     current += data->byteCount;
   }
+
+  std::stable_sort(opaqueItems.GetData(),
+                   opaqueItems.GetData() + opaqueItems.GetCount(),
+                   isDrawnBeforeOpaque);
+  std::stable_sort(translucentItems.GetData(),
+                   translucentItems.GetData() + translucentItems.GetCount(),
+                   isDrawnBeforeTranslucent);
+
+  stats.extractionByteCount = static_cast<ezUInt64>(max - begin);
+
+  auto drawStart = ezTime::Now();
+  stats.sortTime = drawStart - sortStart;
+
+  // Opaque Pass
+  // ===========
+  glCheck(glEnable(GL_DEPTH_TEST));
+  glCheck(glDepthFunc(GL_LEQUAL));
+  glCheck(glDepthMask(GL_TRUE));
+  glCheck(glDisable(GL_BLEND));
+
+  renderItems(opaqueItems);
+
+  // Translucent Pass
+  // ================
+  // Still tested against the opaque items, but without writing depth.
+  glCheck(glDepthMask(GL_FALSE));
+  glCheck(glEnable(GL_BLEND));
+  glCheck(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+  renderItems(translucentItems);
+
+  // glClear respects the depth mask, so we have to restore it for the next frame.
+  glCheck(glDepthMask(GL_TRUE));
+
+  stats.drawTime = ezTime::Now() - drawStart;
+
+  // Destroy the Data
+  // ================
+  for (auto current = begin; current < max;)
+  {
+    auto data = reinterpret_cast<ExtractionData*>(current);
+    current += data->byteCount;
+
+    switch(data->type)
+    {
+    case ExtractionDataType::Sprite:
+      static_cast<SpriteData*>(data)->~SpriteData();
+      break;
+    default:
+      EZ_REPORT_FAILURE("Unknown extraction data type.");
+      break;
+    }
+  }
+
+  opaqueItems.Clear();
+  translucentItems.Clear();
 }
 
 static ezResult presentFrame(const kr::WindowImpl& window)
@@ -155,6 +325,8 @@ static ezResult presentFrame(const kr::WindowImpl& window)
 
 void kr::Renderer::extract()
 {
+  auto extractStart = ezTime::Now();
+
   g_isCameraSetForCurrentFrame = false;
 
   // Reset the write buffer's allocation pointer.
@@ -172,6 +344,8 @@ void kr::Renderer::extract()
   {
     ezLog::Warning(g_pLog, "No camera set for current frame.");
   }
+
+  currentFrameStats().extractTime = ezTime::Now() - extractStart;
 }
 
 void kr::Renderer::update(ezTime dt, Borrowed<Window> pTarget)
@@ -187,6 +361,22 @@ void kr::Renderer::update(ezTime dt, Borrowed<Window> pTarget)
   /// \todo This is Windows specific.
   glCheck(wglMakeCurrent(window.m_hDC, window.m_hRC));
 
+  auto& stats = currentFrameStats();
+
+  // Process Pending Updates
+  // =======================
+  auto updateStart = ezTime::Now();
+
+  // Textures go first, so sprites waiting on them can be updated in the same frame.
+  processTextureLoads();
+  updateTextureResidency();
+  processSpriteUpdateQueue();
+
+  // Shader programs are only swapped here, between frames.
+  reloadChangedShaders();
+
+  stats.updateTime = ezTime::Now() - updateStart;
+
   // Clear the Screen
   // ================
   {
@@ -197,8 +387,6 @@ void kr::Renderer::update(ezTime dt, Borrowed<Window> pTarget)
   glCheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
   glCheck(glEnable(GL_MULTISAMPLE));
-  glCheck(glEnable(GL_BLEND));
-  glCheck(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
 
   // Render the Data
   // ===============
@@ -210,11 +398,16 @@ void kr::Renderer::update(ezTime dt, Borrowed<Window> pTarget)
 
   // Swap Buffers
   // ============
+  auto presentStart = ezTime::Now();
 
   if (presentFrame(window).Failed())
   {
     ezLog::Warning(g_pLog, "Failed to present frame.");
   }
+
+  stats.presentTime = ezTime::Now() - presentStart;
+
+  finishFrameStats();
 }
 
 void kr::Renderer::addExtractionListener(ExtractionEventListener listener)
@@ -240,9 +433,13 @@ void kr::extract(Renderer::Extractor& e, const ezCamera& cam, float aspectRatio)
 
 void kr::extract(Renderer::Extractor& e,
                  const Sprite& sprite,
-                 Transform2D transform)
+                 Transform2D transform,
+                 DrawOrder order)
 {
   auto pData = g_pWriteBuffer->allocate<SpriteData>();
+  pData->order = order;
+  pData->isTranslucent = sprite.isTranslucent();
+
   pData->pTexture = sprite.getTexture();
   pData->pVertexBuffer = sprite.getVertexBuffer();
   pData->pShader = sprite.getShader();
@@ -252,9 +449,14 @@ void kr::extract(Renderer::Extractor& e,
   pData->uTexture = sprite.getTextureUniform();
   pData->uOrigin = sprite.getOriginUniform();
   pData->uRotation = sprite.getRotationUniform();
+  pData->uDepth = sprite.getDepthUniform();
   pData->uViewMatrix = sprite.getViewMatrixUniform();
   pData->uProjectionMatrix = sprite.getProjectionMatrixUniform();
 
   pData->transform = move(transform);
   pData->color = sprite.getColor();
+
+  // Needed to draw sprites using a texture array in batches.
+  pData->textureLayer = sprite.getTextureLayer();
+  ezMemoryUtils::Copy(pData->vertices, sprite.getVertices().GetPtr(), 4);
 }
@@ -0,0 +1,241 @@
+#include <krEngine/rendering/renderer.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
+
+#include <algorithm>
+
+namespace
+{
+  /// \brief Ring buffer of the statistics of the last frames.
+  struct StatsHistory
+  {
+    ezDynamicArray<kr::RendererFrameStats> frames;
+    ezUInt32 size = 120;
+
+    /// \brief Where the next finished frame goes, once the history is full.
+    ezUInt32 next = 0;
+  };
+}
+
+static kr::RendererFrameStats g_currentFrame;
+static kr::RendererFrameStats g_lastFrame;
+static StatsHistory* g_pHistory;
+static bool g_initialized = false;
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, RendererStats)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pHistory = new (m_mem_history) StatsHistory();
+    g_currentFrame = kr::RendererFrameStats();
+    g_lastFrame = kr::RendererFrameStats();
+
+    g_initialized = true;
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    g_pHistory->~StatsHistory();
+    g_pHistory = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_history[sizeof(StatsHistory)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+kr::RendererFrameStats& kr::currentFrameStats()
+{
+  return g_currentFrame;
+}
+
+void kr::finishFrameStats()
+{
+  EZ_ASSERT_DEV(g_initialized, "RendererStats subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  g_lastFrame = g_currentFrame;
+  g_currentFrame = RendererFrameStats();
+
+  auto& history = *g_pHistory;
+  if (history.size == 0)
+    return;
+
+  if (history.frames.GetCount() < history.size)
+  {
+    history.frames.PushBack(g_lastFrame);
+    return;
+  }
+
+  history.frames[history.next] = g_lastFrame;
+  history.next = (history.next + 1) % history.size;
+}
+
+// Single Values
+// =============
+
+double kr::getValue(const RendererFrameStats& stats, RendererStat stat)
+{
+  switch (stat)
+  {
+  case RendererStat::DrawCalls:            return stats.numDrawCalls;
+  case RendererStat::Primitives:           return static_cast<double>(stats.numPrimitives);
+  case RendererStat::StateChanges:         return stats.getNumStateChanges();
+  case RendererStat::ShaderChanges:        return stats.numShaderChanges;
+  case RendererStat::TextureChanges:       return stats.numTextureChanges;
+  case RendererStat::SamplerChanges:       return stats.numSamplerChanges;
+  case RendererStat::VertexArrayChanges:   return stats.numVertexArrayChanges;
+  case RendererStat::UniformUploads:       return stats.numUniformUploads;
+  case RendererStat::BufferBytesUploaded:  return static_cast<double>(stats.bufferBytesUploaded);
+  case RendererStat::TextureBytesUploaded: return static_cast<double>(stats.textureBytesUploaded);
+  case RendererStat::ExtractedItems:       return stats.numExtractedItems;
+  case RendererStat::ExtractedSprites:     return stats.numExtractedSprites;
+  case RendererStat::ExtractionByteCount:  return static_cast<double>(stats.extractionByteCount);
+  case RendererStat::ExtractTime:          return stats.extractTime.GetMilliseconds();
+  case RendererStat::UpdateTime:           return stats.updateTime.GetMilliseconds();
+  case RendererStat::SortTime:             return stats.sortTime.GetMilliseconds();
+  case RendererStat::DrawTime:             return stats.drawTime.GetMilliseconds();
+  case RendererStat::PresentTime:          return stats.presentTime.GetMilliseconds();
+  default:
+    EZ_REPORT_FAILURE("Unknown renderer stat.");
+    break;
+  }
+
+  return 0.0;
+}
+
+const char* kr::getName(RendererStat stat)
+{
+  switch (stat)
+  {
+  case RendererStat::DrawCalls:            return "Draw Calls";
+  case RendererStat::Primitives:           return "Primitives";
+  case RendererStat::StateChanges:         return "State Changes";
+  case RendererStat::ShaderChanges:        return "Shader Changes";
+  case RendererStat::TextureChanges:       return "Texture Changes";
+  case RendererStat::SamplerChanges:       return "Sampler Changes";
+  case RendererStat::VertexArrayChanges:   return "Vertex Array Changes";
+  case RendererStat::UniformUploads:       return "Uniform Uploads";
+  case RendererStat::BufferBytesUploaded:  return "Buffer Bytes Uploaded";
+  case RendererStat::TextureBytesUploaded: return "Texture Bytes Uploaded";
+  case RendererStat::ExtractedItems:       return "Extracted Items";
+  case RendererStat::ExtractedSprites:     return "Extracted Sprites";
+  case RendererStat::ExtractionByteCount:  return "Extraction Bytes";
+  case RendererStat::ExtractTime:          return "Extract Time (ms)";
+  case RendererStat::UpdateTime:           return "Update Time (ms)";
+  case RendererStat::SortTime:             return "Sort Time (ms)";
+  case RendererStat::DrawTime:             return "Draw Time (ms)";
+  case RendererStat::PresentTime:          return "Present Time (ms)";
+  default:
+    EZ_REPORT_FAILURE("Unknown renderer stat.");
+    break;
+  }
+
+  return "<Unknown>";
+}
+
+kr::RendererStatSummary kr::summarize(ezArrayPtr<const RendererFrameStats> frames,
+                                      RendererStat stat)
+{
+  RendererStatSummary summary;
+  if (frames.IsEmpty())
+    return summary;
+
+  ezHybridArray<double, 128> values;
+  for (auto& frame : frames)
+  {
+    values.PushBack(getValue(frame, stat));
+  }
+
+  std::sort(values.GetData(), values.GetData() + values.GetCount());
+
+  double sum = 0.0;
+  for (auto value : values)
+  {
+    sum += value;
+  }
+
+  const auto numFrames = values.GetCount();
+  summary.numFrames = numFrames;
+  summary.min = values[0];
+  summary.max = values[numFrames - 1];
+  summary.average = sum / numFrames;
+
+  // Nearest rank, so the result is always one of the actual values.
+  // The rank is ceil(0.99 * numFrames), which is at least 1.
+  const ezUInt32 rank = (99 * numFrames + 99) / 100;
+  summary.percentile99 = values[rank - 1];
+
+  return summary;
+}
+
+// History
+// =======
+
+kr::RendererFrameStats kr::Renderer::getLastFrameStats()
+{
+  return g_lastFrame;
+}
+
+ezUInt32 kr::Renderer::getStatsHistoryCount()
+{
+  return g_pHistory->frames.GetCount();
+}
+
+kr::RendererFrameStats kr::Renderer::getStatsHistory(ezUInt32 age)
+{
+  auto& history = *g_pHistory;
+  const auto count = history.frames.GetCount();
+  EZ_ASSERT_DEV(age < count, "Only %u frames in the history.", count);
+
+  // Until the history is full, `next` stays at 0 and the newest frame is at the back.
+  auto newest = (history.next + count - 1) % count;
+  return history.frames[(newest + count - age) % count];
+}
+
+void kr::Renderer::setStatsHistorySize(ezUInt32 numFrames)
+{
+  g_pHistory->size = numFrames;
+  clearStatsHistory();
+}
+
+ezUInt32 kr::Renderer::getStatsHistorySize()
+{
+  return g_pHistory->size;
+}
+
+void kr::Renderer::clearStatsHistory()
+{
+  g_pHistory->frames.Clear();
+  g_pHistory->next = 0;
+}
+
+kr::RendererStatSummary kr::Renderer::getStatSummary(RendererStat stat)
+{
+  auto& frames = g_pHistory->frames;
+  return summarize(ezArrayPtr<const RendererFrameStats>(frames.GetData(), frames.GetCount()), stat);
+}
+
+void kr::Renderer::logStats()
+{
+  EZ_LOG_BLOCK("Renderer Stats");
+
+  auto& last = g_lastFrame;
+  ezLog::Info("Last frame: %u draw calls, %llu primitives, %u state changes, %u uniform uploads, "
+              "%llu buffer bytes and %llu texture bytes uploaded, %u extracted items",
+              last.numDrawCalls, last.numPrimitives, last.getNumStateChanges(), last.numUniformUploads,
+              last.bufferBytesUploaded, last.textureBytesUploaded, last.numExtractedItems);
+
+  ezLog::Info("Over the last %u frames (min / avg / max / p99):", getStatsHistoryCount());
+  for (ezUInt32 i = 0; i < static_cast<ezUInt32>(RendererStat::Count); ++i)
+  {
+    auto stat = static_cast<RendererStat>(i);
+    auto summary = getStatSummary(stat);
+    ezLog::Info("  %s: %.2f / %.2f / %.2f / %.2f", getName(stat),
+                summary.min, summary.average, summary.max, summary.percentile99);
+  }
+}
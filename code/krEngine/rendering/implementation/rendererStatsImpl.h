@@ -0,0 +1,15 @@
+#pragma once
+#include <krEngine/rendering/rendererStats.h>
+
+namespace kr
+{
+  /// \brief Statistics of the frame that is currently being rendered.
+  ///
+  /// Rendering code increments the counters in place.
+  /// \note Only accessed from the thread that owns the GL context.
+  RendererFrameStats& currentFrameStats();
+
+  /// \brief Moves the current frame statistics into the history and starts a new frame.
+  /// \note Called once per frame by Renderer::update().
+  void finishFrameStats();
+}
@@ -0,0 +1,153 @@
+#include <krEngine/rendering/samplerCache.h>
+
+#include <Foundation/Containers/HashTable.h>
+#include <Foundation/Algorithm/Hashing.h>
+
+#include <cstring>
+
+namespace
+{
+  struct CacheEntry
+  {
+    kr::Owned<kr::Sampler> pSampler;
+  };
+
+  /// \brief States with the same hash share a bucket.
+  using Bucket = ezHybridArray<CacheEntry*, 1>;
+
+  struct SamplerCacheData
+  {
+    ezHashTable<ezUInt32, Bucket> buckets;
+    ezUInt32 numEntries = 0;
+  };
+}
+
+static SamplerCacheData* g_pCache;
+static bool g_initialized = false;
+
+static void clearCache(SamplerCacheData& cache)
+{
+  for (auto it = cache.buckets.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      if (pEntry->pSampler.data.refCount != 0)
+      {
+        // The borrowers point into the entry, so we cannot free it.
+        ezLog::Error("Shared sampler is still borrowed %u times. Leaking it.",
+                     static_cast<ezUInt32>(pEntry->pSampler.data.refCount));
+        continue;
+      }
+
+      EZ_DEFAULT_DELETE(pEntry);
+    }
+  }
+
+  cache.buckets.Clear();
+  cache.numEntries = 0;
+}
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, SamplerCache)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core",
+    "Textures"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pCache = new (m_mem_cache) SamplerCacheData();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // Samplers belong to the GL context,
+    // which is usually gone by the time the core shuts down.
+    clearCache(*g_pCache);
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    clearCache(*g_pCache);
+
+    g_pCache->~SamplerCacheData();
+    g_pCache = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_cache[sizeof(SamplerCacheData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+static ezUInt32 bitsOf(float value)
+{
+  ezUInt32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/// \pre \a desc is normalized, so equal floats have equal bits.
+static ezUInt32 hashDesc(const kr::SamplerDesc& desc)
+{
+  // Hash the members one by one, so padding never contributes.
+  const ezUInt32 values[] =
+  {
+    static_cast<ezUInt32>(desc.filtering),
+    static_cast<ezUInt32>(desc.wrapping),
+    bitsOf(desc.maxAnisotropy),
+    bitsOf(desc.lodBias),
+  };
+
+  return ezHashing::MurmurHash(values, sizeof(values));
+}
+
+kr::Borrowed<const kr::Sampler> kr::SamplerCache::get(const SamplerDesc& requestedDesc)
+{
+  EZ_ASSERT_DEV(g_initialized, "SamplerCache subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  // Samplers store the normalized state, so that's what we look up.
+  const auto desc = normalized(requestedDesc);
+
+  auto& cache = *g_pCache;
+  auto hash = hashDesc(desc);
+
+  // Look Up
+  // =======
+  Bucket* pBucket = nullptr;
+  if (cache.buckets.TryGetValue(hash, pBucket))
+  {
+    for (auto pEntry : *pBucket)
+    {
+      if (pEntry->pSampler->getDesc() == desc)
+        return borrow(static_cast<const Owned<Sampler>&>(pEntry->pSampler));
+    }
+  }
+
+  // Create
+  // ======
+  auto pSampler = Sampler::create(desc);
+  if (pSampler == nullptr)
+    return nullptr;
+
+  auto pEntry = EZ_DEFAULT_NEW(CacheEntry);
+  pEntry->pSampler = move(pSampler);
+
+  if (pBucket == nullptr)
+  {
+    cache.buckets.Insert(hash, Bucket());
+    cache.buckets.TryGetValue(hash, pBucket);
+  }
+  pBucket->PushBack(pEntry);
+  ++cache.numEntries;
+
+  return borrow(static_cast<const Owned<Sampler>&>(pEntry->pSampler));
+}
+
+ezUInt32 kr::SamplerCache::getCount()
+{
+  return g_pCache->numEntries;
+}
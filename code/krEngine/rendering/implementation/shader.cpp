@@ -1,5 +1,11 @@
 #include <krEngine/rendering/shader.h>
+#include <krEngine/rendering/implementation/shaderImpl.h>
 #include <krEngine/rendering/implementation/opelGlCheck.h>
+#include <krEngine/rendering/implementation/programBinaryCache.h>
+#include <krEngine/rendering/implementation/shaderReload.h>
+#include <krEngine/rendering/implementation/shaderVariantCacheImpl.h>
+#include <krEngine/rendering/implementation/vertexArrayCacheImpl.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
 
 #include <Foundation/IO/FileSystem/FileReader.h>
 
@@ -61,29 +67,36 @@ static void logCompileStatus(GLuint hShader)
   ezLog::Warning("%s", log.GetData());
 }
 
-static GLuint loadAndCompileShader(GLuint type, ezStringView fileName)
+ezResult kr::readShaderSource(ezStringView fileName,
+                              const ShaderDefines& defines,
+                              ezStringBuilder& out_code,
+                              ShaderSourceFiles* out_pFiles)
 {
-  ezStringBuilder sbFileName(fileName);
-
-  EZ_LOG_BLOCK("Loading and Compiling Shader From File", sbFileName);
-
-  // Read file content
-  // =================
+  ezDynamicArray<ezString> files;
+  if (preprocessShader(fileName, defines, out_code, &files).Failed())
+    return EZ_FAILURE;
 
-  ezStringBuilder code;
+  if (out_pFiles)
   {
-    ezFileReader reader;
-    if(reader.Open(sbFileName).Failed())
-      return 0;
-
-    code.ReadAll(reader);
+    for (auto& file : files)
+    {
+      if (!out_pFiles->Contains(file))
+        out_pFiles->PushBack(file);
+    }
   }
 
+  return EZ_SUCCESS;
+}
+
+GLuint kr::beginCompileShader(GLenum type, ezStringView sourceCode)
+{
+  ezStringBuilder code(sourceCode);
+
   // Create shader and set the source
   // ================================
 
   const GLchar* source = code.GetData();
-  GLint sourceLength = code.GetCharacterCount();
+  GLint sourceLength = code.GetElementCount();
 
   auto hShader = glCreateShader(type);
   glCheckLastError();
@@ -94,13 +107,22 @@ static GLuint loadAndCompileShader(GLuint type, ezStringView fileName)
 
   glCheck(glCompileShader(hShader));
 
+  return hShader;
+}
+
+ezResult kr::finishCompileShader(GLuint hShader, ezStringView resourceId)
+{
+  ezStringBuilder sbResourceId(resourceId);
+
+  EZ_LOG_BLOCK("Compiling Shader", sbResourceId);
+
   // Get the compilation status.
   GLint status;
   glCheck(glGetShaderiv(hShader, GL_COMPILE_STATUS, &status));
 
-  // If the compilation was a success, return the handle.
+  // If the compilation was a success, we are done.
   if (status == GL_TRUE)
-    return hShader;
+    return EZ_SUCCESS;
 
   // Shader Compilation Was Not Successful
   // =====================================
@@ -111,12 +133,31 @@ static GLuint loadAndCompileShader(GLuint type, ezStringView fileName)
   // Release the shader.
   glCheck(glDeleteShader(hShader));
 
-  return 0;
+  return EZ_FAILURE;
+}
+
+static GLuint compileShader(GLenum type, ezStringView sourceCode, ezStringView resourceId)
+{
+  auto hShader = kr::beginCompileShader(type, sourceCode);
+  if (kr::finishCompileShader(hShader, resourceId).Failed())
+    return 0;
+
+  return hShader;
+}
+
+kr::Owned<kr::VertexShader> kr::VertexShader::loadAndCompile(ezStringView fileName,
+                                                            const ShaderDefines& defines)
+{
+  ezStringBuilder code;
+  if (readShaderSource(fileName, defines, code).Failed())
+    return nullptr;
+
+  return compile(code, fileName);
 }
 
-kr::Owned<kr::VertexShader> kr::VertexShader::loadAndCompile(ezStringView fileName)
+kr::Owned<kr::VertexShader> kr::VertexShader::compile(ezStringView source, ezStringView resourceId)
 {
-  auto handle = loadAndCompileShader(GL_VERTEX_SHADER, fileName);
+  auto handle = compileShader(GL_VERTEX_SHADER, source, resourceId);
 
   if (glIsShader(handle) != GL_TRUE)
   {
@@ -125,7 +166,7 @@ kr::Owned<kr::VertexShader> kr::VertexShader::loadAndCompile(ezStringView fileNa
 
   VertexShader* vs = EZ_DEFAULT_NEW(VertexShader);
   vs->m_glHandle = handle;
-  vs->m_resourceId = fileName;
+  vs->m_resourceId = resourceId;
 
   return own(vs, [](VertexShader* vs) { EZ_DEFAULT_DELETE(vs); });
 }
@@ -136,9 +177,19 @@ kr::VertexShader::~VertexShader()
   m_glHandle = 0;
 }
 
-kr::Owned<kr::FragmentShader> kr::FragmentShader::loadAndCompile(ezStringView fileName)
+kr::Owned<kr::FragmentShader> kr::FragmentShader::loadAndCompile(ezStringView fileName,
+                                                                const ShaderDefines& defines)
 {
-  auto handle = loadAndCompileShader(GL_FRAGMENT_SHADER, fileName);
+  ezStringBuilder code;
+  if (readShaderSource(fileName, defines, code).Failed())
+    return nullptr;
+
+  return compile(code, fileName);
+}
+
+kr::Owned<kr::FragmentShader> kr::FragmentShader::compile(ezStringView source, ezStringView resourceId)
+{
+  auto handle = compileShader(GL_FRAGMENT_SHADER, source, resourceId);
 
   if (glIsShader(handle) != GL_TRUE)
   {
@@ -148,7 +199,7 @@ kr::Owned<kr::FragmentShader> kr::FragmentShader::loadAndCompile(ezStringView fi
 
   FragmentShader* fs = EZ_DEFAULT_NEW(FragmentShader);
   fs->m_glHandle = handle;
-  fs->m_resourceId = fileName;
+  fs->m_resourceId = resourceId;
 
   return own(fs, [](FragmentShader* fs) { EZ_DEFAULT_DELETE(fs); });
 }
@@ -159,43 +210,36 @@ kr::FragmentShader::~FragmentShader()
   m_glHandle = 0;
 }
 
-kr::Owned<kr::ShaderProgram> kr::ShaderProgram::link(Borrowed<VertexShader> vs,
-                                                     Borrowed<FragmentShader> fs)
+GLuint kr::beginLinkProgram(GLuint hVS, GLuint hFS, bool retrievable)
 {
-  if (vs == nullptr)
-  {
-    EZ_REPORT_FAILURE("Invalid vertex shader pointer.");
-    return nullptr;
-  }
+  auto hProgram = glCreateProgram();
 
-  if (fs == nullptr)
+  if (retrievable)
   {
-    EZ_REPORT_FAILURE("Invalid fragment shader pointer.");
-    return nullptr;
+    glCheck(glProgramParameteri(hProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
   }
 
-  auto hProgram = glCreateProgram();
-
-  glCheck(glAttachShader(hProgram, vs->m_glHandle));
-  glCheck(glAttachShader(hProgram, fs->m_glHandle));
+  glCheck(glAttachShader(hProgram, hVS));
+  glCheck(glAttachShader(hProgram, hFS));
 
   // Link the program
   // ================
 
   glCheck(glLinkProgram(hProgram));
 
+  return hProgram;
+}
+
+ezResult kr::finishLinkProgram(GLuint hProgram)
+{
   // Get the link status
   // ===================
 
   GLint status;
   glCheck(glGetProgramiv(hProgram, GL_LINK_STATUS, &status));
-  // If linking succeeded, return success.
+  // If linking succeeded, we are done.
   if (status == GL_TRUE)
-  {
-    ShaderProgram* pProgram = EZ_DEFAULT_NEW(ShaderProgram);
-    pProgram->m_glHandle = hProgram;
-    return own(pProgram, [](ShaderProgram* p){ EZ_DEFAULT_DELETE(p); });
-  }
+    return EZ_SUCCESS;
 
   // Get log message length
   // ======================
@@ -222,16 +266,374 @@ kr::Owned<kr::ShaderProgram> kr::ShaderProgram::link(Borrowed<VertexShader> vs,
 
   glCheck(glDeleteProgram(hProgram));
 
+  return EZ_FAILURE;
+}
+
+/// \return 0 if linking failed.
+static GLuint linkProgram(GLuint hVS, GLuint hFS, bool retrievable)
+{
+  auto hProgram = kr::beginLinkProgram(hVS, hFS, retrievable);
+  if (kr::finishLinkProgram(hProgram).Failed())
+    return 0;
+
+  return hProgram;
+}
+
+// Reflection
+// ==========
+
+static void stripArraySuffix(ezStringBuilder& name)
+{
+  if (name.EndsWith("[0]"))
+  {
+    name.Shrink(0, 3);
+  }
+}
+
+/// \brief Index of the uniform with the given \a name in \a program, or ezInvalidIndex.
+///
+/// Uniforms whose hash collides with an earlier uniform are not in the hash table.
+static ezUInt32 findUniformIndex(const kr::ShaderProgram& program, ezUInt32 hash, const char* name)
+{
+  ezUInt32 index = ezInvalidIndex;
+  if (!program.m_uniformIndices.TryGetValue(hash, index))
+    return ezInvalidIndex;
+
+  if (program.m_uniforms[index].name == name)
+    return index;
+
+  for (ezUInt32 i = 0; i < program.m_uniforms.GetCount(); ++i)
+  {
+    auto& uniform = program.m_uniforms[i];
+    if (uniform.nameHash == hash && uniform.name == name)
+      return i;
+  }
+
+  return ezInvalidIndex;
+}
+
+/// \brief Updates the reflection tables of \a program from its current GL program.
+///
+/// Known uniforms keep their index, uniforms that are no longer active get location -1.
+static void reflect(kr::ShaderProgram& program)
+{
+  using namespace kr;
+
+  auto hProgram = program.m_glHandle;
+
+  GLint maxNameLength = 0;
+  glCheck(glGetProgramiv(hProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength));
+  GLint maxBlockNameLength = 0;
+  glCheck(glGetProgramiv(hProgram, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength));
+  GLint maxAttributeNameLength = 0;
+  glCheck(glGetProgramiv(hProgram, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxAttributeNameLength));
+
+  ezHybridArray<GLchar, 64> buffer;
+  buffer.SetCountUninitialized(ezMath::Max(ezMath::Max(maxNameLength, maxBlockNameLength),
+                                           ezMath::Max(maxAttributeNameLength, 1)));
+
+  // Uniforms
+  // ========
+  for (auto& uniform : program.m_uniforms)
+  {
+    uniform.glLocation = -1;
+  }
+
+  GLint numUniforms = 0;
+  glCheck(glGetProgramiv(hProgram, GL_ACTIVE_UNIFORMS, &numUniforms));
+
+  ezStringBuilder name;
+  for (GLint i = 0; i < numUniforms; ++i)
+  {
+    GLint arraySize = 0;
+    GLenum glType = 0;
+    glCheck(glGetActiveUniform(hProgram, i, buffer.GetCount(), nullptr, &arraySize, &glType, buffer.GetData()));
+
+    name = buffer.GetData();
+    stripArraySuffix(name);
+
+    // Members of uniform blocks have no location.
+    auto location = glGetUniformLocation(hProgram, name);
+    glCheckLastError();
+    if (location == -1)
+      continue;
+
+    auto hash = hashShaderName(name);
+
+    ezUInt32 index = findUniformIndex(program, hash, name);
+    if (index == ezInvalidIndex)
+    {
+      index = program.m_uniforms.GetCount();
+      program.m_uniforms.ExpandAndGetRef();
+
+      // The table keeps the first uniform of a hash, the others are found by findUniformIndex().
+      ezUInt32 collidingIndex = ezInvalidIndex;
+      if (program.m_uniformIndices.TryGetValue(hash, collidingIndex))
+      {
+        ezLog::Warning("Uniforms '%s' and '%s' have the same hash. Looking up the latter is slow.",
+                       program.m_uniforms[collidingIndex].name.GetData(), name.GetData());
+      }
+      else
+      {
+        program.m_uniformIndices.Insert(hash, index);
+      }
+    }
+
+    auto& uniform = program.m_uniforms[index];
+    uniform.name = name;
+    uniform.nameHash = hash;
+    uniform.glType = glType;
+    uniform.arraySize = arraySize;
+    uniform.glLocation = location;
+  }
+
+  // Uniform Blocks
+  // ==============
+  program.m_uniformBlocks.Clear();
+
+  GLint numBlocks = 0;
+  glCheck(glGetProgramiv(hProgram, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks));
+
+  for (GLint i = 0; i < numBlocks; ++i)
+  {
+    glCheck(glGetActiveUniformBlockName(hProgram, i, buffer.GetCount(), nullptr, buffer.GetData()));
+
+    auto& block = program.m_uniformBlocks.ExpandAndGetRef();
+    block.name = buffer.GetData();
+    block.nameHash = hashShaderName(block.name);
+    block.glIndex = i;
+    glCheck(glGetActiveUniformBlockiv(hProgram, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.byteCount));
+  }
+
+  // Vertex Attributes
+  // =================
+  // Vertex layouts are set up per program, so nothing refers to these by index.
+  program.m_attributes.Clear();
+
+  GLint numAttributes = 0;
+  glCheck(glGetProgramiv(hProgram, GL_ACTIVE_ATTRIBUTES, &numAttributes));
+
+  for (GLint i = 0; i < numAttributes; ++i)
+  {
+    GLint arraySize = 0;
+    GLenum glType = 0;
+    glCheck(glGetActiveAttrib(hProgram, i, buffer.GetCount(), nullptr, &arraySize, &glType, buffer.GetData()));
+
+    name = buffer.GetData();
+    stripArraySuffix(name);
+
+    // Built-in inputs, such as gl_VertexID, have no location.
+    auto location = glGetAttribLocation(hProgram, name);
+    glCheckLastError();
+    if (location == -1)
+      continue;
+
+    auto& attribute = program.m_attributes.ExpandAndGetRef();
+    attribute.name = name;
+    attribute.nameHash = hashShaderName(name);
+    attribute.glType = glType;
+    attribute.arraySize = arraySize;
+    attribute.glLocation = location;
+  }
+}
+
+ezUInt32 kr::ShaderProgram::findUniform(const ShaderUniformName& name) const
+{
+  return findUniformIndex(*this, name.hash, name.name);
+}
+
+const kr::ShaderProgram::Attribute* kr::ShaderProgram::findAttribute(const ShaderUniformName& name) const
+{
+  for (auto& attribute : m_attributes)
+  {
+    if (attribute.nameHash == name.hash && attribute.name == name.name)
+      return &attribute;
+  }
+
   return nullptr;
 }
 
+const kr::ShaderProgram::UniformBlock* kr::ShaderProgram::findUniformBlock(const ShaderUniformName& name) const
+{
+  for (auto& block : m_uniformBlocks)
+  {
+    if (block.nameHash == name.hash && block.name == name.name)
+      return &block;
+  }
+
+  return nullptr;
+}
+
+kr::Owned<kr::ShaderProgram> kr::ShaderProgram::link(Borrowed<VertexShader> vs,
+                                                     Borrowed<FragmentShader> fs)
+{
+  if (vs == nullptr)
+  {
+    EZ_REPORT_FAILURE("Invalid vertex shader pointer.");
+    return nullptr;
+  }
+
+  if (fs == nullptr)
+  {
+    EZ_REPORT_FAILURE("Invalid fragment shader pointer.");
+    return nullptr;
+  }
+
+  auto hProgram = linkProgram(vs->m_glHandle, fs->m_glHandle, false);
+  if (hProgram == 0)
+    return nullptr;
+
+  return adopt(hProgram, "", "", ShaderDefines(), ShaderSourceFiles());
+}
+
+kr::Owned<kr::ShaderProgram> kr::ShaderProgram::adopt(GLuint hProgram,
+                                                      ezStringView vsFileName,
+                                                      ezStringView fsFileName,
+                                                      const ShaderDefines& defines,
+                                                      const ezHybridArray<ezString, 4>& sourceFiles)
+{
+  ShaderProgram* pProgram = EZ_DEFAULT_NEW(ShaderProgram);
+  pProgram->m_glHandle = hProgram;
+  pProgram->m_vsResourceId = vsFileName;
+  pProgram->m_fsResourceId = fsFileName;
+  pProgram->m_defines = defines;
+  pProgram->m_sourceFiles = sourceFiles;
+  reflect(*pProgram);
+
+  if (pProgram->isReloadable() && isShaderHotReloadEnabled())
+  {
+    watchShaderProgram(pProgram);
+  }
+
+  return own(pProgram, [](ShaderProgram* p){ EZ_DEFAULT_DELETE(p); });
+}
+
+/// \brief Compiles and links the given sources, storing the result in the program binary cache.
+/// \return 0 on failure.
+static GLuint compileAndLink(const ezStringBuilder& vsCode, ezStringView vsFileName,
+                             const ezStringBuilder& fsCode, ezStringView fsFileName)
+{
+  using namespace kr;
+
+  auto vs = VertexShader::compile(vsCode, vsFileName);
+  auto fs = FragmentShader::compile(fsCode, fsFileName);
+  if (vs == nullptr || fs == nullptr)
+    return 0;
+
+  const bool useCache = isProgramBinaryCacheEnabled();
+
+  auto hProgram = linkProgram(vs->m_glHandle, fs->m_glHandle, useCache);
+  if (hProgram != 0 && useCache)
+  {
+    storeProgramBinary(computeProgramBinaryKey(vsCode, fsCode), hProgram);
+  }
+
+  return hProgram;
+}
+
+kr::Owned<kr::ShaderProgram> kr::ShaderProgram::loadAndLink(ezStringView vsFileName,
+                                                            ezStringView fsFileName,
+                                                            const ShaderDefines& defines)
+{
+  // Read the Sources
+  // ================
+  // The binary cache key covers the defines and includes, since it hashes the preprocessed sources.
+  ezStringBuilder vsCode;
+  ezStringBuilder fsCode;
+  ShaderSourceFiles sourceFiles;
+  if (readShaderSource(vsFileName, defines, vsCode, &sourceFiles).Failed() ||
+      readShaderSource(fsFileName, defines, fsCode, &sourceFiles).Failed())
+  {
+    return nullptr;
+  }
+
+  return linkPreprocessed(vsFileName, fsFileName, defines, vsCode, fsCode, sourceFiles);
+}
+
+kr::Owned<kr::ShaderProgram> kr::ShaderProgram::linkPreprocessed(ezStringView vsFileName,
+                                                                 ezStringView fsFileName,
+                                                                 const ShaderDefines& defines,
+                                                                 const ezStringBuilder& vsCode,
+                                                                 const ezStringBuilder& fsCode,
+                                                                 const ezHybridArray<ezString, 4>& sourceFiles)
+{
+  // Try the Cache, Then Compile and Link
+  // ====================================
+  GLuint hProgram = 0;
+  if (isProgramBinaryCacheEnabled())
+  {
+    hProgram = loadProgramBinary(computeProgramBinaryKey(vsCode, fsCode));
+  }
+
+  if (hProgram == 0)
+  {
+    hProgram = compileAndLink(vsCode, vsFileName, fsCode, fsFileName);
+    if (hProgram == 0)
+      return nullptr;
+  }
+
+  return adopt(hProgram, vsFileName, fsFileName, defines, sourceFiles);
+}
+
 kr::ShaderProgram::~ShaderProgram()
 {
+  if (isReloadable())
+  {
+    unwatchShaderProgram(this);
+  }
+
+  forgetVertexArraysOf(m_glHandle);
   glCheck(glDeleteProgram(m_glHandle));
   m_glHandle = 0;
 }
 
-kr::ShaderUniform kr::shaderUniformOf(Borrowed<ShaderProgram> pShader, ezStringView uniformName)
+ezResult kr::ShaderProgram::reload()
+{
+  if (!isReloadable())
+  {
+    ezLog::Warning("Only shader programs created by loadAndLink can be reloaded.");
+    return EZ_FAILURE;
+  }
+
+  ezStringBuilder vsCode;
+  ezStringBuilder fsCode;
+  ShaderSourceFiles sourceFiles;
+  if (readShaderSource(m_vsResourceId, m_defines, vsCode, &sourceFiles).Failed() ||
+      readShaderSource(m_fsResourceId, m_defines, fsCode, &sourceFiles).Failed())
+  {
+    return EZ_FAILURE;
+  }
+
+  // Keep the old program until the new one is known to work.
+  auto hProgram = compileAndLink(vsCode, m_vsResourceId, fsCode, m_fsResourceId);
+  if (hProgram == 0)
+    return EZ_FAILURE;
+
+  // The attribute locations may have changed.
+  forgetVertexArraysOf(m_glHandle);
+  glCheck(glDeleteProgram(m_glHandle));
+  m_glHandle = hProgram;
+
+  // The includes may have changed.
+  if (sourceFiles != m_sourceFiles)
+  {
+    m_sourceFiles = sourceFiles;
+
+    if (isShaderHotReloadEnabled())
+    {
+      watchShaderProgram(this);
+    }
+  }
+
+  reflect(*this);
+
+  // Variants sharing this program may no longer match its sources.
+  updateShaderVariantsOf(this);
+
+  return EZ_SUCCESS;
+}
+
+kr::ShaderUniform kr::shaderUniformOf(Borrowed<ShaderProgram> pShader, const ShaderUniformName& uniformName)
 {
   EZ_ASSERT_DEV(pShader != nullptr, "Invalid shader program.");
   if(pShader == nullptr)
@@ -240,20 +642,17 @@ kr::ShaderUniform kr::shaderUniformOf(Borrowed<ShaderProgram> pShader, ezStringV
     return ShaderUniform();
   }
 
-  ezStringBuilder sbUniformName(uniformName);
-  auto location = glGetUniformLocation(pShader->m_glHandle, sbUniformName);
-  glCheckLastError();
-
-  if (location == -1)
+  auto index = pShader->findUniform(uniformName);
+  if (index == ezInvalidIndex || pShader->m_uniforms[index].glLocation == -1)
   {
-    ezLog::Warning("Cannot find uniform location for name '%s'.", sbUniformName);
+    ezLog::Warning("Cannot find uniform location for name '%s'.", uniformName.name);
     return ShaderUniform();
   }
 
   // Success
   // =======
   ShaderUniform u;
-  u.glLocation = location;
+  u.index = index;
   u.pShader = pShader;
   return u;
 }
@@ -270,6 +669,7 @@ ezResult kr::bind(Borrowed<const ShaderProgram> pShader)
 
   // Set the active shader program.
   glCheck(glUseProgram(handle));
+  ++currentFrameStats().numShaderChanges;
 
   // Save the shader program.
   g_pShaderBindings->ExpandAndGetRef() = move(pShader);
@@ -287,6 +687,7 @@ ezResult kr::restoreLastShaderProgram()
 
   // Drop the current binding.
   g_pShaderBindings->PopBack();
+  ++currentFrameStats().numShaderChanges;
 
   if(g_pShaderBindings->IsEmpty())
   {
@@ -303,84 +704,150 @@ ezResult kr::restoreLastShaderProgram()
   return EZ_SUCCESS;
 }
 
-static bool checkUniformUploadPreconditions(const kr::ShaderUniform& uniform)
+using TypeCheck = bool(*)(GLenum glType);
+
+template<GLenum ExpectedType>
+static bool isType(GLenum glType)
+{
+  return glType == ExpectedType;
+}
+
+static bool isTextureSlotType(GLenum glType)
+{
+  switch(glType)
+  {
+  case GL_INT:
+  case GL_SAMPLER_1D:
+  case GL_SAMPLER_2D:
+  case GL_SAMPLER_3D:
+  case GL_SAMPLER_CUBE:
+  case GL_SAMPLER_2D_SHADOW:
+  case GL_SAMPLER_1D_ARRAY:
+  case GL_SAMPLER_2D_ARRAY:
+  case GL_SAMPLER_CUBE_MAP_ARRAY:
+  case GL_SAMPLER_2D_MULTISAMPLE:
+  case GL_INT_SAMPLER_2D:
+  case GL_UNSIGNED_INT_SAMPLER_2D:
+    return true;
+  default:
+    break;
+  }
+
+  return false;
+}
+
+static bool checkUniformUploadPreconditions(const kr::ShaderUniform& uniform, TypeCheck isCompatibleType)
 {
   if (uniform.pShader == nullptr)
   {
     ezLog::Warning("Invalid shader object.");
     return false;
   }
-  if (uniform.glLocation == -1)
+  if (uniform.getGlLocation() == -1)
   {
     ezLog::Warning("Invalid uniform location.");
     return false;
   }
 
+#if EZ_ENABLED(EZ_COMPILE_FOR_DEVELOPMENT)
+  // The driver would reject the upload anyway, but without telling us which uniform it was.
+  auto& reflected = uniform.pShader->m_uniforms[uniform.index];
+  if (!isCompatibleType(reflected.glType))
+  {
+    ezLog::Warning("Uniform '%s' has the incompatible type 0x%x.",
+                   reflected.name.GetData(), reflected.glType);
+    return false;
+  }
+#endif
+
   return true;
 }
 
-#define PRECONDITIONS_FOR_UPLOAD(uniform, type)  \
-  EZ_LOG_BLOCK("Uploading Uniform Value", type); \
-  if(!checkUniformUploadPreconditions(uniform)) return EZ_FAILURE;
+#define PRECONDITIONS_FOR_UPLOAD(uniform, type, isCompatibleType) \
+  EZ_LOG_BLOCK("Uploading Uniform Value", type);                  \
+  if(!checkUniformUploadPreconditions(uniform, isCompatibleType)) return EZ_FAILURE;
 
 
 ezResult kr::uploadData(const ShaderUniform& uniform,
                         ezColor value)
 {
-  PRECONDITIONS_FOR_UPLOAD(uniform, "Color");
+  PRECONDITIONS_FOR_UPLOAD(uniform, "Color", isType<GL_FLOAT_VEC4>);
 
   glCheck(glProgramUniform4fv(uniform.pShader->getGlHandle(),
-                              uniform.glLocation,
+                              uniform.getGlLocation(),
                               1, value.GetData()));
 
+  ++currentFrameStats().numUniformUploads;
+
   return EZ_SUCCESS;
 }
 
 ezResult kr::uploadData(const ShaderUniform& uniform,
                         TextureSlot slot)
 {
-  PRECONDITIONS_FOR_UPLOAD(uniform, "Texture");
+  PRECONDITIONS_FOR_UPLOAD(uniform, "Texture", isTextureSlotType);
 
   glCheck(glProgramUniform1i(uniform.pShader->getGlHandle(),
-                             uniform.glLocation,
+                             uniform.getGlLocation(),
                              slot.value));
 
+  ++currentFrameStats().numUniformUploads;
+
   return EZ_SUCCESS;
 }
 
 ezResult kr::uploadData(const ShaderUniform& uniform, const ezMat4& matrix)
 {
-  PRECONDITIONS_FOR_UPLOAD(uniform, "Matrix4x4");
+  PRECONDITIONS_FOR_UPLOAD(uniform, "Matrix4x4", isType<GL_FLOAT_MAT4>);
 
   glCheck(glProgramUniformMatrix4fv(uniform.pShader->getGlHandle(), // Shader program handle.
-                                    uniform.glLocation,             // Uniform location.
+                                    uniform.getGlLocation(),        // Uniform location.
                                     1,                              // Number of matrices.
                                     GL_FALSE,                       // Transpose?
                                     matrix.m_fElementsCM));         // Matrix data.
 
+  ++currentFrameStats().numUniformUploads;
+
   return EZ_SUCCESS;
 }
 
 ezResult kr::uploadData(const ShaderUniform& uniform, const ezVec2& vec)
 {
-  PRECONDITIONS_FOR_UPLOAD(uniform, "Vec2");
+  PRECONDITIONS_FOR_UPLOAD(uniform, "Vec2", isType<GL_FLOAT_VEC2>);
 
   glCheck(glProgramUniform2fv(uniform.pShader->getGlHandle(), // Shader program handle.
-                              uniform.glLocation,             // Uniform location.
+                              uniform.getGlLocation(),        // Uniform location.
                               1,                              // Number of vectors.
                               vec.GetData()));                // Vector data.
 
+  ++currentFrameStats().numUniformUploads;
+
   return EZ_SUCCESS;
 }
 
 ezResult kr::uploadData(const ShaderUniform& uniform, const ezAngle& angle)
 {
-  PRECONDITIONS_FOR_UPLOAD(uniform, "Angle");
+  PRECONDITIONS_FOR_UPLOAD(uniform, "Angle", isType<GL_FLOAT>);
 
   glCheck(glProgramUniform1f(uniform.pShader->getGlHandle(), // Shader program handle.
-                             uniform.glLocation,             // Uniform location.
+                             uniform.getGlLocation(),        // Uniform location.
                              angle.GetRadian()));            // Matrix data.
 
+  ++currentFrameStats().numUniformUploads;
+
+  return EZ_SUCCESS;
+}
+
+ezResult kr::uploadData(const ShaderUniform& uniform, float value)
+{
+  PRECONDITIONS_FOR_UPLOAD(uniform, "Float", isType<GL_FLOAT>);
+
+  glCheck(glProgramUniform1f(uniform.pShader->getGlHandle(), // Shader program handle.
+                             uniform.getGlLocation(),        // Uniform location.
+                             value));                        // The value.
+
+  ++currentFrameStats().numUniformUploads;
+
   return EZ_SUCCESS;
 }
 
@@ -0,0 +1,234 @@
+#include <krEngine/rendering/shaderBatch.h>
+#include <krEngine/rendering/implementation/shaderImpl.h>
+#include <krEngine/rendering/implementation/programBinaryCache.h>
+#include <krEngine/rendering/implementation/opelGlCheck.h>
+
+// Our GLEW version does not know KHR_parallel_shader_compile yet.
+// The ARB version of the extension uses the same value.
+#define KR_GL_COMPLETION_STATUS 0x91B1
+
+static bool g_isParallelCompileEnabled = false;
+
+void kr::setParallelShaderCompileEnabled(bool isEnabled)
+{
+  g_isParallelCompileEnabled = isEnabled;
+}
+
+bool kr::isParallelShaderCompileEnabled()
+{
+  return g_isParallelCompileEnabled;
+}
+
+static bool isCompleted(GLuint hProgram)
+{
+  GLint completed = GL_TRUE;
+  glCheck(glGetProgramiv(hProgram, KR_GL_COMPLETION_STATUS, &completed));
+  return completed == GL_TRUE;
+}
+
+kr::ShaderBatch::ShaderBatch()
+{
+  m_isParallel = isParallelShaderCompileEnabled();
+}
+
+kr::ShaderBatch::~ShaderBatch()
+{
+  for (auto pEntry : m_entries)
+  {
+    // Deleting is fine even if the driver is still working on them.
+    if (pEntry->hVS != 0)
+      glCheck(glDeleteShader(pEntry->hVS));
+    if (pEntry->hFS != 0)
+      glCheck(glDeleteShader(pEntry->hFS));
+    if (pEntry->hProgram != 0)
+      glCheck(glDeleteProgram(pEntry->hProgram));
+
+    EZ_DEFAULT_DELETE(pEntry);
+  }
+}
+
+ezUInt32 kr::ShaderBatch::add(ezStringView vsFileName,
+                              ezStringView fsFileName,
+                              const ShaderDefines& defines)
+{
+  EZ_ASSERT_DEV(!m_isSubmitted, "Cannot add to a batch that was already submitted.");
+
+  auto pEntry = EZ_DEFAULT_NEW(Entry);
+  pEntry->vsFileName = vsFileName;
+  pEntry->fsFileName = fsFileName;
+  pEntry->defines = defines;
+
+  if (readShaderSource(vsFileName, defines, pEntry->vsCode, &pEntry->sourceFiles).Failed() ||
+      readShaderSource(fsFileName, defines, pEntry->fsCode, &pEntry->sourceFiles).Failed())
+  {
+    pEntry->hasFailed = true;
+  }
+
+  m_entries.PushBack(pEntry);
+  return m_entries.GetCount() - 1;
+}
+
+void kr::ShaderBatch::submit()
+{
+  EZ_ASSERT_DEV(!m_isSubmitted, "A batch can only be submitted once.");
+  m_isSubmitted = true;
+
+  const bool useCache = isProgramBinaryCacheEnabled();
+
+  // Program Binaries
+  // ================
+  if (useCache)
+  {
+    for (auto pEntry : m_entries)
+    {
+      if (pEntry->hasFailed)
+        continue;
+
+      pEntry->hProgram = loadProgramBinary(computeProgramBinaryKey(pEntry->vsCode, pEntry->fsCode));
+      pEntry->isFromBinary = pEntry->hProgram != 0;
+    }
+  }
+
+  // Compile All Stages
+  // ==================
+  for (auto pEntry : m_entries)
+  {
+    if (pEntry->hasFailed || pEntry->isFromBinary)
+      continue;
+
+    pEntry->hVS = beginCompileShader(GL_VERTEX_SHADER, pEntry->vsCode);
+    pEntry->hFS = beginCompileShader(GL_FRAGMENT_SHADER, pEntry->fsCode);
+  }
+
+  // Link All Programs
+  // =================
+  // Linking does not wait for compilation either, the driver chains the work.
+  for (auto pEntry : m_entries)
+  {
+    if (pEntry->hasFailed || pEntry->isFromBinary)
+      continue;
+
+    pEntry->hProgram = beginLinkProgram(pEntry->hVS, pEntry->hFS, useCache);
+  }
+}
+
+bool kr::ShaderBatch::isReady()
+{
+  if (!m_isSubmitted)
+    return false;
+
+  if (m_isFinished || !m_isParallel)
+    return true;
+
+  for (auto pEntry : m_entries)
+  {
+    if (pEntry->hasFailed || pEntry->isFromBinary)
+      continue;
+
+    if (!isCompleted(pEntry->hProgram))
+      return false;
+  }
+
+  return true;
+}
+
+ezUInt32 kr::ShaderBatch::finish()
+{
+  if (!m_isSubmitted)
+  {
+    submit();
+  }
+
+  ezUInt32 numFailed = 0;
+
+  if (m_isFinished)
+  {
+    for (auto pEntry : m_entries)
+    {
+      if (pEntry->hasFailed)
+        ++numFailed;
+    }
+    return numFailed;
+  }
+
+  m_isFinished = true;
+
+  const bool useCache = isProgramBinaryCacheEnabled();
+
+  EZ_LOG_BLOCK("Finishing Shader Batch");
+
+  for (auto pEntry : m_entries)
+  {
+    // Check the Results
+    // =================
+    if (!pEntry->hasFailed && !pEntry->isFromBinary)
+    {
+      // The finish functions delete the GL objects on failure.
+      bool isCompiled = true;
+      if (finishCompileShader(pEntry->hVS, pEntry->vsFileName).Failed())
+      {
+        pEntry->hVS = 0;
+        isCompiled = false;
+      }
+      if (finishCompileShader(pEntry->hFS, pEntry->fsFileName).Failed())
+      {
+        pEntry->hFS = 0;
+        isCompiled = false;
+      }
+
+      if (!isCompiled)
+      {
+        glCheck(glDeleteProgram(pEntry->hProgram));
+        pEntry->hProgram = 0;
+      }
+      else if (finishLinkProgram(pEntry->hProgram).Failed())
+      {
+        pEntry->hProgram = 0;
+      }
+      else if (useCache)
+      {
+        storeProgramBinary(computeProgramBinaryKey(pEntry->vsCode, pEntry->fsCode), pEntry->hProgram);
+      }
+
+      // The program keeps what it needs.
+      if (pEntry->hVS != 0)
+        glCheck(glDeleteShader(pEntry->hVS));
+      if (pEntry->hFS != 0)
+        glCheck(glDeleteShader(pEntry->hFS));
+      pEntry->hVS = 0;
+      pEntry->hFS = 0;
+
+      pEntry->hasFailed = pEntry->hProgram == 0;
+    }
+
+    // Hand Over
+    // =========
+    if (pEntry->hasFailed)
+    {
+      ++numFailed;
+      continue;
+    }
+
+    pEntry->pProgram = ShaderProgram::adopt(pEntry->hProgram,
+                                            pEntry->vsFileName,
+                                            pEntry->fsFileName,
+                                            pEntry->defines,
+                                            pEntry->sourceFiles);
+    pEntry->hProgram = 0;
+
+    // Not needed anymore.
+    pEntry->vsCode.Clear();
+    pEntry->fsCode.Clear();
+  }
+
+  return numFailed;
+}
+
+kr::Owned<kr::ShaderProgram> kr::ShaderBatch::take(ezUInt32 index)
+{
+  EZ_ASSERT_DEV(index < m_entries.GetCount(), "Invalid index.");
+
+  finish();
+
+  return move(m_entries[index]->pProgram);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <krEngine/rendering/shader.h>
+
+namespace kr
+{
+  using ShaderSourceFiles = ezHybridArray<ezString, 4>;
+
+  /// \brief Reads and preprocesses the shader source in \a fileName.
+  /// \param out_pFiles Optional. Receives all files that were read. Files already in there are skipped.
+  ezResult readShaderSource(ezStringView fileName,
+                            const ShaderDefines& defines,
+                            ezStringBuilder& out_code,
+                            ShaderSourceFiles* out_pFiles = nullptr);
+
+  // Compiling and Linking
+  // =====================
+  // Split in two, so the driver can work on many shaders at once.
+  // Querying the status forces the driver to finish, so the begin functions never do that.
+
+  /// \brief Creates a shader of the given \a type and starts compiling it.
+  GLuint beginCompileShader(GLenum type, ezStringView sourceCode);
+
+  /// \brief Waits for the shader to compile.
+  /// \return EZ_FAILURE if compilation failed. The log is forwarded and the shader deleted then.
+  ezResult finishCompileShader(GLuint hShader, ezStringView resourceId);
+
+  /// \brief Creates a program from the given stages and starts linking it.
+  /// \param retrievable Whether the driver should keep the binary around for glGetProgramBinary.
+  GLuint beginLinkProgram(GLuint hVS, GLuint hFS, bool retrievable);
+
+  /// \brief Waits for the program to link.
+  /// \return EZ_FAILURE if linking failed. The log is forwarded and the program deleted then.
+  ezResult finishLinkProgram(GLuint hProgram);
+
+  /// \brief Remembers whether the driver compiles shaders on its own threads.
+  /// \note Set once when the GL context is created. See openGlContext.inl.
+  void setParallelShaderCompileEnabled(bool isEnabled);
+  bool isParallelShaderCompileEnabled();
+}
@@ -0,0 +1,541 @@
+#include <krEngine/rendering/shaderPreprocessor.h>
+
+#include <Foundation/IO/FileSystem/FileReader.h>
+#include <Foundation/Strings/PathUtils.h>
+#include <Foundation/Algorithm/Hashing.h>
+
+namespace
+{
+  /// \brief Whether the lines of a conditional branch reach the compiler.
+  enum class Activity
+  {
+    Active,
+    Inactive,
+
+    /// \brief The condition is too complex to evaluate here.
+    Unknown
+  };
+
+  /// \brief An #if, #ifdef or #ifndef block.
+  struct Conditional
+  {
+    /// \brief Activity of the surrounding lines.
+    Activity parent = Activity::Active;
+
+    /// \brief Activity of the current branch.
+    Activity activity = Activity::Active;
+
+    /// \brief Whether a previous branch was taken for sure.
+    bool isTaken = false;
+
+    /// \brief Whether a previous branch might have been taken.
+    bool isMaybeTaken = false;
+  };
+
+  struct PreprocessorState
+  {
+    const kr::ShaderDefines* pDefines = nullptr;
+    bool definesInserted = false;
+
+    /// \brief The blocks the current line is in.
+    ezHybridArray<Conditional, 8> conditionals;
+
+    /// \brief Names that are known to be defined.
+    ezHybridArray<ezString, 16> definedNames;
+
+    /// \brief Names that were defined or undefined in branches of unknown activity.
+    ezHybridArray<ezString, 8> uncertainNames;
+
+    /// \brief All files read so far. The index is used as source string number.
+    ezDynamicArray<ezString> files;
+
+    /// \brief Indices of the files that are currently being processed.
+    ezHybridArray<ezUInt32, 8> includeStack;
+
+    /// \brief Indices of the files that contain "#pragma once".
+    ezHybridArray<ezUInt32, 8> onceFiles;
+  };
+}
+
+/// \brief Deeper nesting is almost certainly a mistake.
+static const ezUInt32 MaxIncludeDepth = 32;
+
+// ShaderDefines
+// =============
+
+kr::ShaderDefines& kr::ShaderDefines::set(ezStringView name, ezStringView value)
+{
+  ezStringBuilder sbName(name);
+
+  ezUInt32 index = 0;
+  while (index < m_defines.GetCount() && m_defines[index].name.Compare(sbName) < 0)
+  {
+    ++index;
+  }
+
+  if (index < m_defines.GetCount() && m_defines[index].name == sbName)
+  {
+    m_defines[index].value = value;
+    return *this;
+  }
+
+  Define define;
+  define.name = sbName;
+  define.value = value;
+  m_defines.Insert(define, index);
+  return *this;
+}
+
+ezUInt32 kr::ShaderDefines::getHash() const
+{
+  ezStringBuilder text;
+  appendTo(text);
+  return ezHashing::MurmurHash(text.GetData(), text.GetElementCount());
+}
+
+bool kr::ShaderDefines::operator ==(const ShaderDefines& rhs) const
+{
+  if (m_defines.GetCount() != rhs.m_defines.GetCount())
+    return false;
+
+  for (ezUInt32 i = 0; i < m_defines.GetCount(); ++i)
+  {
+    if (m_defines[i].name != rhs.m_defines[i].name ||
+        m_defines[i].value != rhs.m_defines[i].value)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void kr::ShaderDefines::appendTo(ezStringBuilder& out_source) const
+{
+  for (auto& define : m_defines)
+  {
+    out_source.Append("#define ", define.name.GetData(), " ", define.value.GetData(), "\n");
+  }
+}
+
+// Preprocessor
+// ============
+
+/// \brief The part of \a fileName up to and including the last separator or data directory root.
+static void directoryOf(const ezString& fileName, ezStringBuilder& out_directory)
+{
+  const char* begin = fileName.GetData();
+  const char* end = begin;
+  for (const char* p = begin; *p != '\0'; ++p)
+  {
+    if (*p == '/' || *p == '\\' || *p == '>')
+      end = p + 1;
+  }
+
+  out_directory = ezStringView(begin, end);
+}
+
+// Conditionals
+// ============
+// Only as much as is needed to skip includes in branches that are never compiled.
+// Everything that is not evaluated here is left to the compiler.
+
+static bool isIdentifierChar(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static const char* skipSpace(const char* p)
+{
+  while (*p == ' ' || *p == '\t')
+  {
+    ++p;
+  }
+  return p;
+}
+
+static const char* readIdentifier(const char* p, ezStringBuilder& out_name)
+{
+  p = skipSpace(p);
+  const char* begin = p;
+  while (isIdentifierChar(*p))
+  {
+    ++p;
+  }
+
+  out_name = ezStringView(begin, p);
+  return p;
+}
+
+/// \brief The text after \a keyword, or nullptr if \a directive does not start with it.
+static const char* afterKeyword(const char* directive, const char* keyword)
+{
+  const auto length = ezStringUtils::GetStringElementCount(keyword);
+  if (!ezStringUtils::StartsWith(directive, keyword))
+    return nullptr;
+
+  return isIdentifierChar(directive[length]) ? nullptr : directive + length;
+}
+
+static Activity currentActivity(const PreprocessorState& state)
+{
+  return state.conditionals.IsEmpty() ? Activity::Active : state.conditionals.PeekBack().activity;
+}
+
+static Activity isDefined(const PreprocessorState& state, const ezStringBuilder& name)
+{
+  if (state.uncertainNames.Contains(name))
+    return Activity::Unknown;
+
+  return state.definedNames.Contains(name) ? Activity::Active : Activity::Inactive;
+}
+
+static Activity negate(Activity activity)
+{
+  switch (activity)
+  {
+  case Activity::Active:   return Activity::Inactive;
+  case Activity::Inactive: return Activity::Active;
+  default:                 return Activity::Unknown;
+  }
+}
+
+/// \brief Evaluates "0", "1", "defined(NAME)" and their negations. Anything else is unknown.
+static Activity evaluateCondition(const PreprocessorState& state, const char* p)
+{
+  p = skipSpace(p);
+
+  const bool isNegated = *p == '!';
+  if (isNegated)
+  {
+    p = skipSpace(p + 1);
+  }
+
+  ezStringBuilder name;
+  Activity result = Activity::Unknown;
+  if (auto pDefined = afterKeyword(p, "defined"))
+  {
+    p = skipSpace(pDefined);
+
+    const bool hasParenthesis = *p == '(';
+    p = readIdentifier(hasParenthesis ? p + 1 : p, name);
+    p = skipSpace(p);
+
+    if (name.IsEmpty() || (hasParenthesis && *p != ')'))
+      return Activity::Unknown;
+
+    if (hasParenthesis)
+    {
+      p = skipSpace(p + 1);
+    }
+
+    result = isDefined(state, name);
+  }
+  else
+  {
+    p = skipSpace(readIdentifier(p, name));
+    if (name == "0")
+      result = Activity::Inactive;
+    else if (name == "1")
+      result = Activity::Active;
+    else
+      return Activity::Unknown;
+  }
+
+  // Anything but a comment after that, e.g. "&& defined(B)", is beyond us.
+  if (*p != '\0' && *p != '/')
+    return Activity::Unknown;
+
+  return isNegated ? negate(result) : result;
+}
+
+/// \brief Enters the next branch of \a conditional, whose condition evaluated to \a condition.
+static void enterBranch(Conditional& conditional, Activity condition)
+{
+  if (conditional.isTaken)
+    condition = Activity::Inactive;
+  else if (conditional.isMaybeTaken && condition == Activity::Active)
+    condition = Activity::Unknown;
+
+  if (conditional.parent == Activity::Inactive || condition == Activity::Inactive)
+    conditional.activity = Activity::Inactive;
+  else if (conditional.parent == Activity::Unknown || condition == Activity::Unknown)
+    conditional.activity = Activity::Unknown;
+  else
+    conditional.activity = Activity::Active;
+
+  conditional.isTaken = conditional.isTaken || condition == Activity::Active;
+  conditional.isMaybeTaken = conditional.isMaybeTaken || condition == Activity::Unknown;
+}
+
+static void beginConditional(PreprocessorState& state, Activity condition)
+{
+  Conditional conditional;
+  conditional.parent = currentActivity(state);
+  enterBranch(conditional, condition);
+  state.conditionals.PushBack(conditional);
+}
+
+/// \brief Follows #if, #ifdef, #ifndef, #elif, #else, #endif, #define and #undef.
+static void followConditionals(PreprocessorState& state, const ezStringBuilder& directive)
+{
+  const char* text = directive.GetData();
+  const char* p = nullptr;
+  ezStringBuilder name;
+
+  if ((p = afterKeyword(text, "#ifdef")) != nullptr)
+  {
+    readIdentifier(p, name);
+    beginConditional(state, isDefined(state, name));
+  }
+  else if ((p = afterKeyword(text, "#ifndef")) != nullptr)
+  {
+    readIdentifier(p, name);
+    beginConditional(state, negate(isDefined(state, name)));
+  }
+  else if ((p = afterKeyword(text, "#if")) != nullptr)
+  {
+    beginConditional(state, evaluateCondition(state, p));
+  }
+  else if ((p = afterKeyword(text, "#elif")) != nullptr)
+  {
+    // Unbalanced directives are reported by the compiler.
+    if (!state.conditionals.IsEmpty())
+      enterBranch(state.conditionals.PeekBack(), evaluateCondition(state, p));
+  }
+  else if ((p = afterKeyword(text, "#else")) != nullptr)
+  {
+    if (!state.conditionals.IsEmpty())
+      enterBranch(state.conditionals.PeekBack(), Activity::Active);
+  }
+  else if ((p = afterKeyword(text, "#endif")) != nullptr)
+  {
+    if (!state.conditionals.IsEmpty())
+      state.conditionals.PopBack();
+  }
+  else if ((p = afterKeyword(text, "#define")) != nullptr)
+  {
+    readIdentifier(p, name);
+    switch (currentActivity(state))
+    {
+    case Activity::Active:
+      state.uncertainNames.RemoveSwap(name);
+      if (!state.definedNames.Contains(name))
+        state.definedNames.PushBack(name);
+      break;
+    case Activity::Unknown:
+      if (!state.uncertainNames.Contains(name))
+        state.uncertainNames.PushBack(name);
+      break;
+    default:
+      break;
+    }
+  }
+  else if ((p = afterKeyword(text, "#undef")) != nullptr)
+  {
+    readIdentifier(p, name);
+    switch (currentActivity(state))
+    {
+    case Activity::Active:
+      state.uncertainNames.RemoveSwap(name);
+      state.definedNames.RemoveSwap(name);
+      break;
+    case Activity::Unknown:
+      if (!state.uncertainNames.Contains(name))
+        state.uncertainNames.PushBack(name);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+// Includes
+// ========
+
+/// \brief Extracts the quoted path of an #include directive.
+static ezResult parseInclude(const ezStringBuilder& directive, ezStringBuilder& out_path)
+{
+  const char* pOpen = directive.FindSubString("\"");
+  if (pOpen == nullptr)
+    return EZ_FAILURE;
+
+  const char* pClose = directive.FindSubString("\"", pOpen + 1);
+  if (pClose == nullptr || pClose == pOpen + 1)
+    return EZ_FAILURE;
+
+  out_path = ezStringView(pOpen + 1, pClose);
+  return EZ_SUCCESS;
+}
+
+static ezResult processFile(const ezStringBuilder& fileName,
+                            PreprocessorState& state,
+                            ezStringBuilder& out_source)
+{
+  // Bookkeeping
+  // ===========
+  ezUInt32 fileIndex = state.files.IndexOf(fileName);
+  if (fileIndex == ezInvalidIndex)
+  {
+    fileIndex = state.files.GetCount();
+    state.files.PushBack(fileName);
+  }
+
+  if (state.onceFiles.Contains(fileIndex))
+    return EZ_SUCCESS;
+
+  if (state.includeStack.Contains(fileIndex))
+  {
+    ezLog::Warning("Shader file '%s' includes itself.", fileName.GetData());
+    return EZ_FAILURE;
+  }
+
+  if (state.includeStack.GetCount() >= MaxIncludeDepth)
+  {
+    ezLog::Warning("Includes of shader file '%s' are nested too deeply.", fileName.GetData());
+    return EZ_FAILURE;
+  }
+
+  // Read the File
+  // =============
+  ezStringBuilder code;
+  {
+    ezFileReader reader;
+    if (reader.Open(fileName).Failed())
+    {
+      ezLog::Warning("Failed to open shader file '%s'.", fileName.GetData());
+      return EZ_FAILURE;
+    }
+
+    code.ReadAll(reader);
+  }
+
+  state.includeStack.PushBack(fileIndex);
+  KR_ON_SCOPE_EXIT{ state.includeStack.PopBack(); };
+
+  if (fileIndex != 0)
+  {
+    out_source.AppendFormat("#line 1 %u\n", fileIndex);
+  }
+
+  ezStringBuilder directory;
+  directoryOf(state.files[fileIndex], directory);
+
+  // Process Line by Line
+  // ====================
+  const char* p = code.GetData();
+  const char* end = p + code.GetElementCount();
+  ezUInt32 lineNumber = 0;
+
+  ezStringBuilder directive;
+  while (p < end)
+  {
+    const char* lineEnd = p;
+    while (lineEnd < end && *lineEnd != '\n')
+    {
+      ++lineEnd;
+    }
+
+    ezStringView line(p, lineEnd);
+    p = lineEnd < end ? lineEnd + 1 : end;
+    ++lineNumber;
+
+    directive = line;
+    directive.Trim(" \t\r");
+
+    const auto activity = currentActivity(state);
+
+    if (directive.StartsWith("#include"))
+    {
+      // Files included by branches that are never compiled may not even exist.
+      if (activity == Activity::Inactive)
+      {
+        out_source.Append("\n");
+        continue;
+      }
+
+      ezStringBuilder includePath;
+      if (parseInclude(directive, includePath).Failed())
+      {
+        ezLog::Warning("Malformed #include in '%s', line %u.", fileName.GetData(), lineNumber);
+        return EZ_FAILURE;
+      }
+
+      if (!includePath.StartsWith("<") && !ezPathUtils::IsAbsolutePath(includePath))
+      {
+        includePath.Prepend(directory.GetData());
+      }
+
+      if (processFile(includePath, state, out_source).Failed())
+      {
+        ezLog::Warning("Included from '%s', line %u.", fileName.GetData(), lineNumber);
+        return EZ_FAILURE;
+      }
+
+      // Continue with the line after the include.
+      out_source.AppendFormat("#line %u %u\n", lineNumber + 1, fileIndex);
+      continue;
+    }
+
+    if (directive == "#pragma once" && activity != Activity::Inactive)
+    {
+      state.onceFiles.PushBack(fileIndex);
+
+      // Keep the line, so the line numbers still match.
+      out_source.Append("\n");
+      continue;
+    }
+
+    followConditionals(state, directive);
+
+    out_source.Append(line);
+    out_source.Append("\n");
+
+    // GLSL requires the version to come first, so the defines go right after it.
+    if (!state.definesInserted && fileIndex == 0 && directive.StartsWith("#version"))
+    {
+      state.definesInserted = true;
+      if (state.pDefines->getCount() > 0)
+      {
+        state.pDefines->appendTo(out_source);
+        out_source.AppendFormat("#line %u %u\n", lineNumber + 1, fileIndex);
+      }
+    }
+  }
+
+  return EZ_SUCCESS;
+}
+
+ezResult kr::preprocessShader(ezStringView fileName,
+                              const ShaderDefines& defines,
+                              ezStringBuilder& out_source,
+                              ezDynamicArray<ezString>* out_pFiles)
+{
+  PreprocessorState state;
+  state.pDefines = &defines;
+
+  for (ezUInt32 i = 0; i < defines.getCount(); ++i)
+  {
+    state.definedNames.PushBack(defines[i].name);
+  }
+
+  out_source.Clear();
+  auto result = processFile(ezStringBuilder(fileName), state, out_source);
+
+  // Without a version, the defines simply go first.
+  if (result.Succeeded() && !state.definesInserted && defines.getCount() > 0)
+  {
+    ezStringBuilder source;
+    defines.appendTo(source);
+    source.Append("#line 1 0\n");
+    source.Append(out_source.GetData());
+    out_source = source;
+  }
+
+  if (out_pFiles)
+  {
+    *out_pFiles = state.files;
+  }
+
+  return result;
+}
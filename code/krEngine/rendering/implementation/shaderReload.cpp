@@ -0,0 +1,331 @@
+#include <krEngine/rendering/shader.h>
+#include <krEngine/rendering/implementation/shaderReload.h>
+#include <krEngine/rendering/implementation/shaderVariantCacheImpl.h>
+
+#include <Foundation/IO/FileSystem/FileSystem.h>
+#include <Foundation/IO/OSFile.h>
+#include <Foundation/Threading/Thread.h>
+#include <Foundation/Threading/ThreadUtils.h>
+#include <Foundation/Threading/AtomicInteger.h>
+#include <Foundation/Threading/Mutex.h>
+#include <Foundation/Threading/Lock.h>
+
+namespace
+{
+  struct WatchedFile
+  {
+    /// \brief Immutable after creation, so the watcher may read it without locking.
+    ezString absolutePath;
+
+    /// \brief Only touched by the watcher thread. 0 until the first poll.
+    ezInt64 lastModified = 0;
+
+    /// \brief Set by the watcher thread, cleared by reloadChangedShaders.
+    ezAtomicInteger32 hasChanged;
+  };
+
+  struct WatchedProgram
+  {
+    kr::ShaderProgram* pProgram;
+
+    /// \brief The stages and everything they include.
+    ezHybridArray<WatchedFile*, 4> files;
+
+    /// \brief Files of other variants sharing the program. See watchSharedShaderFiles.
+    ezHybridArray<WatchedFile*, 4> sharedFiles;
+  };
+
+  /// \brief Polls the modification times of all watched files.
+  class ShaderWatcher : public ezThread
+  {
+  public: // *** Data
+    ezAtomicInteger32 m_shouldStop;
+
+  public: // *** Construction
+    ShaderWatcher() : ezThread("Shader Watcher") {}
+
+  private: // *** Overrides
+    virtual ezUInt32 Run() override;
+  };
+
+  struct ShaderReloadData
+  {
+    /// \brief Guards the array of files. The files themselves are never freed before shutdown,
+    ///        so the watcher can poll them without holding the lock.
+    ezMutex filesMutex;
+    ezDynamicArray<WatchedFile*> files;
+
+    /// \brief Only accessed by the thread that owns the GL context.
+    ezDynamicArray<WatchedProgram> programs;
+
+    ShaderWatcher* pWatcher = nullptr;
+  };
+}
+
+/// \brief Time between two polls of the watcher thread.
+static const ezUInt32 PollIntervalMilliseconds = 250;
+
+static ShaderReloadData* g_pReload;
+
+static void stopWatcher(ShaderReloadData& data)
+{
+  if (data.pWatcher == nullptr)
+    return;
+
+  data.pWatcher->m_shouldStop = 1;
+  data.pWatcher->Join();
+  EZ_DEFAULT_DELETE(data.pWatcher);
+}
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, ShaderReload)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core",
+    "Shaders"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pReload = new (m_mem_reload) ShaderReloadData();
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    stopWatcher(*g_pReload);
+
+    for (auto pFile : g_pReload->files)
+    {
+      EZ_DEFAULT_DELETE(pFile);
+    }
+
+    g_pReload->~ShaderReloadData();
+    g_pReload = nullptr;
+  }
+
+private:
+  ezUInt8 m_mem_reload[sizeof(ShaderReloadData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+static ezInt64 modificationTimeOf(const ezString& absolutePath)
+{
+  ezFileStats stats;
+  if (ezOSFile::GetFileStats(absolutePath.GetData(), stats).Failed())
+    return 0;
+
+  return stats.m_LastModificationTime.GetInt64(ezSIUnitOfTime::Microsecond);
+}
+
+ezUInt32 ShaderWatcher::Run()
+{
+  ezHybridArray<WatchedFile*, 64> files;
+
+  while (m_shouldStop == 0)
+  {
+    {
+      EZ_LOCK(g_pReload->filesMutex);
+      files.Clear();
+      for (auto pFile : g_pReload->files)
+      {
+        files.PushBack(pFile);
+      }
+    }
+
+    for (auto pFile : files)
+    {
+      auto modified = modificationTimeOf(pFile->absolutePath);
+
+      // Files that are being written may be missing for a moment.
+      if (modified == 0)
+        continue;
+
+      if (pFile->lastModified != 0 && modified != pFile->lastModified)
+      {
+        pFile->hasChanged = 1;
+      }
+      pFile->lastModified = modified;
+    }
+
+    ezThreadUtils::Sleep(PollIntervalMilliseconds);
+  }
+
+  return 0;
+}
+
+static WatchedFile* watchFile(ezStringView fileName)
+{
+  ezStringBuilder absolutePath;
+  if (ezFileSystem::ResolvePath(ezStringBuilder(fileName), false, &absolutePath, nullptr).Failed())
+  {
+    ezLog::Warning("Unable to resolve path of shader '%s'. It will not be hot reloaded.",
+                   ezStringBuilder(fileName).GetData());
+    return nullptr;
+  }
+
+  EZ_LOCK(g_pReload->filesMutex);
+
+  for (auto pFile : g_pReload->files)
+  {
+    if (pFile->absolutePath == absolutePath)
+      return pFile;
+  }
+
+  auto pFile = EZ_DEFAULT_NEW(WatchedFile);
+  pFile->absolutePath = absolutePath;
+  g_pReload->files.PushBack(pFile);
+  return pFile;
+}
+
+static WatchedProgram* findWatchedProgram(kr::ShaderProgram* pProgram)
+{
+  for (auto& entry : g_pReload->programs)
+  {
+    if (entry.pProgram == pProgram)
+      return &entry;
+  }
+
+  return nullptr;
+}
+
+static void watchFiles(const ezHybridArray<ezString, 4>& fileNames,
+                       ezHybridArray<WatchedFile*, 4>& out_files)
+{
+  out_files.Clear();
+  for (auto& fileName : fileNames)
+  {
+    if (auto pFile = watchFile(fileName))
+    {
+      out_files.PushBack(pFile);
+    }
+  }
+}
+
+void kr::watchShaderProgram(ShaderProgram* pProgram)
+{
+  EZ_ASSERT_DEV(pProgram->isReloadable(), "Only programs loaded from files can be watched.");
+
+  auto pEntry = findWatchedProgram(pProgram);
+  if (pEntry == nullptr)
+  {
+    pEntry = &g_pReload->programs.ExpandAndGetRef();
+    pEntry->pProgram = pProgram;
+  }
+
+  watchFiles(pProgram->m_sourceFiles, pEntry->files);
+}
+
+void kr::watchSharedShaderFiles(ShaderProgram* pProgram, const ezHybridArray<ezString, 4>& files)
+{
+  if (auto pEntry = findWatchedProgram(pProgram))
+  {
+    watchFiles(files, pEntry->sharedFiles);
+  }
+}
+
+void kr::unwatchShaderProgram(ShaderProgram* pProgram)
+{
+  // Programs may outlive the engine.
+  if (g_pReload == nullptr)
+    return;
+
+  auto& programs = g_pReload->programs;
+  for (ezUInt32 i = 0; i < programs.GetCount(); ++i)
+  {
+    if (programs[i].pProgram == pProgram)
+    {
+      programs.RemoveAtSwap(i);
+      return;
+    }
+  }
+}
+
+void kr::setShaderHotReloadEnabled(bool enabled)
+{
+  if (enabled == isShaderHotReloadEnabled())
+    return;
+
+  if (!enabled)
+  {
+    stopWatcher(*g_pReload);
+    return;
+  }
+
+  g_pReload->pWatcher = EZ_DEFAULT_NEW(ShaderWatcher);
+  g_pReload->pWatcher->Start();
+}
+
+bool kr::isShaderHotReloadEnabled()
+{
+  return g_pReload->pWatcher != nullptr;
+}
+
+ezUInt32 kr::reloadChangedShaders()
+{
+  if (!isShaderHotReloadEnabled())
+    return 0;
+
+  // Collect the Changes
+  // ===================
+  // Taking the flags first means that changes during the reload are picked up next frame.
+  ezHybridArray<WatchedFile*, 8> changedFiles;
+  {
+    EZ_LOCK(g_pReload->filesMutex);
+    for (auto pFile : g_pReload->files)
+    {
+      if (pFile->hasChanged.CompareAndSwap(1, 0))
+      {
+        changedFiles.PushBack(pFile);
+      }
+    }
+  }
+
+  if (changedFiles.IsEmpty())
+    return 0;
+
+  auto containsChangedFile = [&changedFiles](const ezHybridArray<WatchedFile*, 4>& files)
+  {
+    for (auto pFile : files)
+    {
+      if (changedFiles.Contains(pFile))
+        return true;
+    }
+    return false;
+  };
+
+  // Find Affected Programs
+  // ======================
+  // Collected first, since reloading may change the watched files of a program.
+  ezHybridArray<ShaderProgram*, 8> affectedPrograms;
+  ezHybridArray<ShaderProgram*, 8> affectedSharedPrograms;
+  for (auto& entry : g_pReload->programs)
+  {
+    if (containsChangedFile(entry.files))
+    {
+      affectedPrograms.PushBack(entry.pProgram);
+    }
+    else if (containsChangedFile(entry.sharedFiles))
+    {
+      affectedSharedPrograms.PushBack(entry.pProgram);
+    }
+  }
+
+  // Only the files of other variants changed, so there is nothing to rebuild.
+  for (auto pProgram : affectedSharedPrograms)
+  {
+    updateShaderVariantsOf(pProgram);
+  }
+
+  // Reload
+  // ======
+  ezUInt32 numReloaded = 0;
+  for (auto pProgram : affectedPrograms)
+  {
+    EZ_LOG_BLOCK("Hot Reloading Shader Program", pProgram->m_fsResourceId.GetData());
+
+    if (pProgram->reload().Succeeded())
+    {
+      ++numReloaded;
+    }
+  }
+
+  return numReloaded;
+}
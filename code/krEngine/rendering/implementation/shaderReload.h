@@ -0,0 +1,23 @@
+#pragma once
+
+namespace kr
+{
+  class ShaderProgram;
+
+  /// \brief Starts watching the source files of \a pProgram for hot reloading.
+  ///
+  /// Call it again after the source files changed. Shared files are kept then.
+  /// \pre pProgram->isReloadable()
+  void watchShaderProgram(ShaderProgram* pProgram);
+
+  /// \brief Also watches the source files of the other variants sharing \a pProgram.
+  ///
+  /// Replaces the shared files of the last call.
+  /// The program is not built from them, so changes do not reload it.
+  /// They only update the variants sharing it. See updateShaderVariantsOf().
+  /// \note Does nothing if \a pProgram is not watched.
+  void watchSharedShaderFiles(ShaderProgram* pProgram, const ezHybridArray<ezString, 4>& files);
+
+  /// \brief Stops watching the source files of \a pProgram. Does nothing if it is not watched.
+  void unwatchShaderProgram(ShaderProgram* pProgram);
+}
@@ -0,0 +1,453 @@
+#include <krEngine/rendering/shaderVariantCache.h>
+#include <krEngine/rendering/implementation/shaderImpl.h>
+#include <krEngine/rendering/implementation/shaderReload.h>
+#include <krEngine/rendering/implementation/shaderVariantCacheImpl.h>
+
+#include <Foundation/Containers/HashTable.h>
+#include <Foundation/Algorithm/Hashing.h>
+
+namespace
+{
+  /// \brief Identifies a program by its preprocessed sources.
+  struct SourceHash
+  {
+    ezUInt64 vs = 0;
+    ezUInt64 fs = 0;
+
+    bool operator ==(const SourceHash& rhs) const { return vs == rhs.vs && fs == rhs.fs; }
+  };
+
+  struct ProgramEntry
+  {
+    kr::Owned<kr::ShaderProgram> pProgram;
+
+    /// \brief Of the sources the program was last built from.
+    SourceHash sourceHash;
+  };
+
+  /// \brief A requested combination of files and defines.
+  struct VariantEntry
+  {
+    ezString vsFileName;
+    ezString fsFileName;
+    kr::ShaderDefines defines;
+    ezUInt32 hash;
+
+    /// \brief All files read to preprocess the variant.
+    kr::ShaderSourceFiles sourceFiles;
+
+    ProgramEntry* pProgram;
+  };
+
+  /// \brief Entries with the same hash share a bucket.
+  using VariantBucket = ezHybridArray<VariantEntry*, 1>;
+  using ProgramBucket = ezHybridArray<ProgramEntry*, 1>;
+
+  struct ShaderVariantCacheData
+  {
+    ezHashTable<ezUInt32, VariantBucket> variants;
+    ezHashTable<ezUInt32, ProgramBucket> programs;
+    ezUInt32 numPrograms = 0;
+    ezUInt32 generation = 0;
+    kr::ShaderVariantCacheStats stats;
+  };
+}
+
+static ShaderVariantCacheData* g_pCache;
+static bool g_initialized = false;
+
+static void clearCache(ShaderVariantCacheData& cache)
+{
+  for (auto it = cache.variants.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      EZ_DEFAULT_DELETE(pEntry);
+    }
+  }
+
+  for (auto it = cache.programs.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      if (pEntry->pProgram.data.refCount != 0)
+      {
+        // The borrowers point into the entry, so we cannot free it.
+        ezLog::Error("Shader variant '%s' is still borrowed %u times. Leaking it.",
+                     pEntry->pProgram->m_fsResourceId.GetData(),
+                     static_cast<ezUInt32>(pEntry->pProgram.data.refCount));
+        continue;
+      }
+
+      EZ_DEFAULT_DELETE(pEntry);
+    }
+  }
+
+  cache.variants.Clear();
+  cache.programs.Clear();
+  cache.numPrograms = 0;
+}
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, ShaderVariantCache)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core",
+    "Shaders",
+    "ShaderReload"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pCache = new (m_mem_cache) ShaderVariantCacheData();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // Programs belong to the GL context,
+    // which is usually gone by the time the core shuts down.
+    clearCache(*g_pCache);
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    clearCache(*g_pCache);
+
+    g_pCache->~ShaderVariantCacheData();
+    g_pCache = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_cache[sizeof(ShaderVariantCacheData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+// Hashing
+// =======
+
+static ezUInt32 hashVariant(const ezStringBuilder& vsFileName,
+                            const ezStringBuilder& fsFileName,
+                            const kr::ShaderDefines& defines)
+{
+  auto hash = ezHashing::MurmurHash(vsFileName.GetData(), vsFileName.GetElementCount(), defines.getHash());
+  return ezHashing::MurmurHash(fsFileName.GetData(), fsFileName.GetElementCount(), hash);
+}
+
+static ezUInt64 hashSource(const ezStringBuilder& source)
+{
+  // Two differently seeded 32 bit hashes, since a collision would hand out the wrong program.
+  auto low = ezHashing::MurmurHash(source.GetData(), source.GetElementCount(), 0);
+  auto high = ezHashing::MurmurHash(source.GetData(), source.GetElementCount(), 0x6B72);
+  return (static_cast<ezUInt64>(high) << 32) | low;
+}
+
+static SourceHash hashSources(const ezStringBuilder& vsCode, const ezStringBuilder& fsCode)
+{
+  SourceHash hash;
+  hash.vs = hashSource(vsCode);
+  hash.fs = hashSource(fsCode);
+  return hash;
+}
+
+static ezUInt32 bucketOf(const SourceHash& hash)
+{
+  return static_cast<ezUInt32>(hash.vs ^ (hash.fs >> 7) ^ (hash.fs << 13));
+}
+
+// Look Up
+// =======
+
+static VariantEntry* findVariant(ShaderVariantCacheData& cache,
+                                 ezUInt32 hash,
+                                 const ezStringBuilder& vsFileName,
+                                 const ezStringBuilder& fsFileName,
+                                 const kr::ShaderDefines& defines)
+{
+  VariantBucket* pBucket = nullptr;
+  if (!cache.variants.TryGetValue(hash, pBucket))
+    return nullptr;
+
+  for (auto pEntry : *pBucket)
+  {
+    if (pEntry->vsFileName == vsFileName &&
+        pEntry->fsFileName == fsFileName &&
+        pEntry->defines == defines)
+    {
+      return pEntry;
+    }
+  }
+
+  return nullptr;
+}
+
+static ProgramEntry* findProgram(ShaderVariantCacheData& cache, const SourceHash& hash)
+{
+  ProgramBucket* pBucket = nullptr;
+  if (!cache.programs.TryGetValue(bucketOf(hash), pBucket))
+    return nullptr;
+
+  for (auto pEntry : *pBucket)
+  {
+    if (pEntry->sourceHash == hash)
+      return pEntry;
+  }
+
+  return nullptr;
+}
+
+template<typename Bucket, typename Entry>
+static void insert(ezHashTable<ezUInt32, Bucket>& table, ezUInt32 hash, Entry* pEntry)
+{
+  Bucket* pBucket = nullptr;
+  if (!table.TryGetValue(hash, pBucket))
+  {
+    table.Insert(hash, Bucket());
+    table.TryGetValue(hash, pBucket);
+  }
+  pBucket->PushBack(pEntry);
+}
+
+template<typename Bucket, typename Entry>
+static void remove(ezHashTable<ezUInt32, Bucket>& table, ezUInt32 hash, Entry* pEntry)
+{
+  Bucket* pBucket = nullptr;
+  if (!table.TryGetValue(hash, pBucket))
+    return;
+
+  pBucket->RemoveSwap(pEntry);
+  if (pBucket->IsEmpty())
+    table.Remove(hash);
+}
+
+static ProgramEntry* findProgramEntry(ShaderVariantCacheData& cache, kr::ShaderProgram* pProgram)
+{
+  for (auto it = cache.programs.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      if (pEntry->pProgram.data.ptr == pProgram)
+        return pEntry;
+    }
+  }
+
+  return nullptr;
+}
+
+// Sharing
+// =======
+
+/// \brief Watches the files of all variants sharing \a entry that the program is not built from.
+static void watchSharedFiles(ShaderVariantCacheData& cache, ProgramEntry& entry)
+{
+  auto& ownFiles = entry.pProgram->m_sourceFiles;
+
+  kr::ShaderSourceFiles sharedFiles;
+  for (auto it = cache.variants.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pVariant : it.Value())
+    {
+      if (pVariant->pProgram != &entry)
+        continue;
+
+      for (auto& file : pVariant->sourceFiles)
+      {
+        if (!ownFiles.Contains(file) && !sharedFiles.Contains(file))
+          sharedFiles.PushBack(file);
+      }
+    }
+  }
+
+  kr::watchSharedShaderFiles(entry.pProgram.data.ptr, sharedFiles);
+}
+
+/// \brief Whether \a pVariant is what \a pProgram was built from.
+static bool isBuiltFrom(const kr::ShaderProgram* pProgram, const VariantEntry* pVariant)
+{
+  return pVariant->vsFileName == pProgram->m_vsResourceId &&
+         pVariant->fsFileName == pProgram->m_fsResourceId &&
+         pVariant->defines == pProgram->m_defines;
+}
+
+void kr::updateShaderVariantsOf(ShaderProgram* pProgram)
+{
+  // Programs may outlive the engine.
+  if (g_pCache == nullptr)
+    return;
+
+  auto& cache = *g_pCache;
+
+  auto pEntry = findProgramEntry(cache, pProgram);
+  if (pEntry == nullptr)
+    return;
+
+  ++cache.generation;
+
+  // Look the Program Up by its New Sources
+  // ======================================
+  ezStringBuilder vsCode;
+  ezStringBuilder fsCode;
+  if (readShaderSource(pProgram->m_vsResourceId, pProgram->m_defines, vsCode).Failed() ||
+      readShaderSource(pProgram->m_fsResourceId, pProgram->m_defines, fsCode).Failed())
+  {
+    // Most likely written to right now. The watcher reports the file again once it is done.
+    ezLog::Warning("Unable to read the sources of shader variant '%s'.", pProgram->m_fsResourceId.GetData());
+    return;
+  }
+
+  remove(cache.programs, bucketOf(pEntry->sourceHash), pEntry);
+  pEntry->sourceHash = hashSources(vsCode, fsCode);
+  insert(cache.programs, bucketOf(pEntry->sourceHash), pEntry);
+
+  // Forget Variants That No Longer Match
+  // ====================================
+  ezHybridArray<VariantEntry*, 8> staleVariants;
+  for (auto it = cache.variants.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pVariant : it.Value())
+    {
+      if (pVariant->pProgram != pEntry)
+        continue;
+
+      if (isBuiltFrom(pProgram, pVariant))
+      {
+        pVariant->sourceFiles = pProgram->m_sourceFiles;
+        continue;
+      }
+
+      ezStringBuilder variantVsCode;
+      ezStringBuilder variantFsCode;
+      ShaderSourceFiles sourceFiles;
+      if (readShaderSource(pVariant->vsFileName, pVariant->defines, variantVsCode, &sourceFiles).Succeeded() &&
+          readShaderSource(pVariant->fsFileName, pVariant->defines, variantFsCode, &sourceFiles).Succeeded() &&
+          hashSources(variantVsCode, variantFsCode) == pEntry->sourceHash)
+      {
+        pVariant->sourceFiles = sourceFiles;
+        continue;
+      }
+
+      staleVariants.PushBack(pVariant);
+    }
+  }
+
+  for (auto pVariant : staleVariants)
+  {
+    remove(cache.variants, pVariant->hash, pVariant);
+    EZ_DEFAULT_DELETE(pVariant);
+  }
+
+  watchSharedFiles(cache, *pEntry);
+}
+
+// Public API
+// ==========
+
+kr::Borrowed<kr::ShaderProgram> kr::ShaderVariantCache::get(ezStringView vsFileName,
+                                                            ezStringView fsFileName,
+                                                            const ShaderDefines& defines)
+{
+  EZ_ASSERT_DEV(g_initialized, "ShaderVariantCache subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  auto& cache = *g_pCache;
+  ++cache.stats.numRequests;
+
+  ezStringBuilder sbVS(vsFileName);
+  ezStringBuilder sbFS(fsFileName);
+  auto variantHash = hashVariant(sbVS, sbFS, defines);
+
+  // Known Variant
+  // =============
+  if (auto pVariant = findVariant(cache, variantHash, sbVS, sbFS, defines))
+  {
+    ++cache.stats.numNameHits;
+    return borrow(pVariant->pProgram->pProgram);
+  }
+
+  // Known Sources
+  // =============
+  // Preprocessing is cheap compared to compiling and linking.
+  ezStringBuilder vsCode;
+  ezStringBuilder fsCode;
+  ShaderSourceFiles sourceFiles;
+  if (readShaderSource(sbVS, defines, vsCode, &sourceFiles).Failed() ||
+      readShaderSource(sbFS, defines, fsCode, &sourceFiles).Failed())
+  {
+    return nullptr;
+  }
+
+  auto sourceHash = hashSources(vsCode, fsCode);
+
+  auto pProgramEntry = findProgram(cache, sourceHash);
+  if (pProgramEntry)
+  {
+    ++cache.stats.numSourceHits;
+  }
+  else
+  {
+    // Build
+    // =====
+    // From the sources we already have, so nothing is preprocessed twice.
+    auto pProgram = ShaderProgram::linkPreprocessed(sbVS, sbFS, defines, vsCode, fsCode, sourceFiles);
+    if (pProgram == nullptr)
+      return nullptr;
+
+    ++cache.stats.numBuilds;
+
+    pProgramEntry = EZ_DEFAULT_NEW(ProgramEntry);
+    pProgramEntry->pProgram = move(pProgram);
+    pProgramEntry->sourceHash = sourceHash;
+    insert(cache.programs, bucketOf(sourceHash), pProgramEntry);
+    ++cache.numPrograms;
+  }
+
+  auto pVariant = EZ_DEFAULT_NEW(VariantEntry);
+  pVariant->vsFileName = sbVS;
+  pVariant->fsFileName = sbFS;
+  pVariant->defines = defines;
+  pVariant->hash = variantHash;
+  pVariant->sourceFiles = sourceFiles;
+  pVariant->pProgram = pProgramEntry;
+  insert(cache.variants, variantHash, pVariant);
+
+  // Changes to the files of this variant must be noticed, even though the program is not built from them.
+  if (!isBuiltFrom(pProgramEntry->pProgram.data.ptr, pVariant))
+  {
+    watchSharedFiles(cache, *pProgramEntry);
+  }
+
+  return borrow(pProgramEntry->pProgram);
+}
+
+ezUInt32 kr::getShaderVariantGeneration()
+{
+  return g_pCache == nullptr ? 0 : g_pCache->generation;
+}
+
+ezUInt32 kr::ShaderVariantCache::getCount()
+{
+  return g_pCache->numPrograms;
+}
+
+kr::ShaderVariantCacheStats kr::ShaderVariantCache::getStats()
+{
+  return g_pCache->stats;
+}
+
+void kr::ShaderVariantCache::resetStats()
+{
+  g_pCache->stats = ShaderVariantCacheStats();
+}
+
+void kr::ShaderVariantCache::logStats()
+{
+  auto& stats = g_pCache->stats;
+
+  EZ_LOG_BLOCK("Shader Variant Cache Stats");
+
+  ezLog::Info("%u programs, %u requests, %u builds, %u builds saved "
+              "(%u by name, %u by identical sources)",
+              g_pCache->numPrograms, stats.numRequests, stats.numBuilds,
+              stats.getNumBuildsSaved(), stats.numNameHits, stats.numSourceHits);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace kr
+{
+  class ShaderProgram;
+
+  /// \brief Updates the cache after the sources of \a pProgram changed.
+  ///
+  /// The program is looked up by its new sources from now on.
+  /// Variants sharing it whose sources no longer match are forgotten,
+  /// so the next ShaderVariantCache::get() builds them again.
+  /// Does nothing if \a pProgram is not in the cache.
+  void updateShaderVariantsOf(ShaderProgram* pProgram);
+
+  /// \brief Changes whenever updateShaderVariantsOf() ran.
+  ///
+  /// Programs looked up once and kept outside of the cache are looked up again once this changes,
+  /// since their variant may have been forgotten.
+  ezUInt32 getShaderVariantGeneration();
+}
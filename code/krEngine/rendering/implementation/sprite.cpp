@@ -1,14 +1,96 @@
 #include <krEngine/rendering/sprite.h>
 #include <krEngine/rendering/shader.h>
+#include <krEngine/rendering/shaderVariantCache.h>
+#include <krEngine/rendering/vertexBufferPool.h>
+#include <krEngine/rendering/implementation/spriteUpdateQueue.h>
 #include <krEngine/rendering/implementation/opelGlCheck.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
 
-EZ_BEGIN_STATIC_REFLECTED_TYPE(krSpriteVertex, ezNoBase, 1, ezRTTINoAllocator);
-  EZ_BEGIN_PROPERTIES
-    // We use the names used in the shader here.
-    EZ_MEMBER_PROPERTY("vs_position",  pos),
-    EZ_MEMBER_PROPERTY("vs_texCoords", texCoords)
-  EZ_END_PROPERTIES
-EZ_END_STATIC_REFLECTED_TYPE();
+#include <Foundation/Threading/Mutex.h>
+#include <Foundation/Threading/Lock.h>
+
+// The names are hashed once, so looking up the uniforms is cheap.
+static const kr::ShaderUniformName u_origin("u_origin");
+static const kr::ShaderUniformName u_rotation("u_rotation");
+static const kr::ShaderUniformName u_depth("u_depth");
+static const kr::ShaderUniformName u_view("u_view");
+static const kr::ShaderUniformName u_projection("u_projection");
+static const kr::ShaderUniformName u_color("u_color");
+static const kr::ShaderUniformName u_texture("u_texture");
+
+namespace
+{
+  struct SpriteUpdateQueue
+  {
+    ezMutex mutex;
+
+    /// \brief Sprites waiting for the next frame boundary.
+    ezDynamicArray<kr::Sprite*> pending;
+
+    /// \brief Copy of the vertex data of a sprite and where it goes,
+    ///        so the upload does not need to hold the lock.
+    struct Upload
+    {
+      krSpriteVertex vertices[4];
+      GLuint hBuffer;
+      ezUInt32 byteOffset;
+    };
+
+    /// \brief Vertex data of the current frame that needs to be uploaded.
+    /// \note Only used by the renderer, so it is not guarded by the mutex.
+    ezDynamicArray<Upload> uploads;
+
+    /// \brief All vertex data of a frame is written to this buffer at once.
+    GLuint hStagingBuffer = 0;
+    ezUInt32 stagingBufferSize = 0;
+  };
+}
+
+static SpriteUpdateQueue* g_pUpdateQueue;
+static bool g_initialized = false;
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, Sprites)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pUpdateQueue = new (m_mem_updateQueue) SpriteUpdateQueue();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // The staging buffer belongs to the GL context,
+    // which is usually gone by the time the core shuts down.
+    if (g_pUpdateQueue->hStagingBuffer != 0)
+    {
+      glCheck(glDeleteBuffers(1, &g_pUpdateQueue->hStagingBuffer));
+      g_pUpdateQueue->hStagingBuffer = 0;
+      g_pUpdateQueue->stagingBufferSize = 0;
+    }
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    if (g_pUpdateQueue->pending.GetCount() > 0)
+    {
+      ezLog::Error("There are still %u sprites waiting for an update!",
+                    g_pUpdateQueue->pending.GetCount());
+    }
+
+    g_pUpdateQueue->~SpriteUpdateQueue();
+    g_pUpdateQueue = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_updateQueue[sizeof(SpriteUpdateQueue)];
+EZ_END_SUBSYSTEM_DECLARATION
 
 static kr::Owned<kr::VertexBuffer> createVertexBuffer(kr::Borrowed<kr::ShaderProgram> pShader)
 {
@@ -16,14 +98,57 @@ static kr::Owned<kr::VertexBuffer> createVertexBuffer(kr::Borrowed<kr::ShaderPro
 
   EZ_LOG_BLOCK("Create VertexBuffer", "Sprite");
 
-  auto pVB = VertexBuffer::create(BufferUsage::StaticDraw,
-                                  PrimitiveType::TriangleStrip);
+  // Sprites share a few large buffers instead of owning a tiny one each.
+  auto pVB = VertexBufferPool::allocate(4 * sizeof(krSpriteVertex),
+                                        sizeof(krSpriteVertex),
+                                        PrimitiveType::TriangleStrip);
+  if (pVB == nullptr)
+    return nullptr;
 
-  setupLayout(pVB, pShader, "krSpriteVertex");
+  setupLayout<krSpriteVertex>(pVB, pShader);
 
   return move(pVB);
 }
 
+// static
+kr::Borrowed<kr::ShaderProgram> kr::Sprite::getDefaultShader()
+{
+  auto prg = ShaderVariantCache::get("<shader>sprite.vs", "<shader>sprite.fs");
+  if (prg == nullptr)
+  {
+    EZ_REPORT_FAILURE("Failed to get the default sprite shader.");
+  }
+
+  return prg;
+}
+
+// static
+kr::Borrowed<kr::ShaderProgram> kr::Sprite::getDefaultArrayShader()
+{
+  auto prg = ShaderVariantCache::get("<shader>spriteArray.vs", "<shader>spriteArray.fs");
+  if (prg == nullptr)
+  {
+    EZ_REPORT_FAILURE("Failed to get the default sprite array shader.");
+  }
+
+  return prg;
+}
+
+// static
+kr::Borrowed<kr::ShaderProgram> kr::Sprite::getDefaultMultiDrawShader()
+{
+  ShaderDefines defines;
+  defines.set("KR_MULTI_DRAW");
+
+  auto prg = ShaderVariantCache::get("<shader>sprite.vs", "<shader>sprite.fs", defines);
+  if (prg == nullptr)
+  {
+    EZ_REPORT_FAILURE("Failed to get the default multi-draw sprite shader.");
+  }
+
+  return prg;
+}
+
 // static
 kr::Owned<kr::ShaderProgram> kr::Sprite::createDefaultShader()
 {
@@ -40,31 +165,71 @@ kr::Owned<kr::ShaderProgram> kr::Sprite::createDefaultShader()
   return move(prg);
 }
 
+kr::Owned<kr::ShaderProgram> kr::Sprite::createDefaultArrayShader()
+{
+  EZ_LOG_BLOCK("Create Shader", "Sprite Array");
+
+  auto vsName = "<shader>spriteArray.vs";
+  auto fsName = "<shader>spriteArray.fs";
+  auto prg = ShaderProgram::loadAndLink(vsName, fsName);
+  if (prg == nullptr)
+  {
+    EZ_REPORT_FAILURE("Failed to link shaders to program: '%s' and '%s'", vsName, fsName);
+  }
+
+  return move(prg);
+}
+
 kr::Sprite::Sprite()
 {
   m_needUpdate.Add(SpriteComponents::LocalBounds);
   m_needUpdate.Add(SpriteComponents::Cutout);
 }
 
+kr::Sprite::~Sprite()
+{
+  // Sprites may outlive the engine, but then the queue is gone anyway.
+  if (g_pUpdateQueue == nullptr)
+    return;
+
+  EZ_LOCK(g_pUpdateQueue->mutex);
+
+  if (m_isQueued)
+  {
+    g_pUpdateQueue->pending.RemoveSwap(this);
+    m_isQueued = false;
+  }
+}
+
 void kr::Sprite::operator=(const Sprite& other)
 {
+  EZ_ASSERT_DEV(g_initialized, "Sprites subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  // Both sprites are guarded by the same lock.
+  EZ_LOCK(g_pUpdateQueue->mutex);
+
   this->m_needUpdate = other.m_needUpdate;
   ezMemoryUtils::Copy(this->m_vertices, other.m_vertices, 4);
   this->m_pSampler = other.m_pSampler;
   this->m_pTexture = other.m_pTexture;
+  this->m_textureLayer = other.m_textureLayer;
   this->m_localBounds = other.m_localBounds;
   this->m_cutout = other.m_cutout;
   this->m_color = other.m_color;
+  this->m_isTranslucent = other.m_isTranslucent;
   this->m_pShader = other.m_pShader;
   this->m_uTexture = other.m_uTexture;
   this->m_uColor = other.m_uColor;
   this->m_uTransform = other.m_uTransform;
   this->m_uOrigin = other.m_uOrigin;
   this->m_uRotation = other.m_uRotation;
+  this->m_uDepth = other.m_uDepth;
   this->m_uViewMatrix = other.m_uViewMatrix;
   this->m_uProjectionMatrix = other.m_uProjectionMatrix;
 
-  update(*this);
+  // Even if nothing else is outdated, we still need our own vertex buffer.
+  enqueueUpdate();
 }
 
 kr::Sprite::Sprite(const Sprite& other)
@@ -72,28 +237,108 @@ kr::Sprite::Sprite(const Sprite& other)
   *this = other;
 }
 
+// Mutators
+// ========
+// Everything prepareUpdate() reads is written under the queue lock,
+// since the renderer processes the queue on its own thread.
+
+static ezMutex& lockOf()
+{
+  EZ_ASSERT_DEV(g_initialized, "Sprites subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+  return g_pUpdateQueue->mutex;
+}
+
+bool kr::Sprite::needsUpdate() const
+{
+  EZ_LOCK(lockOf());
+  return m_needUpdate.GetValue() != 0;
+}
+
+void kr::Sprite::setTexture(Borrowed<Texture> pTex)
+{
+  EZ_LOCK(lockOf());
+  m_pTexture = move(pTex);
+  markForUpdate(SpriteComponents::Cutout);
+}
+
+void kr::Sprite::setSampler(Borrowed<const Sampler> sampler)
+{
+  EZ_LOCK(lockOf());
+  m_pSampler = move(sampler);
+  enqueueUpdate();
+}
+
+void kr::Sprite::setShader(Borrowed<ShaderProgram> shader)
+{
+  EZ_LOCK(lockOf());
+  m_pShader = move(shader);
+  markForUpdate(SpriteComponents::ShaderUniforms);
+}
+
 void kr::Sprite::setLocalBounds(ezRectFloat newLocalBounds)
 {
+  EZ_LOCK(lockOf());
   m_localBounds = move(newLocalBounds);
-  m_needUpdate.Add(SpriteComponents::LocalBounds);
+  markForUpdate(SpriteComponents::LocalBounds);
+}
+
+ezRectFloat kr::Sprite::getLocalBounds() const
+{
+  // Filled in by prepareUpdate() if no bounds were set.
+  EZ_LOCK(lockOf());
+  return m_localBounds;
 }
 
 void kr::Sprite::setCutout(ezRectU32 newCutout)
 {
+  EZ_LOCK(lockOf());
   m_cutout = move(newCutout);
-  m_needUpdate.Add(SpriteComponents::Cutout);
+  markForUpdate(SpriteComponents::Cutout);
 }
 
-void kr::update(Sprite& sprite)
+ezRectU32 kr::Sprite::getCutout() const
 {
-  EZ_LOG_BLOCK("Updating Sprite");
+  // Filled in by prepareUpdate() if no cutout was set.
+  EZ_LOCK(lockOf());
+  return m_cutout;
+}
+
+void kr::Sprite::markForUpdate(SpriteComponents::Enum component)
+{
+  m_needUpdate.Add(component);
+  enqueueUpdate();
+}
+
+void kr::Sprite::enqueueUpdate()
+{
+  if (!m_isQueued)
+  {
+    g_pUpdateQueue->pending.PushBack(this);
+    m_isQueued = true;
+  }
+}
+
+kr::Sprite::UpdateResult kr::Sprite::prepareUpdate()
+{
+  auto& sprite = *this;
 
   // Terminate, If There Is No Texture
   // =================================
   if (sprite.m_pTexture == nullptr)
   {
     ezLog::Warning("Sprite has no texture yet. Cannot Update.");
-    return;
+    return UpdateResult::Done;
+  }
+
+  // Terminate, If The Texture Failed to Load
+  // ========================================
+  // It has no dimensions to compute the cutout from.
+  if (sprite.m_pTexture->getLoadState() == TextureLoadState::Failed)
+  {
+    ezLog::Warning("Sprite texture '%s' failed to load. Cannot Update.",
+                   sprite.m_pTexture->getName().GetData());
+    return UpdateResult::Done;
   }
 
   // Terminate, If There Is No Sampler
@@ -101,37 +346,50 @@ void kr::update(Sprite& sprite)
   if (sprite.m_pSampler == nullptr)
   {
     ezLog::Warning("Sprite has no sampler yet. Cannot Update.");
-    return;
+    return UpdateResult::Done;
   }
 
-  // Terminate, If There Is No Sampler
-  // =================================
+  // Terminate, If There Is No Shader
+  // ================================
   if(sprite.m_pShader == nullptr)
   {
     ezLog::Warning("Sprite has no shader yet. Cannot Update.");
-    return;
+    return UpdateResult::Done;
   }
 
   // Create Shader, If Needed
   // ========================
   if(sprite.m_needUpdate.IsSet(SpriteComponents::ShaderUniforms))
   {
-    sprite.m_uOrigin           = shaderUniformOf(sprite.m_pShader, "u_origin");
-    sprite.m_uRotation         = shaderUniformOf(sprite.m_pShader, "u_rotation");
-    sprite.m_uViewMatrix       = shaderUniformOf(sprite.m_pShader, "u_view");
-    sprite.m_uProjectionMatrix = shaderUniformOf(sprite.m_pShader, "u_projection");
-    sprite.m_uColor            = shaderUniformOf(sprite.m_pShader, "u_color");
-    sprite.m_uTexture          = shaderUniformOf(sprite.m_pShader, "u_texture");
+    sprite.m_uOrigin           = shaderUniformOf(sprite.m_pShader, u_origin);
+    sprite.m_uRotation         = shaderUniformOf(sprite.m_pShader, u_rotation);
+    sprite.m_uDepth            = shaderUniformOf(sprite.m_pShader, u_depth);
+    sprite.m_uViewMatrix       = shaderUniformOf(sprite.m_pShader, u_view);
+    sprite.m_uProjectionMatrix = shaderUniformOf(sprite.m_pShader, u_projection);
+    sprite.m_uColor            = shaderUniformOf(sprite.m_pShader, u_color);
+    sprite.m_uTexture          = shaderUniformOf(sprite.m_pShader, u_texture);
+
+    sprite.m_needUpdate.Remove(SpriteComponents::ShaderUniforms);
   }
 
+  bool uploadVB = false;
+
   // Create VertexBuffer, If Needed
   // ==============================
   if(sprite.m_pVertexBuffer == nullptr)
   {
     sprite.m_pVertexBuffer = move(createVertexBuffer(sprite.m_pShader));
-  }
 
-  bool uploadVB = false;
+    // Keep the components flagged, so they are updated once a buffer could be created.
+    if (sprite.m_pVertexBuffer == nullptr)
+    {
+      ezLog::Warning("Failed to create the sprite vertex buffer. Trying again next frame.");
+      return UpdateResult::Retry;
+    }
+
+    // A fresh vertex buffer has no meaningful content yet.
+    uploadVB = true;
+  }
 
   // Update Cutout
   // =============
@@ -149,10 +407,10 @@ void kr::update(Sprite& sprite)
       auto t = float(cutout.height) / float(texHeight); // Top.
       auto b = float(cutout.y)      / float(texHeight); // Bottom.
 
-      sprite.m_vertices[0].texCoords.Set(l, t);
-      sprite.m_vertices[1].texCoords.Set(l, b);
-      sprite.m_vertices[2].texCoords.Set(r, t);
-      sprite.m_vertices[3].texCoords.Set(r, b);
+      sprite.m_vertices[0].texCoords.set(l, t);
+      sprite.m_vertices[1].texCoords.set(l, b);
+      sprite.m_vertices[2].texCoords.set(r, t);
+      sprite.m_vertices[3].texCoords.set(r, b);
     }
     else
     {
@@ -161,10 +419,10 @@ void kr::update(Sprite& sprite)
       cutout.width = texWidth;
       cutout.height = texHeight;
 
-      sprite.m_vertices[0].texCoords.Set(0, 1);
-      sprite.m_vertices[1].texCoords.Set(0, 0);
-      sprite.m_vertices[2].texCoords.Set(1, 1);
-      sprite.m_vertices[3].texCoords.Set(1, 0);
+      sprite.m_vertices[0].texCoords.set(0, 1);
+      sprite.m_vertices[1].texCoords.set(0, 0);
+      sprite.m_vertices[2].texCoords.set(1, 1);
+      sprite.m_vertices[3].texCoords.set(1, 0);
     }
 
     uploadVB = true;
@@ -194,14 +452,140 @@ void kr::update(Sprite& sprite)
     sprite.m_needUpdate.Remove(SpriteComponents::LocalBounds);
   }
 
-  // Upload VertexBuffer Data If Necessary
-  // =====================================
-  if (uploadVB)
+  return uploadVB ? UpdateResult::Upload : UpdateResult::Done;
+}
+
+void kr::update(Sprite& sprite)
+{
+  EZ_LOG_BLOCK("Updating Sprite");
+
+  EZ_LOCK(lockOf());
+
+  if (sprite.prepareUpdate() == Sprite::UpdateResult::Upload)
   {
     uploadData(sprite.getVertexBuffer(), sprite.getVertices());
   }
 }
 
+void kr::processSpriteUpdateQueue()
+{
+  auto& uploads = g_pUpdateQueue->uploads;
+  uploads.Clear();
+
+  // Update Sprite States
+  // ====================
+  // Only this part touches the sprites, so the lock is released before talking to GL.
+  {
+    EZ_LOCK(g_pUpdateQueue->mutex);
+
+    auto& pending = g_pUpdateQueue->pending;
+    if (pending.IsEmpty())
+      return;
+
+    EZ_LOG_BLOCK("Processing Sprite Update Queue");
+
+    ezUInt32 numStillPending = 0;
+    for (auto pSprite : pending)
+    {
+      // The texture dimensions are not known before the texture finished loading.
+      auto& pTexture = pSprite->m_pTexture;
+      if (pTexture != nullptr && pTexture->getLoadState() == TextureLoadState::Loading)
+      {
+        pending[numStillPending++] = pSprite;
+        continue;
+      }
+
+      auto result = pSprite->prepareUpdate();
+      if (result == Sprite::UpdateResult::Retry)
+      {
+        pending[numStillPending++] = pSprite;
+        continue;
+      }
+
+      pSprite->m_isQueued = false;
+
+      if (result == Sprite::UpdateResult::Upload)
+      {
+        auto& upload = uploads.ExpandAndGetRef();
+        ezMemoryUtils::Copy(upload.vertices, pSprite->m_vertices, 4);
+        upload.hBuffer = pSprite->m_pVertexBuffer->m_glHandle;
+        upload.byteOffset = pSprite->m_pVertexBuffer->m_byteOffset;
+      }
+    }
+    pending.SetCount(numStillPending);
+  }
+
+  if (uploads.IsEmpty())
+    return;
+
+  // Write All Vertex Data to the Staging Buffer
+  // ===========================================
+  const ezUInt32 bytesPerSprite = 4 * sizeof(krSpriteVertex);
+  const ezUInt32 byteCount = uploads.GetCount() * bytesPerSprite;
+
+  auto& hStaging = g_pUpdateQueue->hStagingBuffer;
+  if (hStaging == 0)
+  {
+    glCheck(glGenBuffers(1, &hStaging));
+  }
+
+  glCheck(glBindBuffer(GL_COPY_READ_BUFFER, hStaging));
+  KR_ON_SCOPE_EXIT{ glCheck(glBindBuffer(GL_COPY_READ_BUFFER, 0)); };
+
+  auto& stagingSize = g_pUpdateQueue->stagingBufferSize;
+  if (byteCount > stagingSize)
+  {
+    stagingSize = ezMath::Max(byteCount, 2 * stagingSize);
+    glCheck(glBufferData(GL_COPY_READ_BUFFER, stagingSize, nullptr, GL_STREAM_DRAW));
+  }
+
+  auto pStaging = static_cast<ezUInt8*>(glMapBufferRange(GL_COPY_READ_BUFFER,
+                                                         0, byteCount,
+                                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  glCheckLastError();
+
+  if (pStaging == nullptr)
+  {
+    ezLog::Warning("Failed to map the sprite staging buffer. Uploading sprites one by one.");
+    for (auto& upload : uploads)
+    {
+      glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, upload.hBuffer));
+      glCheck(glBufferSubData(GL_COPY_WRITE_BUFFER, upload.byteOffset, bytesPerSprite, upload.vertices));
+    }
+    glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    currentFrameStats().bufferBytesUploaded += byteCount;
+
+    uploads.Clear();
+    return;
+  }
+
+  for (ezUInt32 i = 0; i < uploads.GetCount(); ++i)
+  {
+    ezMemoryUtils::Copy(pStaging + i * bytesPerSprite,
+                        reinterpret_cast<const ezUInt8*>(uploads[i].vertices),
+                        bytesPerSprite);
+  }
+
+  glCheck(glUnmapBuffer(GL_COPY_READ_BUFFER));
+  currentFrameStats().bufferBytesUploaded += byteCount;
+
+  // Distribute the Data to the Vertex Buffers
+  // =========================================
+  // These copies stay on the GPU.
+  for (ezUInt32 i = 0; i < uploads.GetCount(); ++i)
+  {
+    glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, uploads[i].hBuffer));
+    glCheck(glCopyBufferSubData(GL_COPY_READ_BUFFER,   // Source.
+                                GL_COPY_WRITE_BUFFER,  // Destination.
+                                i * bytesPerSprite,    // Source offset.
+                                uploads[i].byteOffset, // Destination offset.
+                                bytesPerSprite));      // Number of bytes.
+  }
+  glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+  uploads.Clear();
+}
+
 bool kr::canRender(const Sprite& sprite)
 {
   return sprite.getTexture() != nullptr
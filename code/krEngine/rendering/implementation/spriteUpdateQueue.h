@@ -0,0 +1,10 @@
+#pragma once
+
+namespace kr
+{
+  /// \brief Processes all sprites that were queued for an update since the last call.
+  ///
+  /// The vertex data of all processed sprites is merged into a single mapped buffer write.
+  /// \note Must be called on the thread that owns the GL context, before drawing.
+  void processSpriteUpdateQueue();
+}
@@ -1,137 +1,1176 @@
 #include <krEngine/rendering/texture.h>
+#include <krEngine/rendering/textureCompression.h>
 #include <krEngine/rendering/implementation/textureImpl.h>
+#include <krEngine/rendering/implementation/textureFormats.h>
+#include <krEngine/rendering/implementation/textureMips.h>
+#include <krEngine/rendering/implementation/cookedTexture.h>
+#include <krEngine/rendering/implementation/mappedFile.h>
 #include <krEngine/rendering/implementation/opelGlCheck.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
 
 #include <Foundation/IO/FileSystem/FileSystem.h>
+#include <Foundation/Threading/TaskSystem.h>
+#include <Foundation/Threading/Mutex.h>
+#include <Foundation/Threading/Lock.h>
 
-using TextureBindings = ezHybridArray<kr::Borrowed<const kr::Texture>, 8>;
+#include <algorithm>
+
+/// \brief Builds the mip chain of \a image on the CPU, if \a options ask for it.
+/// \note Does not touch any GL state.
+/// \return Whether the mip levels still need to be generated on the GPU after uploading.
+static bool prepareMipLevels(ezImage& image, const kr::TextureLoadOptions& options)
+{
+  using namespace kr;
+
+  if (options.mipGeneration == TextureMipGeneration::None)
+    return false;
+
+  // Levels that come with the file are always used as they are.
+  if (image.GetNumMipLevels() > 1)
+    return false;
+
+  if (ezImageFormat::GetType(image.GetImageFormat()) != ezImageFormatType::LINEAR)
+  {
+    ezLog::Warning("Cannot generate mip levels for compressed images.");
+    return false;
+  }
+
+  MipFilter filter;
+  switch(options.mipGeneration)
+  {
+  case TextureMipGeneration::Gpu:
+    // The GPU cannot generate mip levels of compressed textures.
+    if (options.compression == TextureCompression::None)
+      return true;
+    filter = MipFilter::Box;
+    break;
+  case TextureMipGeneration::Box:    filter = MipFilter::Box;    break;
+  case TextureMipGeneration::Kaiser: filter = MipFilter::Kaiser; break;
+  default:
+    EZ_REPORT_FAILURE("Invalid input.");
+    return false;
+  }
+
+  if (generateMipChain(image, filter).Failed())
+  {
+    ezLog::Warning("Cannot filter mip levels of format \"%s\" on the CPU. Using the GPU instead.",
+                   ezImageFormat::GetName(image.GetImageFormat()));
+    return true;
+  }
+
+  return false;
+}
+
+/// \brief Block compresses \a image on the CPU, if \a options ask for it.
+/// \note Does not touch any GL state.
+static void compressIfRequested(ezImage& image, const kr::TextureLoadOptions& options)
+{
+  if (options.compression == kr::TextureCompression::None)
+    return;
+
+  // Already compressed.
+  if (ezImageFormat::GetType(image.GetImageFormat()) != ezImageFormatType::LINEAR)
+    return;
+
+  if (compressImage(image, options.compression, options.compressionQuality).Failed())
+  {
+    ezLog::Warning("Cannot compress format \"%s\". Uploading it uncompressed.",
+                   ezImageFormat::GetName(image.GetImageFormat()));
+  }
+}
+
+/// \brief Maps the cooked texture with the ezFileSystem path \a fileName into memory.
+static ezResult mapCookedTexture(const char* fileName, kr::MappedFile& out_file)
+{
+  ezString absolutePath;
+  if (ezFileSystem::ResolvePath(fileName, false, &absolutePath, nullptr).Failed())
+  {
+    ezLog::Warning("Unable to resolve path of cooked texture.");
+    return EZ_FAILURE;
+  }
+
+  return out_file.open(absolutePath.GetData());
+}
+
+/// \brief Decodes the files \a fileNames as the layers of a texture array.
+/// \note Does not touch any GL state.
+static ezResult decodeArrayLayers(ezArrayPtr<const char* const> fileNames,
+                                  const kr::TextureLoadOptions& options,
+                                  ezDynamicArray<ezImage>& out_images,
+                                  bool& out_generateMipsOnGpu)
+{
+  auto& images = out_images;
+  images.Clear();
+  images.SetCount(fileNames.GetCount());
+
+  out_generateMipsOnGpu = false;
+  for (ezUInt32 i = 0; i < fileNames.GetCount(); ++i)
+  {
+    if (images[i].LoadFrom(fileNames[i]).Failed())
+    {
+      ezLog::Warning("Failed to load layer %u from \"%s\".", i, fileNames[i]);
+      return EZ_FAILURE;
+    }
+
+    out_generateMipsOnGpu = prepareMipLevels(images[i], options);
+    compressIfRequested(images[i], options);
+
+    const auto& first = images[0];
+    const auto& image = images[i];
+    if (image.GetWidth() != first.GetWidth() ||
+        image.GetHeight() != first.GetHeight() ||
+        image.GetImageFormat() != first.GetImageFormat() ||
+        image.GetNumMipLevels() != first.GetNumMipLevels() ||
+        image.GetNumFaces() != 1 || image.GetNumArrayIndices() != 1)
+    {
+      ezLog::Warning("Layer %u (\"%s\") does not match the size, format and mip levels of the first layer.",
+                     i, fileNames[i]);
+      return EZ_FAILURE;
+    }
+  }
+
+  return EZ_SUCCESS;
+}
+
+namespace kr
+{
+  /// \brief Decodes the image of an asynchronously loaded texture on a worker thread.
+  class TextureLoadTask : public ezTask
+  {
+  public: // *** Data
+    TextureImpl* m_pTexture = nullptr;
+    TextureLoadOptions m_options;
+    TextureLoadedCallback m_onLoaded;
+
+    /// \brief Written by the worker thread.
+    ezImage m_image;
+    ezResult m_result = EZ_FAILURE;
+    bool m_generateMipsOnGpu = false;
+
+    /// \brief Cooked textures are mapped instead of decoded.
+    bool m_isCooked = false;
+    MappedFile m_cookedFile;
+
+    /// \brief Decoded layers, if the texture was created by Texture::loadArray().
+    ezDynamicArray<ezImage> m_layers;
+
+    /// \brief Loads an evicted texture again, instead of loading it for the first time.
+    bool m_isReload = false;
+
+  public: // *** Accessors
+    /// \brief Number of bytes that will be uploaded for this texture.
+    ezUInt64 getByteCount() const
+    {
+      if (m_result.Failed())
+        return 0;
+
+      if (m_isCooked)
+        return m_cookedFile.getByteCount();
+
+      ezUInt64 byteCount = m_image.GetDataSize();
+      for (auto& layer : m_layers)
+      {
+        byteCount += layer.GetDataSize();
+      }
+      return byteCount;
+    }
+
+  private: // *** Overrides
+    virtual void Execute() override
+    {
+      if (m_isCooked)
+      {
+        m_result = mapCookedTexture(m_pTexture->m_name.GetData(), m_cookedFile);
+        if (m_result.Succeeded())
+        {
+          touchPages();
+        }
+        return;
+      }
+
+      // Only read here, the array file names never change after loading.
+      auto& arrayFileNames = m_pTexture->m_arrayFileNames;
+      if (!arrayFileNames.IsEmpty())
+      {
+        ezHybridArray<const char*, 8> fileNames;
+        for (auto& fileName : arrayFileNames)
+        {
+          fileNames.PushBack(fileName.GetData());
+        }
+
+        m_result = decodeArrayLayers(fileNames, m_options, m_layers, m_generateMipsOnGpu);
+        return;
+      }
+
+      m_result = m_image.LoadFrom(m_pTexture->m_name.GetData());
+
+      if (m_result.Succeeded())
+      {
+        m_generateMipsOnGpu = prepareMipLevels(m_image, m_options);
+        compressIfRequested(m_image, m_options);
+      }
+    }
+
+    /// \brief Reads one byte of each page, so the render thread does not stall on page faults.
+    void touchPages()
+    {
+      const ezUInt64 pageSize = 4096;
+
+      volatile ezUInt8 sink = 0;
+      for (ezUInt64 i = 0; i < m_cookedFile.getByteCount(); i += pageSize)
+      {
+        sink += m_cookedFile.getData()[i];
+      }
+    }
+  };
+}
+
+namespace
+{
+  /// \brief A texture that finished loading, waiting for its listener to be called.
+  struct LoadedNotification
+  {
+    kr::TextureImpl* pTexture;
+    kr::TextureLoadedCallback onLoaded;
+    ezResult result;
+  };
+
+  struct AsyncTextureLoads
+  {
+    ezMutex mutex;
+
+    /// \brief Tasks that are currently decoding on worker threads.
+    ezDynamicArray<kr::TextureLoadTask*> decoding;
+
+    /// \brief Decoded images waiting for upload, sorted by priority.
+    ezDynamicArray<kr::TextureLoadTask*> uploading;
+
+    /// \brief Listeners are called after releasing the mutex, so they may load or release textures.
+    /// \note Only accessed from the thread that owns the GL context, without the mutex.
+    ezDynamicArray<LoadedNotification> notifications;
+
+    /// \brief Bound instead of textures that are not resident. Arrays get a single layer array instead.
+    GLuint hPlaceholder = 0;
+    GLuint hArrayPlaceholder = 0;
+    GLuint hPixelBuffer = 0;
+    ezUInt32 uploadBudget = 8 * 1024 * 1024;
+  };
+
+  /// \brief Bookkeeping for the GPU memory budget.
+  /// \note Only accessed from the thread that owns the GL context.
+  struct ResidencyTracking
+  {
+    /// \brief All textures that were uploaded at least once.
+    ezDynamicArray<kr::TextureImpl*> textures;
+
+    /// \brief 0 means there is no budget.
+    ezUInt64 budget = 0;
+
+    /// \brief Incremented at each frame boundary. Textures are stamped with it when they are bound.
+    ezUInt64 frame = 1;
+
+    kr::TextureMemoryStats currentFrame;
+    kr::TextureMemoryStats lastFrame;
+
+    /// \brief Whether the budget could not be met at the last frame boundary.
+    bool isOverBudget = false;
+  };
+}
+
+namespace
+{
+  struct TextureBinding
+  {
+    kr::Borrowed<const kr::Texture> pTexture;
+
+    /// \brief The target the texture was bound to.
+    /// \note The target of a texture may change while it is bound, e.g. once it finished loading,
+    ///       so it has to be remembered to unbind the right one.
+    GLenum target = GL_TEXTURE_2D;
+  };
+}
+
+using TextureBindings = ezHybridArray<TextureBinding, 8>;
 using SamplerBindings = ezHybridArray<kr::Borrowed<const kr::Sampler>, 8>;
 
-static TextureBindings* g_pTextureBindings;
-static SamplerBindings* g_pSamplerBindings;
-static bool g_initialized = false;
+static TextureBindings* g_pTextureBindings;
+static SamplerBindings* g_pSamplerBindings;
+static AsyncTextureLoads* g_pAsyncLoads;
+static ResidencyTracking* g_pResidency;
+static bool g_initialized = false;
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, Textures)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pTextureBindings = new (m_mem_textureBindings) TextureBindings();
+    g_pSamplerBindings = new (m_mem_samplerBindings) SamplerBindings();
+    g_pAsyncLoads = new (m_mem_asyncLoads) AsyncTextureLoads();
+    g_pResidency = new (m_mem_residency) ResidencyTracking();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // These belong to the GL context,
+    // which is usually gone by the time the core shuts down.
+    if (g_pAsyncLoads->hPlaceholder != 0)
+    {
+      glCheck(glDeleteTextures(1, &g_pAsyncLoads->hPlaceholder));
+      g_pAsyncLoads->hPlaceholder = 0;
+    }
+
+    if (g_pAsyncLoads->hArrayPlaceholder != 0)
+    {
+      glCheck(glDeleteTextures(1, &g_pAsyncLoads->hArrayPlaceholder));
+      g_pAsyncLoads->hArrayPlaceholder = 0;
+    }
+
+    if (g_pAsyncLoads->hPixelBuffer != 0)
+    {
+      glCheck(glDeleteBuffers(1, &g_pAsyncLoads->hPixelBuffer));
+      g_pAsyncLoads->hPixelBuffer = 0;
+    }
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    // Async Loads
+    // ===========
+    auto numLoading = g_pAsyncLoads->decoding.GetCount() + g_pAsyncLoads->uploading.GetCount();
+    if (numLoading > 0)
+    {
+      ezLog::Error("There are still %u textures loading!", numLoading);
+    }
+
+    g_pAsyncLoads->~AsyncTextureLoads();
+    g_pAsyncLoads = nullptr;
+
+    // Residency
+    // =========
+    if (g_pResidency->textures.GetCount() > 0)
+    {
+      ezLog::Error("There are still %u textures alive!", g_pResidency->textures.GetCount());
+    }
+
+    g_pResidency->~ResidencyTracking();
+    g_pResidency = nullptr;
+
+    // Sampler Bindings
+    // ================
+    if (g_pSamplerBindings->GetCount() > 0)
+    {
+      ezLog::Error("There are still %u active sampler bindings!",
+                    g_pSamplerBindings->GetCount());
+    }
+
+    g_pSamplerBindings->~SamplerBindings();
+    g_pSamplerBindings = nullptr;
+
+    // Texture Bindings
+    // ================
+    if (g_pTextureBindings->GetCount() > 0)
+    {
+      ezLog::Error("There are still %u active texture bindings!",
+                    g_pTextureBindings->GetCount());
+    }
+
+    g_pTextureBindings->~TextureBindings();
+    g_pTextureBindings = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_textureBindings[sizeof(TextureBindings)];
+  ezUInt8 m_mem_samplerBindings[sizeof(SamplerBindings)];
+  ezUInt8 m_mem_asyncLoads[sizeof(AsyncTextureLoads)];
+  ezUInt8 m_mem_residency[sizeof(ResidencyTracking)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+kr::TextureImpl* kr::getImpl(Texture* pTex)
+{
+  return static_cast<TextureImpl*>(pTex);
+}
+
+const kr::TextureImpl* kr::getImpl(const Texture* pTex)
+{
+  return static_cast<const TextureImpl*>(pTex);
+}
+
+static void releaseTexture(kr::Texture* pTex)
+{
+  auto pImpl = getImpl(pTex);
+
+  // Cancel Pending Async Load
+  // =========================
+  kr::TextureLoadTask* pTask = nullptr;
+  {
+    EZ_LOCK(g_pAsyncLoads->mutex);
+    pTask = pImpl->m_pLoadTask;
+    if (pTask)
+    {
+      g_pAsyncLoads->decoding.Remove(pTask);
+      g_pAsyncLoads->uploading.Remove(pTask);
+      pImpl->m_pLoadTask = nullptr;
+    }
+  }
+
+  if (pTask)
+  {
+    // Waits for the task in case it is running already.
+    ezTaskSystem::CancelTask(pTask);
+    EZ_DEFAULT_DELETE(pTask);
+  }
+
+  // Released by an earlier listener of the same frame.
+  auto& notifications = g_pAsyncLoads->notifications;
+  for (ezUInt32 i = notifications.GetCount(); i > 0; --i)
+  {
+    if (notifications[i - 1].pTexture == pImpl)
+      notifications.RemoveAt(i - 1);
+  }
+
+  if (pImpl->m_glHandle != 0)
+  {
+    glCheck(glDeleteTextures(1, &pImpl->m_glHandle));
+  }
+
+  if (pImpl->m_isTracked)
+  {
+    g_pResidency->textures.RemoveSwap(pImpl);
+  }
+
+  EZ_DEFAULT_DELETE(pImpl);
+}
+
+/// \brief The target \a tex has to be bound to.
+static GLenum glTargetOf(const kr::Texture& tex)
+{
+  auto pImpl = getImpl(&tex);
+
+  // Arrays have their own placeholder, everything else uses the 2D one.
+  if (pImpl->m_loadState != kr::TextureLoadState::Loaded || pImpl->m_isEvicted)
+    return tex.isArray() ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+
+  return pImpl->m_glTarget;
+}
+
+/// \brief Binds the texture on top of the binding stack again, if there is one.
+/// \param usedTarget The target that was used in the meantime.
+static void rebindCurrentTexture(GLenum usedTarget)
+{
+  glCheck(glActiveTexture(GL_TEXTURE0));
+  glCheck(glBindTexture(usedTarget, 0));
+
+  if (!g_pTextureBindings->IsEmpty())
+  {
+    auto& current = g_pTextureBindings->PeekBack();
+    auto target = glTargetOf(*current.pTexture);
+    if (target != current.target && target != usedTarget)
+    {
+      glCheck(glBindTexture(current.target, 0));
+    }
+
+    current.target = target;
+    glCheck(glBindTexture(current.target, current.pTexture->getGlHandle()));
+  }
+}
+
+namespace
+{
+  struct SubImage
+  {
+    const void* pPixels;
+    ezUInt32 width;
+    ezUInt32 height;
+    ezUInt32 byteCount;
+  };
+
+  /// \brief Everything needed to upload pixel data, regardless of where it comes from.
+  struct PixelUpload
+  {
+    GLenum target = GL_TEXTURE_2D;
+    kr::GlTextureFormat glFormat;
+    ezImageFormat::Enum imageFormat = ezImageFormat::UNKNOWN;
+
+    ezUInt32 width = 0;
+    ezUInt32 height = 0;
+    ezUInt32 numMipLevels = 0;
+    ezUInt32 numFaces = 1;
+    ezUInt32 numArrayIndices = 1;
+
+    /// \brief Number of bytes of all sub-images.
+    ezUInt64 byteCount = 0;
+
+    /// \brief Let the GPU build a full mip chain from the base level after uploading.
+    bool generateMips = false;
+
+    /// \brief Ordered by mip level, then array index, then face.
+    ezHybridArray<SubImage, 16> subImages;
+  };
+}
+
+/// \brief Number of bytes the GPU needs for the given texture, ignoring any padding of the driver.
+static ezUInt64 estimateGpuByteCount(ezImageFormat::Enum format,
+                                     bool isCompressed,
+                                     ezUInt32 width,
+                                     ezUInt32 height,
+                                     ezUInt32 numMipLevels,
+                                     ezUInt32 numLayers)
+{
+  const ezUInt64 bitsPerPixel = ezImageFormat::GetBitsPerPixel(format);
+
+  ezUInt64 byteCount = 0;
+  for (ezUInt32 mip = 0; mip < numMipLevels; ++mip)
+  {
+    ezUInt64 levelWidth = ezMath::Max(width >> mip, 1u);
+    ezUInt64 levelHeight = ezMath::Max(height >> mip, 1u);
+
+    // Block compressed levels always consist of whole 4x4 blocks.
+    if (isCompressed)
+    {
+      levelWidth = (levelWidth + 3) / 4 * 4;
+      levelHeight = (levelHeight + 3) / 4 * 4;
+    }
+
+    byteCount += levelWidth * levelHeight * bitsPerPixel / 8;
+  }
+
+  return byteCount * numLayers;
+}
+
+/// \brief Uploads all sub-images of \a upload into the texture of \a tex.
+static ezResult uploadPixelData(kr::TextureImpl& tex, const PixelUpload& upload)
+{
+  using namespace kr;
+
+  const auto target = upload.target;
+  const auto& glFormat = upload.glFormat;
+  const auto numAllocatedLevels = upload.generateMips ? computeNumMipLevels(upload.width, upload.height)
+                                                      : upload.numMipLevels;
+  const auto numLayers = upload.numArrayIndices * upload.numFaces;
+  const bool isLayered = target == GL_TEXTURE_2D_ARRAY || target == GL_TEXTURE_CUBE_MAP_ARRAY;
+
+  EZ_ASSERT_DEV(upload.subImages.GetCount() == upload.numMipLevels * numLayers,
+                "Sub-images do not match the dimensions.");
+
+  tex.m_glTarget = target;
+  tex.m_width = upload.width;
+  tex.m_height = upload.height;
+  tex.m_format = upload.imageFormat;
+  tex.m_numMipLevels = numAllocatedLevels;
+  tex.m_numLayers = upload.numArrayIndices;
+  tex.m_byteCount = upload.byteCount;
+  tex.m_gpuByteCount = estimateGpuByteCount(upload.imageFormat, glFormat.isCompressed,
+                                            upload.width, upload.height,
+                                            numAllocatedLevels, numLayers);
+
+  // Freshly uploaded textures count as used, so they are not evicted right away.
+  tex.m_lastBindFrame = g_pResidency->frame;
+  if (!tex.m_isTracked)
+  {
+    g_pResidency->textures.PushBack(&tex);
+    tex.m_isTracked = true;
+  }
+
+  KR_ON_SCOPE_EXIT{ rebindCurrentTexture(target); };
+
+  glCheck(glActiveTexture(GL_TEXTURE0));
+  glCheck(glBindTexture(target, tex.m_glHandle));
+
+  // Allocate Storage for All Levels
+  // ===============================
+  if (isLayered)
+  {
+    glCheck(glTexStorage3D(target, numAllocatedLevels, glFormat.internalFormat,
+                           upload.width, upload.height, numLayers));
+  }
+  else
+  {
+    // Also allocates all faces of a cube map.
+    glCheck(glTexStorage2D(target, numAllocatedLevels, glFormat.internalFormat,
+                           upload.width, upload.height));
+  }
+
+  // Rows of small mip levels and 3 byte formats are not 4 byte aligned.
+  glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+  KR_ON_SCOPE_EXIT{ glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4)); };
+
+  // Upload Each Sub-Image
+  // =====================
+  for (ezUInt32 i = 0; i < upload.subImages.GetCount(); ++i)
+  {
+    const auto& sub = upload.subImages[i];
+    currentFrameStats().textureBytesUploaded += sub.byteCount;
+    const GLint mip = i / numLayers;
+    const GLint layer = i % numLayers;
+
+    if (isLayered)
+    {
+      if (glFormat.isCompressed)
+      {
+        glCheck(glCompressedTexSubImage3D(target, mip, 0, 0, layer, sub.width, sub.height, 1,
+                                          glFormat.internalFormat, sub.byteCount, sub.pPixels));
+      }
+      else
+      {
+        glCheck(glTexSubImage3D(target, mip, 0, 0, layer, sub.width, sub.height, 1,
+                                glFormat.format, glFormat.type, sub.pPixels));
+      }
+    }
+    else
+    {
+      // Without an array, the layer is the face.
+      const GLenum subTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer
+                                                             : target;
+
+      if (glFormat.isCompressed)
+      {
+        glCheck(glCompressedTexSubImage2D(subTarget, mip, 0, 0, sub.width, sub.height,
+                                          glFormat.internalFormat, sub.byteCount, sub.pPixels));
+      }
+      else
+      {
+        glCheck(glTexSubImage2D(subTarget, mip, 0, 0, sub.width, sub.height,
+                                glFormat.format, glFormat.type, sub.pPixels));
+      }
+    }
+  }
+
+  if (upload.generateMips)
+  {
+    glCheck(glGenerateMipmap(target));
+  }
+
+  // Set Default Sampling Options
+  // ============================
+  glCheck(glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0));
+  glCheck(glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, numAllocatedLevels - 1));
+  glCheck(glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT));
+  glCheck(glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT));
+  glCheck(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, numAllocatedLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR
+                                                                                : GL_LINEAR));
+  glCheck(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+  return EZ_SUCCESS;
+}
+
+/// \brief Uploads all mip levels, faces and array slices of \a image.
+/// \param pPixels
+///   Pointer to the pixel data of \a image.
+///   If a pixel unpack buffer is bound, this is the offset into that buffer instead.
+/// \param generateMips Let the GPU build a full mip chain from the base level after uploading.
+static ezResult uploadPixelData(kr::TextureImpl& tex,
+                                const ezImage& image,
+                                const ezUInt8* pPixels,
+                                bool generateMips)
+{
+  using namespace kr;
+
+  PixelUpload upload;
+  upload.imageFormat = image.GetImageFormat();
+
+  if (toGlTextureFormat(upload.imageFormat, upload.glFormat).Failed())
+  {
+    ezLog::Warning("Image format \"%s\" is not supported.",
+                   ezImageFormat::GetName(upload.imageFormat));
+    return EZ_FAILURE;
+  }
+
+  upload.target = glTextureTargetOf(image);
+  upload.width = image.GetWidth();
+  upload.height = image.GetHeight();
+  upload.numMipLevels = image.GetNumMipLevels();
+  upload.numFaces = image.GetNumFaces();
+  upload.numArrayIndices = image.GetNumArrayIndices();
+  upload.byteCount = image.GetDataSize();
+  upload.generateMips = generateMips;
+
+  auto pImageBase = image.GetDataPointer<ezUInt8>();
+
+  for (ezUInt32 mip = 0; mip < upload.numMipLevels; ++mip)
+  {
+    for (ezUInt32 arrayIndex = 0; arrayIndex < upload.numArrayIndices; ++arrayIndex)
+    {
+      for (ezUInt32 face = 0; face < upload.numFaces; ++face)
+      {
+        auto offset = image.GetSubImagePointer<ezUInt8>(mip, face, arrayIndex) - pImageBase;
+
+        auto& sub = upload.subImages.ExpandAndGetRef();
+        sub.pPixels = pPixels + offset;
+        sub.width = image.GetWidth(mip);
+        sub.height = image.GetHeight(mip);
+        sub.byteCount = image.GetDepthPitch(mip);
+      }
+    }
+  }
+
+  return uploadPixelData(tex, upload);
+}
+
+/// \brief Uploads the pixel data of a cooked texture straight from the memory mapping.
+static ezResult uploadCookedPixelData(kr::TextureImpl& tex, const kr::MappedFile& file, bool generateMips)
+{
+  using namespace kr;
+
+  GlTextureFormat glFormat;
+  auto pSubImages = validateCookedTexture(file.getData(), file.getByteCount(), glFormat);
+  if (pSubImages == nullptr)
+  {
+    ezLog::Warning("Invalid or corrupt cooked texture.");
+    return EZ_FAILURE;
+  }
+
+  auto& header = *reinterpret_cast<const CookedTextureHeader*>(file.getData());
+
+  PixelUpload upload;
+  upload.imageFormat = static_cast<ezImageFormat::Enum>(header.imageFormat);
+  upload.glFormat = glFormat;
+  upload.target = header.glTarget;
+  upload.width = header.width;
+  upload.height = header.height;
+  upload.numMipLevels = header.numMipLevels;
+  upload.numFaces = header.numFaces;
+  upload.numArrayIndices = header.numArrayIndices;
+  upload.byteCount = header.byteCount;
+  upload.generateMips = generateMips && header.numMipLevels == 1 && !upload.glFormat.isCompressed;
+
+  for (ezUInt32 i = 0; i < header.numSubImages; ++i)
+  {
+    auto& sub = upload.subImages.ExpandAndGetRef();
+    sub.pPixels = file.getData() + pSubImages[i].offset;
+    sub.width = pSubImages[i].width;
+    sub.height = pSubImages[i].height;
+    sub.byteCount = pSubImages[i].byteCount;
+  }
+
+  return uploadPixelData(tex, upload);
+}
+
+/// \brief Uploads \a image through a pixel unpack buffer,
+///        so the driver can transfer the data without stalling.
+static ezResult uploadPixelDataAsync(kr::TextureImpl& tex, ezImage& image, bool generateMips)
+{
+  auto& loads = *g_pAsyncLoads;
+
+  if (loads.hPixelBuffer == 0)
+  {
+    glCheck(glGenBuffers(1, &loads.hPixelBuffer));
+  }
+
+  const auto byteCount = image.GetDataSize();
+
+  glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, loads.hPixelBuffer));
+  KR_ON_SCOPE_EXIT{ glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0)); };
+
+  // Orphan the previous storage, so we don't have to wait for the last transfer to finish.
+  glCheck(glBufferData(GL_PIXEL_UNPACK_BUFFER, byteCount, nullptr, GL_STREAM_DRAW));
+
+  auto pMapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                  0, byteCount,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  glCheckLastError();
+
+  if (pMapped == nullptr)
+  {
+    ezLog::Warning("Failed to map pixel buffer. Uploading texture '%s' directly.",
+                   tex.m_name.GetData());
+    glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    return uploadPixelData(tex, image, image.GetDataPointer<ezUInt8>(), generateMips);
+  }
+
+  ezMemoryUtils::Copy(static_cast<ezUInt8*>(pMapped), image.GetDataPointer<ezUInt8>(), byteCount);
+  glCheck(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+
+  // With a bound unpack buffer, the pixel pointer is an offset into that buffer.
+  return uploadPixelData(tex, image, nullptr, generateMips);
+}
+
+/// \brief Uploads the decoded \a images as the layers of the GL texture of \a tex.
+static ezResult uploadArrayPixelData(kr::TextureImpl& tex,
+                                     const ezDynamicArray<ezImage>& images,
+                                     bool generateMipsOnGpu)
+{
+  using namespace kr;
+
+  // Describe the Upload
+  // ===================
+  const auto& first = images[0];
+
+  PixelUpload upload;
+  upload.imageFormat = first.GetImageFormat();
+
+  if (toGlTextureFormat(upload.imageFormat, upload.glFormat).Failed())
+  {
+    ezLog::Warning("Image format \"%s\" is not supported.",
+                   ezImageFormat::GetName(upload.imageFormat));
+    return EZ_FAILURE;
+  }
+
+  // Even a single layer has to be an array, so it works with array samplers.
+  upload.target = GL_TEXTURE_2D_ARRAY;
+  upload.width = first.GetWidth();
+  upload.height = first.GetHeight();
+  upload.numMipLevels = first.GetNumMipLevels();
+  upload.numArrayIndices = images.GetCount();
+  upload.generateMips = generateMipsOnGpu;
+
+  // The layers are uploaded straight from their images, without combining them first.
+  for (ezUInt32 mip = 0; mip < upload.numMipLevels; ++mip)
+  {
+    for (const auto& image : images)
+    {
+      auto& sub = upload.subImages.ExpandAndGetRef();
+      sub.pPixels = image.GetSubImagePointer<ezUInt8>(mip, 0, 0);
+      sub.width = image.GetWidth(mip);
+      sub.height = image.GetHeight(mip);
+      sub.byteCount = image.GetDepthPitch(mip);
+      upload.byteCount += sub.byteCount;
+    }
+  }
+
+  return uploadPixelData(tex, upload);
+}
+
+/// \brief Frees the CPU side image data of \a tex according to \a residency.
+/// \pre The image was uploaded already.
+static void applyResidency(kr::TextureImpl& tex, kr::TextureResidency residency)
+{
+  using namespace kr;
+
+  switch(residency)
+  {
+  case TextureResidency::Keep:
+    break;
+  case TextureResidency::DropAfterUpload:
+    tex.m_image = ezImage();
+    break;
+  case TextureResidency::MetadataOnly:
+    {
+      // Describes the same image, but never allocates pixel data.
+      ezImage header;
+      header.SetWidth(tex.m_image.GetWidth());
+      header.SetHeight(tex.m_image.GetHeight());
+      header.SetDepth(tex.m_image.GetDepth());
+      header.SetImageFormat(tex.m_image.GetImageFormat());
+      header.SetNumMipLevels(tex.m_image.GetNumMipLevels());
+      header.SetNumFaces(tex.m_image.GetNumFaces());
+      header.SetNumArrayIndices(tex.m_image.GetNumArrayIndices());
+      tex.m_image = move(header);
+    }
+    break;
+  default:
+    EZ_REPORT_FAILURE("Invalid input.");
+    break;
+  }
+}
+
+static void createPlaceholder(AsyncTextureLoads& loads)
+{
+  // A single white pixel, so tinted sprites still show their color.
+  const ezUInt32 white = 0xFFFFFFFF;
+
+  glCheck(glGenTextures(1, &loads.hPlaceholder));
+  glCheck(glActiveTexture(GL_TEXTURE0));
+  glCheck(glBindTexture(GL_TEXTURE_2D, loads.hPlaceholder));
+  glCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_BGRA, GL_UNSIGNED_BYTE, &white));
+  glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+  glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  rebindCurrentTexture(GL_TEXTURE_2D);
+
+  // Array shaders sample a sampler2DArray, so they need a placeholder of that type.
+  glCheck(glGenTextures(1, &loads.hArrayPlaceholder));
+  glCheck(glBindTexture(GL_TEXTURE_2D_ARRAY, loads.hArrayPlaceholder));
+  glCheck(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_BGRA, GL_UNSIGNED_BYTE, &white));
+  glCheck(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+  glCheck(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  rebindCurrentTexture(GL_TEXTURE_2D_ARRAY);
+}
+
+static ezTaskPriority::Enum translate(kr::TextureLoadPriority priority)
+{
+  switch(priority)
+  {
+  // Only runs on the file access threads, so it never competes with the other loads.
+  case kr::TextureLoadPriority::Low:    return ezTaskPriority::FileAccess;
+  case kr::TextureLoadPriority::Normal: return ezTaskPriority::LongRunning;
+  case kr::TextureLoadPriority::High:   return ezTaskPriority::LongRunningHighPriority;
+  default:
+    break;
+  }
+
+  EZ_REPORT_FAILURE("Invalid input.");
+  return ezTaskPriority::LongRunning;
+}
+
+/// \brief Counts \a tex as reloaded in the texture memory statistics of the current frame.
+static void countReload(const kr::TextureImpl& tex)
+{
+  auto& frame = g_pResidency->currentFrame;
+  frame.reloadedBytes += tex.m_gpuByteCount;
+  ++frame.numReloaded;
+}
+
+/// \brief Hands \a pTask to a worker thread. It is uploaded by processTextureLoads() once decoded.
+static void startLoading(kr::TextureLoadTask* pTask)
+{
+  pTask->m_pTexture->m_pLoadTask = pTask;
+
+  {
+    EZ_LOCK(g_pAsyncLoads->mutex);
+    g_pAsyncLoads->decoding.PushBack(pTask);
+  }
+
+  ezTaskSystem::StartSingleTask(pTask, translate(pTask->m_options.priority));
+}
+
+/// \brief Uploads the decoded image of \a pTask, queues the notification of the listener and destroys the task.
+static void finishLoading(kr::TextureLoadTask* pTask)
+{
+  using namespace kr;
+
+  auto& tex = *pTask->m_pTexture;
+  tex.m_pLoadTask = nullptr;
+
+  if (pTask->m_result.Succeeded())
+  {
+    glCheck(glGenTextures(1, &tex.m_glHandle));
+
+    if (pTask->m_isCooked)
+    {
+      auto generateMips = pTask->m_options.mipGeneration != TextureMipGeneration::None;
+      pTask->m_result = uploadCookedPixelData(tex, pTask->m_cookedFile, generateMips);
+    }
+    else if (!pTask->m_layers.IsEmpty())
+    {
+      pTask->m_result = uploadArrayPixelData(tex, pTask->m_layers, pTask->m_generateMipsOnGpu);
+    }
+    else
+    {
+      pTask->m_result = uploadPixelDataAsync(tex, pTask->m_image, pTask->m_generateMipsOnGpu);
+    }
+  }
+
+  if (pTask->m_result.Succeeded())
+  {
+    // Texture arrays do not keep their images.
+    if (pTask->m_layers.IsEmpty())
+    {
+      tex.m_image = move(pTask->m_image);
+      applyResidency(tex, pTask->m_options.residency);
+    }
 
-EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, Textures)
-  BEGIN_SUBSYSTEM_DEPENDENCIES
-    "Foundation",
-    "Core"
-  END_SUBSYSTEM_DEPENDENCIES
+    tex.m_loadState = TextureLoadState::Loaded;
 
-  ON_CORE_STARTUP
+    if (pTask->m_isReload)
+    {
+      tex.m_isEvicted = false;
+      countReload(tex);
+    }
+  }
+  else if (pTask->m_isReload)
   {
-    g_pTextureBindings = new (m_mem_textureBindings) TextureBindings();
-    g_pSamplerBindings = new (m_mem_samplerBindings) SamplerBindings();
+    ezLog::Warning("Failed to reload evicted texture '%s'. Binding the placeholder instead.",
+                   tex.m_name.GetData());
+    tex.m_loadState = TextureLoadState::Failed;
+  }
+  else
+  {
+    ezLog::Warning("Failed to load texture '%s'.", tex.m_name.GetData());
+    tex.m_loadState = TextureLoadState::Failed;
+  }
 
-    g_initialized = true;
+  if (pTask->m_onLoaded.IsValid())
+  {
+    auto& notification = g_pAsyncLoads->notifications.ExpandAndGetRef();
+    notification.pTexture = &tex;
+    notification.onLoaded = move(pTask->m_onLoaded);
+    notification.result = pTask->m_result;
   }
 
-  ON_CORE_SHUTDOWN
+  EZ_DEFAULT_DELETE(pTask);
+}
+
+/// \brief Uploads decoded images until the upload budget of this frame is used up.
+static void uploadDecodedTextures(AsyncTextureLoads& loads)
+{
+  EZ_LOCK(loads.mutex);
+
+  if (loads.hPlaceholder == 0)
   {
-    // Sampler Bindings
-    // ================
-    if (g_pSamplerBindings->GetCount() > 0)
+    createPlaceholder(loads);
+  }
+
+  // Collect Decoded Images
+  // ======================
+  for (ezUInt32 i = 0; i < loads.decoding.GetCount();)
+  {
+    auto pTask = loads.decoding[i];
+    if (!pTask->IsTaskFinished())
     {
-      ezLog::Error("There are still %u active sampler bindings!",
-                    g_pSamplerBindings->GetCount());
+      ++i;
+      continue;
     }
 
-    g_pSamplerBindings->~SamplerBindings();
-    g_pSamplerBindings = nullptr;
+    loads.decoding.RemoveAt(i);
 
-    // Texture Bindings
-    // ================
-    if (g_pTextureBindings->GetCount() > 0)
+    // Higher priorities go first, equal priorities keep their order.
+    auto insertionIndex = loads.uploading.GetCount();
+    while (insertionIndex > 0
+        && loads.uploading[insertionIndex - 1]->m_options.priority < pTask->m_options.priority)
     {
-      ezLog::Error("There are still %u active texture bindings!",
-                    g_pTextureBindings->GetCount());
+      --insertionIndex;
     }
+    loads.uploading.Insert(pTask, insertionIndex);
+  }
 
-    g_pTextureBindings->~TextureBindings();
-    g_pTextureBindings = nullptr;
+  if (loads.uploading.IsEmpty())
+    return;
 
-    g_initialized = false;
-  }
+  // Upload Within Budget
+  // ====================
+  EZ_LOG_BLOCK("Uploading Asynchronously Loaded Textures");
 
-private:
-  ezUInt8 m_mem_textureBindings[sizeof(TextureBindings)];
-  ezUInt8 m_mem_samplerBindings[sizeof(SamplerBindings)];
-EZ_END_SUBSYSTEM_DECLARATION
+  ezUInt64 uploadedBytes = 0;
+  while (!loads.uploading.IsEmpty())
+  {
+    auto pTask = loads.uploading[0];
+    auto byteCount = pTask->getByteCount();
 
-kr::TextureImpl* kr::getImpl(Texture* pTex)
+    // Always upload at least one texture per frame, so big ones don't get stuck.
+    if (uploadedBytes > 0 && uploadedBytes + byteCount > loads.uploadBudget)
+      break;
+
+    loads.uploading.RemoveAt(0);
+    finishLoading(pTask);
+    uploadedBytes += byteCount;
+  }
+}
+
+void kr::processTextureLoads()
 {
-  return static_cast<TextureImpl*>(pTex);
+  auto& loads = *g_pAsyncLoads;
+
+  uploadDecodedTextures(loads);
+
+  // Notify Listeners
+  // ================
+  // One at a time, since a listener may release the texture of a later notification.
+  auto& notifications = loads.notifications;
+  while (!notifications.IsEmpty())
+  {
+    auto notification = notifications[0];
+    notifications.RemoveAt(0);
+    notification.onLoaded(*notification.pTexture, notification.result);
+  }
 }
 
-const kr::TextureImpl* kr::getImpl(const Texture* pTex)
+/// \brief Loads the file \a fileName into the GL texture of \a tex.
+/// \note Cooked textures are uploaded without decoding or copying them on the CPU,
+///       so they never have an image, regardless of the residency.
+static ezResult loadPixelData(kr::TextureImpl& tex, const char* fileName, const kr::TextureLoadOptions& options)
 {
-  return static_cast<const TextureImpl*>(pTex);
+  using namespace kr;
+
+  if (isCookedTextureFileName(fileName))
+  {
+    MappedFile file;
+    if (mapCookedTexture(fileName, file).Failed())
+      return EZ_FAILURE;
+
+    // Cooked textures can't be filtered on the CPU without decoding them.
+    auto generateMips = options.mipGeneration != TextureMipGeneration::None;
+    return uploadCookedPixelData(tex, file, generateMips);
+  }
+
+  ezImage img;
+  if (img.LoadFrom(fileName).Failed())
+    return EZ_FAILURE;
+
+  auto generateMipsOnGpu = prepareMipLevels(img, options);
+  compressIfRequested(img, options);
+  tex.m_image = move(img);
+
+  auto pPixels = tex.m_image.GetDataPointer<ezUInt8>();
+  if (uploadPixelData(tex, tex.m_image, pPixels, generateMipsOnGpu).Failed())
+    return EZ_FAILURE;
+
+  applyResidency(tex, options.residency);
+  return EZ_SUCCESS;
 }
 
-static void releaseTexture(kr::Texture* pTex)
+/// \brief Loads the files \a fileNames as the layers of the GL texture of \a tex.
+static ezResult loadArrayPixelData(kr::TextureImpl& tex,
+                                   ezArrayPtr<const char* const> fileNames,
+                                   const kr::TextureLoadOptions& options)
 {
-  auto pImpl = getImpl(pTex);
-  EZ_DEFAULT_DELETE(pImpl);
+  ezDynamicArray<ezImage> images;
+  bool generateMipsOnGpu = false;
+  if (decodeArrayLayers(fileNames, options, images, generateMipsOnGpu).Failed())
+    return EZ_FAILURE;
+
+  return uploadArrayPixelData(tex, images, generateMipsOnGpu);
 }
 
-static void uploadPixelData(kr::Borrowed<kr::Texture> texture)
+/// \brief Whether \a tex still has its decoded pixel data on the CPU.
+static bool hasResidentImage(const kr::TextureImpl& tex)
 {
-  KR_RAII_BIND_TEXTURE_2D(texture, kr::TextureSlot(0));
+  using namespace kr;
 
-  auto pTex = getImpl(texture);
-  auto pixels = pTex->m_image.GetSubImagePointer<void>();
+  // Cooked textures and texture arrays never keep their images.
+  return tex.m_options.residency == TextureResidency::Keep
+      && tex.m_arrayFileNames.IsEmpty()
+      && !isCookedTextureFileName(tex.m_name.GetData());
+}
 
-  glCheck(glBindTexture(GL_TEXTURE_2D, pTex->m_glHandle));
+/// \brief Loads the pixel data of an evicted texture again, the same way it was loaded initially.
+///
+/// A resident image is uploaded right away. Anything else is read from disk on a worker thread
+/// and uploaded by processTextureLoads(), so binding never waits for the file.
+/// Until then, the placeholder is bound instead.
+static void reloadPixelData(kr::TextureImpl& tex)
+{
+  using namespace kr;
 
-  auto texFormatType = ezImageFormat::GetType(pTex->m_image.GetImageFormat());
-  if (texFormatType == ezImageFormatType::LINEAR)
-  {
-    glCheck(glTexImage2D(GL_TEXTURE_2D,              // Target
-                         0,                          // (Mip) Level
-                         GL_RGBA,                    // Format used by OpenGL (not our pixels).
-                         pTex->m_image.GetWidth(),   // Texture width
-                         pTex->m_image.GetHeight(),  // Texture height
-                         0,                          // Must be 0, as per the specification.
-                         GL_BGRA,                    // Format of the pixels (see last argument).
-                         GL_UNSIGNED_BYTE,           // Size per pixel.
-                         pixels));                   // The actual pixel data.
-  }
-  else if(texFormatType == ezImageFormatType::BLOCK_COMPRESSED)
+  EZ_LOG_BLOCK("Reloading Evicted Texture", tex.m_name.GetData());
+
+  if (hasResidentImage(tex))
   {
-    GLenum glFormat;
+    glCheck(glGenTextures(1, &tex.m_glHandle));
 
-    auto texImageFormat = pTex->m_image.GetImageFormat();
-    switch(texImageFormat)
+    // Levels beyond those of the image were generated on the GPU.
+    auto generateMipsOnGpu = tex.m_image.GetNumMipLevels() < tex.m_numMipLevels;
+    auto pPixels = tex.m_image.GetDataPointer<ezUInt8>();
+    if (uploadPixelData(tex, tex.m_image, pPixels, generateMipsOnGpu).Succeeded())
     {
-    case ezImageFormat::BC3_UNORM:
-      glFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
-      break;
-      // TODO Support more types.
-    default:
-      ezLog::Warning("Image format \"%s\" not supported at this time. Please export your image as BC3/DXT5",
-                     ezImageFormat::GetName(texImageFormat));
+      tex.m_isEvicted = false;
+      countReload(tex);
       return;
     }
 
-    glCheck(glCompressedTexImage2D(GL_TEXTURE_2D,                // Target
-                                   0,                            // (Mip) Level
-                                   glFormat,                     // Format used by OpenGL (not our pixels).
-                                   pTex->m_image.GetWidth(),     // Texture width
-                                   pTex->m_image.GetHeight(),    // Texture height
-                                   0,                            // Must be 0, as per the specification.
-                                   pTex->m_image.GetDataSize(),  // Number of bytes of the pixel data.
-                                   pixels));                     // The actual pixel data.
+    ezLog::Warning("Failed to upload the resident image. Loading it from disk instead.");
+    glCheck(glDeleteTextures(1, &tex.m_glHandle));
+    tex.m_glHandle = 0;
   }
 
-  // Set Default Sampling Options
-  // ============================
-  glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-  glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-  glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-  glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  auto pTask = EZ_DEFAULT_NEW(TextureLoadTask);
+  pTask->SetTaskName("Reload Evicted Texture");
+  pTask->m_pTexture = &tex;
+  pTask->m_options = tex.m_options;
+  pTask->m_isCooked = tex.m_arrayFileNames.IsEmpty() && isCookedTextureFileName(tex.m_name.GetData());
+  pTask->m_isReload = true;
+
+  startLoading(pTask);
 }
 
 // static
-kr::Owned<kr::Texture> kr::Texture::load(ezStringView fileName)
+kr::Owned<kr::Texture> kr::Texture::load(ezStringView fileName, TextureLoadOptions options)
 {
   ezStringBuilder sbFileName(fileName);
   EZ_LOG_BLOCK("Loading Texture", sbFileName);
@@ -139,22 +1178,88 @@ kr::Owned<kr::Texture> kr::Texture::load(ezStringView fileName)
   EZ_ASSERT_DEV(g_initialized, "Textures subsystem not initialized. "
                                "Did you forget to start the ezEngine?");
 
-  ezImage img;
-  if (img.LoadFrom(sbFileName).Failed())
+  TextureImpl* pTex = EZ_DEFAULT_NEW(TextureImpl);
+  pTex->m_name = sbFileName;
+  pTex->m_options = options;
+  glCheck(glGenTextures(1, &pTex->m_glHandle));
+
+  auto tex = own<Texture>(pTex, releaseTexture);
+
+  if (loadPixelData(*pTex, sbFileName, options).Failed())
   {
-    // Loading failed.
     return nullptr;
   }
 
+  return move(tex);
+}
+
+// static
+kr::Owned<kr::Texture> kr::Texture::loadAsync(ezStringView fileName,
+                                              TextureLoadOptions options,
+                                              TextureLoadedCallback onLoaded)
+{
+  ezStringBuilder sbFileName(fileName);
+  EZ_LOG_BLOCK("Loading Texture Asynchronously", sbFileName);
+
+  EZ_ASSERT_DEV(g_initialized, "Textures subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
   TextureImpl* pTex = EZ_DEFAULT_NEW(TextureImpl);
   pTex->m_name = sbFileName;
-  pTex->m_image = move(img);
+  pTex->m_loadState = TextureLoadState::Loading;
+  pTex->m_options = options;
+
+  auto pTask = EZ_DEFAULT_NEW(TextureLoadTask);
+  pTask->SetTaskName("Decode Texture");
+  pTask->m_pTexture = pTex;
+  pTask->m_options = options;
+  pTask->m_onLoaded = move(onLoaded);
+  pTask->m_isCooked = isCookedTextureFileName(sbFileName);
+
+  startLoading(pTask);
+
+  return own<Texture>(pTex, releaseTexture);
+}
+
+// static
+kr::Owned<kr::Texture> kr::Texture::loadArray(ezArrayPtr<const char* const> fileNames,
+                                              TextureLoadOptions options)
+{
+  EZ_LOG_BLOCK("Loading Texture Array");
+
+  EZ_ASSERT_DEV(g_initialized, "Textures subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  if (fileNames.IsEmpty())
+  {
+    ezLog::Warning("Cannot create a texture array without any layers.");
+    return nullptr;
+  }
+
+  ezStringBuilder name;
+  for (ezUInt32 i = 0; i < fileNames.GetCount(); ++i)
+  {
+    if (i > 0)
+      name.Append(";");
+    name.Append(fileNames[i]);
+  }
+
+  TextureImpl* pTex = EZ_DEFAULT_NEW(TextureImpl);
+  pTex->m_name = name;
+  pTex->m_glTarget = GL_TEXTURE_2D_ARRAY;
+  pTex->m_options = options;
+  for (auto fileName : fileNames)
+  {
+    pTex->m_arrayFileNames.PushBack(fileName);
+  }
   glCheck(glGenTextures(1, &pTex->m_glHandle));
 
   auto tex = own<Texture>(pTex, releaseTexture);
 
-  // TODO Defer uploading pixel data?
-  uploadPixelData(tex);
+  if (loadArrayPixelData(*pTex, fileNames, options).Failed())
+  {
+    return nullptr;
+  }
 
   return move(tex);
 }
@@ -168,9 +1273,185 @@ const kr::TextureName& kr::Texture::getName() const
   return getImpl(this)->m_name;
 }
 
+ezUInt32 kr::Texture::getWidth() const
+{
+  return getImpl(this)->m_width;
+}
+
+ezUInt32 kr::Texture::getHeight() const
+{
+  return getImpl(this)->m_height;
+}
+
+ezImageFormat::Enum kr::Texture::getFormat() const
+{
+  return getImpl(this)->m_format;
+}
+
+ezUInt32 kr::Texture::getNumMipLevels() const
+{
+  return getImpl(this)->m_numMipLevels;
+}
+
+ezUInt64 kr::Texture::getByteCount() const
+{
+  return getImpl(this)->m_byteCount;
+}
+
+ezUInt32 kr::Texture::getNumLayers() const
+{
+  return getImpl(this)->m_numLayers;
+}
+
+ezUInt64 kr::Texture::getGpuByteCount() const
+{
+  return getImpl(this)->m_gpuByteCount;
+}
+
+bool kr::Texture::isResident() const
+{
+  auto pImpl = getImpl(this);
+  return pImpl->m_loadState == TextureLoadState::Loaded && !pImpl->m_isEvicted;
+}
+
+bool kr::Texture::isArray() const
+{
+  return getImpl(this)->m_glTarget == GL_TEXTURE_2D_ARRAY;
+}
+
 ezUInt32 kr::Texture::getGlHandle() const
 {
-  return static_cast<ezUInt32>(getImpl(this)->m_glHandle);
+  auto pImpl = getImpl(this);
+  if (pImpl->m_loadState != TextureLoadState::Loaded || pImpl->m_isEvicted)
+  {
+    auto hPlaceholder = isArray() ? g_pAsyncLoads->hArrayPlaceholder : g_pAsyncLoads->hPlaceholder;
+    return static_cast<ezUInt32>(hPlaceholder);
+  }
+
+  return static_cast<ezUInt32>(pImpl->m_glHandle);
+}
+
+kr::TextureLoadState kr::Texture::getLoadState() const
+{
+  return getImpl(this)->m_loadState;
+}
+
+void kr::setTextureUploadBudget(ezUInt32 bytesPerFrame)
+{
+  g_pAsyncLoads->uploadBudget = bytesPerFrame;
+}
+
+ezUInt32 kr::getTextureUploadBudget()
+{
+  return g_pAsyncLoads->uploadBudget;
+}
+
+void kr::setTextureMemoryBudget(ezUInt64 byteCount)
+{
+  g_pResidency->budget = byteCount;
+}
+
+ezUInt64 kr::getTextureMemoryBudget()
+{
+  return g_pResidency->budget;
+}
+
+kr::TextureMemoryStats kr::getTextureMemoryStats()
+{
+  return g_pResidency->lastFrame;
+}
+
+/// \brief Frees the GPU memory of \a tex. It is loaded again the next time it is bound.
+static void evict(kr::TextureImpl& tex)
+{
+  glCheck(glDeleteTextures(1, &tex.m_glHandle));
+  tex.m_glHandle = 0;
+  tex.m_isEvicted = true;
+
+  auto& frame = g_pResidency->currentFrame;
+  frame.evictedBytes += tex.m_gpuByteCount;
+  ++frame.numEvicted;
+}
+
+/// \brief Logs when the textures start or stop exceeding the budget, instead of every frame.
+static void updateOverBudget(ResidencyTracking& residency, ezUInt64 residentBytes)
+{
+  const bool isOverBudget = residency.budget != 0 && residentBytes > residency.budget;
+  if (isOverBudget == residency.isOverBudget)
+    return;
+
+  residency.isOverBudget = isOverBudget;
+
+  if (isOverBudget)
+  {
+    ezLog::Warning("Textures exceed their memory budget by %llu bytes, "
+                   "but all remaining textures were used in the last frame.",
+                   residentBytes - residency.budget);
+  }
+  else
+  {
+    ezLog::Info("Textures are within their memory budget again.");
+  }
+}
+
+void kr::updateTextureResidency()
+{
+  auto& residency = *g_pResidency;
+
+  // Finish the Last Frame
+  // =====================
+  auto& stats = residency.currentFrame;
+  for (auto pTex : residency.textures)
+  {
+    stats.totalBytes += pTex->m_gpuByteCount;
+    ++stats.numTextures;
+
+    if (!pTex->m_isEvicted)
+    {
+      stats.residentBytes += pTex->m_gpuByteCount;
+      ++stats.numResident;
+    }
+  }
+
+  residency.lastFrame = stats;
+  residency.currentFrame = TextureMemoryStats();
+
+  const auto lastFrame = residency.frame++;
+
+  if (residency.budget == 0 || residency.lastFrame.residentBytes <= residency.budget)
+  {
+    updateOverBudget(residency, residency.lastFrame.residentBytes);
+    return;
+  }
+
+  // Evict Least Recently Bound
+  // ==========================
+  EZ_LOG_BLOCK("Evicting Textures");
+
+  // Textures bound in the last frame will most likely be needed again right away.
+  ezDynamicArray<TextureImpl*> candidates;
+  for (auto pTex : residency.textures)
+  {
+    if (!pTex->m_isEvicted && pTex->m_glHandle != 0 && pTex->m_lastBindFrame < lastFrame)
+    {
+      candidates.PushBack(pTex);
+    }
+  }
+
+  std::sort(candidates.GetData(), candidates.GetData() + candidates.GetCount(),
+            [](const TextureImpl* lhs, const TextureImpl* rhs){ return lhs->m_lastBindFrame < rhs->m_lastBindFrame; });
+
+  auto residentBytes = residency.lastFrame.residentBytes;
+  for (auto pTex : candidates)
+  {
+    if (residentBytes <= residency.budget)
+      break;
+
+    residentBytes -= pTex->m_gpuByteCount;
+    evict(*pTex);
+  }
+
+  updateOverBudget(residency, residentBytes);
 }
 
 ezResult kr::bind(Borrowed<const Texture> pTexture, TextureSlot slot)
@@ -181,16 +1462,31 @@ ezResult kr::bind(Borrowed<const Texture> pTexture, TextureSlot slot)
     return EZ_FAILURE;
   }
 
+  // Residency is bookkeeping, not part of the observable state of the texture.
+  auto pImpl = const_cast<TextureImpl*>(getImpl(&*pTexture));
+
+  // Binds the placeholder while reloading.
+  if (pImpl->m_isEvicted && pImpl->m_loadState == TextureLoadState::Loaded && pImpl->m_pLoadTask == nullptr)
+  {
+    reloadPixelData(*pImpl);
+  }
+
+  pImpl->m_lastBindFrame = g_pResidency->frame;
+
   auto handle = pTexture->getGlHandle();
+  auto target = glTargetOf(*pTexture);
 
   // Set the active texture unit.
   glCheck(glActiveTexture(GL_TEXTURE0 + slot.value));
 
   // Bind the texture.
-  glCheck(glBindTexture(GL_TEXTURE_2D, handle));
+  glCheck(glBindTexture(target, handle));
+  ++currentFrameStats().numTextureChanges;
 
-  // Save the texture ptr.
-  g_pTextureBindings->ExpandAndGetRef() = move(pTexture);
+  // Save the texture ptr and where it went.
+  auto& binding = g_pTextureBindings->ExpandAndGetRef();
+  binding.pTexture = move(pTexture);
+  binding.target = target;
 
   return EZ_SUCCESS;
 }
@@ -204,28 +1500,38 @@ ezResult kr::restoreLastTexture2D(TextureSlot slot)
   }
 
   // Drop the current binding.
+  auto droppedTarget = g_pTextureBindings->PeekBack().target;
   g_pTextureBindings->PopBack();
+  ++currentFrameStats().numTextureChanges;
 
   // Set the active texture unit.
   glCheck(glActiveTexture(GL_TEXTURE0 + slot.value));
 
   if(g_pTextureBindings->IsEmpty())
   {
-    glCheck(glBindTexture(GL_TEXTURE_2D, 0));
+    glCheck(glBindTexture(droppedTarget, 0));
     return EZ_SUCCESS;
   }
 
   // Get the handle of the current binding.
-  auto handle = g_pTextureBindings->PeekBack()->getGlHandle();
+  // It may have finished loading in the meantime, so its target is looked up again.
+  auto& current = g_pTextureBindings->PeekBack();
+  current.target = glTargetOf(*current.pTexture);
+
+  // Don't leave the dropped texture bound to a different target of this unit.
+  if (current.target != droppedTarget)
+  {
+    glCheck(glBindTexture(droppedTarget, 0));
+  }
 
   // And actually bind it again.
-  glCheck(glBindTexture(GL_TEXTURE_2D, handle));
+  glCheck(glBindTexture(current.target, current.pTexture->getGlHandle()));
 
   return EZ_SUCCESS;
 }
 
 // static
-kr::Owned<kr::Sampler> kr::Sampler::create()
+kr::Owned<kr::Sampler> kr::Sampler::create(const SamplerDesc& desc)
 {
   GLuint h;
   glCheck(glGenSamplers(1, &h));
@@ -237,8 +1543,10 @@ kr::Owned<kr::Sampler> kr::Sampler::create()
 
   Sampler* pSampler = EZ_DEFAULT_NEW(Sampler);
   pSampler->m_glHandle = h;
-  pSampler->setFiltering(pSampler->m_filtering);
-  pSampler->setWrapping(pSampler->m_wrapping);
+  pSampler->setFiltering(desc.filtering);
+  pSampler->setWrapping(desc.wrapping);
+  pSampler->setMaxAnisotropy(desc.maxAnisotropy);
+  pSampler->setLodBias(desc.lodBias);
   return own(pSampler, [](Sampler* s){ EZ_DEFAULT_DELETE(s); });
 }
 
@@ -265,6 +1573,22 @@ static GLenum translate(kr::TextureFiltering f)
   return 0;
 }
 
+/// \brief Magnification never uses mip maps, so only the filter within a level is relevant.
+static GLenum translateMagFilter(kr::TextureFiltering f)
+{
+  switch(f)
+  {
+  case kr::TextureFiltering::Nearest:
+  case kr::TextureFiltering::NearestMipMapNearest:
+  case kr::TextureFiltering::NearestMpMapLinear:
+    return GL_NEAREST;
+  default:
+    break;
+  }
+
+  return GL_LINEAR;
+}
+
 static GLenum translate(kr::TextureWrapping w)
 {
   switch(w)
@@ -284,9 +1608,8 @@ static GLenum translate(kr::TextureWrapping w)
 void kr::Sampler::setFiltering(TextureFiltering filtering)
 {
   m_filtering = filtering;
-  auto value = translate(filtering);
-  glCheck(glSamplerParameteri(m_glHandle, GL_TEXTURE_MIN_FILTER, value));
-  glCheck(glSamplerParameteri(m_glHandle, GL_TEXTURE_MAG_FILTER, value));
+  glCheck(glSamplerParameteri(m_glHandle, GL_TEXTURE_MIN_FILTER, translate(filtering)));
+  glCheck(glSamplerParameteri(m_glHandle, GL_TEXTURE_MAG_FILTER, translateMagFilter(filtering)));
 }
 
 void kr::Sampler::setWrapping(TextureWrapping wrapping)
@@ -297,6 +1620,52 @@ void kr::Sampler::setWrapping(TextureWrapping wrapping)
   glCheck(glSamplerParameteri(m_glHandle, GL_TEXTURE_WRAP_T, value));
 }
 
+kr::SamplerDesc kr::normalized(SamplerDesc desc)
+{
+  // Comparisons with NaN are false, so these also replace NaNs.
+  desc.maxAnisotropy = desc.maxAnisotropy >= 1.0f ? desc.maxAnisotropy : 1.0f;
+  desc.lodBias = desc.lodBias == desc.lodBias ? desc.lodBias : 0.0f;
+
+  // Adding 0 turns -0 into +0.
+  desc.maxAnisotropy += 0.0f;
+  desc.lodBias += 0.0f;
+
+  return desc;
+}
+
+void kr::Sampler::setMaxAnisotropy(float maxAnisotropy)
+{
+  SamplerDesc desc;
+  desc.maxAnisotropy = maxAnisotropy;
+  m_maxAnisotropy = normalized(desc).maxAnisotropy;
+
+  if (!GLEW_EXT_texture_filter_anisotropic)
+    return;
+
+  GLfloat supportedMax = 1.0f;
+  glCheck(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &supportedMax));
+  glCheck(glSamplerParameterf(m_glHandle, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                              ezMath::Min(m_maxAnisotropy, supportedMax)));
+}
+
+void kr::Sampler::setLodBias(float lodBias)
+{
+  SamplerDesc desc;
+  desc.lodBias = lodBias;
+  m_lodBias = normalized(desc).lodBias;
+  glCheck(glSamplerParameterf(m_glHandle, GL_TEXTURE_LOD_BIAS, m_lodBias));
+}
+
+kr::SamplerDesc kr::Sampler::getDesc() const
+{
+  SamplerDesc desc;
+  desc.filtering = m_filtering;
+  desc.wrapping = m_wrapping;
+  desc.maxAnisotropy = m_maxAnisotropy;
+  desc.lodBias = m_lodBias;
+  return desc;
+}
+
 ezResult kr::bind(Borrowed<const Sampler> pSampler, TextureSlot slot)
 {
   if (pSampler == nullptr)
@@ -309,6 +1678,7 @@ ezResult kr::bind(Borrowed<const Sampler> pSampler, TextureSlot slot)
 
   // Bind the texture.
   glCheck(glBindSampler(slot.value, pSampler->m_glHandle));
+  ++currentFrameStats().numSamplerChanges;
 
   // Save the handle.
   g_pSamplerBindings->ExpandAndGetRef() = move(pSampler);
@@ -326,6 +1696,7 @@ ezResult kr::restoreLastSampler(TextureSlot slot)
 
   // Drop the current binding.
   g_pSamplerBindings->PopBack();
+  ++currentFrameStats().numSamplerChanges;
 
   if(g_pSamplerBindings->IsEmpty())
   {
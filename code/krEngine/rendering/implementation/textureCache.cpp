@@ -0,0 +1,392 @@
+#include <krEngine/rendering/textureCache.h>
+
+#include <Foundation/Containers/HashTable.h>
+#include <Foundation/Algorithm/Hashing.h>
+#include <Foundation/Threading/Mutex.h>
+#include <Foundation/Threading/Lock.h>
+
+#include <algorithm>
+
+namespace
+{
+  struct CacheEntry
+  {
+    kr::Owned<kr::Texture> pTexture;
+
+    /// \brief Options the texture was loaded with. Part of the key, together with the name.
+    kr::TextureLoadOptions options;
+
+    /// \brief Value of the use counter at the time of the last request. Used for eviction.
+    ezUInt64 lastUse = 0;
+
+    /// \brief Number of requests that were served by this entry.
+    ezUInt32 numHits = 0;
+  };
+
+  /// \brief Names with the same hash share a bucket.
+  using Bucket = ezHybridArray<CacheEntry*, 1>;
+
+  struct TextureCacheData
+  {
+    ezMutex mutex;
+    ezHashTable<ezUInt32, Bucket> buckets;
+    ezUInt32 numEntries = 0;
+    ezUInt64 useCounter = 0;
+    ezUInt64 budget = 256 * 1024 * 1024;
+    kr::TextureCacheStats stats;
+  };
+}
+
+static TextureCacheData* g_pCache;
+static bool g_initialized = false;
+
+static ezUInt64 byteCountOf(const CacheEntry& entry)
+{
+  return entry.pTexture->getByteCount();
+}
+
+static bool isUnused(const CacheEntry& entry)
+{
+  return entry.pTexture.data.refCount == 0;
+}
+
+static bool hasFailed(const CacheEntry& entry)
+{
+  return entry.pTexture->getLoadState() == kr::TextureLoadState::Failed;
+}
+
+static void clearCache(TextureCacheData& cache)
+{
+  for (auto it = cache.buckets.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      if (!isUnused(*pEntry))
+      {
+        // The borrowers point into the entry, so we cannot free it.
+        ezLog::Error("Cached texture '%s' is still borrowed %u times. Leaking it.",
+                     pEntry->pTexture->getName().GetData(),
+                     static_cast<ezUInt32>(pEntry->pTexture.data.refCount));
+        continue;
+      }
+
+      EZ_DEFAULT_DELETE(pEntry);
+    }
+  }
+
+  cache.buckets.Clear();
+  cache.numEntries = 0;
+}
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, TextureCache)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core",
+    "Textures"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pCache = new (m_mem_cache) TextureCacheData();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // Unloading textures needs the GL context,
+    // which is usually gone by the time the core shuts down.
+    EZ_LOCK(g_pCache->mutex);
+    clearCache(*g_pCache);
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    clearCache(*g_pCache);
+
+    g_pCache->~TextureCacheData();
+    g_pCache = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_cache[sizeof(TextureCacheData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+static ezUInt32 hashName(const kr::TextureName& name)
+{
+  return ezHashing::MurmurHash(name.GetData(), name.GetElementCount());
+}
+
+/// \brief Whether textures loaded with these options have the same content.
+/// \note The priority only affects when a texture is loaded, so it is not compared.
+static bool haveSameContent(const kr::TextureLoadOptions& lhs, const kr::TextureLoadOptions& rhs)
+{
+  return lhs.mipGeneration == rhs.mipGeneration
+      && lhs.residency == rhs.residency
+      && lhs.compression == rhs.compression
+      && lhs.compressionQuality == rhs.compressionQuality;
+}
+
+static CacheEntry* find(TextureCacheData& cache, ezUInt32 hash,
+                        const kr::TextureName& name, const kr::TextureLoadOptions& options)
+{
+  Bucket* pBucket = nullptr;
+  if (!cache.buckets.TryGetValue(hash, pBucket))
+    return nullptr;
+
+  for (auto pEntry : *pBucket)
+  {
+    if (pEntry->pTexture->getName() == name && haveSameContent(pEntry->options, options))
+      return pEntry;
+  }
+
+  return nullptr;
+}
+
+static void remove(TextureCacheData& cache, CacheEntry* pEntry)
+{
+  auto hash = hashName(pEntry->pTexture->getName());
+
+  Bucket* pBucket = nullptr;
+  if (cache.buckets.TryGetValue(hash, pBucket))
+  {
+    pBucket->Remove(pEntry);
+    if (pBucket->IsEmpty())
+    {
+      cache.buckets.Remove(hash);
+    }
+  }
+
+  --cache.numEntries;
+  EZ_DEFAULT_DELETE(pEntry);
+}
+
+/// \brief Unloads the least recently requested unused textures until the cache is within budget.
+/// \param forceAll Unload all unused textures, regardless of the budget.
+static ezUInt32 evict(TextureCacheData& cache, bool forceAll)
+{
+  ezDynamicArray<CacheEntry*> candidates;
+  ezUInt64 totalBytes = 0;
+
+  for (auto it = cache.buckets.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      totalBytes += byteCountOf(*pEntry);
+      if (isUnused(*pEntry))
+      {
+        candidates.PushBack(pEntry);
+      }
+    }
+  }
+
+  if (!forceAll && totalBytes <= cache.budget)
+    return 0;
+
+  std::sort(candidates.GetData(), candidates.GetData() + candidates.GetCount(),
+            [](const CacheEntry* lhs, const CacheEntry* rhs){ return lhs->lastUse < rhs->lastUse; });
+
+  ezUInt32 numEvicted = 0;
+  for (auto pEntry : candidates)
+  {
+    if (!forceAll && totalBytes <= cache.budget)
+      break;
+
+    totalBytes -= byteCountOf(*pEntry);
+    remove(cache, pEntry);
+    ++numEvicted;
+  }
+
+  if (!forceAll && totalBytes > cache.budget)
+  {
+    ezLog::Warning("Texture cache exceeds its budget by %llu bytes, "
+                   "but all remaining textures are in use.",
+                   totalBytes - cache.budget);
+  }
+
+  return numEvicted;
+}
+
+using LoadFunction = kr::Owned<kr::Texture>(*)(ezStringView, kr::TextureLoadOptions);
+
+static kr::Borrowed<kr::Texture> loadCached(ezStringView fileName,
+                                            kr::TextureLoadOptions options,
+                                            LoadFunction loadFunc)
+{
+  using namespace kr;
+
+  EZ_ASSERT_DEV(g_initialized, "TextureCache subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  auto& cache = *g_pCache;
+
+  EZ_LOCK(cache.mutex);
+
+  TextureName name(fileName);
+  auto hash = hashName(name);
+
+  // Look Up
+  // =======
+  auto pEntry = find(cache, hash, name, options);
+
+  // Load it again, e.g. in case the file was missing and is there now.
+  // Failed textures that are still borrowed have to stay, since the borrowers point into the entry.
+  if (pEntry && hasFailed(*pEntry) && isUnused(*pEntry))
+  {
+    remove(cache, pEntry);
+    pEntry = nullptr;
+  }
+
+  if (pEntry)
+  {
+    ++cache.stats.numHits;
+    ++pEntry->numHits;
+    pEntry->lastUse = ++cache.useCounter;
+    return borrow(pEntry->pTexture);
+  }
+
+  ++cache.stats.numMisses;
+
+  // Load
+  // ====
+  auto pTexture = loadFunc(name, options);
+  if (pTexture == nullptr)
+    return nullptr;
+
+  pEntry = EZ_DEFAULT_NEW(CacheEntry);
+  pEntry->pTexture = move(pTexture);
+  pEntry->options = options;
+  pEntry->lastUse = ++cache.useCounter;
+
+  Bucket* pBucket = nullptr;
+  if (!cache.buckets.TryGetValue(hash, pBucket))
+  {
+    cache.buckets.Insert(hash, Bucket());
+    cache.buckets.TryGetValue(hash, pBucket);
+  }
+  pBucket->PushBack(pEntry);
+  ++cache.numEntries;
+
+  // Borrow it before evicting, so the new texture is never a candidate.
+  auto result = borrow(pEntry->pTexture);
+  cache.stats.numEvictions += evict(cache, false);
+
+  return result;
+}
+
+kr::Borrowed<kr::Texture> kr::TextureCache::load(ezStringView fileName,
+                                                 TextureLoadOptions options)
+{
+  return loadCached(fileName, options, &Texture::load);
+}
+
+static kr::Owned<kr::Texture> loadAsyncWithoutCallback(ezStringView fileName,
+                                                       kr::TextureLoadOptions options)
+{
+  return kr::Texture::loadAsync(fileName, options);
+}
+
+kr::Borrowed<kr::Texture> kr::TextureCache::loadAsync(ezStringView fileName,
+                                                      TextureLoadOptions options)
+{
+  return loadCached(fileName, options, &loadAsyncWithoutCallback);
+}
+
+bool kr::TextureCache::contains(ezStringView fileName)
+{
+  TextureName name(fileName);
+
+  EZ_LOCK(g_pCache->mutex);
+
+  Bucket* pBucket = nullptr;
+  if (!g_pCache->buckets.TryGetValue(hashName(name), pBucket))
+    return false;
+
+  for (auto pEntry : *pBucket)
+  {
+    if (pEntry->pTexture->getName() == name)
+      return true;
+  }
+
+  return false;
+}
+
+void kr::TextureCache::setBudget(ezUInt64 byteCount)
+{
+  EZ_LOCK(g_pCache->mutex);
+  g_pCache->budget = byteCount;
+  g_pCache->stats.numEvictions += evict(*g_pCache, false);
+}
+
+ezUInt64 kr::TextureCache::getBudget()
+{
+  return g_pCache->budget;
+}
+
+ezUInt32 kr::TextureCache::unloadUnused()
+{
+  EZ_LOCK(g_pCache->mutex);
+  auto numEvicted = evict(*g_pCache, true);
+  g_pCache->stats.numEvictions += numEvicted;
+  return numEvicted;
+}
+
+kr::TextureCacheStats kr::TextureCache::getStats()
+{
+  EZ_LOCK(g_pCache->mutex);
+
+  auto stats = g_pCache->stats;
+  stats.numTextures = g_pCache->numEntries;
+  stats.byteCount = 0;
+  for (auto it = g_pCache->buckets.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      stats.byteCount += byteCountOf(*pEntry);
+    }
+  }
+
+  return stats;
+}
+
+void kr::TextureCache::resetStats()
+{
+  EZ_LOCK(g_pCache->mutex);
+
+  g_pCache->stats = TextureCacheStats();
+  for (auto it = g_pCache->buckets.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      pEntry->numHits = 0;
+    }
+  }
+}
+
+void kr::TextureCache::logStats()
+{
+  auto stats = getStats();
+
+  EZ_LOG_BLOCK("Texture Cache Stats");
+
+  ezLog::Info("%u textures, %llu bytes, %u hits, %u misses (%.1f%% hit rate), %u evictions",
+              stats.numTextures, stats.byteCount,
+              stats.numHits, stats.numMisses, stats.getHitRate() * 100.0f,
+              stats.numEvictions);
+
+  // Textures that were requested repeatedly are candidates for sharing in content.
+  EZ_LOCK(g_pCache->mutex);
+  for (auto it = g_pCache->buckets.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      if (pEntry->numHits == 0)
+        continue;
+
+      ezLog::Info("'%s' was requested %u times.",
+                  pEntry->pTexture->getName().GetData(), pEntry->numHits + 1);
+    }
+  }
+}
@@ -0,0 +1,856 @@
+#include <krEngine/rendering/textureCompression.h>
+
+#include <Foundation/Threading/TaskSystem.h>
+
+#if EZ_ENABLED(KR_SIMD_SSE2)
+  #include <emmintrin.h>
+#endif
+
+namespace
+{
+  /// \brief The 16 pixels of a 4x4 block, one array per channel (RGBA), in the range [0, 255].
+  struct Block
+  {
+    float channels[4][16];
+  };
+
+  /// \brief An endpoint or palette entry of a block, RGBA in the range [0, 255].
+  struct Endpoint
+  {
+    float c[4];
+  };
+
+  /// \brief The channels an encoder works on. Color uses RGB, alpha uses A only.
+  struct Channels
+  {
+    ezUInt32 first;
+    ezUInt32 count;
+  };
+
+  const Channels ColorChannels = { 0, 3 };
+  const Channels AlphaChannel  = { 3, 1 };
+  const Channels AllChannels   = { 0, 4 };
+
+  struct Settings
+  {
+    kr::TextureCompression compression;
+    kr::TextureCompressionQuality quality;
+    bool isBgra;
+    bool hasAlpha;
+    ezUInt32 blockByteCount;
+  };
+
+  struct SubImageJob
+  {
+    const ezUInt8* pSource;
+    ezUInt32 rowPitch;
+    ezUInt32 width;
+    ezUInt32 height;
+
+    ezUInt8* pTarget;
+    ezUInt32 numBlocksX;
+    ezUInt32 numBlocksY;
+  };
+
+  /// \brief A range of block rows of a sub-image. The unit of work of a single task.
+  struct Chunk
+  {
+    const SubImageJob* pJob;
+    ezUInt32 firstBlockRow;
+    ezUInt32 numBlockRows;
+  };
+}
+
+/// \brief Number of block rows each task compresses.
+static const ezUInt32 BlockRowsPerTask = 8;
+
+static float clampChannel(float value)
+{
+  return ezMath::Clamp(value, 0.0f, 255.0f);
+}
+
+static ezUInt32 numRefinementsOf(kr::TextureCompressionQuality quality)
+{
+  switch(quality)
+  {
+  case kr::TextureCompressionQuality::Fast:   return 0;
+  case kr::TextureCompressionQuality::Normal: return 1;
+  case kr::TextureCompressionQuality::High:   return 4;
+  default:
+    break;
+  }
+
+  EZ_REPORT_FAILURE("Invalid input.");
+  return 0;
+}
+
+static void loadBlock(const Settings& settings, const SubImageJob& job,
+                      ezUInt32 blockX, ezUInt32 blockY, Block& out_block)
+{
+  for (ezUInt32 y = 0; y < 4; ++y)
+  {
+    // Blocks at the border repeat the last row or column.
+    auto sourceY = ezMath::Min(blockY * 4 + y, job.height - 1);
+    auto pRow = job.pSource + sourceY * job.rowPitch;
+
+    for (ezUInt32 x = 0; x < 4; ++x)
+    {
+      auto sourceX = ezMath::Min(blockX * 4 + x, job.width - 1);
+      auto pPixel = pRow + sourceX * 4;
+      auto i = y * 4 + x;
+
+      out_block.channels[0][i] = pPixel[settings.isBgra ? 2 : 0];
+      out_block.channels[1][i] = pPixel[1];
+      out_block.channels[2][i] = pPixel[settings.isBgra ? 0 : 2];
+      out_block.channels[3][i] = settings.hasAlpha ? pPixel[3] : 255.0f;
+    }
+  }
+}
+
+// Shared Building Blocks
+// ======================
+
+/// \brief Finds the closest entry of \a palette for each pixel of \a block.
+/// \return The sum of the squared errors.
+static float findClosest(const Block& block, Channels channels,
+                         const Endpoint* palette, ezUInt32 numEntries,
+                         ezUInt8 (&out_indices)[16])
+{
+  float totalError = 0.0f;
+
+#if EZ_ENABLED(KR_SIMD_SSE2)
+  // Four pixels at once.
+  for (ezUInt32 i = 0; i < 16; i += 4)
+  {
+    __m128 pixels[4];
+    for (ezUInt32 c = 0; c < channels.count; ++c)
+    {
+      pixels[c] = _mm_loadu_ps(&block.channels[channels.first + c][i]);
+    }
+
+    __m128 bestError = _mm_set1_ps(ezMath::BasicType<float>::MaxValue());
+    __m128 bestIndex = _mm_setzero_ps();
+
+    for (ezUInt32 e = 0; e < numEntries; ++e)
+    {
+      __m128 error = _mm_setzero_ps();
+      for (ezUInt32 c = 0; c < channels.count; ++c)
+      {
+        __m128 difference = _mm_sub_ps(pixels[c], _mm_set1_ps(palette[e].c[channels.first + c]));
+        error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+      }
+
+      __m128 isCloser = _mm_cmplt_ps(error, bestError);
+      bestError = _mm_min_ps(error, bestError);
+      bestIndex = _mm_or_ps(_mm_and_ps(isCloser, _mm_set1_ps(float(e))),
+                            _mm_andnot_ps(isCloser, bestIndex));
+    }
+
+    float errors[4];
+    float indices[4];
+    _mm_storeu_ps(errors, bestError);
+    _mm_storeu_ps(indices, bestIndex);
+
+    for (ezUInt32 k = 0; k < 4; ++k)
+    {
+      out_indices[i + k] = static_cast<ezUInt8>(indices[k]);
+      totalError += errors[k];
+    }
+  }
+#else
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    float bestError = ezMath::BasicType<float>::MaxValue();
+    ezUInt8 bestIndex = 0;
+
+    for (ezUInt32 e = 0; e < numEntries; ++e)
+    {
+      float error = 0.0f;
+      for (ezUInt32 c = channels.first; c < channels.first + channels.count; ++c)
+      {
+        float difference = block.channels[c][i] - palette[e].c[c];
+        error += difference * difference;
+      }
+
+      if (error < bestError)
+      {
+        bestError = error;
+        bestIndex = static_cast<ezUInt8>(e);
+      }
+    }
+
+    out_indices[i] = bestIndex;
+    totalError += bestError;
+  }
+#endif
+
+  return totalError;
+}
+
+/// \brief Initial endpoints that span the colors of \a block.
+static void computeEndpoints(const Block& block, Channels channels, kr::TextureCompressionQuality quality,
+                             Endpoint& out_e0, Endpoint& out_e1)
+{
+  const ezUInt32 end = channels.first + channels.count;
+
+  // Bounding Box
+  // ============
+  if (quality == kr::TextureCompressionQuality::Fast)
+  {
+    for (ezUInt32 c = channels.first; c < end; ++c)
+    {
+      float minValue = 255.0f;
+      float maxValue = 0.0f;
+      for (ezUInt32 i = 0; i < 16; ++i)
+      {
+        minValue = ezMath::Min(minValue, block.channels[c][i]);
+        maxValue = ezMath::Max(maxValue, block.channels[c][i]);
+      }
+
+      // Insetting reduces the error of the pixels in between.
+      const float inset = (maxValue - minValue) / 16.0f;
+      out_e0.c[c] = maxValue - inset;
+      out_e1.c[c] = minValue + inset;
+    }
+    return;
+  }
+
+  // Principal Axis
+  // ==============
+  Endpoint mean = {};
+  for (ezUInt32 c = channels.first; c < end; ++c)
+  {
+    for (ezUInt32 i = 0; i < 16; ++i)
+    {
+      mean.c[c] += block.channels[c][i];
+    }
+    mean.c[c] /= 16.0f;
+  }
+
+  float covariance[4][4] = {};
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    for (ezUInt32 a = channels.first; a < end; ++a)
+    {
+      for (ezUInt32 b = channels.first; b < end; ++b)
+      {
+        covariance[a][b] += (block.channels[a][i] - mean.c[a]) * (block.channels[b][i] - mean.c[b]);
+      }
+    }
+  }
+
+  // Power iteration converges to the eigenvector with the largest eigenvalue.
+  Endpoint axis = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+  for (ezUInt32 iteration = 0; iteration < 8; ++iteration)
+  {
+    Endpoint next = {};
+    float lengthSquared = 0.0f;
+    for (ezUInt32 a = channels.first; a < end; ++a)
+    {
+      for (ezUInt32 b = channels.first; b < end; ++b)
+      {
+        next.c[a] += covariance[a][b] * axis.c[b];
+      }
+      lengthSquared += next.c[a] * next.c[a];
+    }
+
+    // All pixels are equal.
+    if (lengthSquared < 1e-8f)
+    {
+      out_e0 = mean;
+      out_e1 = mean;
+      return;
+    }
+
+    const float inverseLength = 1.0f / ezMath::Sqrt(lengthSquared);
+    for (ezUInt32 c = channels.first; c < end; ++c)
+    {
+      axis.c[c] = next.c[c] * inverseLength;
+    }
+  }
+
+  float minT = 0.0f;
+  float maxT = 0.0f;
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    float t = 0.0f;
+    for (ezUInt32 c = channels.first; c < end; ++c)
+    {
+      t += (block.channels[c][i] - mean.c[c]) * axis.c[c];
+    }
+    minT = ezMath::Min(minT, t);
+    maxT = ezMath::Max(maxT, t);
+  }
+
+  for (ezUInt32 c = channels.first; c < end; ++c)
+  {
+    out_e0.c[c] = clampChannel(mean.c[c] + axis.c[c] * maxT);
+    out_e1.c[c] = clampChannel(mean.c[c] + axis.c[c] * minT);
+  }
+}
+
+/// \brief Least squares fit of the endpoints to the pixels, keeping the current \a indices.
+/// \param weightsOfE0 For each index, how much the first endpoint contributes to the palette entry.
+/// \return false if all pixels use the same palette entry, so there is nothing to solve.
+static bool refineEndpoints(const Block& block, Channels channels,
+                            const ezUInt8 (&indices)[16], const float* weightsOfE0,
+                            Endpoint& inout_e0, Endpoint& inout_e1)
+{
+  float aa = 0.0f;
+  float ab = 0.0f;
+  float bb = 0.0f;
+  Endpoint ax = {};
+  Endpoint bx = {};
+
+  const ezUInt32 end = channels.first + channels.count;
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    const float a = weightsOfE0[indices[i]];
+    const float b = 1.0f - a;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+
+    for (ezUInt32 c = channels.first; c < end; ++c)
+    {
+      ax.c[c] += a * block.channels[c][i];
+      bx.c[c] += b * block.channels[c][i];
+    }
+  }
+
+  const float determinant = aa * bb - ab * ab;
+  if (ezMath::Abs(determinant) < 1e-6f)
+    return false;
+
+  const float inverse = 1.0f / determinant;
+  for (ezUInt32 c = channels.first; c < end; ++c)
+  {
+    inout_e0.c[c] = clampChannel((ax.c[c] * bb - bx.c[c] * ab) * inverse);
+    inout_e1.c[c] = clampChannel((bx.c[c] * aa - ax.c[c] * ab) * inverse);
+  }
+
+  return true;
+}
+
+/// \brief Writes bits to a zero-initialized block, starting at the least significant bit.
+struct BitWriter
+{
+  ezUInt8* pData;
+  ezUInt32 bitOffset = 0;
+
+  explicit BitWriter(ezUInt8* pData) : pData(pData) {}
+
+  void write(ezUInt32 value, ezUInt32 numBits)
+  {
+    for (ezUInt32 i = 0; i < numBits; ++i, ++bitOffset)
+    {
+      if (value & (1u << i))
+      {
+        pData[bitOffset / 8] |= static_cast<ezUInt8>(1u << (bitOffset % 8));
+      }
+    }
+  }
+};
+
+// BC1 Color Block
+// ===============
+
+/// \brief Fraction of the first endpoint in each palette entry of a 4 color block.
+static const float Bc1WeightsOfE0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+struct ColorFit
+{
+  ezUInt16 c0;
+  ezUInt16 c1;
+  ezUInt8 indices[16];
+  float error;
+};
+
+static ezUInt16 to565(const Endpoint& e)
+{
+  auto r = static_cast<ezUInt32>(e.c[0] * 31.0f / 255.0f + 0.5f);
+  auto g = static_cast<ezUInt32>(e.c[1] * 63.0f / 255.0f + 0.5f);
+  auto b = static_cast<ezUInt32>(e.c[2] * 31.0f / 255.0f + 0.5f);
+  return static_cast<ezUInt16>((r << 11) | (g << 5) | b);
+}
+
+static Endpoint from565(ezUInt16 value)
+{
+  ezUInt32 r = (value >> 11) & 31;
+  ezUInt32 g = (value >> 5) & 63;
+  ezUInt32 b = value & 31;
+
+  Endpoint result = { { float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)), 255.0f } };
+  return result;
+}
+
+static void fitColor(const Block& block, const Endpoint& e0, const Endpoint& e1, ColorFit& out_fit)
+{
+  out_fit.c0 = to565(e0);
+  out_fit.c1 = to565(e1);
+
+  // c0 > c1 selects the 4 color mode without transparency.
+  if (out_fit.c0 < out_fit.c1)
+  {
+    ezMath::Swap(out_fit.c0, out_fit.c1);
+  }
+
+  Endpoint palette[4];
+  palette[0] = from565(out_fit.c0);
+  palette[1] = from565(out_fit.c1);
+
+  if (out_fit.c0 == out_fit.c1)
+  {
+    // The 3 color mode would be selected, but the first entry is the same in both modes.
+    out_fit.error = findClosest(block, ColorChannels, palette, 1, out_fit.indices);
+    return;
+  }
+
+  for (ezUInt32 c = 0; c < 3; ++c)
+  {
+    palette[2].c[c] = (2.0f * palette[0].c[c] + palette[1].c[c]) / 3.0f;
+    palette[3].c[c] = (palette[0].c[c] + 2.0f * palette[1].c[c]) / 3.0f;
+  }
+
+  out_fit.error = findClosest(block, ColorChannels, palette, 4, out_fit.indices);
+}
+
+static void encodeColorBlock(const Block& block, kr::TextureCompressionQuality quality, ezUInt8* pOut)
+{
+  Endpoint e0;
+  Endpoint e1;
+  computeEndpoints(block, ColorChannels, quality, e0, e1);
+
+  ColorFit best;
+  fitColor(block, e0, e1, best);
+
+  for (ezUInt32 i = 0; i < numRefinementsOf(quality); ++i)
+  {
+    if (!refineEndpoints(block, ColorChannels, best.indices, Bc1WeightsOfE0, e0, e1))
+      break;
+
+    ColorFit candidate;
+    fitColor(block, e0, e1, candidate);
+    if (candidate.error >= best.error)
+      break;
+
+    best = candidate;
+  }
+
+  pOut[0] = static_cast<ezUInt8>(best.c0 & 0xFF);
+  pOut[1] = static_cast<ezUInt8>(best.c0 >> 8);
+  pOut[2] = static_cast<ezUInt8>(best.c1 & 0xFF);
+  pOut[3] = static_cast<ezUInt8>(best.c1 >> 8);
+
+  ezUInt32 indexBits = 0;
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    indexBits |= ezUInt32(best.indices[i]) << (2 * i);
+  }
+  ezMemoryUtils::Copy(pOut + 4, reinterpret_cast<const ezUInt8*>(&indexBits), 4);
+}
+
+// BC3 Alpha Block
+// ===============
+
+/// \brief Fraction of the first endpoint in each palette entry of an 8 value alpha block.
+static const float AlphaWeightsOfE0[8] = { 1.0f, 0.0f, 6.0f / 7.0f, 5.0f / 7.0f, 4.0f / 7.0f, 3.0f / 7.0f, 2.0f / 7.0f, 1.0f / 7.0f };
+
+struct AlphaFit
+{
+  ezUInt8 a0;
+  ezUInt8 a1;
+  ezUInt8 indices[16];
+  float error;
+};
+
+static void fitAlpha(const Block& block, float e0, float e1, AlphaFit& out_fit)
+{
+  // a0 > a1 selects the 8 value mode.
+  out_fit.a0 = static_cast<ezUInt8>(ezMath::Max(e0, e1) + 0.5f);
+  out_fit.a1 = static_cast<ezUInt8>(ezMath::Min(e0, e1) + 0.5f);
+
+  Endpoint palette[8];
+  for (ezUInt32 i = 0; i < 8; ++i)
+  {
+    palette[i].c[3] = AlphaWeightsOfE0[i] * out_fit.a0 + (1.0f - AlphaWeightsOfE0[i]) * out_fit.a1;
+  }
+
+  const ezUInt32 numEntries = out_fit.a0 == out_fit.a1 ? 1 : 8;
+  out_fit.error = findClosest(block, AlphaChannel, palette, numEntries, out_fit.indices);
+}
+
+static void encodeAlphaBlock(const Block& block, kr::TextureCompressionQuality quality, ezUInt8* pOut)
+{
+  // The extremes are exact for a single channel, so there is no need for the principal axis.
+  Endpoint e0 = {};
+  Endpoint e1 = { { 0.0f, 0.0f, 0.0f, 255.0f } };
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    e0.c[3] = ezMath::Max(e0.c[3], block.channels[3][i]);
+    e1.c[3] = ezMath::Min(e1.c[3], block.channels[3][i]);
+  }
+
+  AlphaFit best;
+  fitAlpha(block, e0.c[3], e1.c[3], best);
+
+  for (ezUInt32 i = 0; i < numRefinementsOf(quality); ++i)
+  {
+    if (!refineEndpoints(block, AlphaChannel, best.indices, AlphaWeightsOfE0, e0, e1))
+      break;
+
+    AlphaFit candidate;
+    fitAlpha(block, e0.c[3], e1.c[3], candidate);
+    if (candidate.error >= best.error)
+      break;
+
+    best = candidate;
+  }
+
+  pOut[0] = best.a0;
+  pOut[1] = best.a1;
+
+  ezUInt64 indexBits = 0;
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    indexBits |= ezUInt64(best.indices[i]) << (3 * i);
+  }
+
+  for (ezUInt32 i = 0; i < 6; ++i)
+  {
+    pOut[2 + i] = static_cast<ezUInt8>(indexBits >> (8 * i));
+  }
+}
+
+// BC7 Block
+// =========
+// Only mode 6 is used: a single subset with 7 bit RGBA endpoints, a p-bit per endpoint and 4 bit indices.
+
+static const ezUInt32 Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Fit
+{
+  ezUInt8 e0[4];
+  ezUInt8 e1[4];
+  ezUInt32 p0;
+  ezUInt32 p1;
+  ezUInt8 indices[16];
+  float error;
+};
+
+static void quantizeBc7(const Endpoint& e, ezUInt32 pBit, ezUInt8 (&out_endpoint)[4])
+{
+  for (ezUInt32 c = 0; c < 4; ++c)
+  {
+    auto value = (e.c[c] - float(pBit)) / 2.0f + 0.5f;
+    out_endpoint[c] = static_cast<ezUInt8>(ezMath::Clamp(value, 0.0f, 127.0f));
+  }
+}
+
+/// \brief Squared error of \a e after quantizing it with \a pBit.
+static float quantizationErrorBc7(const Endpoint& e, ezUInt32 pBit)
+{
+  ezUInt8 quantized[4];
+  quantizeBc7(e, pBit, quantized);
+
+  float error = 0.0f;
+  for (ezUInt32 c = 0; c < 4; ++c)
+  {
+    float difference = e.c[c] - float(quantized[c] * 2 + pBit);
+    error += difference * difference;
+  }
+  return error;
+}
+
+static void fitBc7(const Block& block, const Endpoint& e0, const Endpoint& e1,
+                   ezUInt32 p0, ezUInt32 p1, Bc7Fit& out_fit)
+{
+  out_fit.p0 = p0;
+  out_fit.p1 = p1;
+  quantizeBc7(e0, p0, out_fit.e0);
+  quantizeBc7(e1, p1, out_fit.e1);
+
+  // Same integer interpolation as the decoder.
+  Endpoint palette[16];
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    for (ezUInt32 c = 0; c < 4; ++c)
+    {
+      ezUInt32 v0 = out_fit.e0[c] * 2 + p0;
+      ezUInt32 v1 = out_fit.e1[c] * 2 + p1;
+      palette[i].c[c] = float(((64 - Bc7Weights[i]) * v0 + Bc7Weights[i] * v1 + 32) >> 6);
+    }
+  }
+
+  out_fit.error = findClosest(block, AllChannels, palette, 16, out_fit.indices);
+}
+
+static void fitBc7BestPBits(const Block& block, const Endpoint& e0, const Endpoint& e1,
+                            kr::TextureCompressionQuality quality, Bc7Fit& out_fit)
+{
+  if (quality == kr::TextureCompressionQuality::High)
+  {
+    // Try all combinations.
+    fitBc7(block, e0, e1, 0, 0, out_fit);
+    for (ezUInt32 combination = 1; combination < 4; ++combination)
+    {
+      Bc7Fit candidate;
+      fitBc7(block, e0, e1, combination & 1, combination >> 1, candidate);
+      if (candidate.error < out_fit.error)
+      {
+        out_fit = candidate;
+      }
+    }
+    return;
+  }
+
+  // Pick the p-bit that represents each endpoint best on its own.
+  auto p0 = quantizationErrorBc7(e0, 1) < quantizationErrorBc7(e0, 0) ? 1u : 0u;
+  auto p1 = quantizationErrorBc7(e1, 1) < quantizationErrorBc7(e1, 0) ? 1u : 0u;
+  fitBc7(block, e0, e1, p0, p1, out_fit);
+}
+
+static void encodeBc7Block(const Block& block, kr::TextureCompressionQuality quality, ezUInt8* pOut)
+{
+  Endpoint e0;
+  Endpoint e1;
+  computeEndpoints(block, AllChannels, quality, e0, e1);
+
+  Bc7Fit best;
+  fitBc7BestPBits(block, e0, e1, quality, best);
+
+  float weightsOfE0[16];
+  for (ezUInt32 i = 0; i < 16; ++i)
+  {
+    weightsOfE0[i] = 1.0f - float(Bc7Weights[i]) / 64.0f;
+  }
+
+  for (ezUInt32 i = 0; i < numRefinementsOf(quality); ++i)
+  {
+    if (!refineEndpoints(block, AllChannels, best.indices, weightsOfE0, e0, e1))
+      break;
+
+    Bc7Fit candidate;
+    fitBc7BestPBits(block, e0, e1, quality, candidate);
+    if (candidate.error >= best.error)
+      break;
+
+    best = candidate;
+  }
+
+  // The most significant bit of the first index is implicitly 0, so swap the endpoints if needed.
+  if (best.indices[0] >= 8)
+  {
+    for (ezUInt32 c = 0; c < 4; ++c)
+    {
+      ezMath::Swap(best.e0[c], best.e1[c]);
+    }
+    ezMath::Swap(best.p0, best.p1);
+
+    for (auto& index : best.indices)
+    {
+      index = static_cast<ezUInt8>(15 - index);
+    }
+  }
+
+  ezMemoryUtils::ZeroFill(pOut, 16);
+  BitWriter bits(pOut);
+
+  bits.write(1 << 6, 7); // Mode 6.
+  for (ezUInt32 c = 0; c < 4; ++c)
+  {
+    bits.write(best.e0[c], 7);
+    bits.write(best.e1[c], 7);
+  }
+  bits.write(best.p0, 1);
+  bits.write(best.p1, 1);
+
+  bits.write(best.indices[0], 3);
+  for (ezUInt32 i = 1; i < 16; ++i)
+  {
+    bits.write(best.indices[i], 4);
+  }
+}
+
+// Distributing the Work
+// =====================
+
+static void compressChunk(const Settings& settings, const Chunk& chunk)
+{
+  const auto& job = *chunk.pJob;
+
+  Block block;
+  for (ezUInt32 blockY = chunk.firstBlockRow; blockY < chunk.firstBlockRow + chunk.numBlockRows; ++blockY)
+  {
+    for (ezUInt32 blockX = 0; blockX < job.numBlocksX; ++blockX)
+    {
+      loadBlock(settings, job, blockX, blockY, block);
+      auto pOut = job.pTarget + (blockY * job.numBlocksX + blockX) * settings.blockByteCount;
+
+      switch(settings.compression)
+      {
+      case kr::TextureCompression::BC1:
+        encodeColorBlock(block, settings.quality, pOut);
+        break;
+      case kr::TextureCompression::BC3:
+        encodeAlphaBlock(block, settings.quality, pOut);
+        encodeColorBlock(block, settings.quality, pOut + 8);
+        break;
+      case kr::TextureCompression::BC7:
+        encodeBc7Block(block, settings.quality, pOut);
+        break;
+      default:
+        EZ_REPORT_FAILURE("Invalid input.");
+        return;
+      }
+    }
+  }
+}
+
+namespace
+{
+  class CompressionTask : public ezTask
+  {
+  public: // *** Data
+    const Settings* m_pSettings = nullptr;
+    Chunk m_chunk;
+
+  private: // *** Overrides
+    virtual void Execute() override
+    {
+      compressChunk(*m_pSettings, m_chunk);
+    }
+  };
+}
+
+/// \brief Determines how to read pixels of \a format.
+/// \return EZ_FAILURE if \a format cannot be compressed.
+static ezResult describeSource(ezImageFormat::Enum format, Settings& out_settings, bool& out_isSrgb)
+{
+  switch(format)
+  {
+  case ezImageFormat::B8G8R8A8_UNORM:      out_settings.isBgra = true;  out_settings.hasAlpha = true;  out_isSrgb = false; break;
+  case ezImageFormat::B8G8R8A8_UNORM_SRGB: out_settings.isBgra = true;  out_settings.hasAlpha = true;  out_isSrgb = true;  break;
+  case ezImageFormat::B8G8R8X8_UNORM:      out_settings.isBgra = true;  out_settings.hasAlpha = false; out_isSrgb = false; break;
+  case ezImageFormat::B8G8R8X8_UNORM_SRGB: out_settings.isBgra = true;  out_settings.hasAlpha = false; out_isSrgb = true;  break;
+  case ezImageFormat::R8G8B8A8_UNORM:      out_settings.isBgra = false; out_settings.hasAlpha = true;  out_isSrgb = false; break;
+  case ezImageFormat::R8G8B8A8_UNORM_SRGB: out_settings.isBgra = false; out_settings.hasAlpha = true;  out_isSrgb = true;  break;
+  default:
+    return EZ_FAILURE;
+  }
+
+  return EZ_SUCCESS;
+}
+
+ezResult kr::compressImage(ezImage& image, TextureCompression compression, TextureCompressionQuality quality)
+{
+  if (compression == TextureCompression::None)
+    return EZ_SUCCESS;
+
+  Settings settings;
+  settings.compression = compression;
+  settings.quality = quality;
+
+  bool isSrgb = false;
+  if (describeSource(image.GetImageFormat(), settings, isSrgb).Failed())
+    return EZ_FAILURE;
+
+  ezImageFormat::Enum targetFormat;
+  switch(compression)
+  {
+  case TextureCompression::BC1:
+    targetFormat = isSrgb ? ezImageFormat::BC1_UNORM_SRGB : ezImageFormat::BC1_UNORM;
+    settings.blockByteCount = 8;
+    break;
+  case TextureCompression::BC3:
+    targetFormat = isSrgb ? ezImageFormat::BC3_UNORM_SRGB : ezImageFormat::BC3_UNORM;
+    settings.blockByteCount = 16;
+    break;
+  case TextureCompression::BC7:
+    targetFormat = isSrgb ? ezImageFormat::BC7_UNORM_SRGB : ezImageFormat::BC7_UNORM;
+    settings.blockByteCount = 16;
+    break;
+  default:
+    EZ_REPORT_FAILURE("Invalid input.");
+    return EZ_FAILURE;
+  }
+
+  ezImage result;
+  result.SetWidth(image.GetWidth());
+  result.SetHeight(image.GetHeight());
+  result.SetImageFormat(targetFormat);
+  result.SetNumMipLevels(image.GetNumMipLevels());
+  result.SetNumFaces(image.GetNumFaces());
+  result.SetNumArrayIndices(image.GetNumArrayIndices());
+  result.AllocateImageData();
+
+  // Split the Work
+  // ==============
+  ezDynamicArray<SubImageJob> jobs;
+  for (ezUInt32 mip = 0; mip < image.GetNumMipLevels(); ++mip)
+  {
+    for (ezUInt32 arrayIndex = 0; arrayIndex < image.GetNumArrayIndices(); ++arrayIndex)
+    {
+      for (ezUInt32 face = 0; face < image.GetNumFaces(); ++face)
+      {
+        auto& job = jobs.ExpandAndGetRef();
+        job.pSource = image.GetSubImagePointer<ezUInt8>(mip, face, arrayIndex);
+        job.rowPitch = image.GetRowPitch(mip);
+        job.width = image.GetWidth(mip);
+        job.height = image.GetHeight(mip);
+        job.pTarget = result.GetSubImagePointer<ezUInt8>(mip, face, arrayIndex);
+        job.numBlocksX = (job.width + 3) / 4;
+        job.numBlocksY = (job.height + 3) / 4;
+      }
+    }
+  }
+
+  // The jobs are complete, so pointers to them stay valid from here on.
+  ezDynamicArray<Chunk> chunks;
+  for (auto& job : jobs)
+  {
+    for (ezUInt32 row = 0; row < job.numBlocksY; row += BlockRowsPerTask)
+    {
+      auto& chunk = chunks.ExpandAndGetRef();
+      chunk.pJob = &job;
+      chunk.firstBlockRow = row;
+      chunk.numBlockRows = ezMath::Min(BlockRowsPerTask, job.numBlocksY - row);
+    }
+  }
+
+  // Compress
+  // ========
+  if (chunks.GetCount() == 1)
+  {
+    // Not worth the overhead of a task.
+    compressChunk(settings, chunks[0]);
+  }
+  else
+  {
+    // A single group, so we only wait once for all of them.
+    auto group = ezTaskSystem::CreateTaskGroup(ezTaskPriority::ThisFrame);
+
+    ezDynamicArray<CompressionTask*> tasks;
+    for (auto& chunk : chunks)
+    {
+      auto pTask = EZ_DEFAULT_NEW(CompressionTask);
+      pTask->SetTaskName("Compress Texture Blocks");
+      pTask->m_pSettings = &settings;
+      pTask->m_chunk = chunk;
+
+      tasks.PushBack(pTask);
+      ezTaskSystem::AddTaskToGroup(group, pTask);
+    }
+
+    ezTaskSystem::StartTaskGroup(group);
+    ezTaskSystem::WaitForGroup(group);
+
+    for (auto pTask : tasks)
+    {
+      EZ_DEFAULT_DELETE(pTask);
+    }
+  }
+
+  image = move(result);
+  return EZ_SUCCESS;
+}
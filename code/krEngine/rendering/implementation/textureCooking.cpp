@@ -0,0 +1,242 @@
+#include <krEngine/rendering/textureCooking.h>
+#include <krEngine/rendering/textureCompression.h>
+#include <krEngine/rendering/implementation/textureFormats.h>
+#include <krEngine/rendering/implementation/textureMips.h>
+#include <krEngine/rendering/implementation/cookedTexture.h>
+
+#include <Foundation/IO/FileSystem/FileWriter.h>
+
+static ezUInt64 alignUp(ezUInt64 value, ezUInt64 alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+static ezResult writePadding(ezFileWriter& file, ezUInt64 byteCount)
+{
+  const ezUInt8 zeros[kr::CookedTextureDataAlignment] = {};
+  return file.WriteBytes(zeros, byteCount);
+}
+
+ezResult kr::cookTexture(ezStringView sourceFile, ezStringView targetFile, TextureCookOptions options)
+{
+  ezStringBuilder sbSourceFile(sourceFile);
+  ezStringBuilder sbTargetFile(targetFile);
+  EZ_LOG_BLOCK("Cooking Texture", sbSourceFile);
+
+  ezImage image;
+  if (image.LoadFrom(sbSourceFile).Failed())
+  {
+    ezLog::Warning("Failed to load source image.");
+    return EZ_FAILURE;
+  }
+
+  // Mip Chain
+  // =========
+  const bool isLinear = ezImageFormat::GetType(image.GetImageFormat()) == ezImageFormatType::LINEAR;
+  if (options.mipGeneration != TextureMipGeneration::None && image.GetNumMipLevels() == 1 && isLinear)
+  {
+    auto filter = options.mipGeneration == TextureMipGeneration::Kaiser ? MipFilter::Kaiser
+                                                                        : MipFilter::Box;
+    if (generateMipChain(image, filter).Failed())
+    {
+      ezLog::Warning("Cannot filter mip levels of format \"%s\". Cooking the base level only.",
+                     ezImageFormat::GetName(image.GetImageFormat()));
+    }
+  }
+
+  // Compression
+  // ===========
+  if (options.compression != TextureCompression::None && isLinear)
+  {
+    if (compressImage(image, options.compression, options.compressionQuality).Failed())
+    {
+      ezLog::Warning("Cannot compress format \"%s\". Cooking it uncompressed.",
+                     ezImageFormat::GetName(image.GetImageFormat()));
+    }
+  }
+
+  GlTextureFormat glFormat;
+  if (toGlTextureFormat(image.GetImageFormat(), glFormat).Failed())
+  {
+    ezLog::Warning("Image format \"%s\" is not supported.",
+                   ezImageFormat::GetName(image.GetImageFormat()));
+    return EZ_FAILURE;
+  }
+
+  // Header
+  // ======
+  CookedTextureHeader header;
+  ezMemoryUtils::ZeroFill(&header);
+  ezMemoryUtils::Copy(header.magic, "KRTX", 4);
+  header.version = CookedTextureVersion;
+  header.imageFormat = image.GetImageFormat();
+  header.glTarget = glTextureTargetOf(image);
+  header.glInternalFormat = glFormat.internalFormat;
+  header.glFormat = glFormat.format;
+  header.glType = glFormat.type;
+  header.isCompressed = glFormat.isCompressed ? 1 : 0;
+  header.width = image.GetWidth();
+  header.height = image.GetHeight();
+  header.numMipLevels = image.GetNumMipLevels();
+  header.numFaces = image.GetNumFaces();
+  header.numArrayIndices = image.GetNumArrayIndices();
+  header.numSubImages = header.numMipLevels * header.numFaces * header.numArrayIndices;
+
+  // Sub-Image Table
+  // ===============
+  ezDynamicArray<CookedSubImage> subImages;
+  ezDynamicArray<const ezUInt8*> sources;
+
+  ezUInt64 offset = sizeof(CookedTextureHeader) + header.numSubImages * sizeof(CookedSubImage);
+  for (ezUInt32 mip = 0; mip < header.numMipLevels; ++mip)
+  {
+    for (ezUInt32 arrayIndex = 0; arrayIndex < header.numArrayIndices; ++arrayIndex)
+    {
+      for (ezUInt32 face = 0; face < header.numFaces; ++face)
+      {
+        offset = alignUp(offset, CookedTextureDataAlignment);
+
+        auto& sub = subImages.ExpandAndGetRef();
+        ezMemoryUtils::ZeroFill(&sub);
+        sub.offset = offset;
+        sub.byteCount = image.GetDepthPitch(mip);
+        sub.width = image.GetWidth(mip);
+        sub.height = image.GetHeight(mip);
+
+        sources.PushBack(image.GetSubImagePointer<ezUInt8>(mip, face, arrayIndex));
+
+        offset += sub.byteCount;
+        header.byteCount += sub.byteCount;
+      }
+    }
+  }
+
+  // Write
+  // =====
+  ezFileWriter file;
+  if (file.Open(sbTargetFile).Failed())
+  {
+    ezLog::Warning("Unable to open '%s' for writing.", sbTargetFile.GetData());
+    return EZ_FAILURE;
+  }
+
+  const ezUInt64 tableByteCount = subImages.GetCount() * sizeof(CookedSubImage);
+  if (file.WriteBytes(&header, sizeof(header)).Failed() ||
+      file.WriteBytes(subImages.GetData(), tableByteCount).Failed())
+  {
+    ezLog::Warning("Failed to write header.");
+    return EZ_FAILURE;
+  }
+
+  ezUInt64 written = sizeof(CookedTextureHeader) + tableByteCount;
+  for (ezUInt32 i = 0; i < subImages.GetCount(); ++i)
+  {
+    if (writePadding(file, subImages[i].offset - written).Failed() ||
+        file.WriteBytes(sources[i], subImages[i].byteCount).Failed())
+    {
+      ezLog::Warning("Failed to write pixel data.");
+      return EZ_FAILURE;
+    }
+
+    written = subImages[i].offset + subImages[i].byteCount;
+  }
+
+  return EZ_SUCCESS;
+}
+
+// Validation
+// ==========
+
+/// \brief Number of bytes glTexSubImage* or glCompressedTexSubImage* read for a sub-image,
+///        with an unpack alignment of 1.
+static ezUInt64 requiredByteCount(ezImageFormat::Enum format, bool isCompressed, ezUInt64 width, ezUInt64 height)
+{
+  const ezUInt64 bitsPerPixel = ezImageFormat::GetBitsPerPixel(format);
+
+  // Block compressed sub-images always consist of whole 4x4 blocks.
+  if (isCompressed)
+  {
+    width = (width + 3) / 4 * 4;
+    height = (height + 3) / 4 * 4;
+  }
+
+  return (width * height * bitsPerPixel + 7) / 8;
+}
+
+const kr::CookedSubImage* kr::validateCookedTexture(const ezUInt8* pData,
+                                                    ezUInt64 byteCount,
+                                                    GlTextureFormat& out_glFormat)
+{
+  // Header
+  // ======
+  if (byteCount < sizeof(CookedTextureHeader))
+    return nullptr;
+
+  auto& header = *reinterpret_cast<const CookedTextureHeader*>(pData);
+  if (!ezMemoryUtils::IsEqual(header.magic, "KRTX", 4) || header.version != CookedTextureVersion)
+    return nullptr;
+
+  // Limits of every GL 4.3 implementation.
+  const ezUInt32 maxSize = 16384;
+  const ezUInt32 maxArrayIndices = 2048;
+
+  if (header.width == 0 || header.width > maxSize ||
+      header.height == 0 || header.height > maxSize ||
+      (header.numFaces != 1 && header.numFaces != 6) ||
+      header.numArrayIndices == 0 || header.numArrayIndices > maxArrayIndices ||
+      header.numMipLevels == 0 || header.numMipLevels > computeNumMipLevels(header.width, header.height))
+    return nullptr;
+
+  // Cannot overflow within the limits above.
+  if (header.numSubImages != header.numMipLevels * header.numFaces * header.numArrayIndices)
+    return nullptr;
+
+  // Formats
+  // =======
+  // Only accept the GL enums we would have picked ourselves.
+  const auto imageFormat = static_cast<ezImageFormat::Enum>(header.imageFormat);
+  GlTextureFormat glFormat;
+  if (toGlTextureFormat(imageFormat, glFormat).Failed())
+    return nullptr;
+
+  if (header.glInternalFormat != glFormat.internalFormat ||
+      header.glFormat != glFormat.format ||
+      header.glType != glFormat.type ||
+      (header.isCompressed != 0) != glFormat.isCompressed)
+    return nullptr;
+
+  const bool isCube = header.numFaces == 6;
+  const bool isArray = header.numArrayIndices > 1;
+  const GLenum expectedTarget = isCube ? (isArray ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP)
+                                       : (isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D);
+  if (header.glTarget != expectedTarget)
+    return nullptr;
+
+  // Sub-Images
+  // ==========
+  const ezUInt64 tableByteCount = ezUInt64(header.numSubImages) * sizeof(CookedSubImage);
+  if (tableByteCount > byteCount - sizeof(CookedTextureHeader))
+    return nullptr;
+
+  const ezUInt32 numLayers = header.numFaces * header.numArrayIndices;
+  auto pSubImages = reinterpret_cast<const CookedSubImage*>(pData + sizeof(CookedTextureHeader));
+  for (ezUInt32 i = 0; i < header.numSubImages; ++i)
+  {
+    auto& sub = pSubImages[i];
+
+    // Written this way, so a huge offset cannot wrap around.
+    if (sub.offset > byteCount || sub.byteCount > byteCount - sub.offset)
+      return nullptr;
+
+    const ezUInt32 mip = i / numLayers;
+    if (sub.width != ezMath::Max(header.width >> mip, 1u) ||
+        sub.height != ezMath::Max(header.height >> mip, 1u))
+      return nullptr;
+
+    if (sub.byteCount < requiredByteCount(imageFormat, glFormat.isCompressed, sub.width, sub.height))
+      return nullptr;
+  }
+
+  out_glFormat = glFormat;
+  return pSubImages;
+}
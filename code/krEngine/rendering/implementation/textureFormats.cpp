@@ -0,0 +1,74 @@
+#include <krEngine/rendering/implementation/textureFormats.h>
+
+static kr::GlTextureFormat linear(GLenum internalFormat, GLenum format, GLenum type)
+{
+  kr::GlTextureFormat result;
+  result.internalFormat = internalFormat;
+  result.format = format;
+  result.type = type;
+  return result;
+}
+
+static kr::GlTextureFormat compressed(GLenum internalFormat)
+{
+  kr::GlTextureFormat result;
+  result.internalFormat = internalFormat;
+  result.isCompressed = true;
+  return result;
+}
+
+ezResult kr::toGlTextureFormat(ezImageFormat::Enum imageFormat, GlTextureFormat& out_glFormat)
+{
+  switch(imageFormat)
+  {
+  // Linear Formats
+  // ==============
+  case ezImageFormat::B8G8R8A8_UNORM:      out_glFormat = linear(GL_RGBA8,        GL_BGRA, GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::B8G8R8A8_UNORM_SRGB: out_glFormat = linear(GL_SRGB8_ALPHA8, GL_BGRA, GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::B8G8R8X8_UNORM:      out_glFormat = linear(GL_RGB8,         GL_BGRA, GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::B8G8R8X8_UNORM_SRGB: out_glFormat = linear(GL_SRGB8,        GL_BGRA, GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::B8G8R8_UNORM:        out_glFormat = linear(GL_RGB8,         GL_BGR,  GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::R8G8B8A8_UNORM:      out_glFormat = linear(GL_RGBA8,        GL_RGBA, GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::R8G8B8A8_UNORM_SRGB: out_glFormat = linear(GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::R8G8_UNORM:          out_glFormat = linear(GL_RG8,          GL_RG,   GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::R8_UNORM:            out_glFormat = linear(GL_R8,           GL_RED,  GL_UNSIGNED_BYTE); break;
+  case ezImageFormat::B5G6R5_UNORM:        out_glFormat = linear(GL_RGB565,       GL_RGB,  GL_UNSIGNED_SHORT_5_6_5); break;
+  case ezImageFormat::R16G16B16A16_UNORM:  out_glFormat = linear(GL_RGBA16,       GL_RGBA, GL_UNSIGNED_SHORT); break;
+  case ezImageFormat::R16G16B16A16_FLOAT:  out_glFormat = linear(GL_RGBA16F,      GL_RGBA, GL_HALF_FLOAT); break;
+  case ezImageFormat::R32G32B32A32_FLOAT:  out_glFormat = linear(GL_RGBA32F,      GL_RGBA, GL_FLOAT); break;
+  case ezImageFormat::R32_FLOAT:           out_glFormat = linear(GL_R32F,         GL_RED,  GL_FLOAT); break;
+
+  // Block Compressed Formats
+  // ========================
+  case ezImageFormat::BC1_UNORM:      out_glFormat = compressed(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT); break;
+  case ezImageFormat::BC1_UNORM_SRGB: out_glFormat = compressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT); break;
+  case ezImageFormat::BC2_UNORM:      out_glFormat = compressed(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT); break;
+  case ezImageFormat::BC2_UNORM_SRGB: out_glFormat = compressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT); break;
+  case ezImageFormat::BC3_UNORM:      out_glFormat = compressed(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT); break;
+  case ezImageFormat::BC3_UNORM_SRGB: out_glFormat = compressed(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT); break;
+  case ezImageFormat::BC4_UNORM:      out_glFormat = compressed(GL_COMPRESSED_RED_RGTC1); break;
+  case ezImageFormat::BC4_SNORM:      out_glFormat = compressed(GL_COMPRESSED_SIGNED_RED_RGTC1); break;
+  case ezImageFormat::BC5_UNORM:      out_glFormat = compressed(GL_COMPRESSED_RG_RGTC2); break;
+  case ezImageFormat::BC5_SNORM:      out_glFormat = compressed(GL_COMPRESSED_SIGNED_RG_RGTC2); break;
+  case ezImageFormat::BC6H_UF16:      out_glFormat = compressed(GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT); break;
+  case ezImageFormat::BC6H_SF16:      out_glFormat = compressed(GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT); break;
+  case ezImageFormat::BC7_UNORM:      out_glFormat = compressed(GL_COMPRESSED_RGBA_BPTC_UNORM); break;
+  case ezImageFormat::BC7_UNORM_SRGB: out_glFormat = compressed(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM); break;
+
+  default:
+    return EZ_FAILURE;
+  }
+
+  return EZ_SUCCESS;
+}
+
+GLenum kr::glTextureTargetOf(const ezImage& image)
+{
+  const bool isCube = image.GetNumFaces() == 6;
+  const bool isArray = image.GetNumArrayIndices() > 1;
+
+  if (isCube)
+    return isArray ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
+
+  return isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <CoreUtils/Image/Image.h>
+
+namespace kr
+{
+  /// \brief Describes how pixel data of an ezImageFormat is handed to OpenGL.
+  struct GlTextureFormat
+  {
+    /// \brief The sized format OpenGL stores the texture in.
+    GLenum internalFormat = GL_NONE;
+
+    /// \brief Layout of the pixels we upload. Unused for compressed formats.
+    GLenum format = GL_NONE;
+
+    /// \brief Type of each component of the pixels we upload. Unused for compressed formats.
+    GLenum type = GL_NONE;
+
+    bool isCompressed = false;
+  };
+
+  /// \brief Looks up the OpenGL equivalent of \a imageFormat.
+  /// \return EZ_FAILURE if there is no such equivalent.
+  ezResult toGlTextureFormat(ezImageFormat::Enum imageFormat, GlTextureFormat& out_glFormat);
+
+  /// \brief GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_CUBE_MAP_ARRAY,
+  ///        depending on the number of faces and array indices of \a image.
+  GLenum glTextureTargetOf(const ezImage& image);
+}
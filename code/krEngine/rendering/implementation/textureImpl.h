@@ -4,14 +4,62 @@
 
 namespace kr
 {
+  class TextureLoadTask;
+
   class TextureImpl : public Texture
   {
   public: // *** Data
     GLuint m_glHandle = 0;
+
+    /// \brief GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_CUBE_MAP_ARRAY.
+    GLenum m_glTarget = GL_TEXTURE_2D;
+
     TextureName m_name;
     ezImage m_image;
+
+    // Metadata
+    // ========
+    // Cached, so it survives dropping the image.
+    ezUInt32 m_width = 0;
+    ezUInt32 m_height = 0;
+    ezImageFormat::Enum m_format = ezImageFormat::UNKNOWN;
+    ezUInt32 m_numMipLevels = 0;
+    ezUInt32 m_numLayers = 1;
+    ezUInt64 m_byteCount = 0;
+    ezUInt64 m_gpuByteCount = 0;
+
+    /// \brief Needed to load the texture again after it was evicted.
+    TextureLoadOptions m_options;
+
+    /// \brief File names of the layers, if this texture was created by Texture::loadArray().
+    ezDynamicArray<TextureName> m_arrayFileNames;
+
+    // Residency
+    // =========
+    /// \brief Frame in which this texture was last bound. Used to evict the least recently bound textures.
+    ezUInt64 m_lastBindFrame = 0;
+
+    /// \brief Whether the GPU memory was freed to stay within the texture memory budget.
+    bool m_isEvicted = false;
+
+    /// \brief Whether this texture is in the list of textures considered for eviction.
+    bool m_isTracked = false;
+
+    TextureLoadState m_loadState = TextureLoadState::Loaded;
+
+    /// \brief Only valid while the texture is loading asynchronously.
+    TextureLoadTask* m_pLoadTask = nullptr;
   };
 
   TextureImpl* getImpl(Texture* pTex);
   const TextureImpl* getImpl(const Texture* pTex);
+
+  /// \brief Uploads asynchronously loaded textures that finished decoding.
+  /// \note Must be called on the thread that owns the GL context, before drawing.
+  void processTextureLoads();
+
+  /// \brief Finishes the texture memory statistics of the last frame
+  ///        and evicts textures until the memory budget is met.
+  /// \note Must be called on the thread that owns the GL context, once per frame before drawing.
+  void updateTextureResidency();
 }
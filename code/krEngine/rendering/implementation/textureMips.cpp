@@ -0,0 +1,290 @@
+#include <krEngine/rendering/implementation/textureMips.h>
+
+#if EZ_ENABLED(KR_SIMD_SSE2)
+  #include <emmintrin.h>
+#endif
+
+// Each pixel has four 8 bit channels.
+static const ezUInt32 BytesPerPixel = 4;
+
+static bool isSupported(ezImageFormat::Enum format)
+{
+  switch(format)
+  {
+  case ezImageFormat::B8G8R8A8_UNORM:
+  case ezImageFormat::B8G8R8A8_UNORM_SRGB:
+  case ezImageFormat::B8G8R8X8_UNORM:
+  case ezImageFormat::B8G8R8X8_UNORM_SRGB:
+  case ezImageFormat::R8G8B8A8_UNORM:
+  case ezImageFormat::R8G8B8A8_UNORM_SRGB:
+    return true;
+  default:
+    break;
+  }
+
+  return false;
+}
+
+struct Level
+{
+  const ezUInt8* pPixels;
+  ezUInt32 width;
+  ezUInt32 height;
+  ezUInt32 rowPitch;
+};
+
+struct MutableLevel
+{
+  ezUInt8* pPixels;
+  ezUInt32 width;
+  ezUInt32 height;
+  ezUInt32 rowPitch;
+};
+
+// Box Filter
+// ==========
+
+static void downsampleBox(const Level& src, const MutableLevel& dst)
+{
+  for (ezUInt32 y = 0; y < dst.height; ++y)
+  {
+    // Odd sizes repeat the last row or column.
+    auto pRow0 = src.pPixels + ezMath::Min(2 * y,     src.height - 1) * src.rowPitch;
+    auto pRow1 = src.pPixels + ezMath::Min(2 * y + 1, src.height - 1) * src.rowPitch;
+    auto pOut = dst.pPixels + y * dst.rowPitch;
+
+    ezUInt32 x = 0;
+
+#if EZ_ENABLED(KR_SIMD_SSE2)
+    // Two output pixels from four input pixels of each row per iteration.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(2);
+    for (; x + 2 <= dst.width && 2 * x + 3 < src.width; x += 2)
+    {
+      __m128i top    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + 2 * x * BytesPerPixel));
+      __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + 2 * x * BytesPerPixel));
+
+      // Widen to 16 bit and sum vertically.
+      __m128i sumLeft  = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+      __m128i sumRight = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+      // Sum horizontally. The lower 4 lanes contain the result.
+      sumLeft  = _mm_add_epi16(sumLeft,  _mm_srli_si128(sumLeft,  8));
+      sumRight = _mm_add_epi16(sumRight, _mm_srli_si128(sumRight, 8));
+
+      __m128i sum = _mm_unpacklo_epi64(sumLeft, sumRight);
+      __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(pOut + x * BytesPerPixel),
+                       _mm_packus_epi16(average, average));
+    }
+#endif
+
+    for (; x < dst.width; ++x)
+    {
+      auto x0 = ezMath::Min(2 * x,     src.width - 1) * BytesPerPixel;
+      auto x1 = ezMath::Min(2 * x + 1, src.width - 1) * BytesPerPixel;
+
+      for (ezUInt32 c = 0; c < BytesPerPixel; ++c)
+      {
+        ezUInt32 sum = pRow0[x0 + c] + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c];
+        pOut[x * BytesPerPixel + c] = static_cast<ezUInt8>((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+// Kaiser Filter
+// =============
+
+/// \brief Half the number of taps of the kernel.
+static const ezInt32 KaiserRadius = 4;
+
+/// \brief Zeroth order modified Bessel function of the first kind.
+static float besselI0(float x)
+{
+  float sum = 1.0f;
+  float term = 1.0f;
+  for (int k = 1; k < 16; ++k)
+  {
+    term *= (x / (2.0f * k)) * (x / (2.0f * k));
+    sum += term;
+  }
+  return sum;
+}
+
+static float sinc(float x)
+{
+  if (ezMath::Abs(x) < 1e-5f)
+    return 1.0f;
+
+  const float px = ezMath::BasicType<float>::Pi() * x;
+  return ezMath::Sin(ezAngle::Radian(px)) / px;
+}
+
+/// \brief Weights for a 2:1 reduction. The taps sit at distances of 0.5, 1.5, ... from the output pixel center.
+static void computeKaiserWeights(float (&out_weights)[2 * KaiserRadius])
+{
+  const float alpha = 4.0f;
+  const float normalization = besselI0(alpha);
+
+  float sum = 0.0f;
+  for (ezInt32 i = 0; i < 2 * KaiserRadius; ++i)
+  {
+    const float distance = float(i - KaiserRadius) + 0.5f;
+    const float t = distance / float(KaiserRadius);
+    const float window = besselI0(alpha * ezMath::Sqrt(ezMath::Max(0.0f, 1.0f - t * t))) / normalization;
+
+    // The cutoff is at half the source frequency.
+    out_weights[i] = sinc(distance * 0.5f) * window;
+    sum += out_weights[i];
+  }
+
+  for (auto& weight : out_weights)
+  {
+    weight /= sum;
+  }
+}
+
+static void downsampleKaiser(const Level& src, const MutableLevel& dst, ezDynamicArray<float>& temp)
+{
+  float weights[2 * KaiserRadius];
+  computeKaiserWeights(weights);
+
+  auto clampIndex = [](ezInt32 i, ezUInt32 count)
+  {
+    return static_cast<ezUInt32>(ezMath::Clamp(i, 0, static_cast<ezInt32>(count) - 1));
+  };
+
+  // Horizontal Pass
+  // ===============
+  // Result has the width of the destination and the height of the source.
+  temp.SetCount(dst.width * src.height * BytesPerPixel);
+
+  for (ezUInt32 y = 0; y < src.height; ++y)
+  {
+    auto pRow = src.pPixels + y * src.rowPitch;
+    auto pOut = temp.GetData() + y * dst.width * BytesPerPixel;
+
+    for (ezUInt32 x = 0; x < dst.width; ++x)
+    {
+      float sum[BytesPerPixel] = {};
+      for (ezInt32 i = 0; i < 2 * KaiserRadius; ++i)
+      {
+        auto srcX = clampIndex(2 * static_cast<ezInt32>(x) + i - KaiserRadius + 1, src.width);
+        for (ezUInt32 c = 0; c < BytesPerPixel; ++c)
+        {
+          sum[c] += weights[i] * pRow[srcX * BytesPerPixel + c];
+        }
+      }
+
+      for (ezUInt32 c = 0; c < BytesPerPixel; ++c)
+      {
+        pOut[x * BytesPerPixel + c] = sum[c];
+      }
+    }
+  }
+
+  // Vertical Pass
+  // =============
+  for (ezUInt32 y = 0; y < dst.height; ++y)
+  {
+    auto pOut = dst.pPixels + y * dst.rowPitch;
+
+    for (ezUInt32 x = 0; x < dst.width; ++x)
+    {
+      float sum[BytesPerPixel] = {};
+      for (ezInt32 i = 0; i < 2 * KaiserRadius; ++i)
+      {
+        auto srcY = clampIndex(2 * static_cast<ezInt32>(y) + i - KaiserRadius + 1, src.height);
+        auto pIn = temp.GetData() + (srcY * dst.width + x) * BytesPerPixel;
+        for (ezUInt32 c = 0; c < BytesPerPixel; ++c)
+        {
+          sum[c] += weights[i] * pIn[c];
+        }
+      }
+
+      // The negative lobes can over- and undershoot.
+      for (ezUInt32 c = 0; c < BytesPerPixel; ++c)
+      {
+        pOut[x * BytesPerPixel + c] = static_cast<ezUInt8>(ezMath::Clamp(sum[c] + 0.5f, 0.0f, 255.0f));
+      }
+    }
+  }
+}
+
+// Public API
+// ==========
+
+ezUInt32 kr::computeNumMipLevels(ezUInt32 width, ezUInt32 height)
+{
+  ezUInt32 numLevels = 1;
+  auto size = ezMath::Max(width, height);
+  while (size > 1)
+  {
+    size /= 2;
+    ++numLevels;
+  }
+  return numLevels;
+}
+
+ezResult kr::generateMipChain(ezImage& image, MipFilter filter)
+{
+  if (!isSupported(image.GetImageFormat()))
+    return EZ_FAILURE;
+
+  // Allocate the Full Chain
+  // =======================
+  ezImage result;
+  result.SetWidth(image.GetWidth());
+  result.SetHeight(image.GetHeight());
+  result.SetImageFormat(image.GetImageFormat());
+  result.SetNumFaces(image.GetNumFaces());
+  result.SetNumArrayIndices(image.GetNumArrayIndices());
+  result.SetNumMipLevels(computeNumMipLevels(image.GetWidth(), image.GetHeight()));
+  result.AllocateImageData();
+
+  ezDynamicArray<float> temp;
+
+  for (ezUInt32 arrayIndex = 0; arrayIndex < result.GetNumArrayIndices(); ++arrayIndex)
+  {
+    for (ezUInt32 face = 0; face < result.GetNumFaces(); ++face)
+    {
+      // Copy the base level.
+      for (ezUInt32 y = 0; y < result.GetHeight(); ++y)
+      {
+        ezMemoryUtils::Copy(result.GetSubImagePointer<ezUInt8>(0, face, arrayIndex) + y * result.GetRowPitch(0),
+                            image.GetSubImagePointer<ezUInt8>(0, face, arrayIndex) + y * image.GetRowPitch(0),
+                            result.GetWidth() * BytesPerPixel);
+      }
+
+      // Filter each level from the previous one.
+      for (ezUInt32 mip = 1; mip < result.GetNumMipLevels(); ++mip)
+      {
+        Level src;
+        src.pPixels = result.GetSubImagePointer<ezUInt8>(mip - 1, face, arrayIndex);
+        src.width = result.GetWidth(mip - 1);
+        src.height = result.GetHeight(mip - 1);
+        src.rowPitch = result.GetRowPitch(mip - 1);
+
+        MutableLevel dst;
+        dst.pPixels = result.GetSubImagePointer<ezUInt8>(mip, face, arrayIndex);
+        dst.width = result.GetWidth(mip);
+        dst.height = result.GetHeight(mip);
+        dst.rowPitch = result.GetRowPitch(mip);
+
+        switch(filter)
+        {
+        case kr::MipFilter::Box:    downsampleBox(src, dst); break;
+        case kr::MipFilter::Kaiser: downsampleKaiser(src, dst, temp); break;
+        default:
+          EZ_REPORT_FAILURE("Invalid input.");
+          return EZ_FAILURE;
+        }
+      }
+    }
+  }
+
+  image = move(result);
+  return EZ_SUCCESS;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <CoreUtils/Image/Image.h>
+
+namespace kr
+{
+  enum class MipFilter
+  {
+    Box,
+    Kaiser,
+  };
+
+  /// \brief Number of levels of a full mip chain down to 1x1.
+  ezUInt32 computeNumMipLevels(ezUInt32 width, ezUInt32 height);
+
+  /// \brief Replaces all levels of \a image with ones generated from its base level.
+  ///
+  /// Each level is filtered from the previous one. All faces and array slices are processed.
+  /// \note Does not touch any GL state, so this can run on any thread.
+  /// \return EZ_FAILURE if the format of \a image is not supported.
+  ///         Only formats with four 8 bit channels are supported at the moment.
+  ezResult generateMipChain(ezImage& image, MipFilter filter);
+}
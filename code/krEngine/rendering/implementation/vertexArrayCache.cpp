@@ -0,0 +1,425 @@
+#include <krEngine/rendering/vertexArrayCache.h>
+#include <krEngine/rendering/implementation/vertexArrayCacheImpl.h>
+#include <krEngine/rendering/implementation/opelGlCheck.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
+
+#include <Foundation/Containers/HashTable.h>
+#include <Foundation/Algorithm/Hashing.h>
+
+namespace
+{
+  struct CacheEntry
+  {
+    ezHybridArray<kr::ResolvedVertexAttribute, 8> attributes;
+    GLuint hVertexArray = 0;
+  };
+
+  /// \brief Formats with the same hash share a bucket.
+  using Bucket = ezHybridArray<CacheEntry*, 1>;
+
+  /// \brief The vertex array object a layout resolved to for a program.
+  struct ResolvedLayout
+  {
+    GLuint hVertexArray = 0;
+
+    /// \brief Whether all attributes of the layout are active in the program.
+    bool isComplete = false;
+  };
+
+  /// \brief A copy of a registered vertex layout, including the attribute names.
+  struct LayoutEntry
+  {
+    ezHybridArray<ezString, 8> names;
+    ezHybridArray<kr::VertexAttribute, 8> attributes;
+
+    /// \brief Points into the arrays above, which never change after registering.
+    kr::VertexLayout* pLayout = nullptr;
+
+    /// \brief Keyed by the GL handle of the program.
+    ezHashTable<ezUInt32, ResolvedLayout> programs;
+  };
+
+  struct VertexArrayCacheData
+  {
+    ezHashTable<ezUInt32, Bucket> buckets;
+    ezUInt32 numEntries = 0;
+
+    /// \brief Registered layouts. The id of a layout is its index + 1.
+    ezDynamicArray<LayoutEntry*> layouts;
+
+    /// \brief Ids of the registered layouts, by the hash of their content.
+    ezHashTable<ezUInt32, ezHybridArray<ezUInt32, 1>> layoutIds;
+  };
+}
+
+static VertexArrayCacheData* g_pCache;
+static bool g_initialized = false;
+
+static void clearCache(VertexArrayCacheData& cache)
+{
+  for (auto it = cache.buckets.GetIterator(); it.IsValid(); ++it)
+  {
+    for (auto pEntry : it.Value())
+    {
+      glCheck(glDeleteVertexArrays(1, &pEntry->hVertexArray));
+      EZ_DEFAULT_DELETE(pEntry);
+    }
+  }
+
+  cache.buckets.Clear();
+  cache.numEntries = 0;
+
+  // The resolved layouts refer to the deleted vertex array objects.
+  for (auto pEntry : cache.layouts)
+  {
+    pEntry->programs.Clear();
+  }
+}
+
+static void clearLayouts(VertexArrayCacheData& cache)
+{
+  for (auto pEntry : cache.layouts)
+  {
+    EZ_DEFAULT_DELETE(pEntry->pLayout);
+    EZ_DEFAULT_DELETE(pEntry);
+  }
+
+  cache.layouts.Clear();
+  cache.layoutIds.Clear();
+}
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, VertexArrayCache)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pCache = new (m_mem_cache) VertexArrayCacheData();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // Vertex array objects belong to the GL context,
+    // which is usually gone by the time the core shuts down.
+    clearCache(*g_pCache);
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    clearLayouts(*g_pCache);
+
+    g_pCache->~VertexArrayCacheData();
+    g_pCache = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_cache[sizeof(VertexArrayCacheData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+static ezUInt32 hashFormat(ezArrayPtr<const kr::ResolvedVertexAttribute> attributes)
+{
+  // Hash the members one by one, so padding never contributes.
+  ezHybridArray<ezUInt32, 64> values;
+  for (auto& attribute : attributes)
+  {
+    values.PushBack(attribute.location);
+    values.PushBack(attribute.glType);
+    values.PushBack(static_cast<ezUInt32>(attribute.numComponents));
+    values.PushBack(attribute.isNormalized);
+    values.PushBack(attribute.isInteger);
+    values.PushBack(attribute.offset);
+    values.PushBack(attribute.binding);
+    values.PushBack(attribute.divisor);
+  }
+
+  return ezHashing::MurmurHash(values.GetData(), values.GetCount() * sizeof(ezUInt32));
+}
+
+static bool isSameFormat(const CacheEntry& entry,
+                         ezArrayPtr<const kr::ResolvedVertexAttribute> attributes)
+{
+  if (entry.attributes.GetCount() != attributes.GetCount())
+    return false;
+
+  for (ezUInt32 i = 0; i < attributes.GetCount(); ++i)
+  {
+    auto& lhs = entry.attributes[i];
+    auto& rhs = attributes[i];
+    if (lhs.location != rhs.location
+        || lhs.glType != rhs.glType
+        || lhs.numComponents != rhs.numComponents
+        || lhs.isNormalized != rhs.isNormalized
+        || lhs.isInteger != rhs.isInteger
+        || lhs.offset != rhs.offset
+        || lhs.binding != rhs.binding
+        || lhs.divisor != rhs.divisor)
+      return false;
+  }
+
+  return true;
+}
+
+static GLuint createVertexArray(ezArrayPtr<const kr::ResolvedVertexAttribute> attributes)
+{
+  GLuint hVertexArray = 0;
+  glCheck(glGenVertexArrays(1, &hVertexArray));
+
+  if (hVertexArray == 0)
+  {
+    ezLog::Warning("Failed to create OpenGL vertex array object. "
+                   "Did you forget to create a rendering context?");
+    return 0;
+  }
+
+  // Don't change whatever is bound right now.
+  GLint hPreviousVao = 0;
+  glCheck(glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &hPreviousVao));
+  glCheck(glBindVertexArray(hVertexArray));
+
+  // Most attributes read from binding point 0, which bind() attaches the vertex buffer to.
+  for (auto& attribute : attributes)
+  {
+    glCheck(glEnableVertexAttribArray(attribute.location));
+
+    if (attribute.isInteger)
+    {
+      glCheck(glVertexAttribIFormat(attribute.location,
+                                    attribute.numComponents,
+                                    attribute.glType,
+                                    attribute.offset));
+    }
+    else
+    {
+      glCheck(glVertexAttribFormat(attribute.location,
+                                   attribute.numComponents,
+                                   attribute.glType,
+                                   attribute.isNormalized,
+                                   attribute.offset));
+    }
+
+    glCheck(glVertexAttribBinding(attribute.location, attribute.binding));
+    glCheck(glVertexBindingDivisor(attribute.binding, attribute.divisor));
+  }
+
+  glCheck(glBindVertexArray(static_cast<GLuint>(hPreviousVao)));
+
+  return hVertexArray;
+}
+
+GLuint kr::VertexArrayCache::get(ezArrayPtr<const ResolvedVertexAttribute> attributes)
+{
+  EZ_ASSERT_DEV(g_initialized, "VertexArrayCache subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  auto& cache = *g_pCache;
+  auto hash = hashFormat(attributes);
+
+  // Look Up
+  // =======
+  Bucket* pBucket = nullptr;
+  if (cache.buckets.TryGetValue(hash, pBucket))
+  {
+    for (auto pEntry : *pBucket)
+    {
+      if (isSameFormat(*pEntry, attributes))
+        return pEntry->hVertexArray;
+    }
+  }
+
+  // Create
+  // ======
+  auto hVertexArray = createVertexArray(attributes);
+  if (hVertexArray == 0)
+    return 0;
+
+  auto pEntry = EZ_DEFAULT_NEW(CacheEntry);
+  pEntry->attributes.PushBackRange(attributes);
+  pEntry->hVertexArray = hVertexArray;
+
+  if (pBucket == nullptr)
+  {
+    cache.buckets.Insert(hash, Bucket());
+    cache.buckets.TryGetValue(hash, pBucket);
+  }
+  pBucket->PushBack(pEntry);
+  ++cache.numEntries;
+
+  return hVertexArray;
+}
+
+void kr::VertexArrayCache::bind(GLuint hVertexArray, GLuint hBuffer, ezUInt32 stride, GLuint hIndexBuffer)
+{
+  glCheck(glBindVertexArray(hVertexArray));
+  ++currentFrameStats().numVertexArrayChanges;
+
+  glCheck(glBindVertexBuffer(0, hBuffer, 0, static_cast<GLsizei>(stride)));
+
+  // The element array binding is part of the vertex array state,
+  // and shared vertex arrays are used with different index buffers.
+  glCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, hIndexBuffer));
+}
+
+static ezUInt32 hashLayout(const kr::VertexLayout& layout)
+{
+  ezUInt32 hash = ezHashing::MurmurHash(&layout.m_stride, sizeof(layout.m_stride));
+  for (auto& attribute : layout.m_attributes)
+  {
+    const ezUInt32 values[] = {
+      ezHashing::MurmurHash(attribute.name, ezStringUtils::GetStringElementCount(attribute.name)),
+      attribute.glType,
+      static_cast<ezUInt32>(attribute.numComponents),
+      attribute.isNormalized,
+      attribute.offset,
+    };
+    hash = ezHashing::MurmurHash(values, sizeof(values), hash);
+  }
+
+  return hash;
+}
+
+static bool isSameLayout(const kr::VertexLayout& lhs, const kr::VertexLayout& rhs)
+{
+  if (lhs.m_stride != rhs.m_stride || lhs.m_attributes.GetCount() != rhs.m_attributes.GetCount())
+    return false;
+
+  for (ezUInt32 i = 0; i < lhs.m_attributes.GetCount(); ++i)
+  {
+    auto& l = lhs.m_attributes[i];
+    auto& r = rhs.m_attributes[i];
+    if (!ezStringUtils::IsEqual(l.name, r.name)
+        || l.glType != r.glType
+        || l.numComponents != r.numComponents
+        || l.isNormalized != r.isNormalized
+        || l.offset != r.offset)
+      return false;
+  }
+
+  return true;
+}
+
+ezUInt32 kr::VertexArrayCache::registerLayout(const VertexLayout& layout)
+{
+  EZ_ASSERT_DEV(g_initialized, "VertexArrayCache subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  auto& cache = *g_pCache;
+  auto hash = hashLayout(layout);
+
+  // Look Up
+  // =======
+  ezHybridArray<ezUInt32, 1>* pIds = nullptr;
+  if (cache.layoutIds.TryGetValue(hash, pIds))
+  {
+    for (auto id : *pIds)
+    {
+      if (isSameLayout(*cache.layouts[id - 1]->pLayout, layout))
+        return id;
+    }
+  }
+
+  // Copy
+  // ====
+  // The names are copied first, so the attributes can point to them.
+  auto pEntry = EZ_DEFAULT_NEW(LayoutEntry);
+  for (auto& attribute : layout.m_attributes)
+  {
+    pEntry->names.PushBack(attribute.name);
+  }
+  for (ezUInt32 i = 0; i < layout.m_attributes.GetCount(); ++i)
+  {
+    auto& attribute = pEntry->attributes.ExpandAndGetRef();
+    attribute = layout.m_attributes[i];
+    attribute.name = pEntry->names[i].GetData();
+  }
+  pEntry->pLayout = EZ_DEFAULT_NEW(VertexLayout)(
+    ezArrayPtr<const VertexAttribute>(pEntry->attributes.GetData(), pEntry->attributes.GetCount()),
+    layout.m_stride);
+
+  cache.layouts.PushBack(pEntry);
+  auto id = cache.layouts.GetCount();
+
+  if (pIds == nullptr)
+  {
+    cache.layoutIds.Insert(hash, ezHybridArray<ezUInt32, 1>());
+    cache.layoutIds.TryGetValue(hash, pIds);
+  }
+  pIds->PushBack(id);
+
+  return id;
+}
+
+GLuint kr::VertexArrayCache::get(ezUInt32 layoutId,
+                                 Borrowed<const ShaderProgram> pShader,
+                                 ezResult* out_pResult)
+{
+  EZ_ASSERT_DEV(g_initialized, "VertexArrayCache subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  auto& cache = *g_pCache;
+
+  if (layoutId == 0 || layoutId > cache.layouts.GetCount())
+  {
+    ezLog::Warning("Invalid vertex layout id %u.", layoutId);
+    return 0;
+  }
+
+  if (pShader == nullptr)
+  {
+    ezLog::Warning("Shader program is nullptr. Aborting.");
+    return 0;
+  }
+
+  auto& entry = *cache.layouts[layoutId - 1];
+  const ezUInt32 hProgram = pShader->getGlHandle();
+
+  // Look Up
+  // =======
+  ResolvedLayout* pResolved = nullptr;
+  if (entry.programs.TryGetValue(hProgram, pResolved))
+  {
+    if (out_pResult)
+      *out_pResult = pResolved->isComplete ? EZ_SUCCESS : EZ_FAILURE;
+    return pResolved->hVertexArray;
+  }
+
+  // Resolve
+  // =======
+  ezHybridArray<ResolvedVertexAttribute, 8> attributes;
+  auto result = resolveVertexLayout(pShader, *entry.pLayout, attributes);
+  if (out_pResult)
+    *out_pResult = result;
+
+  auto hVertexArray = get(ezArrayPtr<const ResolvedVertexAttribute>(attributes.GetData(), attributes.GetCount()));
+  if (hVertexArray == 0)
+    return 0;
+
+  ResolvedLayout resolved;
+  resolved.hVertexArray = hVertexArray;
+  resolved.isComplete = result.Succeeded();
+  entry.programs.Insert(hProgram, resolved);
+
+  return hVertexArray;
+}
+
+void kr::forgetVertexArraysOf(GLuint hProgram)
+{
+  // Programs may be deleted after the engine shut down.
+  if (g_pCache == nullptr)
+    return;
+
+  for (auto pEntry : g_pCache->layouts)
+  {
+    pEntry->programs.Remove(static_cast<ezUInt32>(hProgram));
+  }
+}
+
+ezUInt32 kr::VertexArrayCache::getCount()
+{
+  return g_pCache->numEntries;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace kr
+{
+  /// \brief Forgets which vertex array objects were resolved for the program \a hProgram.
+  ///
+  /// Call this before deleting a program, since GL may hand out its name again
+  /// for a program with different attribute locations.
+  /// The shared vertex array objects themselves stay in the cache.
+  void forgetVertexArraysOf(GLuint hProgram);
+}
@@ -1,5 +1,9 @@
 #include <krEngine/rendering/vertexBuffer.h>
+#include <krEngine/rendering/indexBuffer.h>
+#include <krEngine/rendering/vertexArrayCache.h>
+#include <krEngine/rendering/implementation/vertexBufferPoolImpl.h>
 #include <krEngine/rendering/implementation/opelGlCheck.h>
+#include <krEngine/rendering/implementation/rendererStatsImpl.h>
 
 #include <Foundation/Reflection/Reflection.h>
 
@@ -10,6 +14,7 @@ namespace
     kr::Borrowed<const kr::VertexBuffer> pVertexBuffer;
     kr::Borrowed<const kr::ShaderProgram> pShader;
     GLuint glHandle_VAO = 0;
+    ezUInt32 stride = 0;
   };
 }
 
@@ -135,15 +140,40 @@ kr::Owned<kr::VertexBuffer> kr::VertexBuffer::create(BufferUsage usage,
   return own(pVertexBuffer, [](VertexBuffer* ptr){ EZ_DEFAULT_DELETE(ptr); });
 }
 
+kr::Owned<kr::VertexBuffer> kr::createPooledVertexBuffer(VertexBufferPoolPage* pPage,
+                                                         GLuint hBuffer,
+                                                         ezUInt32 byteOffset,
+                                                         ezUInt32 byteCount,
+                                                         PrimitiveType primitive)
+{
+  VertexBuffer* pVertexBuffer = EZ_DEFAULT_NEW(VertexBuffer);
+  pVertexBuffer->m_glHandle = hBuffer;
+  pVertexBuffer->m_usage = BufferUsage::DynamicDraw;
+  pVertexBuffer->m_primitive = primitive;
+  pVertexBuffer->m_byteOffset = byteOffset;
+  pVertexBuffer->m_byteCount = byteCount;
+  pVertexBuffer->m_pPoolPage = pPage;
+  return own(pVertexBuffer, [](VertexBuffer* ptr){ EZ_DEFAULT_DELETE(ptr); });
+}
+
 kr::VertexBuffer::~VertexBuffer()
 {
-  glCheck(glDeleteBuffers(1, &m_glHandle));
+  if (isPooled())
+  {
+    // The GL buffer belongs to the page.
+    releasePooledVertexBuffer(*this);
+  }
+  else
+  {
+    glCheck(glDeleteBuffers(1, &m_glHandle));
+  }
+
   m_glHandle = 0;
 }
 
 ezResult kr::setupLayout(Borrowed<VertexBuffer> pVertBuffer,
                          Borrowed<ShaderProgram> pShader,
-                         const char* layoutTypeName)
+                         const VertexLayout& layout)
 {
   EZ_LOG_BLOCK("Setup Vertex Buffer Layout");
 
@@ -159,65 +189,44 @@ ezResult kr::setupLayout(Borrowed<VertexBuffer> pVertBuffer,
     return EZ_FAILURE;
   }
 
+  pVertBuffer->m_layoutId = VertexArrayCache::registerLayout(layout);
+  pVertBuffer->m_stride = layout.m_stride;
+
+  // Vertex Array Object (VAO)
+  // =========================
+  // Shared by all vertex buffers of the same format.
+  // Resolved right away, so missing attributes are reported here instead of on the first bind.
+  auto result = EZ_SUCCESS;
+  auto vao = VertexArrayCache::get(pVertBuffer->m_layoutId, pShader, &result);
+  if (vao == 0)
+    return EZ_FAILURE;
+
+  return result;
+}
+
+ezResult kr::setupLayout(Borrowed<VertexBuffer> pVertBuffer,
+                         Borrowed<ShaderProgram> pShader,
+                         const char* layoutTypeName)
+{
   // Use reflection to find the actual type data.
   auto pLayout = ezRTTI::FindTypeByName(layoutTypeName);
 
   if (pLayout == nullptr)
   {
     ezLog::Warning(
-        "Given layout type name is not the name of a reflected type (ezRTTI)",
+        "Given layout type name '%s' is not the name of a reflected type (ezRTTI)",
         layoutTypeName);
     return EZ_FAILURE;
   }
 
-  // Vertex Array Object (VAO)
-  // =========================
-  GLuint vao = 0;
-
-  // Check if we already
-  for (ezUInt32 i = 0; i < pVertBuffer->m_Vaos.GetCount(); ++i)
-  {
-    auto& pair = pVertBuffer->m_Vaos[i];
-    if (pair.pShader == pShader)
-    {
-      ezLog::Debug("Overwriting existing vertex buffer layout binding.");
-      vao = pair.hVao;
-      break;
-    }
-  }
-
-  // If we have an existing vertex array object.
-  if (vao == 0)
-  {
-    // Create a new one.
-    glCheck(glGenVertexArrays(1, &vao));
-
-    // Remember it.
-    auto& entry = pVertBuffer->m_Vaos.ExpandAndGetRef();
-    entry.hVao = vao;
-    entry.pShader = pShader;
-  }
-
-  glCheck(glBindVertexArray(vao));
-
-  // Bind Vertex Buffer Object
-  // =========================
-  auto hVbo = pVertBuffer->m_glHandle;
-  auto vboTarget = static_cast<GLenum>(pVertBuffer->getTarget());
-
-  glCheck(glBindBuffer(vboTarget, hVbo));
-
-  // Bind Vertex Attributes
-  // ======================
-  // The size of the layout type.
-  auto stride = pLayout->GetTypeSize();
+  // Translate the Reflected Members
+  // ===============================
+  ezHybridArray<VertexAttribute, 8> attributes;
 
   // The properties of the layout type.
   auto& props = pLayout->GetProperties();
 
-  auto result = EZ_SUCCESS;
-  size_t offset = 0;
-  auto hProgram = pShader->m_glHandle;
+  ezUInt32 offset = 0;
 
   for (ezUInt32 i = 0; i < props.GetCount(); ++i)
   {
@@ -227,55 +236,27 @@ ezResult kr::setupLayout(Borrowed<VertexBuffer> pVertBuffer,
     if (pProp->GetCategory() != ezPropertyCategory::Member)
       continue;
 
-    // The name of the attribute in the layout struct.
-    auto attributeName = static_cast<ezAbstractMemberProperty*>(pProp)->GetPropertyName();
-
     // The reflectable member attribute.
     auto pAttribute = static_cast<ezAbstractMemberProperty*>(pProp)->GetSpecificType();
 
-    // Size of the attribute (in bytes).
-    auto attributeSize = pAttribute->GetTypeSize();
+    auto& attribute = attributes.ExpandAndGetRef();
+
+    // The name of the attribute in the layout struct.
+    attribute.name = static_cast<ezAbstractMemberProperty*>(pProp)->GetPropertyName();
+    attribute.isNormalized = GL_FALSE;
+    attribute.offset = offset;
 
     // The variant type of the attribute.
     // used to determine the corresponding GL type and number of components.
-    auto attributeType = pAttribute->GetVariantType();
-
-    // The reference to the attribute within the program.
-    auto location = glGetAttribLocation(hProgram, attributeName);
-    glCheckLastError();
+    getSizeInfo(pAttribute->GetVariantType(), attribute.glType, attribute.numComponents);
 
-    if (location != -1)
-    {
-      // Set Vertex Attributes for the Found Location
-      // ============================================
-
-      GLenum type;
-      GLint numComponents;
-      getSizeInfo(attributeType, type, numComponents);
-
-      glCheck(glEnableVertexAttribArray(location));
-      glCheck(glVertexAttribPointer(location,
-                                    numComponents,
-                                    type,
-                                    GL_FALSE,
-                                    stride,
-                                    (void*)offset));
-    }
-    else
-    {
-      ezLog::Warning("Attribute location of '%s' not found.", attributeName);
-      result = EZ_FAILURE;
-    }
-
-    offset += attributeSize;
+    offset += pAttribute->GetTypeSize();
   }
 
-  /// \todo Do the following two calls using some kind of scope(exit) mechanism.
+  VertexLayout layout(ezArrayPtr<const VertexAttribute>(attributes.GetData(), attributes.GetCount()),
+                      pLayout->GetTypeSize());
 
-  glCheck(glBindVertexArray(0));
-  glCheck(glBindBuffer(vboTarget, 0));
-
-  return result;
+  return setupLayout(move(pVertBuffer), move(pShader), layout);
 }
 
 ezResult kr::uploadData(kr::Borrowed<const VertexBuffer> pVertBuffer,
@@ -297,14 +278,51 @@ ezResult kr::uploadData(kr::Borrowed<const VertexBuffer> pVertBuffer,
 
   EZ_ASSERT_DEBUG(glIsBuffer(handle) == GL_TRUE, "Invalid vertex buffer");
 
+  if (pVertBuffer->isPooled())
+  {
+    // Pooled Buffers Have a Fixed Size
+    // ================================
+    if (offet + byteCount > pVertBuffer->m_byteCount)
+    {
+      ezLog::Warning("Cannot upload %u bytes at offset %u to a pooled vertex buffer of %u bytes.",
+                     byteCount, offet, pVertBuffer->m_byteCount);
+      return EZ_FAILURE;
+    }
+
+    // The storage already exists.
+    if (bytes == nullptr)
+      return EZ_SUCCESS;
+
+    glCheck(glBindBuffer(target, handle));
+    glCheck(glBufferSubData(target, pVertBuffer->m_byteOffset + offet, byteCount, bytes));
+    glCheck(glBindBuffer(target, 0));
+    currentFrameStats().bufferBytesUploaded += byteCount;
+
+    return EZ_SUCCESS;
+  }
+
   glCheck(glBindBuffer(target, handle));
   // TODO Could optimize here by using glBufferSubData instead.
   glCheck(glBufferData(target, (GLsizeiptr)byteCount, bytes, usage));
   glCheck(glBindBuffer(target, 0));
 
+  // Without data, the buffer is only allocated.
+  if (bytes != nullptr)
+    currentFrameStats().bufferBytesUploaded += byteCount;
+
   return EZ_SUCCESS;
 }
 
+/// \brief Binds the shared \a hVao with the buffers of \a vertexBuffer.
+static void bindVertexArray(const kr::VertexBuffer& vertexBuffer, GLuint hVao, ezUInt32 stride)
+{
+  auto& pIndexBuffer = vertexBuffer.m_pIndexBuffer;
+  kr::VertexArrayCache::bind(hVao,
+                             vertexBuffer.m_glHandle,
+                             stride,
+                             pIndexBuffer != nullptr ? pIndexBuffer->m_glHandle : 0);
+}
+
 ezResult kr::bind(kr::Borrowed<const VertexBuffer> pVertBuffer, Borrowed<const ShaderProgram> pShader)
 {
   if (pVertBuffer == nullptr)
@@ -319,31 +337,29 @@ ezResult kr::bind(kr::Borrowed<const VertexBuffer> pVertBuffer, Borrowed<const S
     return EZ_FAILURE;
   }
 
-  GLuint handle = 0;
-
-  for (auto& pair : pVertBuffer->m_Vaos)
+  if (pVertBuffer->m_layoutId == 0)
   {
-    if (pair.pShader == pShader)
-    {
-      handle = pair.hVao;
-      break;
-    }
+    ezLog::Warning("Vertex buffer has no layout. Call setupLayout() first.");
+    return EZ_FAILURE;
   }
 
+  auto handle = VertexArrayCache::get(pVertBuffer->m_layoutId, pShader);
+  auto stride = pVertBuffer->m_stride;
+
   if (handle == 0)
   {
-    ezLog::Warning("No vertex array object found in given vertex buffer for given program.");
+    ezLog::Warning("No vertex array object for the layout of the given vertex buffer and the given program.");
     return EZ_FAILURE;
   }
 
-  // Bind the vertex array object.
-  glCheck(glBindVertexArray(handle));
+  bindVertexArray(*pVertBuffer, handle, stride);
 
   // Save the handle.
   auto& pair = g_pVertexBufferBindings->ExpandAndGetRef();
   pair.pVertexBuffer = move(pVertBuffer);
   pair.pShader = move(pShader);
   pair.glHandle_VAO = handle;
+  pair.stride = stride;
 
   return EZ_SUCCESS;
 }
@@ -372,6 +388,7 @@ ezResult kr::restoreLastVertexBuffer(Borrowed<const ShaderProgram> pShader)
   if(g_pVertexBufferBindings->IsEmpty())
   {
     glCheck(glBindVertexArray(0));
+    ++currentFrameStats().numVertexArrayChanges;
     return EZ_SUCCESS;
   }
 
@@ -381,7 +398,7 @@ ezResult kr::restoreLastVertexBuffer(Borrowed<const ShaderProgram> pShader)
   EZ_ASSERT_DEV(pair.pShader == pShader, "Invalid binding state.");
 
   // And actually bind it again.
-  glCheck(glBindVertexArray(pair.glHandle_VAO));
+  bindVertexArray(*pair.pVertexBuffer, pair.glHandle_VAO, pair.stride);
 
   return EZ_SUCCESS;
 }
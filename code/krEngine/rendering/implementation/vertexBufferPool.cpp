@@ -0,0 +1,467 @@
+#include <krEngine/rendering/vertexBufferPool.h>
+#include <krEngine/rendering/implementation/vertexBufferPoolImpl.h>
+#include <krEngine/rendering/implementation/opelGlCheck.h>
+
+#include <algorithm>
+
+struct kr::VertexBufferPoolPage
+{
+  struct FreeRange
+  {
+    ezUInt32 offset;
+    ezUInt32 byteCount;
+  };
+
+  struct Allocation
+  {
+    VertexBuffer* pVertexBuffer;
+
+    /// \brief The offset of the allocation is always a multiple of this.
+    ezUInt32 stride;
+  };
+
+  GLuint hBuffer = 0;
+  ezUInt32 byteCount = 0;
+
+  /// \brief Sorted by offset. Adjacent ranges are always merged.
+  ezDynamicArray<FreeRange> freeRanges;
+
+  ezDynamicArray<Allocation> allocations;
+};
+
+namespace
+{
+  struct VertexBufferPoolData
+  {
+    ezDynamicArray<kr::VertexBufferPoolPage*> pages;
+    ezUInt32 pageSize = 1024 * 1024;
+
+    /// \brief Compaction moves the allocations through this buffer,
+    ///        since copies within a single buffer must not overlap.
+    GLuint hScratchBuffer = 0;
+    ezUInt32 scratchBufferSize = 0;
+  };
+}
+
+static VertexBufferPoolData* g_pPool;
+static bool g_initialized = false;
+
+static void destroyPage(kr::VertexBufferPoolPage* pPage)
+{
+  glCheck(glDeleteBuffers(1, &pPage->hBuffer));
+  EZ_DEFAULT_DELETE(pPage);
+}
+
+EZ_BEGIN_SUBSYSTEM_DECLARATION(krEngine, VertexBufferPool)
+  BEGIN_SUBSYSTEM_DEPENDENCIES
+    "Foundation",
+    "Core"
+  END_SUBSYSTEM_DEPENDENCIES
+
+  ON_CORE_STARTUP
+  {
+    g_pPool = new (m_mem_pool) VertexBufferPoolData();
+
+    g_initialized = true;
+  }
+
+  ON_ENGINE_SHUTDOWN
+  {
+    // The buffers belong to the GL context,
+    // which is usually gone by the time the core shuts down.
+    for (auto pPage : g_pPool->pages)
+    {
+      if (!pPage->allocations.IsEmpty())
+      {
+        ezLog::Error("%u pooled vertex buffers are still alive. "
+                     "They lose their storage now.",
+                     pPage->allocations.GetCount());
+      }
+
+      // Cut the remaining buffers loose, so their destructors don't touch the page.
+      for (auto& allocation : pPage->allocations)
+      {
+        allocation.pVertexBuffer->m_pPoolPage = nullptr;
+        allocation.pVertexBuffer->m_glHandle = 0;
+      }
+
+      destroyPage(pPage);
+    }
+    g_pPool->pages.Clear();
+
+    if (g_pPool->hScratchBuffer != 0)
+    {
+      glCheck(glDeleteBuffers(1, &g_pPool->hScratchBuffer));
+      g_pPool->hScratchBuffer = 0;
+      g_pPool->scratchBufferSize = 0;
+    }
+  }
+
+  ON_CORE_SHUTDOWN
+  {
+    g_pPool->~VertexBufferPoolData();
+    g_pPool = nullptr;
+
+    g_initialized = false;
+  }
+
+private:
+  ezUInt8 m_mem_pool[sizeof(VertexBufferPoolData)];
+EZ_END_SUBSYSTEM_DECLARATION
+
+static ezUInt32 alignUp(ezUInt32 value, ezUInt32 alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Ranges
+// ======
+
+/// \brief First fit.
+static bool tryAllocateRange(kr::VertexBufferPoolPage& page,
+                             ezUInt32 byteCount,
+                             ezUInt32 stride,
+                             ezUInt32& out_offset)
+{
+  auto& ranges = page.freeRanges;
+
+  for (ezUInt32 i = 0; i < ranges.GetCount(); ++i)
+  {
+    auto range = ranges[i];
+    const ezUInt32 start = alignUp(range.offset, stride);
+    const ezUInt32 end = range.offset + range.byteCount;
+
+    if (start + byteCount > end)
+      continue;
+
+    // Whatever remains before and after the allocation stays free.
+    const ezUInt32 leading = start - range.offset;
+    const ezUInt32 trailing = end - (start + byteCount);
+
+    if (leading > 0 && trailing > 0)
+    {
+      ranges[i].byteCount = leading;
+      ranges.Insert({ start + byteCount, trailing }, i + 1);
+    }
+    else if (leading > 0)
+    {
+      ranges[i].byteCount = leading;
+    }
+    else if (trailing > 0)
+    {
+      ranges[i].offset = start + byteCount;
+      ranges[i].byteCount = trailing;
+    }
+    else
+    {
+      ranges.RemoveAt(i);
+    }
+
+    out_offset = start;
+    return true;
+  }
+
+  return false;
+}
+
+static void releaseRange(kr::VertexBufferPoolPage& page, ezUInt32 offset, ezUInt32 byteCount)
+{
+  auto& ranges = page.freeRanges;
+
+  ezUInt32 i = 0;
+  while (i < ranges.GetCount() && ranges[i].offset < offset)
+  {
+    ++i;
+  }
+
+  ranges.Insert({ offset, byteCount }, i);
+
+  // Merge with the next range.
+  if (i + 1 < ranges.GetCount() && ranges[i].offset + ranges[i].byteCount == ranges[i + 1].offset)
+  {
+    ranges[i].byteCount += ranges[i + 1].byteCount;
+    ranges.RemoveAt(i + 1);
+  }
+
+  // Merge with the previous range.
+  if (i > 0 && ranges[i - 1].offset + ranges[i - 1].byteCount == ranges[i].offset)
+  {
+    ranges[i - 1].byteCount += ranges[i].byteCount;
+    ranges.RemoveAt(i);
+  }
+}
+
+// Pages
+// =====
+
+static kr::VertexBufferPoolPage* createPage(ezUInt32 byteCount)
+{
+  GLuint hBuffer = 0;
+  glCheck(glGenBuffers(1, &hBuffer));
+
+  if (hBuffer == 0)
+  {
+    ezLog::Warning("Failed to create OpenGL buffer for the vertex buffer pool. "
+                   "Did you forget to create a rendering context?");
+    return nullptr;
+  }
+
+  glCheck(glBindBuffer(GL_ARRAY_BUFFER, hBuffer));
+  glCheck(glBufferData(GL_ARRAY_BUFFER, byteCount, nullptr, GL_DYNAMIC_DRAW));
+  glCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+  auto pPage = EZ_DEFAULT_NEW(kr::VertexBufferPoolPage);
+  pPage->hBuffer = hBuffer;
+  pPage->byteCount = byteCount;
+  pPage->freeRanges.PushBack({ 0, byteCount });
+  return pPage;
+}
+
+static kr::Owned<kr::VertexBuffer> allocateFrom(kr::VertexBufferPoolPage& page,
+                                                ezUInt32 byteCount,
+                                                ezUInt32 stride,
+                                                kr::PrimitiveType primitive)
+{
+  ezUInt32 offset = 0;
+  if (!tryAllocateRange(page, byteCount, stride, offset))
+    return nullptr;
+
+  auto pVertexBuffer = kr::createPooledVertexBuffer(&page, page.hBuffer, offset, byteCount, primitive);
+  page.allocations.PushBack({ pVertexBuffer.data.ptr, stride });
+  return move(pVertexBuffer);
+}
+
+kr::Owned<kr::VertexBuffer> kr::VertexBufferPool::allocate(ezUInt32 byteCount,
+                                                           ezUInt32 stride,
+                                                           PrimitiveType primitive)
+{
+  EZ_ASSERT_DEV(g_initialized, "VertexBufferPool subsystem not initialized. "
+                               "Did you forget to start the ezEngine?");
+
+  if (byteCount == 0 || stride == 0)
+  {
+    ezLog::Warning("Cannot allocate a pooled vertex buffer of %u bytes with a stride of %u.",
+                   byteCount, stride);
+    return nullptr;
+  }
+
+  auto& pool = *g_pPool;
+
+  // Too large to share a page.
+  if (byteCount > pool.pageSize)
+  {
+    auto pVertexBuffer = VertexBuffer::create(BufferUsage::DynamicDraw, primitive);
+    if (pVertexBuffer != nullptr)
+    {
+      uploadData(pVertexBuffer, byteCount, nullptr);
+    }
+    return move(pVertexBuffer);
+  }
+
+  for (auto pPage : pool.pages)
+  {
+    auto pVertexBuffer = allocateFrom(*pPage, byteCount, stride, primitive);
+    if (pVertexBuffer != nullptr)
+      return move(pVertexBuffer);
+  }
+
+  // All pages are full.
+  auto pPage = createPage(pool.pageSize);
+  if (pPage == nullptr)
+    return nullptr;
+
+  pool.pages.PushBack(pPage);
+  return allocateFrom(*pPage, byteCount, stride, primitive);
+}
+
+void kr::releasePooledVertexBuffer(VertexBuffer& vertexBuffer)
+{
+  auto& page = *vertexBuffer.m_pPoolPage;
+
+  for (ezUInt32 i = 0; i < page.allocations.GetCount(); ++i)
+  {
+    if (page.allocations[i].pVertexBuffer == &vertexBuffer)
+    {
+      page.allocations.RemoveAtSwap(i);
+      break;
+    }
+  }
+
+  // Empty pages are kept around until the next compaction.
+  releaseRange(page, vertexBuffer.m_byteOffset, vertexBuffer.m_byteCount);
+  vertexBuffer.m_pPoolPage = nullptr;
+}
+
+void kr::VertexBufferPool::setPageSize(ezUInt32 byteCount)
+{
+  g_pPool->pageSize = byteCount;
+}
+
+ezUInt32 kr::VertexBufferPool::getPageSize()
+{
+  return g_pPool->pageSize;
+}
+
+// Compaction
+// ==========
+
+/// \brief Moves all allocations of \a page to its front.
+/// \return The number of moved allocations.
+static ezUInt32 compactPage(kr::VertexBufferPoolPage& page)
+{
+  using Allocation = kr::VertexBufferPoolPage::Allocation;
+
+  auto& allocations = page.allocations;
+  std::sort(allocations.GetData(), allocations.GetData() + allocations.GetCount(),
+            [](const Allocation& lhs, const Allocation& rhs)
+            {
+              return lhs.pVertexBuffer->m_byteOffset < rhs.pVertexBuffer->m_byteOffset;
+            });
+
+  // Compute the New Layout
+  // ======================
+  ezHybridArray<ezUInt32, 64> newOffsets;
+  ezUInt32 numMoved = 0;
+  ezUInt32 end = 0;
+
+  for (auto& allocation : allocations)
+  {
+    auto offset = alignUp(end, allocation.stride);
+    if (offset != allocation.pVertexBuffer->m_byteOffset)
+    {
+      ++numMoved;
+    }
+
+    newOffsets.PushBack(offset);
+    end = offset + allocation.pVertexBuffer->m_byteCount;
+  }
+
+  // Move the Data
+  // =============
+  if (numMoved > 0)
+  {
+    auto& pool = *g_pPool;
+
+    if (pool.hScratchBuffer == 0)
+    {
+      glCheck(glGenBuffers(1, &pool.hScratchBuffer));
+    }
+
+    glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, pool.hScratchBuffer));
+    if (pool.scratchBufferSize < end)
+    {
+      pool.scratchBufferSize = end;
+      glCheck(glBufferData(GL_COPY_WRITE_BUFFER, end, nullptr, GL_STREAM_COPY));
+    }
+
+    // Copy everything to its new place in the scratch buffer ...
+    glCheck(glBindBuffer(GL_COPY_READ_BUFFER, page.hBuffer));
+    for (ezUInt32 i = 0; i < allocations.GetCount(); ++i)
+    {
+      auto pVertexBuffer = allocations[i].pVertexBuffer;
+      glCheck(glCopyBufferSubData(GL_COPY_READ_BUFFER,             // Source.
+                                  GL_COPY_WRITE_BUFFER,            // Destination.
+                                  pVertexBuffer->m_byteOffset,     // Source offset.
+                                  newOffsets[i],                   // Destination offset.
+                                  pVertexBuffer->m_byteCount));    // Number of bytes.
+      pVertexBuffer->m_byteOffset = newOffsets[i];
+    }
+
+    // ... and back in one piece.
+    glCheck(glBindBuffer(GL_COPY_READ_BUFFER, pool.hScratchBuffer));
+    glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, page.hBuffer));
+    glCheck(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, end));
+
+    glCheck(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    glCheck(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+  }
+
+  // Rebuild the Free Ranges
+  // =======================
+  // Alignment may leave small gaps between the allocations.
+  page.freeRanges.Clear();
+
+  ezUInt32 cursor = 0;
+  for (auto& allocation : allocations)
+  {
+    auto pVertexBuffer = allocation.pVertexBuffer;
+    if (pVertexBuffer->m_byteOffset > cursor)
+    {
+      page.freeRanges.PushBack({ cursor, pVertexBuffer->m_byteOffset - cursor });
+    }
+    cursor = pVertexBuffer->m_byteOffset + pVertexBuffer->m_byteCount;
+  }
+
+  if (cursor < page.byteCount)
+  {
+    page.freeRanges.PushBack({ cursor, page.byteCount - cursor });
+  }
+
+  return numMoved;
+}
+
+ezUInt32 kr::VertexBufferPool::compact()
+{
+  EZ_LOG_BLOCK("Compact Vertex Buffer Pool");
+
+  auto& pages = g_pPool->pages;
+  ezUInt32 numMoved = 0;
+
+  for (ezUInt32 i = pages.GetCount(); i > 0; --i)
+  {
+    auto pPage = pages[i - 1];
+
+    if (pPage->allocations.IsEmpty())
+    {
+      destroyPage(pPage);
+      pages.RemoveAt(i - 1);
+      continue;
+    }
+
+    numMoved += compactPage(*pPage);
+  }
+
+  return numMoved;
+}
+
+// Statistics
+// ==========
+
+kr::VertexBufferPoolStats kr::VertexBufferPool::getStats()
+{
+  VertexBufferPoolStats stats;
+
+  for (auto pPage : g_pPool->pages)
+  {
+    ++stats.numPages;
+    stats.numAllocations += pPage->allocations.GetCount();
+    stats.numFreeRanges += pPage->freeRanges.GetCount();
+    stats.byteCount += pPage->byteCount;
+
+    for (auto& allocation : pPage->allocations)
+    {
+      stats.usedByteCount += allocation.pVertexBuffer->m_byteCount;
+    }
+
+    for (auto& range : pPage->freeRanges)
+    {
+      stats.largestFreeRange = ezMath::Max<ezUInt64>(stats.largestFreeRange, range.byteCount);
+    }
+  }
+
+  return stats;
+}
+
+void kr::VertexBufferPool::logStats()
+{
+  auto stats = getStats();
+
+  EZ_LOG_BLOCK("Vertex Buffer Pool Stats");
+
+  ezLog::Info("%u vertex buffers in %u pages, %llu of %llu bytes used, "
+              "%u free ranges, largest free range %llu bytes (%.1f%% fragmentation)",
+              stats.numAllocations, stats.numPages,
+              stats.usedByteCount, stats.byteCount,
+              stats.numFreeRanges, stats.largestFreeRange,
+              stats.getFragmentation() * 100.0f);
+}
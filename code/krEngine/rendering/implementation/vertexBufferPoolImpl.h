@@ -0,0 +1,16 @@
+#pragma once
+#include <krEngine/rendering/vertexBufferPool.h>
+
+namespace kr
+{
+  /// \brief Creates a vertex buffer for the range of \a byteCount bytes at \a byteOffset of the page buffer \a hBuffer.
+  Owned<VertexBuffer> createPooledVertexBuffer(VertexBufferPoolPage* pPage,
+                                               GLuint hBuffer,
+                                               ezUInt32 byteOffset,
+                                               ezUInt32 byteCount,
+                                               PrimitiveType primitive);
+
+  /// \brief Gives the range of \a vertexBuffer back to its page.
+  /// \note Called by the destructor of pooled vertex buffers.
+  void releasePooledVertexBuffer(VertexBuffer& vertexBuffer);
+}
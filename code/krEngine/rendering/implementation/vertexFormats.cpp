@@ -0,0 +1,90 @@
+#include <krEngine/rendering/vertexFormats.h>
+
+#include <cstring>
+
+ezUInt16 kr::toHalf(float value)
+{
+  ezUInt32 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  const ezUInt32 sign = (bits >> 16) & 0x8000;
+  const ezUInt32 exponent = (bits >> 23) & 0xFF;
+  ezUInt32 mantissa = bits & 0x7FFFFF;
+
+  // Infinity and NaN. NaNs stay NaNs.
+  if (exponent == 0xFF)
+    return static_cast<ezUInt16>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+  const ezInt32 halfExponent = static_cast<ezInt32>(exponent) - 127 + 15;
+
+  // Too large.
+  if (halfExponent >= 0x1F)
+    return static_cast<ezUInt16>(sign | 0x7C00);
+
+  ezUInt32 half;
+  ezUInt32 remainder;
+  ezUInt32 halfway;
+
+  if (halfExponent <= 0)
+  {
+    // Too small, even for a subnormal half.
+    if (halfExponent < -10)
+      return static_cast<ezUInt16>(sign);
+
+    // Subnormal. The implicit leading bit becomes explicit.
+    mantissa |= 0x800000;
+    const ezUInt32 shift = static_cast<ezUInt32>(14 - halfExponent);
+    half = mantissa >> shift;
+    remainder = mantissa & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  }
+  else
+  {
+    half = (static_cast<ezUInt32>(halfExponent) << 10) | (mantissa >> 13);
+    remainder = mantissa & 0x1FFF;
+    halfway = 0x1000;
+  }
+
+  // Round to nearest even. A carry correctly moves into the exponent, up to infinity.
+  if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+    ++half;
+
+  return static_cast<ezUInt16>(sign | half);
+}
+
+float kr::fromHalf(ezUInt16 value)
+{
+  const ezUInt32 sign = static_cast<ezUInt32>(value & 0x8000) << 16;
+  ezUInt32 exponent = (value >> 10) & 0x1F;
+  ezUInt32 mantissa = value & 0x3FF;
+
+  ezUInt32 bits;
+  if (exponent == 0x1F)
+  {
+    // Infinity and NaN.
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  }
+  else if (exponent != 0)
+  {
+    bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  }
+  else if (mantissa == 0)
+  {
+    bits = sign;
+  }
+  else
+  {
+    // Subnormal halfs are normal floats.
+    exponent = 127 - 15 + 1;
+    while ((mantissa & 0x400) == 0)
+    {
+      mantissa <<= 1;
+      --exponent;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
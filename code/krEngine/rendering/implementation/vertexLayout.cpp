@@ -0,0 +1,136 @@
+#include <krEngine/rendering/vertexLayout.h>
+#include <krEngine/rendering/implementation/opelGlCheck.h>
+
+kr::VertexLayout::VertexLayout(ezArrayPtr<const VertexAttribute> attributes, ezUInt32 stride) :
+  m_attributes(attributes),
+  m_stride(stride)
+{
+  for (auto& attribute : attributes)
+  {
+    m_names.PushBack(ShaderUniformName(attribute.name));
+  }
+}
+
+static bool isIntegerType(GLenum glType)
+{
+  switch(glType)
+  {
+  case GL_BYTE:
+  case GL_UNSIGNED_BYTE:
+  case GL_SHORT:
+  case GL_UNSIGNED_SHORT:
+  case GL_INT:
+  case GL_UNSIGNED_INT:
+    return true;
+  default:
+    break;
+  }
+
+  return false;
+}
+
+/// \brief Whether the shader input of the given type is an int or uint scalar or vector.
+static bool isIntegerInput(GLenum glType)
+{
+  switch(glType)
+  {
+  case GL_INT:
+  case GL_INT_VEC2:
+  case GL_INT_VEC3:
+  case GL_INT_VEC4:
+  case GL_UNSIGNED_INT:
+  case GL_UNSIGNED_INT_VEC2:
+  case GL_UNSIGNED_INT_VEC3:
+  case GL_UNSIGNED_INT_VEC4:
+    return true;
+  default:
+    break;
+  }
+
+  return false;
+}
+
+ezResult kr::resolveVertexLayout(Borrowed<const ShaderProgram> pShader,
+                                 const VertexLayout& layout,
+                                 ezHybridArray<ResolvedVertexAttribute, 8>& out_attributes)
+{
+  out_attributes.Clear();
+
+  if (pShader == nullptr)
+  {
+    ezLog::Warning("Shader program is nullptr. Aborting.");
+    return EZ_FAILURE;
+  }
+
+  auto result = EZ_SUCCESS;
+
+  for (ezUInt32 i = 0; i < layout.m_attributes.GetCount(); ++i)
+  {
+    auto& attribute = layout.m_attributes[i];
+
+    auto pActive = pShader->findAttribute(layout.m_names[i]);
+    if (pActive == nullptr)
+    {
+      ezLog::Warning("Attribute location of '%s' not found.", attribute.name);
+      result = EZ_FAILURE;
+      continue;
+    }
+
+    auto& resolved = out_attributes.ExpandAndGetRef();
+    resolved.location = static_cast<GLuint>(pActive->glLocation);
+    resolved.glType = attribute.glType;
+    resolved.numComponents = attribute.numComponents;
+    resolved.isNormalized = attribute.isNormalized;
+    resolved.offset = attribute.offset;
+    resolved.binding = 0;
+    resolved.divisor = 0;
+
+    // Otherwise glVertexAttribPointer would convert them to floats.
+    const bool isInteger = isIntegerType(attribute.glType)
+                        && !attribute.isNormalized
+                        && isIntegerInput(pActive->glType);
+    resolved.isInteger = isInteger ? GL_TRUE : GL_FALSE;
+  }
+
+  return result;
+}
+
+ezResult kr::applyVertexLayout(Borrowed<const ShaderProgram> pShader,
+                               const VertexLayout& layout)
+{
+  ezHybridArray<ResolvedVertexAttribute, 8> attributes;
+  auto result = resolveVertexLayout(move(pShader), layout, attributes);
+
+  applyVertexLayout(ezArrayPtr<const ResolvedVertexAttribute>(attributes.GetData(), attributes.GetCount()),
+                    layout.m_stride);
+
+  return result;
+}
+
+void kr::applyVertexLayout(ezArrayPtr<const ResolvedVertexAttribute> attributes,
+                           ezUInt32 stride)
+{
+  for (auto& attribute : attributes)
+  {
+    auto pOffset = reinterpret_cast<const void*>(static_cast<size_t>(attribute.offset));
+    glCheck(glEnableVertexAttribArray(attribute.location));
+
+    if (attribute.isInteger)
+    {
+      glCheck(glVertexAttribIPointer(attribute.location,
+                                     attribute.numComponents,
+                                     attribute.glType,
+                                     stride,
+                                     pOffset));
+    }
+    else
+    {
+      glCheck(glVertexAttribPointer(attribute.location,
+                                    attribute.numComponents,
+                                    attribute.glType,
+                                    attribute.isNormalized,
+                                    stride,
+                                    pOffset));
+    }
+  }
+}
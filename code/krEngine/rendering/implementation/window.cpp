@@ -2,6 +2,7 @@
 #include <krEngine/ownership.h>
 
 #include "windowImpl.h"
+#include "shaderImpl.h"
 
 static ezResult destroyOpenGLContext(kr::WindowImpl& window);
 static ezResult createOpenGLContext(kr::WindowImpl& window);
@@ -0,0 +1,76 @@
+#pragma once
+#include <krEngine/ownership.h>
+#include <krEngine/rendering/vertexBuffer.h>
+
+namespace kr
+{
+  enum class IndexType
+  {
+    UInt16 = GL_UNSIGNED_SHORT, ///< Enough for 65536 vertices, at half the size.
+    UInt32 = GL_UNSIGNED_INT,
+  };
+
+  class IndexBuffer
+  {
+  public: // *** Static API
+    KR_ENGINE_API static Owned<IndexBuffer> create(BufferUsage usage, IndexType type);
+
+    /// \brief A shared index buffer that draws at least \a numQuads quads as triangles.
+    ///
+    /// Each quad uses 4 vertices in triangle strip order, i.e. top left, bottom left,
+    /// top right and bottom right, and is drawn as the triangles (0, 1, 2) and (2, 1, 3).
+    /// Quad \c i uses the vertices from <tt>4 * i</tt> to <tt>4 * i + 3</tt>.
+    ///
+    /// The buffer grows as needed, but keeps its GL handle, so vertex array objects
+    /// referring to it stay valid. Check getType() after every call though,
+    /// as it switches to 32 bit indices for more than 16384 quads.
+    /// \note Must be called on the thread that owns the GL context.
+    KR_ENGINE_API static Borrowed<IndexBuffer> getQuads(ezUInt32 numQuads);
+
+  public: // *** Data
+    BufferUsage m_usage; ///< Set on construction.
+    IndexType m_type;    ///< Set on construction or by the last upload.
+
+    GLuint m_glHandle = 0;
+
+    /// \brief Number of indices in the buffer, set by uploadData().
+    ezUInt32 m_count = 0;
+
+  public: // *** Accessors/Mutators
+    BufferUsage getUsage() const { return m_usage; }
+    IndexType getType() const { return m_type; }
+    GLenum getGlType() const { return static_cast<GLenum>(m_type); }
+    ezUInt32 getCount() const { return m_count; }
+    GLuint getGlHandle() const { return m_glHandle; }
+
+    /// \brief Size of a single index in bytes.
+    ezUInt32 getIndexSize() const { return m_type == IndexType::UInt16 ? 2 : 4; }
+
+  public: // *** Construction
+    KR_ENGINE_API ~IndexBuffer();
+
+  private: // *** Private Construction
+    /// Create these using a static factory function of this class.
+    IndexBuffer() = default;
+
+    IndexBuffer(const IndexBuffer&) = delete;
+    void operator =(const IndexBuffer&) = delete;
+  };
+
+  /// \brief Replaces the content of the index buffer with the given 16 bit \a indices.
+  /// \note Changes the type of the buffer to IndexType::UInt16.
+  KR_ENGINE_API ezResult uploadData(Borrowed<IndexBuffer> pIndexBuffer,
+                                    ezArrayPtr<const ezUInt16> indices);
+
+  /// \brief Replaces the content of the index buffer with the given 32 bit \a indices.
+  /// \note Changes the type of the buffer to IndexType::UInt32.
+  KR_ENGINE_API ezResult uploadData(Borrowed<IndexBuffer> pIndexBuffer,
+                                    ezArrayPtr<const ezUInt32> indices);
+
+  /// \brief Uses \a pIndexBuffer for all layouts of \a pVertBuffer, including those set up later.
+  ///
+  /// Drawing with glDrawElements then fetches the vertices through the index buffer.
+  /// \param pIndexBuffer May be nullptr to go back to non-indexed drawing.
+  KR_ENGINE_API ezResult attachIndexBuffer(Borrowed<VertexBuffer> pVertBuffer,
+                                           Borrowed<const IndexBuffer> pIndexBuffer);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <krEngine/rendering/window.h>
+#include <krEngine/rendering/rendererStats.h>
 
 namespace kr
 {
@@ -19,5 +20,32 @@ namespace kr
 
     KR_ENGINE_API void extract();
     KR_ENGINE_API void update(ezTime dt, Borrowed<Window> pTarget);
+
+    // Statistics
+    // ==========
+
+    /// \brief Statistics of the frame that was last finished by update().
+    KR_ENGINE_API RendererFrameStats getLastFrameStats();
+
+    /// \brief Number of frames in the statistics history.
+    KR_ENGINE_API ezUInt32 getStatsHistoryCount();
+
+    /// \brief Statistics of a past frame.
+    /// \param age 0 is the last frame, 1 the one before it, and so on.
+    ///            Must be less than getStatsHistoryCount().
+    KR_ENGINE_API RendererFrameStats getStatsHistory(ezUInt32 age);
+
+    /// \brief How many frames are kept in the statistics history. Defaults to 120.
+    /// \note Clears the history.
+    KR_ENGINE_API void setStatsHistorySize(ezUInt32 numFrames);
+    KR_ENGINE_API ezUInt32 getStatsHistorySize();
+
+    KR_ENGINE_API void clearStatsHistory();
+
+    /// \brief Summarizes \a stat over all frames in the statistics history.
+    KR_ENGINE_API RendererStatSummary getStatSummary(RendererStat stat);
+
+    /// \brief Logs the last frame and a summary of each stat over the history.
+    KR_ENGINE_API void logStats();
   };
 }
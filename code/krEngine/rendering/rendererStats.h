@@ -0,0 +1,115 @@
+#pragma once
+
+namespace kr
+{
+  /// \brief What the renderer did during a single frame.
+  ///
+  /// A frame ends with Renderer::update(). Work done outside of the renderer,
+  /// such as uploading a vertex buffer while setting up a scene, counts towards the next frame.
+  struct RendererFrameStats
+  {
+    // Draws
+    // =====
+    ezUInt32 numDrawCalls = 0;
+
+    /// \brief Triangles, lines or points, depending on what was drawn.
+    ezUInt64 numPrimitives = 0;
+
+    // State Changes
+    // =============
+    // Every bind counts, including restoring the previous binding.
+    ezUInt32 numShaderChanges = 0;
+    ezUInt32 numTextureChanges = 0;
+    ezUInt32 numSamplerChanges = 0;
+    ezUInt32 numVertexArrayChanges = 0;
+
+    ezUInt32 getNumStateChanges() const
+    {
+      return numShaderChanges + numTextureChanges + numSamplerChanges + numVertexArrayChanges;
+    }
+
+    // Uploads
+    // =======
+    ezUInt32 numUniformUploads = 0;
+
+    /// \brief Bytes written to vertex, index, indirect and staging buffers.
+    ezUInt64 bufferBytesUploaded = 0;
+
+    /// \brief Bytes of pixel data uploaded to textures.
+    ezUInt64 textureBytesUploaded = 0;
+
+    // Extraction
+    // ==========
+    ezUInt32 numExtractedItems = 0;
+    ezUInt32 numExtractedSprites = 0;
+
+    /// \brief Bytes of the extraction buffer used by the extracted items.
+    ezUInt64 extractionByteCount = 0;
+
+    // CPU Time per Phase
+    // ==================
+    /// \brief Spent in Renderer::extract(), including all extraction listeners.
+    ezTime extractTime;
+
+    /// \brief Spent processing texture loads, sprite updates and shader reloads.
+    ezTime updateTime;
+
+    /// \brief Spent gathering and sorting the extracted items.
+    ezTime sortTime;
+
+    /// \brief Spent binding state, uploading uniforms and issuing draw calls.
+    ezTime drawTime;
+
+    ezTime presentTime;
+  };
+
+  /// \brief A single value of RendererFrameStats, for queries over several frames.
+  enum class RendererStat
+  {
+    DrawCalls,
+    Primitives,
+    StateChanges,
+    ShaderChanges,
+    TextureChanges,
+    SamplerChanges,
+    VertexArrayChanges,
+    UniformUploads,
+    BufferBytesUploaded,
+    TextureBytesUploaded,
+    ExtractedItems,
+    ExtractedSprites,
+    ExtractionByteCount,
+
+    // Times are in milliseconds.
+    ExtractTime,
+    UpdateTime,
+    SortTime,
+    DrawTime,
+    PresentTime,
+
+    Count
+  };
+
+  /// \brief Extracts \a stat from \a stats. Times are in milliseconds.
+  KR_ENGINE_API double getValue(const RendererFrameStats& stats, RendererStat stat);
+
+  /// \brief A readable name of \a stat, e.g. "Draw Calls".
+  KR_ENGINE_API const char* getName(RendererStat stat);
+
+  /// \brief A single value of RendererFrameStats over several frames.
+  struct RendererStatSummary
+  {
+    ezUInt32 numFrames = 0;
+
+    double min = 0.0;
+    double average = 0.0;
+    double max = 0.0;
+
+    /// \brief 99% of the frames have a value that is not larger than this.
+    double percentile99 = 0.0;
+  };
+
+  /// \brief Summarizes \a stat over all \a frames.
+  KR_ENGINE_API RendererStatSummary summarize(ezArrayPtr<const RendererFrameStats> frames,
+                                              RendererStat stat);
+}
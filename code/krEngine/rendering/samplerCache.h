@@ -0,0 +1,21 @@
+#pragma once
+#include <krEngine/rendering/texture.h>
+
+namespace kr
+{
+  /// \brief Hands out shared, immutable samplers, so there is only one GL sampler per state.
+  ///
+  /// Sprites using the same sampler object can be drawn without switching samplers,
+  /// so prefer this over Sampler::create for everything that doesn't change its sampler.
+  /// All shared samplers live until the engine shuts down.
+  namespace SamplerCache
+  {
+    /// \brief Returns the shared sampler with the given state. Creates it on first use.
+    /// \note States that are equal after normalized() share a sampler.
+    /// \note Requires a current GL context.
+    KR_ENGINE_API Borrowed<const Sampler> get(const SamplerDesc& desc = SamplerDesc());
+
+    /// \brief Number of distinct samplers in the cache.
+    KR_ENGINE_API ezUInt32 getCount();
+  }
+}
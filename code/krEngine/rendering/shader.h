@@ -1,6 +1,9 @@
 #pragma once
 #include <krEngine/ownership.h>
 #include <krEngine/rendering/texture.h>
+#include <krEngine/rendering/shaderPreprocessor.h>
+
+#include <Foundation/Containers/HashTable.h>
 
 namespace kr
 {
@@ -13,7 +16,13 @@ namespace kr
 
   public: // *** Static API
     /// \brief Loads and compiles a vertex shader from the source code located in \a filename.
-    KR_ENGINE_API static Owned<VertexShader> loadAndCompile(ezStringView filename);
+    /// \see preprocessShader
+    KR_ENGINE_API static Owned<VertexShader> loadAndCompile(ezStringView filename,
+                                                            const ShaderDefines& defines = ShaderDefines());
+
+    /// \brief Compiles a vertex shader from the given \a source code.
+    /// \param resourceId Used to identify the shader in log messages.
+    KR_ENGINE_API static Owned<VertexShader> compile(ezStringView source, ezStringView resourceId);
 
   public: // *** Construction
     KR_ENGINE_API ~VertexShader();
@@ -22,7 +31,7 @@ namespace kr
     ezUInt32 getGlHandle() const { return m_glHandle; }
 
   private: // *** Private Construction
-    /// \brief Can only be constructed by loadAndCompile.
+    /// \brief Can only be constructed by loadAndCompile or compile.
     VertexShader() = default;
     VertexShader(const VertexShader&) = delete;
     void operator =(const VertexShader&) = delete;
@@ -37,8 +46,14 @@ namespace kr
     ezString128 m_resourceId;
 
   public: // *** Static API
-    /// \brief Loads and compiles a vertex shader from the source code located in \a filename.
-    KR_ENGINE_API static Owned<FragmentShader> loadAndCompile(ezStringView filename);
+    /// \brief Loads and compiles a fragment shader from the source code located in \a filename.
+    /// \see preprocessShader
+    KR_ENGINE_API static Owned<FragmentShader> loadAndCompile(ezStringView filename,
+                                                              const ShaderDefines& defines = ShaderDefines());
+
+    /// \brief Compiles a fragment shader from the given \a source code.
+    /// \param resourceId Used to identify the shader in log messages.
+    KR_ENGINE_API static Owned<FragmentShader> compile(ezStringView source, ezStringView resourceId);
 
   public: // *** Construction
     KR_ENGINE_API ~FragmentShader();
@@ -47,53 +62,248 @@ namespace kr
     ezUInt32 getGlHandle() const { return m_glHandle; }
 
   private: // *** Private Construction
-    /// \brief Can only be constructed by loadAndCompile.
+    /// \brief Can only be constructed by loadAndCompile or compile.
     FragmentShader() = default;
     FragmentShader(const FragmentShader&) = delete;
     void operator =(const FragmentShader&) = delete;
   };
 
 
+  /// \brief 32 bit FNV-1a hash of the given name. Used to look up uniforms.
+  inline ezUInt32 hashShaderName(ezStringView name)
+  {
+    ezUInt32 hash = 2166136261u;
+    for (auto p = name.GetData(); p < name.GetEndPosition(); ++p)
+    {
+      hash = (hash ^ static_cast<ezUInt8>(*p)) * 16777619u;
+    }
+    return hash;
+  }
+
+  /// \brief The name of a uniform, uniform block or vertex attribute together with its hash.
+  ///
+  /// Create these once, e.g. as static constants, so looking up uniforms
+  /// does not have to hash the name every time.
+  struct ShaderUniformName
+  {
+    const char* name;
+    ezUInt32 hash;
+
+    ShaderUniformName(const char* name) : name(name), hash(hashShaderName(name)) {}
+  };
+
+
   class ShaderProgram
   {
   public: // *** Static API
     /// \brief Links the given vertex and fragment shaders \a pVS and \a pFS to a program.
     KR_ENGINE_API static Owned<ShaderProgram> link(Borrowed<VertexShader> vs,
                                                    Borrowed<FragmentShader> fs);
-    static Owned<ShaderProgram> loadAndLink(ezStringView vsFileName,
-                                                    ezStringView fsFileName)
+
+    /// \brief Loads, compiles and links the program from the given source files.
+    ///
+    /// Both stages are preprocessed with the given \a defines.
+    /// Prefer ShaderVariantCache::get() to share programs with the same files and defines.
+    ///
+    /// If a program binary cache directory is set, the linked program is stored there
+    /// and loaded from there the next time, without compiling anything.
+    /// \see setProgramBinaryCacheDirectory
+    KR_ENGINE_API static Owned<ShaderProgram> loadAndLink(ezStringView vsFileName,
+                                                          ezStringView fsFileName,
+                                                          const ShaderDefines& defines = ShaderDefines());
+
+    /// \brief Like loadAndLink, but with sources that were already preprocessed.
+    ///
+    /// \a sourceFiles are all files read to preprocess \a vsCode and \a fsCode.
+    /// \note Used by the ShaderVariantCache, which preprocesses the sources to look them up anyway.
+    KR_ENGINE_API static Owned<ShaderProgram> linkPreprocessed(ezStringView vsFileName,
+                                                               ezStringView fsFileName,
+                                                               const ShaderDefines& defines,
+                                                               const ezStringBuilder& vsCode,
+                                                               const ezStringBuilder& fsCode,
+                                                               const ezHybridArray<ezString, 4>& sourceFiles);
+
+  public: // *** Types
+    /// \brief An active uniform, as reported by the driver after linking.
+    struct Uniform
     {
-      auto vs = VertexShader::loadAndCompile(vsFileName);
-      auto fs = FragmentShader::loadAndCompile(fsFileName);
-      return link(vs, fs);
-    }
+      /// \brief Arrays are listed without the "[0]" suffix.
+      ezString name;
+      ezUInt32 nameHash = 0;
+
+      /// \brief E.g. GL_FLOAT_VEC4 or GL_SAMPLER_2D.
+      GLenum glType = 0;
+
+      /// \brief Number of array elements, 1 for non-arrays.
+      GLint arraySize = 1;
+
+      /// \brief -1 if the uniform is no longer active after a reload.
+      GLint glLocation = -1;
+    };
+
+    struct UniformBlock
+    {
+      ezString name;
+      ezUInt32 nameHash = 0;
+      GLuint glIndex = GL_INVALID_INDEX;
+      GLint byteCount = 0;
+    };
+
+    /// \brief An active vertex attribute, as reported by the driver after linking.
+    struct Attribute
+    {
+      ezString name;
+      ezUInt32 nameHash = 0;
+
+      /// \brief E.g. GL_FLOAT_VEC2.
+      GLenum glType = 0;
+      GLint arraySize = 1;
+      GLint glLocation = -1;
+    };
 
   public: // *** Data
+
     /// \note You should not fiddle around with this directly.
     ezUInt32 m_glHandle = 0;
 
+    /// \brief Source files of the program. Empty unless created by loadAndLink.
+    ezString128 m_vsResourceId;
+    ezString128 m_fsResourceId;
+    ShaderDefines m_defines;
+
+    /// \brief All files read to build the program, including the included ones.
+    ezHybridArray<ezString, 4> m_sourceFiles;
+
+    /// \brief Reflection of all active uniforms, built once after linking.
+    ///
+    /// Reloading updates the entries in place, so indices stay valid.
+    ezHybridArray<Uniform, 8> m_uniforms;
+    ezHybridArray<UniformBlock, 2> m_uniformBlocks;
+
+    /// \brief Maps name hashes to indices into m_uniforms.
+    /// \note Only holds the first uniform of each hash. Colliding names are found by a linear search.
+    ezHashTable<ezUInt32, ezUInt32> m_uniformIndices;
+
+    /// \brief Reflection of all active vertex attributes. Rebuilt after every reload.
+    ezHybridArray<Attribute, 4> m_attributes;
+
   public: // *** Construction
     KR_ENGINE_API ~ShaderProgram();
 
+  public: // *** Reloading
+    /// \brief Compiles and links the source files again and replaces the program with the result.
+    ///
+    /// Uniforms obtained through shaderUniformOf stay valid, but their values are lost,
+    /// since the new program starts out with the defaults of its sources.
+    /// Upload them again afterwards. The renderer does that for every draw anyway.
+    /// \return EZ_FAILURE if the program was not created by loadAndLink,
+    ///         or the new sources do not compile or link. The old program is kept then.
+    /// \note Must not be called while the program is bound.
+    KR_ENGINE_API ezResult reload();
+
+  public: // *** Reflection
+    /// \brief Index of the active uniform with the given \a name in m_uniforms.
+    /// \return ezInvalidIndex if there is no such uniform.
+    KR_ENGINE_API ezUInt32 findUniform(const ShaderUniformName& name) const;
+
+    /// \return nullptr if there is no active uniform block with the given \a name.
+    KR_ENGINE_API const UniformBlock* findUniformBlock(const ShaderUniformName& name) const;
+
+    /// \return nullptr if there is no active vertex attribute with the given \a name.
+    KR_ENGINE_API const Attribute* findAttribute(const ShaderUniformName& name) const;
+
   public: // *** Accessors/Mutators
     ezUInt32 getGlHandle() const { return m_glHandle; }
 
+    /// \brief Whether this program was loaded from files and can be reloaded.
+    bool isReloadable() const { return !m_vsResourceId.IsEmpty() && !m_fsResourceId.IsEmpty(); }
+
   private: // *** Private Construction
-    /// \brief Can only be constructed by link.
+    friend class ShaderBatch;
+
+    /// \brief Can only be constructed by link, loadAndLink or a ShaderBatch.
     ShaderProgram() = default;
 
+    /// \brief Takes ownership of the linked GL program \a hProgram and reflects its uniforms.
+    ///
+    /// Programs with source files are watched for hot reloading.
+    static Owned<ShaderProgram> adopt(GLuint hProgram,
+                                      ezStringView vsFileName,
+                                      ezStringView fsFileName,
+                                      const ShaderDefines& defines,
+                                      const ezHybridArray<ezString, 4>& sourceFiles);
+
     EZ_DISALLOW_COPY_AND_ASSIGN(ShaderProgram);
   };
 
 
+  // Program Binary Cache
+  // ====================
+
+  struct ProgramBinaryCacheStats
+  {
+    /// \brief Number of programs that were loaded from a cached binary.
+    ezUInt32 numHits = 0;
+
+    /// \brief Number of programs without a cached binary.
+    ezUInt32 numMisses = 0;
+
+    /// \brief Number of cached binaries the driver refused to load, e.g. after a driver update.
+    ezUInt32 numRejected = 0;
+
+    /// \brief Number of binaries written to the cache.
+    ezUInt32 numStored = 0;
+  };
+
+  /// \brief Sets the ezFileSystem directory linked programs are cached in, e.g. "<output>shaderCache/".
+  ///
+  /// The binaries are keyed by the shader sources and the driver,
+  /// so stale binaries are never used. They are only ever valid on the machine that created them.
+  /// Pass an empty string to disable the cache, which is the default.
+  /// \note The cache is also disabled if the driver does not support any program binary format.
+  KR_ENGINE_API void setProgramBinaryCacheDirectory(ezStringView directory);
+  KR_ENGINE_API ezStringView getProgramBinaryCacheDirectory();
+
+  KR_ENGINE_API ProgramBinaryCacheStats getProgramBinaryCacheStats();
+  KR_ENGINE_API void resetProgramBinaryCacheStats();
+
+
+  // Hot Reloading
+  // =============
+
+  /// \brief Watches the source files of all programs created by loadAndLink on a background thread.
+  ///
+  /// Programs whose files changed are reloaded by reloadChangedShaders.
+  /// Disabled by default.
+  /// \note Only programs loaded while hot reloading is enabled are watched,
+  ///       so enable it before loading any shaders.
+  KR_ENGINE_API void setShaderHotReloadEnabled(bool enabled);
+  KR_ENGINE_API bool isShaderHotReloadEnabled();
+
+  /// \brief Reloads all programs whose source files changed since the last call.
+  ///
+  /// The renderer calls this at the beginning of each frame,
+  /// so programs are never swapped in the middle of a frame.
+  /// Uniform values of reloaded programs are lost. See ShaderProgram::reload().
+  /// \return The number of programs that were reloaded successfully.
+  KR_ENGINE_API ezUInt32 reloadChangedShaders();
+
+
   struct ShaderUniform
   {
-    GLuint glLocation = -1;
+    /// \brief Index into ShaderProgram::m_uniforms.
+    ezUInt32 index = ezInvalidIndex;
     Borrowed<ShaderProgram> pShader;
+
+    bool isValid() const { return pShader != nullptr && index != ezInvalidIndex; }
+
+    /// \brief The current location. Changes when the program is reloaded.
+    GLint getGlLocation() const { return isValid() ? pShader->m_uniforms[index].glLocation : -1; }
   };
 
+  /// \brief Looks up the uniform in the reflection table of \a pShader. Never queries the driver.
   KR_ENGINE_API ShaderUniform shaderUniformOf(Borrowed<ShaderProgram> pShader,
-                                              ezStringView uniformName);
+                                              const ShaderUniformName& uniformName);
 
   /// \brief Uploads an \a ezColor value.
   KR_ENGINE_API ezResult uploadData(const ShaderUniform& uniform,
@@ -112,6 +322,9 @@ namespace kr
   KR_ENGINE_API ezResult uploadData(const ShaderUniform& uniform,
                                     const ezAngle& matrix);
 
+  KR_ENGINE_API ezResult uploadData(const ShaderUniform& uniform,
+                                    float value);
+
   KR_ENGINE_API ezResult bind(Borrowed<const ShaderProgram> pShader);
 
   /// \see KR_RAII_BIND_SHADER
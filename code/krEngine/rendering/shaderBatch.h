@@ -0,0 +1,94 @@
+#pragma once
+#include <krEngine/rendering/shader.h>
+
+namespace kr
+{
+  /// \brief Compiles and links many shader programs at once, without waiting for each of them.
+  ///
+  /// Submitting hands all work to the driver in one go. Drivers with
+  /// KHR_parallel_shader_compile (or the ARB version) compile on their own threads,
+  /// so the application can keep loading other things and poll isReady() meanwhile.
+  /// Other drivers compile while the status is queried, so finish() does the work then.
+  ///
+  /// \code
+  ///   ShaderBatch batch;
+  ///   auto spriteIndex = batch.add("<shader>sprite.vs", "<shader>sprite.fs");
+  ///   batch.submit();
+  ///   // ... load textures ...
+  ///   auto pSpriteShader = batch.take(spriteIndex);
+  /// \endcode
+  /// \note All functions require the GL context that the programs are used with.
+  class ShaderBatch
+  {
+  public: // *** Construction
+    KR_ENGINE_API ShaderBatch();
+
+    /// \brief Deletes all programs that were not taken.
+    KR_ENGINE_API ~ShaderBatch();
+
+  public: // *** Building
+    /// \brief Reads and preprocesses the given program. Its compilation starts with submit().
+    /// \return The index to pass to take().
+    KR_ENGINE_API ezUInt32 add(ezStringView vsFileName,
+                               ezStringView fsFileName,
+                               const ShaderDefines& defines = ShaderDefines());
+
+    /// \brief Starts compiling and linking all added programs. Does not wait for the driver.
+    ///
+    /// Programs found in the program binary cache skip compiling.
+    KR_ENGINE_API void submit();
+
+    /// \brief Whether the driver finished all submitted programs. Never blocks.
+    ///
+    /// Without parallel compile support, the driver does not report progress,
+    /// so this is true right after submitting.
+    KR_ENGINE_API bool isReady();
+
+    /// \brief Waits for all submitted programs and checks the results.
+    /// \return The number of programs that failed to compile or link.
+    KR_ENGINE_API ezUInt32 finish();
+
+    /// \brief Hands out the program with the given \a index. Finishes the batch first, if necessary.
+    /// \return nullptr if the program failed, or was already taken.
+    KR_ENGINE_API Owned<ShaderProgram> take(ezUInt32 index);
+
+  public: // *** Accessors
+    ezUInt32 getCount() const { return m_entries.GetCount(); }
+
+    /// \brief Whether the driver compiles on its own threads.
+    bool isParallel() const { return m_isParallel; }
+
+  private: // *** Types
+    struct Entry
+    {
+      ezString128 vsFileName;
+      ezString128 fsFileName;
+      ShaderDefines defines;
+      ezHybridArray<ezString, 4> sourceFiles;
+      ezStringBuilder vsCode;
+      ezStringBuilder fsCode;
+
+      GLuint hVS = 0;
+      GLuint hFS = 0;
+      GLuint hProgram = 0;
+
+      /// \brief Loaded from the program binary cache, so there is nothing to compile.
+      bool isFromBinary = false;
+
+      /// \brief Failed reading, compiling or linking.
+      bool hasFailed = false;
+
+      Owned<ShaderProgram> pProgram;
+    };
+
+  private: // *** Data
+    ezDynamicArray<Entry*> m_entries;
+    bool m_isParallel = false;
+    bool m_isSubmitted = false;
+    bool m_isFinished = false;
+
+  private: // *** Private Construction
+    ShaderBatch(const ShaderBatch&) = delete;
+    void operator =(const ShaderBatch&) = delete;
+  };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+namespace kr
+{
+  /// \brief A set of preprocessor definitions that selects a shader variant.
+  ///
+  /// The definitions are kept sorted by name, so the order in which they are set does not matter.
+  class ShaderDefines
+  {
+  public: // *** Types
+    struct Define
+    {
+      ezString name;
+      ezString value;
+    };
+
+  public: // *** Mutators
+    /// \brief Defines \a name as \a value. Replaces the value if \a name is already defined.
+    KR_ENGINE_API ShaderDefines& set(ezStringView name, ezStringView value = "1");
+
+  public: // *** Accessors
+    ezUInt32 getCount() const { return m_defines.GetCount(); }
+    const Define& operator[](ezUInt32 index) const { return m_defines[index]; }
+
+    /// \brief Identifies the set. Equal sets have the same hash.
+    KR_ENGINE_API ezUInt32 getHash() const;
+
+    KR_ENGINE_API bool operator ==(const ShaderDefines& rhs) const;
+    bool operator !=(const ShaderDefines& rhs) const { return !(*this == rhs); }
+
+    /// \brief Appends a "#define name value" line for each definition.
+    KR_ENGINE_API void appendTo(ezStringBuilder& out_source) const;
+
+  private: // *** Data
+    ezHybridArray<Define, 4> m_defines;
+  };
+
+  /// \brief Reads the GLSL file \a fileName and resolves its #include directives.
+  ///
+  /// Included paths are relative to the including file, unless they start with a
+  /// data directory root such as "<shader>". A file containing "#pragma once" is
+  /// only included once. The \a defines are inserted right after the #version line.
+  ///
+  /// Includes in conditional branches that are never compiled are skipped.
+  /// Only #ifdef, #ifndef, #else, #endif and #if or #elif with "0", "1" or "defined(NAME)",
+  /// optionally negated, are evaluated, taking \a defines and #define lines into account.
+  /// Includes in branches with any other condition are always expanded.
+  /// All conditional lines are kept, so the compiler still sees them.
+  ///
+  /// The output contains #line directives, where the source string number is
+  /// the index of the file in \a out_pFiles. The main file has index 0.
+  /// \param out_pFiles Optional. Receives all files that were read.
+  /// \return EZ_FAILURE if a file could not be read or the includes are circular.
+  KR_ENGINE_API ezResult preprocessShader(ezStringView fileName,
+                                          const ShaderDefines& defines,
+                                          ezStringBuilder& out_source,
+                                          ezDynamicArray<ezString>* out_pFiles = nullptr);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <krEngine/rendering/shader.h>
+
+namespace kr
+{
+  struct ShaderVariantCacheStats
+  {
+    /// \brief Number of calls to ShaderVariantCache::get().
+    ezUInt32 numRequests = 0;
+
+    /// \brief Requests for files and defines that were requested before.
+    ezUInt32 numNameHits = 0;
+
+    /// \brief Requests for new files or defines that preprocess to the sources of a cached program.
+    ezUInt32 numSourceHits = 0;
+
+    /// \brief Number of programs that had to be built.
+    ezUInt32 numBuilds = 0;
+
+    ezUInt32 getNumBuildsSaved() const { return numNameHits + numSourceHits; }
+  };
+
+  /// \brief Hands out shared shader programs, so each variant is only compiled once.
+  ///
+  /// A variant is identified by its source files and its set of defines.
+  /// Different variants whose preprocessed sources are identical share one program as well,
+  /// so batching by program identity works for them.
+  /// All variants live until the engine shuts down.
+  namespace ShaderVariantCache
+  {
+    /// \brief Returns the shared program built from the given files and \a defines.
+    ///        Loads and links it on first use.
+    /// \return nullptr if the program does not compile or link. Failures are not cached,
+    ///         so fixed sources are picked up by the next call.
+    /// \note Requires a current GL context.
+    /// \note A program shared by several variants is reloaded from the files of the variant
+    ///       it was built for. Once the sources of another variant no longer match,
+    ///       the next call for that variant builds a program of its own.
+    ///       Programs that were already handed out for it keep the shared one.
+    KR_ENGINE_API Borrowed<ShaderProgram> get(ezStringView vsFileName,
+                                              ezStringView fsFileName,
+                                              const ShaderDefines& defines = ShaderDefines());
+
+    /// \brief Number of distinct programs in the cache.
+    KR_ENGINE_API ezUInt32 getCount();
+
+    KR_ENGINE_API ShaderVariantCacheStats getStats();
+    KR_ENGINE_API void resetStats();
+
+    /// \brief Logs the stats, including the number of builds that were saved.
+    KR_ENGINE_API void logStats();
+  }
+}
@@ -6,15 +6,20 @@
 
 #include <Foundation/Reflection/Reflection.h>
 
-/// \note Ez's reflection requires the type to live in the top-level, not in any namespace.
 struct krSpriteVertex
 {
   // *** Per-Vertex Data
   ezVec2 pos = ezVec2::ZeroVector();
-  ezVec2 texCoords = ezVec2::ZeroVector();
+
+  /// \brief Normalized to 16 bits, which is plenty for coordinates within the texture.
+  kr::UNorm16x2 texCoords;
 };
 
-EZ_DECLARE_REFLECTABLE_TYPE(EZ_NO_LINKAGE, krSpriteVertex);
+KR_BEGIN_VERTEX_LAYOUT(krSpriteVertex)
+  // We use the names used in the shader here.
+  KR_VERTEX_ATTRIBUTE("vs_position",  pos),
+  KR_VERTEX_ATTRIBUTE("vs_texCoords", texCoords)
+KR_END_VERTEX_LAYOUT
 
 namespace kr
 {
@@ -25,45 +30,80 @@ namespace kr
                    Cutout,
                    LocalBounds);
 
+  /// \brief A textured quad.
+  ///
+  /// Mutating a sprite does not require a GL context. Changed sprites are queued
+  /// and their GL resources are updated by the renderer at the next frame boundary.
+  /// The texture, sampler, shader, bounds and cutout are guarded by the update queue,
+  /// so they may be set from any thread while the renderer processes the queue.
   class KR_ENGINE_API Sprite
   {
   public: // *** Util
+    /// \brief The default sprite shader, shared by all callers.
+    ///
+    /// Sprites are only batched if they use the same program, so prefer this over createDefaultShader().
+    /// \see ShaderVariantCache
+    static Borrowed<ShaderProgram> getDefaultShader();
+
+    /// \brief The shared shader for sprites using a texture array (see Texture::loadArray()).
+    ///
+    /// All sprites sharing such a shader, texture array and sampler are drawn in a single draw call.
+    static Borrowed<ShaderProgram> getDefaultArrayShader();
+
+    /// \brief The default sprite shader reading the per-sprite data per instance instead of from uniforms.
+    ///
+    /// The renderer draws runs of sprites using the default shader with this one,
+    /// so each run needs a single multi-draw call per vertex buffer page.
+    static Borrowed<ShaderProgram> getDefaultMultiDrawShader();
+
+    /// \brief Builds a new, unshared instance of the default sprite shader.
     static Owned<ShaderProgram> createDefaultShader();
 
+    /// \brief Builds a new, unshared instance of the texture array sprite shader.
+    static Owned<ShaderProgram> createDefaultArrayShader();
+
   public: // *** Construction
     Sprite();
     Sprite(const Sprite& other);
     void operator=(const Sprite& other);
+    ~Sprite();
 
   public: // *** Accessors/Mutators
-    bool needsUpdate() const { return m_needUpdate.GetValue() != 0; }
+    bool needsUpdate() const;
 
     void setColor(ezColor c) { m_color = move(c); }
     ezColor getColor() const { return m_color; }
 
+    /// \brief Translucent sprites are blended and drawn back-to-front after all opaque sprites.
+    ///
+    /// Opaque sprites are drawn front-to-back with depth testing and without blending.
+    /// Sprites are translucent by default.
+    void setTranslucent(bool translucent) { m_isTranslucent = translucent; }
+    bool isTranslucent() const { return m_isTranslucent; }
+
     /// \name Texture
     /// \{
 
     /// \brief Set the current texture.
-    void setTexture(Borrowed<Texture> pTex)
-    {
-      m_pTexture = pTex;
-      m_needUpdate.Add(SpriteComponents::Cutout);
-    }
+    void setTexture(Borrowed<Texture> pTex);
 
     /// \brief Gets the handle to the current texture.
     Borrowed<Texture> getTexture() { return m_pTexture; }
 
     Borrowed<const Texture> getTexture() const { return m_pTexture; }
 
+    /// \brief Selects the layer of a texture array. Ignored for other textures.
+    void setTextureLayer(ezUInt32 layer) { m_textureLayer = layer; }
+    ezUInt32 getTextureLayer() const { return m_textureLayer; }
+
     /// \}
 
     /// \name Sampler
     /// \{
 
-    void setSampler(Borrowed<Sampler> sampler) { this->m_pSampler = move(sampler); }
-
-    Borrowed<Sampler> getSampler() { return this->m_pSampler; }
+    /// \brief Sprites sharing the same sampler object can be drawn together.
+    /// \see SamplerCache::get
+    void setSampler(Borrowed<const Sampler> sampler);
 
     Borrowed<const Sampler> getSampler() const { return this->m_pSampler; }
 
@@ -72,11 +112,7 @@ namespace kr
     /// \name Shader Program
     /// \{
 
-    void setShader(Borrowed<ShaderProgram> shader)
-    {
-      this->m_pShader = move(shader);
-      this->m_needUpdate.Add(SpriteComponents::ShaderUniforms);
-    }
+    void setShader(Borrowed<ShaderProgram> shader);
 
     Borrowed<ShaderProgram> getShader() { return m_pShader; }
 
@@ -88,15 +124,16 @@ namespace kr
     void setLocalBounds(ezRectFloat newLocalBounds);
 
     /// \brief Get the bounds of this sprite.
-    ezRectFloat getLocalBounds() const { return m_localBounds; }
+    ezRectFloat getLocalBounds() const;
 
     void setCutout(ezRectU32 newCutout);
-    ezRectU32 getCutout() const { return this->m_cutout; }
+    ezRectU32 getCutout() const;
 
     ShaderUniform getTextureUniform() const { return m_uTexture; }
     ShaderUniform getColorUniform() const { return m_uColor; }
     ShaderUniform getOriginUniform() const { return m_uOrigin; }
     ShaderUniform getRotationUniform() const { return m_uRotation; }
+    ShaderUniform getDepthUniform() const { return m_uDepth; }
     ShaderUniform getViewMatrixUniform() const { return m_uViewMatrix; }
     ShaderUniform getProjectionMatrixUniform() const { return m_uProjectionMatrix; }
 
@@ -107,8 +144,33 @@ namespace kr
 
   public: // *** Friends
     friend KR_ENGINE_API void update(Sprite& sprite);
+    friend void processSpriteUpdateQueue();
+
+  private: // *** Internal
+    /// \brief Flags \a component as outdated and queues this sprite for an update.
+    /// \pre The update queue is locked.
+    void markForUpdate(SpriteComponents::Enum component);
+
+    /// \brief Queues this sprite for an update at the next frame boundary.
+    /// \pre The update queue is locked.
+    void enqueueUpdate();
+
+    enum class UpdateResult
+    {
+      Done,   ///< Nothing to upload, or the sprite cannot be updated until it is changed again.
+      Upload, ///< The vertex data changed and needs to be uploaded.
+      Retry,  ///< Creating the vertex buffer failed. The pending updates are kept.
+    };
+
+    /// \brief Updates everything except the vertex buffer contents.
+    /// \pre The update queue is locked.
+    UpdateResult prepareUpdate();
 
   private: // *** Data
+    /// \brief Whether this sprite is currently in the update queue.
+    /// \note Guarded by the update queue.
+    bool m_isQueued = false;
+
     /// \brief 1's for all components that need updating.
     ezBitflags<SpriteComponents> m_needUpdate;
 
@@ -117,11 +179,14 @@ namespace kr
 
     Owned<VertexBuffer> m_pVertexBuffer;
 
-    Borrowed<Sampler> m_pSampler;
+    Borrowed<const Sampler> m_pSampler;
 
     /// \brief Handle to the texture used by this sprite.
     Borrowed<Texture> m_pTexture;
 
+    /// \brief Layer of the texture array to show.
+    ezUInt32 m_textureLayer = 0;
+
     /// \brief Local bounds of this sprite.
     ezRectFloat m_localBounds = { 0.0f, 0.0f };
 
@@ -130,6 +195,8 @@ namespace kr
 
     ezColor m_color = ezColor::White;
 
+    bool m_isTranslucent = true;
+
     Borrowed<ShaderProgram> m_pShader;
 
     ShaderUniform m_uTexture;
@@ -137,6 +204,7 @@ namespace kr
     ShaderUniform m_uTransform;
     ShaderUniform m_uOrigin;
     ShaderUniform m_uRotation;
+    ShaderUniform m_uDepth;
     ShaderUniform m_uViewMatrix;
     ShaderUniform m_uProjectionMatrix;
   };
@@ -146,21 +214,23 @@ namespace kr
   /// Use this for validation before extracting sprite data.
   KR_ENGINE_API bool canRender(const Sprite& sprite);
 
-  /// \brief Updates the internal state of \a sprite.
+  /// \brief Updates the internal state of \a sprite immediately.
+  ///
+  /// You usually don't need this, as the renderer processes all changed sprites
+  /// at the next frame boundary.
+  /// \note Requires a current GL context.
   KR_ENGINE_API void update(Sprite& sprite);
 
   /// \brief Initializes a sprite.
-  /// \note This is actually just an update call.
+  /// \note The GL resources of the sprite are created at the next frame boundary.
   inline ezResult initialize(Sprite& sprite,
                              Borrowed<Texture> texture,
-                             Borrowed<Sampler> sampler,
+                             Borrowed<const Sampler> sampler,
                              Borrowed<ShaderProgram> shader)
   {
     sprite.setTexture(texture);
     sprite.setSampler(sampler);
     sprite.setShader(shader);
-    update(sprite);
-    bool success = canRender(sprite) && !sprite.needsUpdate();
-    return success ? EZ_FAILURE : EZ_SUCCESS;
+    return canRender(sprite) ? EZ_SUCCESS : EZ_FAILURE;
   }
 }
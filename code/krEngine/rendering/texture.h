@@ -7,15 +7,114 @@ namespace kr
 {
   using TextureName = ezString128;
 
+  class Texture;
+
+  enum class TextureLoadPriority
+  {
+    Low,    ///< Decoded on the file access threads, so it never delays Normal and High loads.
+    Normal,
+    High,
+  };
+
+  enum class TextureLoadState
+  {
+    Loading, ///< Still being decoded or waiting for upload. A placeholder is bound instead.
+    Loaded,
+    Failed,
+  };
+
+  /// \brief How to build the mip chain of images that only contain the base level.
+  /// \note Only applies to uncompressed images. Mip levels stored in the file are always used as they are.
+  enum class TextureMipGeneration
+  {
+    None,   ///< Only upload the levels stored in the file.
+    Gpu,    ///< Use glGenerateMipmap after uploading. Cheapest, but the quality depends on the driver.
+    Box,    ///< 2x2 box filter on the CPU. Runs on the loading thread.
+    Kaiser, ///< Kaiser-windowed sinc filter on the CPU. Sharper than Box, but slower.
+  };
+
+  /// \brief Block compression for uncompressed images, applied on the CPU before uploading.
+  /// \note Only images with four 8 bit channels are compressed. Others are uploaded as they are.
+  enum class TextureCompression
+  {
+    None,
+    BC1, ///< 4 bits per pixel. Drops the alpha channel.
+    BC3, ///< 8 bits per pixel. BC1 color plus interpolated alpha.
+    BC7, ///< 8 bits per pixel. Best quality for color and alpha, but the slowest to encode.
+  };
+
+  enum class TextureCompressionQuality
+  {
+    Fast,   ///< Endpoints from the bounding box of each block.
+    Normal, ///< Endpoints along the principal axis of each block, refined once.
+    High,   ///< Like Normal, but refined repeatedly and with an exhaustive search where it pays off.
+  };
+
+  /// \brief What happens to the decoded image once its pixel data is on the GPU.
+  enum class TextureResidency
+  {
+    Keep,            ///< Texture::getImage() keeps returning the full image.
+    DropAfterUpload, ///< Free the image. Texture::getImage() returns an empty image.
+    MetadataOnly,    ///< Free the pixel data, but keep the header (size, format, levels) in Texture::getImage().
+  };
+
+  struct TextureLoadOptions
+  {
+    /// \brief Determines the order of decoding and uploading of asynchronously loaded textures.
+    TextureLoadPriority priority = TextureLoadPriority::Normal;
+
+    TextureMipGeneration mipGeneration = TextureMipGeneration::None;
+
+    TextureResidency residency = TextureResidency::Keep;
+
+    /// \brief Compressing happens after generating mip levels on the CPU.
+    /// \note TextureMipGeneration::Gpu cannot be used with compression. Box filtering is used instead.
+    TextureCompression compression = TextureCompression::None;
+    TextureCompressionQuality compressionQuality = TextureCompressionQuality::Normal;
+  };
+
+  /// \brief Called on the render thread once an asynchronously loaded texture is ready or failed to load.
+  /// \note May load or release textures, including the one passed in.
+  using TextureLoadedCallback = ezDelegate<void(const Texture& texture, ezResult result)>;
+
   class Texture
   {
   public:
     /// \brief Loads a texture from the filesystem with the given \a filename.
-    KR_ENGINE_API static Owned<Texture> load(ezStringView fileName);
+    ///
+    /// Files with the extension "krtex" are cooked textures (see cookTexture()).
+    /// They are memory mapped and uploaded without decoding.
+    /// \note Decodes and uploads the pixel data right away. Requires a current GL context.
+    /// \see loadAsync
+    KR_ENGINE_API static Owned<Texture> load(ezStringView fileName,
+                                             TextureLoadOptions options = TextureLoadOptions());
+
+    /// \brief Returns a texture right away and loads its data in the background.
+    ///
+    /// The file is decoded on a worker thread. The pixel data is then uploaded
+    /// through a pixel buffer by the renderer, spread across frames.
+    /// Until then, a placeholder is bound instead of this texture.
+    /// \note Does not require a GL context.
+    /// \see setTextureUploadBudget
+    KR_ENGINE_API static Owned<Texture> loadAsync(ezStringView fileName,
+                                                  TextureLoadOptions options = TextureLoadOptions(),
+                                                  TextureLoadedCallback onLoaded = TextureLoadedCallback());
+
+    /// \brief Loads the given files as the layers of a single GL_TEXTURE_2D_ARRAY.
+    ///
+    /// All images must have the same size, format and number of mip levels.
+    /// Sprites using the returned texture select their image via Sprite::setTextureLayer()
+    /// and can be drawn together in a single draw call.
+    /// \note Texture arrays do not keep their images, regardless of the TextureResidency.
+    /// \note Decodes and uploads the pixel data right away. Requires a current GL context.
+    KR_ENGINE_API static Owned<Texture> loadArray(ezArrayPtr<const char* const> fileNames,
+                                                  TextureLoadOptions options = TextureLoadOptions());
 
   public: // *** Accessors/Mutators
 
     /// \brief Get the underlying image data of the texture.
+    /// \note Depending on the TextureResidency this texture was loaded with,
+    ///       this may be empty or lack the pixel data.
     KR_ENGINE_API const ezImage& getImage() const;
 
     /// \brief Gets the name of the texture.
@@ -24,12 +123,45 @@ namespace kr
     /// Else the name will be the given string.
     KR_ENGINE_API const TextureName& getName() const;
 
-    ezUInt32 getWidth() const { return getImage().GetWidth(); }
-    ezUInt32 getHeight() const { return getImage().GetHeight(); }
+    /// \name Metadata
+    /// These are available regardless of the TextureResidency, once the texture is loaded.
+    /// \{
+
+    KR_ENGINE_API ezUInt32 getWidth() const;
+    KR_ENGINE_API ezUInt32 getHeight() const;
+    KR_ENGINE_API ezImageFormat::Enum getFormat() const;
+
+    /// \brief Number of mip levels on the GPU, including generated ones.
+    KR_ENGINE_API ezUInt32 getNumMipLevels() const;
+
+    /// \brief Number of bytes of pixel data that were uploaded.
+    KR_ENGINE_API ezUInt64 getByteCount() const;
+
+    /// \brief Estimated number of bytes of GPU memory, including generated mip levels.
+    /// \note Also valid while the texture is evicted.
+    KR_ENGINE_API ezUInt64 getGpuByteCount() const;
+
+    /// \brief Number of array slices, 1 for textures that are not arrays.
+    KR_ENGINE_API ezUInt32 getNumLayers() const;
+
+    /// \brief Whether this is a texture array created by loadArray().
+    /// \note Stays true while the texture is evicted or reloading.
+    KR_ENGINE_API bool isArray() const;
+
+    /// \}
 
     /// The result of glGenTextures()
+    /// \note While the texture is loading, this is the handle of the placeholder texture.
+    ///       Arrays use a placeholder array with a single layer.
     KR_ENGINE_API ezUInt32 getGlHandle() const;
 
+    KR_ENGINE_API TextureLoadState getLoadState() const;
+    bool isLoaded() const { return getLoadState() == TextureLoadState::Loaded; }
+
+    /// \brief Whether the texture is loaded and was not evicted to meet the texture memory budget.
+    /// \see setTextureMemoryBudget
+    KR_ENGINE_API bool isResident() const;
+
   protected: // *** Construction
     Texture() = default; ///< Default ctor (private).
 
@@ -49,6 +181,48 @@ namespace kr
   KR_ENGINE_API ezResult bind(Borrowed<const Texture> pTexture, TextureSlot slot);
   KR_ENGINE_API ezResult restoreLastTexture2D(TextureSlot slot);
 
+  /// \brief Number of bytes of asynchronously loaded textures that are uploaded per frame.
+  /// \note At least one texture is uploaded each frame, no matter how big it is.
+  KR_ENGINE_API void setTextureUploadBudget(ezUInt32 bytesPerFrame);
+  KR_ENGINE_API ezUInt32 getTextureUploadBudget();
+
+  // Texture Memory
+  // ==============
+
+  struct TextureMemoryStats
+  {
+    /// \brief Estimated GPU memory of all loaded textures, including evicted ones.
+    ezUInt64 totalBytes = 0;
+
+    /// \brief Estimated GPU memory of the textures that are currently on the GPU.
+    ezUInt64 residentBytes = 0;
+
+    /// \brief Memory freed by evicting textures during the frame.
+    ezUInt64 evictedBytes = 0;
+
+    /// \brief Memory of evicted textures that had to be loaded again during the frame.
+    ezUInt64 reloadedBytes = 0;
+
+    ezUInt32 numTextures = 0;
+    ezUInt32 numResident = 0;
+    ezUInt32 numEvicted = 0;
+    ezUInt32 numReloaded = 0;
+  };
+
+  /// \brief Estimated number of bytes of GPU memory all textures together may use.
+  ///
+  /// At each frame boundary, the least recently bound textures are evicted until the budget is met.
+  /// Textures bound in the previous frame are never evicted.
+  /// An evicted texture is loaded again the next time it is bound.
+  /// Unless it kept its image (TextureResidency::Keep), the file is decoded in the background
+  /// like with Texture::loadAsync(), and the placeholder is bound until it is uploaded.
+  /// The default of 0 means there is no budget.
+  KR_ENGINE_API void setTextureMemoryBudget(ezUInt64 byteCount);
+  KR_ENGINE_API ezUInt64 getTextureMemoryBudget();
+
+  /// \brief Texture memory statistics of the last completed frame.
+  KR_ENGINE_API TextureMemoryStats getTextureMemoryStats();
+
   // Texture Sampling
   // ================
 
@@ -70,10 +244,42 @@ namespace kr
     ClampToBorder,
   };
 
+  /// \brief The complete state of a sampler.
+  struct SamplerDesc
+  {
+    TextureFiltering filtering = TextureFiltering::Nearest;
+    TextureWrapping wrapping = TextureWrapping::Repeat;
+
+    /// \brief 1 disables anisotropic filtering.
+    /// \note Clamped to what the GPU supports. Ignored if anisotropic filtering is not available.
+    float maxAnisotropy = 1.0f;
+
+    /// \brief Added to the mip level the GPU selects.
+    float lodBias = 0.0f;
+
+    bool operator ==(const SamplerDesc& other) const
+    {
+      return filtering == other.filtering
+          && wrapping == other.wrapping
+          && maxAnisotropy == other.maxAnisotropy
+          && lodBias == other.lodBias;
+    }
+
+    bool operator !=(const SamplerDesc& other) const { return !(*this == other); }
+  };
+
+  /// \brief The canonical form of \a desc, which is what samplers actually use.
+  ///
+  /// maxAnisotropy is at least 1, -0 becomes 0, and NaNs are replaced by the defaults,
+  /// so equal sampler states always compare and hash equal.
+  KR_ENGINE_API SamplerDesc normalized(SamplerDesc desc);
+
   class Sampler
   {
   public: // *** Static API
-    KR_ENGINE_API static Owned<Sampler> create();
+    /// \brief Creates a sampler only the caller uses.
+    /// \see SamplerCache::get for samplers that are shared.
+    KR_ENGINE_API static Owned<Sampler> create(const SamplerDesc& desc = SamplerDesc());
 
   public: // *** Data
     ezUInt32 m_glHandle;
@@ -81,6 +287,8 @@ namespace kr
   private: // *** Data
     TextureFiltering m_filtering = TextureFiltering::Nearest;
     TextureWrapping m_wrapping = TextureWrapping::Repeat;
+    float m_maxAnisotropy = 1.0f;
+    float m_lodBias = 0.0f;
 
   public: // *** Accessors/Mutators
     KR_ENGINE_API void setFiltering(TextureFiltering filtering);
@@ -89,6 +297,14 @@ namespace kr
     KR_ENGINE_API void setWrapping(TextureWrapping wrapping);
     TextureWrapping getWrapping() const { return m_wrapping; }
 
+    KR_ENGINE_API void setMaxAnisotropy(float maxAnisotropy);
+    float getMaxAnisotropy() const { return m_maxAnisotropy; }
+
+    KR_ENGINE_API void setLodBias(float lodBias);
+    float getLodBias() const { return m_lodBias; }
+
+    KR_ENGINE_API SamplerDesc getDesc() const;
+
     ezUInt32 getGlHandle() const { return m_glHandle; }
 
   public: // *** Construction
@@ -0,0 +1,68 @@
+#pragma once
+#include <krEngine/rendering/texture.h>
+
+namespace kr
+{
+  struct TextureCacheStats
+  {
+    /// \brief Number of requests that were served by an already loaded texture.
+    ezUInt32 numHits = 0;
+
+    /// \brief Number of requests that had to load a texture.
+    ezUInt32 numMisses = 0;
+
+    /// \brief Number of textures that were unloaded to get back within budget.
+    ezUInt32 numEvictions = 0;
+
+    /// \brief Number of textures currently in the cache.
+    ezUInt32 numTextures = 0;
+
+    /// \brief Number of bytes of pixel data of all textures currently in the cache.
+    ezUInt64 byteCount = 0;
+
+    float getHitRate() const
+    {
+      auto numRequests = numHits + numMisses;
+      return numRequests == 0 ? 0.0f : float(numHits) / float(numRequests);
+    }
+  };
+
+  /// \brief Hands out shared textures, so each file is only loaded once.
+  ///
+  /// Textures are identified by their name and load options, so the same file
+  /// referred to by a different name (e.g. different casing) is loaded again,
+  /// and so is the same file requested with different mip generation, residency or compression.
+  /// The load priority is not part of the key.
+  /// A texture is only unloaded once nobody borrows it anymore and the
+  /// cache exceeds its budget.
+  namespace TextureCache
+  {
+    /// \brief Returns the cached texture with the given name, or loads it via Texture::load.
+    /// \return nullptr if the texture could not be loaded.
+    KR_ENGINE_API Borrowed<Texture> load(ezStringView fileName,
+                                         TextureLoadOptions options = TextureLoadOptions());
+
+    /// \brief Returns the cached texture with the given name, or loads it via Texture::loadAsync.
+    /// \note A texture that failed to load is loaded again on the next request,
+    ///       once nobody borrows it anymore.
+    KR_ENGINE_API Borrowed<Texture> loadAsync(ezStringView fileName,
+                                              TextureLoadOptions options = TextureLoadOptions());
+
+    /// \brief Whether a texture with the given name is in the cache, loaded with any options.
+    KR_ENGINE_API bool contains(ezStringView fileName);
+
+    /// \brief Number of bytes of pixel data the cache may hold before unused textures are unloaded.
+    KR_ENGINE_API void setBudget(ezUInt64 byteCount);
+    KR_ENGINE_API ezUInt64 getBudget();
+
+    /// \brief Unloads all textures that are not borrowed by anyone, regardless of the budget.
+    /// \return The number of unloaded textures.
+    KR_ENGINE_API ezUInt32 unloadUnused();
+
+    KR_ENGINE_API TextureCacheStats getStats();
+    KR_ENGINE_API void resetStats();
+
+    /// \brief Logs the hit rate and all textures that were requested more than once.
+    KR_ENGINE_API void logStats();
+  }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <krEngine/rendering/texture.h>
+
+namespace kr
+{
+  /// \brief Compresses all mip levels, faces and array slices of \a image in place.
+  ///
+  /// The blocks are distributed across the worker threads of the ezTaskSystem.
+  /// Only images with four 8 bit channels can be compressed.
+  /// BC1 drops the alpha channel. sRGB images stay sRGB.
+  /// \note Does not touch any GL state, so this can run on any thread.
+  /// \return EZ_FAILURE if the format of \a image is not supported. \a image is left untouched then.
+  KR_ENGINE_API ezResult compressImage(ezImage& image,
+                                       TextureCompression compression,
+                                       TextureCompressionQuality quality = TextureCompressionQuality::Normal);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <krEngine/rendering/texture.h>
+
+namespace kr
+{
+  struct TextureCookOptions
+  {
+    /// \brief How to build the mip chain, if the source image has none.
+    /// \note Cooking happens without a GL context, so TextureMipGeneration::Gpu filters like Box.
+    TextureMipGeneration mipGeneration = TextureMipGeneration::Box;
+
+    /// \brief Block compression of uncompressed source images, applied after generating the mip chain.
+    TextureCompression compression = TextureCompression::None;
+    TextureCompressionQuality compressionQuality = TextureCompressionQuality::High;
+  };
+
+  /// \brief Converts any image ezImage can load into a cooked texture (*.krtex).
+  ///
+  /// Cooked textures contain the complete mip chain in the layout OpenGL expects,
+  /// so Texture::load can memory map them and upload them without decoding.
+  /// Compressed source images stay compressed.
+  /// Cooking is the place for slow, high quality compression, as it only happens once.
+  /// \param targetFile Path of the cooked texture. Should have the extension "krtex".
+  /// \note Does not require a GL context.
+  KR_ENGINE_API ezResult cookTexture(ezStringView sourceFile,
+                                     ezStringView targetFile,
+                                     TextureCookOptions options = TextureCookOptions());
+}
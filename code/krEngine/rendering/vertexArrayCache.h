@@ -0,0 +1,48 @@
+#pragma once
+#include <krEngine/rendering/vertexLayout.h>
+
+namespace kr
+{
+  /// \brief Hands out shared vertex array objects, so there is only one per vertex format.
+  ///
+  /// A vertex format is a set of resolved attributes, i.e. the attributes of a VertexLayout
+  /// at the locations some shader program expects them.
+  /// A vertex array object only stores the format, using separate attribute formats (GL 4.3).
+  /// The vertex buffer and its stride are attached in bind(), so all buffers of a format share one.
+  /// All shared vertex array objects live until the engine shuts down.
+  ///
+  /// Vertex layouts are registered once, so the vertex array object of a layout and a shader program
+  /// is found by a single lookup instead of resolving the layout again for every bind.
+  namespace VertexArrayCache
+  {
+    /// \brief Returns the shared vertex array object of the given format. Creates it on first use.
+    /// \return 0 if no vertex array object could be created.
+    /// \note Requires a current GL context.
+    KR_ENGINE_API GLuint get(ezArrayPtr<const ResolvedVertexAttribute> attributes);
+
+    /// \brief Keeps a copy of \a layout, so it can be resolved for any shader program later on.
+    /// \return The id of the layout. Layouts with the same attributes and stride get the same id.
+    KR_ENGINE_API ezUInt32 registerLayout(const VertexLayout& layout);
+
+    /// \brief Returns the shared vertex array object of the registered layout \a layoutId
+    ///        at the attribute locations of \a pShader.
+    ///
+    /// The layout is only resolved on the first request for a program.
+    /// \param out_pResult If not nullptr, set to EZ_FAILURE if an attribute of the layout
+    ///                    is not active in \a pShader, like resolveVertexLayout().
+    /// \return 0 if no vertex array object could be created.
+    /// \note Requires a current GL context.
+    KR_ENGINE_API GLuint get(ezUInt32 layoutId,
+                             Borrowed<const ShaderProgram> pShader,
+                             ezResult* out_pResult = nullptr);
+
+    /// \brief Binds \a hVertexArray with the vertex buffer \a hBuffer and the index buffer \a hIndexBuffer.
+    /// \param hIndexBuffer May be 0.
+    /// \note Attaches \a hBuffer to binding point 0. Attributes read from other binding points
+    ///       need their buffers attached with glBindVertexBuffer.
+    KR_ENGINE_API void bind(GLuint hVertexArray, GLuint hBuffer, ezUInt32 stride, GLuint hIndexBuffer);
+
+    /// \brief Number of distinct vertex array objects in the cache.
+    KR_ENGINE_API ezUInt32 getCount();
+  }
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <krEngine/ownership.h>
 #include <krEngine/rendering/shader.h>
+#include <krEngine/rendering/vertexLayout.h>
 
 namespace kr
 {
@@ -21,7 +22,8 @@ namespace kr
 
   enum class BufferTarget
   {
-    Array = GL_ARRAY_BUFFER
+    Array = GL_ARRAY_BUFFER,
+    ElementArray = GL_ELEMENT_ARRAY_BUFFER
   };
 
   enum class PrimitiveType
@@ -43,26 +45,43 @@ namespace kr
     Patches = GL_PATCHES
   };
 
+  class IndexBuffer;
+  struct VertexBufferPoolPage;
+
   class VertexBuffer
   {
   public: // *** Static API
     KR_ENGINE_API static Owned<VertexBuffer> create(BufferUsage usage,
                                                     PrimitiveType primitive);
 
-  public: // *** Types
-    struct VertexArrayProgramPair
-    {
-      GLuint hVao = 0;
-      Borrowed<ShaderProgram> pShader;
-    };
-
   public: // *** Data
     BufferUsage m_usage;       ///< Set on construction.
     PrimitiveType m_primitive; ///< Set on construction.
     BufferTarget m_target = BufferTarget::Array;
 
     GLuint m_glHandle = 0;
-    ezHybridArray<VertexArrayProgramPair, 1> m_Vaos;
+
+    /// \brief Id of the layout registered by setupLayout(). 0 if it was not set up yet.
+    /// \see VertexArrayCache::registerLayout
+    ezUInt32 m_layoutId = 0;
+
+    /// \brief Size of a vertex in bytes, according to the layout.
+    ezUInt32 m_stride = 0;
+
+    /// \brief Bound along with the vertex array object. Set by attachIndexBuffer().
+    Borrowed<const IndexBuffer> m_pIndexBuffer;
+
+    // Pooling
+    // =======
+
+    /// \brief Start of this buffer within m_glHandle. Only pooled buffers start anywhere but 0.
+    ezUInt32 m_byteOffset = 0;
+
+    /// \brief Size of the range of a pooled buffer. Other buffers are resized by every upload.
+    ezUInt32 m_byteCount = 0;
+
+    /// \brief The page of the VertexBufferPool this buffer lives in, if any.
+    VertexBufferPoolPage* m_pPoolPage = nullptr;
 
   public: // *** Accessors/Mutators
     void setUsage(BufferUsage usage) { m_usage = usage; }
@@ -74,21 +93,50 @@ namespace kr
     void setTarget(BufferTarget target) { m_target = target; }
     BufferTarget getTarget() const { return m_target; }
 
+    bool isPooled() const { return m_pPoolPage != nullptr; }
+
+    /// \brief Index of the first vertex of this buffer within the GL buffer.
+    ///
+    /// Pass this as \c first to glDrawArrays or as \c basevertex to glDrawElementsBaseVertex.
+    ezUInt32 getBaseVertex(ezUInt32 stride) const { return m_byteOffset / stride; }
+
   public: // *** Construction
     KR_ENGINE_API ~VertexBuffer();
 
   private: // *** Private Construction
-    /// Create these using a static factory function of this class.
+    friend Owned<VertexBuffer> createPooledVertexBuffer(VertexBufferPoolPage*, GLuint, ezUInt32, ezUInt32, PrimitiveType);
+
+    /// Create these using a static factory function of this class or the VertexBufferPool.
     VertexBuffer() = default;
 
     VertexBuffer(const VertexBuffer&) = delete;
     void operator =(const VertexBuffer&) = delete;
   };
 
+  /// \brief Sets the layout of this vertex buffer and resolves it for the given \a pShader.
+  ///
+  /// The buffer can be bound with other programs as well.
+  /// The layout is resolved for them on their first bind.
+  KR_ENGINE_API ezResult setupLayout(Borrowed<VertexBuffer> pVertBuffer,
+                                     Borrowed<ShaderProgram> pShader,
+                                     const VertexLayout& layout);
+
+  /// \brief Sets the layout of this vertex buffer to the one declared for \a TVertex.
+  /// \see KR_BEGIN_VERTEX_LAYOUT
+  template<typename TVertex>
+  ezResult setupLayout(Borrowed<VertexBuffer> pVertBuffer,
+                       Borrowed<ShaderProgram> pShader)
+  {
+    return setupLayout(move(pVertBuffer), move(pShader), vertexLayoutOf<TVertex>());
+  }
+
   /// \brief Sets the layout of this vertex buffer for the given \a pShader.
   /// \param layoutTypeName
   ///   The name of a reflectable (ezRTTI) type descibing the
   ///   vertex buffer layout. Yes, this is Black Magic.
+  /// \deprecated Looks up the type and the attribute names on every call
+  ///             and ignores any padding between the members.
+  ///             Declare the layout with KR_BEGIN_VERTEX_LAYOUT instead.
   KR_ENGINE_API ezResult setupLayout(Borrowed<VertexBuffer> pVertBuffer,
                                      Borrowed<ShaderProgram> pShader,
                                      const char* layoutTypeName);
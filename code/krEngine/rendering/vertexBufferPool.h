@@ -0,0 +1,71 @@
+#pragma once
+#include <krEngine/rendering/vertexBuffer.h>
+
+namespace kr
+{
+  struct VertexBufferPoolStats
+  {
+    /// \brief Number of GL buffers the ranges are carved out of.
+    ezUInt32 numPages = 0;
+
+    /// \brief Number of vertex buffers currently living in a page.
+    ezUInt32 numAllocations = 0;
+
+    /// \brief Number of disjoint free ranges across all pages.
+    ezUInt32 numFreeRanges = 0;
+
+    /// \brief Size of all pages together.
+    ezUInt64 byteCount = 0;
+
+    /// \brief Bytes used by allocations, not counting alignment gaps.
+    ezUInt64 usedByteCount = 0;
+
+    /// \brief Size of the largest free range of any page.
+    ezUInt64 largestFreeRange = 0;
+
+    ezUInt64 getFreeByteCount() const { return byteCount - usedByteCount; }
+
+    /// \brief 0 if all free memory of a page is in one piece, approaching 1 the more it is scattered.
+    ///
+    /// Only looks at the largest free range, so several pages with one range each are not fragmented.
+    float getFragmentation() const
+    {
+      auto freeByteCount = getFreeByteCount();
+      if (freeByteCount == 0 || numFreeRanges <= numPages)
+        return 0.0f;
+      return 1.0f - float(largestFreeRange) / float(freeByteCount);
+    }
+  };
+
+  /// \brief Carves many small vertex buffers out of a few large GL buffers.
+  ///
+  /// A pooled vertex buffer shares its GL handle with the other buffers of its page
+  /// and starts at VertexBuffer::m_byteOffset. Vertex array objects of pooled buffers
+  /// point to the start of the page, so draws have to start at VertexBuffer::getBaseVertex().
+  /// \note All functions must be called on the thread that owns the GL context.
+  namespace VertexBufferPool
+  {
+    /// \brief Allocates a vertex buffer of \a byteCount bytes for vertices of \a stride bytes.
+    ///
+    /// Allocations that do not fit into a page get a GL buffer of their own.
+    /// The content is undefined until it is uploaded with uploadData().
+    /// \return nullptr if no GL buffer could be created.
+    KR_ENGINE_API Owned<VertexBuffer> allocate(ezUInt32 byteCount,
+                                               ezUInt32 stride,
+                                               PrimitiveType primitive);
+
+    /// \brief Size of newly created pages. Defaults to 1 MiB.
+    KR_ENGINE_API void setPageSize(ezUInt32 byteCount);
+    KR_ENGINE_API ezUInt32 getPageSize();
+
+    /// \brief Moves the allocations of each page to its front, so the free space is in one piece,
+    ///        and releases all empty pages.
+    ///
+    /// Allocations never move between pages, so their vertex array objects stay valid.
+    /// \return The number of moved allocations.
+    KR_ENGINE_API ezUInt32 compact();
+
+    KR_ENGINE_API VertexBufferPoolStats getStats();
+    KR_ENGINE_API void logStats();
+  }
+}
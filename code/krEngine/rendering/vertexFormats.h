@@ -0,0 +1,184 @@
+#pragma once
+
+namespace kr
+{
+  // Conversion
+  // ==========
+
+  /// \brief Maps \a value from [0, 1] to [0, 255]. Values outside the range are clamped.
+  inline ezUInt8 toUNorm8(float value)
+  {
+    return static_cast<ezUInt8>(ezMath::Clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+  }
+
+  /// \brief Maps \a value from [-1, 1] to [-127, 127]. Values outside the range are clamped.
+  inline ezInt8 toSNorm8(float value)
+  {
+    auto scaled = ezMath::Clamp(value, -1.0f, 1.0f) * 127.0f;
+    return static_cast<ezInt8>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+  }
+
+  /// \brief Maps \a value from [0, 1] to [0, 65535]. Values outside the range are clamped.
+  inline ezUInt16 toUNorm16(float value)
+  {
+    return static_cast<ezUInt16>(ezMath::Clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+  }
+
+  /// \brief Maps \a value from [-1, 1] to [-32767, 32767]. Values outside the range are clamped.
+  inline ezInt16 toSNorm16(float value)
+  {
+    auto scaled = ezMath::Clamp(value, -1.0f, 1.0f) * 32767.0f;
+    return static_cast<ezInt16>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+  }
+
+  inline float fromUNorm8(ezUInt8 value)   { return value / 255.0f; }
+  inline float fromSNorm8(ezInt8 value)    { return ezMath::Max(value / 127.0f, -1.0f); }
+  inline float fromUNorm16(ezUInt16 value) { return value / 65535.0f; }
+  inline float fromSNorm16(ezInt16 value)  { return ezMath::Max(value / 32767.0f, -1.0f); }
+
+  /// \brief Converts \a value to an IEEE 754 half precision float, rounding to nearest even.
+  ///
+  /// Values too large for a half become infinity, values too small become zero.
+  KR_ENGINE_API ezUInt16 toHalf(float value);
+
+  KR_ENGINE_API float fromHalf(ezUInt16 value);
+
+  // Normalized Integers
+  // ===================
+  // The shader sees these as floats in [0, 1] or [-1, 1].
+
+  /// \brief Four unsigned bytes, e.g. for colors. 4 bytes instead of 16 for an ezColor.
+  struct UNorm8x4
+  {
+    ezUInt8 x = 0, y = 0, z = 0, w = 0;
+
+    void set(float x, float y, float z, float w)
+    {
+      this->x = toUNorm8(x); this->y = toUNorm8(y); this->z = toUNorm8(z); this->w = toUNorm8(w);
+    }
+    void set(const ezColor& color) { set(color.r, color.g, color.b, color.a); }
+
+    ezVec4 get() const { return ezVec4(fromUNorm8(x), fromUNorm8(y), fromUNorm8(z), fromUNorm8(w)); }
+  };
+
+  /// \brief Four signed bytes, e.g. for normals.
+  struct SNorm8x4
+  {
+    ezInt8 x = 0, y = 0, z = 0, w = 0;
+
+    void set(float x, float y, float z, float w)
+    {
+      this->x = toSNorm8(x); this->y = toSNorm8(y); this->z = toSNorm8(z); this->w = toSNorm8(w);
+    }
+
+    ezVec4 get() const { return ezVec4(fromSNorm8(x), fromSNorm8(y), fromSNorm8(z), fromSNorm8(w)); }
+  };
+
+  /// \brief Two unsigned shorts, e.g. for texture coordinates in [0, 1]. 4 bytes instead of 8 for an ezVec2.
+  struct UNorm16x2
+  {
+    ezUInt16 x = 0, y = 0;
+
+    void set(float x, float y) { this->x = toUNorm16(x); this->y = toUNorm16(y); }
+
+    ezVec2 get() const { return ezVec2(fromUNorm16(x), fromUNorm16(y)); }
+  };
+
+  /// \brief Two signed shorts.
+  struct SNorm16x2
+  {
+    ezInt16 x = 0, y = 0;
+
+    void set(float x, float y) { this->x = toSNorm16(x); this->y = toSNorm16(y); }
+
+    ezVec2 get() const { return ezVec2(fromSNorm16(x), fromSNorm16(y)); }
+  };
+
+  // Half Floats
+  // ===========
+
+  /// \brief Two half floats. Exact for integers up to 2048.
+  struct Half2
+  {
+    ezUInt16 x = 0, y = 0;
+
+    void set(float x, float y) { this->x = toHalf(x); this->y = toHalf(y); }
+
+    ezVec2 get() const { return ezVec2(fromHalf(x), fromHalf(y)); }
+  };
+
+  struct Half4
+  {
+    ezUInt16 x = 0, y = 0, z = 0, w = 0;
+
+    void set(float x, float y, float z, float w)
+    {
+      this->x = toHalf(x); this->y = toHalf(y); this->z = toHalf(z); this->w = toHalf(w);
+    }
+
+    ezVec4 get() const { return ezVec4(fromHalf(x), fromHalf(y), fromHalf(z), fromHalf(w)); }
+  };
+
+  // Packed
+  // ======
+
+  /// \brief x, y and z with 10 bits each and w with 2 bits, packed into 32 bits.
+  ///
+  /// Matches GL_INT_2_10_10_10_REV, so x occupies the lowest bits. Good for normals and tangents.
+  struct SNorm2_10_10_10
+  {
+    ezUInt32 bits = 0;
+
+    void set(float x, float y, float z, float w = 1.0f)
+    {
+      auto pack = [](float value, float scale, ezUInt32 mask)
+      {
+        auto scaled = ezMath::Clamp(value, -1.0f, 1.0f) * scale;
+        auto rounded = static_cast<ezInt32>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+        return static_cast<ezUInt32>(rounded) & mask;
+      };
+      bits = pack(x, 511.0f, 0x3FF)
+           | pack(y, 511.0f, 0x3FF) << 10
+           | pack(z, 511.0f, 0x3FF) << 20
+           | pack(w,   1.0f, 0x3)   << 30;
+    }
+
+    ezVec4 get() const
+    {
+      // Shift the field to the top, then back down with sign extension.
+      auto unpack = [](ezUInt32 packed, ezUInt32 shift, ezUInt32 width, float scale)
+      {
+        auto value = static_cast<ezInt32>(packed << (32 - shift - width)) >> (32 - width);
+        return ezMath::Max(value / scale, -1.0f);
+      };
+      return ezVec4(unpack(bits, 0, 10, 511.0f), unpack(bits, 10, 10, 511.0f),
+                    unpack(bits, 20, 10, 511.0f), unpack(bits, 30, 2, 1.0f));
+    }
+  };
+
+  /// \brief Unsigned variant of SNorm2_10_10_10, matching GL_UNSIGNED_INT_2_10_10_10_REV.
+  struct UNorm2_10_10_10
+  {
+    ezUInt32 bits = 0;
+
+    void set(float x, float y, float z, float w = 1.0f)
+    {
+      auto pack = [](float value, float scale)
+      {
+        return static_cast<ezUInt32>(ezMath::Clamp(value, 0.0f, 1.0f) * scale + 0.5f);
+      };
+      bits = pack(x, 1023.0f)
+           | pack(y, 1023.0f) << 10
+           | pack(z, 1023.0f) << 20
+           | pack(w,    3.0f) << 30;
+    }
+
+    ezVec4 get() const
+    {
+      return ezVec4(( bits        & 0x3FF) / 1023.0f,
+                    ((bits >> 10) & 0x3FF) / 1023.0f,
+                    ((bits >> 20) & 0x3FF) / 1023.0f,
+                    ( bits >> 30)          / 3.0f);
+    }
+  };
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include <krEngine/rendering/shader.h>
+#include <krEngine/rendering/vertexFormats.h>
+
+#include <cstddef>
+
+namespace kr
+{
+  /// \brief Describes how a single attribute is stored within a vertex.
+  struct VertexAttribute
+  {
+    /// \brief Name of the attribute in the vertex shader.
+    const char* name;
+
+    /// \brief Type of each component, e.g. GL_FLOAT or GL_HALF_FLOAT.
+    ///
+    /// For GL_INT_2_10_10_10_REV and GL_UNSIGNED_INT_2_10_10_10_REV, all four components share 32 bits.
+    GLenum glType;
+    GLint numComponents;
+
+    /// \brief Whether integer components are mapped to [0, 1] or [-1, 1].
+    ///
+    /// Integers that are not normalized are passed as integers to integer shader inputs,
+    /// and converted to floats for all others.
+    GLboolean isNormalized;
+
+    /// \brief Byte offset of the attribute within the vertex.
+    ezUInt32 offset;
+  };
+
+  /// \brief GL type, number of components and normalization of a vertex member of type \a T.
+  ///
+  /// Use KR_DECLARE_VERTEX_ATTRIBUTE_TYPE to add your own types.
+  template<typename T>
+  struct VertexAttributeTraits;
+
+  /// \brief The attributes and the stride of a vertex type.
+  ///
+  /// The name hashes are computed once on construction,
+  /// so setting up a vertex buffer with this layout does no string work.
+  class VertexLayout
+  {
+  public: // *** Data
+    ezArrayPtr<const VertexAttribute> m_attributes;
+    ezUInt32 m_stride = 0;
+
+    /// \brief One entry per attribute.
+    ezHybridArray<ShaderUniformName, 4> m_names;
+
+  public: // *** Construction
+    /// \note Does not copy the \a attributes, so they have to outlive this layout.
+    KR_ENGINE_API VertexLayout(ezArrayPtr<const VertexAttribute> attributes, ezUInt32 stride);
+
+  public: // *** Accessors/Mutators
+    ezArrayPtr<const VertexAttribute> getAttributes() const { return m_attributes; }
+    ezUInt32 getStride() const { return m_stride; }
+
+  private: // *** Private Construction
+    VertexLayout(const VertexLayout&) = delete;
+    void operator =(const VertexLayout&) = delete;
+  };
+
+  /// \brief The layout of \a TVertex, as declared with KR_BEGIN_VERTEX_LAYOUT.
+  template<typename TVertex>
+  const VertexLayout& vertexLayoutOf();
+
+  /// \brief An attribute of a VertexLayout at the location of an active input of a shader program.
+  struct ResolvedVertexAttribute
+  {
+    GLuint location;
+    GLenum glType;
+    GLint numComponents;
+    GLboolean isNormalized;
+
+    /// \brief Whether the components reach an int or uint shader input without conversion to float.
+    GLboolean isInteger;
+
+    ezUInt32 offset;
+
+    /// \brief Index of the vertex buffer binding point the attribute is read from. 0 by default.
+    /// \note Ignored by applyVertexLayout(). \see VertexArrayCache
+    GLuint binding;
+
+    /// \brief Advance per instance instead of per vertex if not 0. Shared by all attributes of a binding.
+    GLuint divisor;
+  };
+
+  /// \brief Looks up the attribute locations of \a layout in \a pShader.
+  /// \return EZ_FAILURE if an attribute of the \a layout is not active in \a pShader.
+  ///         All other attributes are still resolved.
+  KR_ENGINE_API ezResult resolveVertexLayout(Borrowed<const ShaderProgram> pShader,
+                                             const VertexLayout& layout,
+                                             ezHybridArray<ResolvedVertexAttribute, 8>& out_attributes);
+
+  /// \brief Sets the attribute pointers of the currently bound vertex array object
+  ///        for the buffer currently bound to GL_ARRAY_BUFFER.
+  /// \return EZ_FAILURE if an attribute of the \a layout is not active in \a pShader.
+  ///         All other attributes are still set up.
+  KR_ENGINE_API ezResult applyVertexLayout(Borrowed<const ShaderProgram> pShader,
+                                           const VertexLayout& layout);
+
+  /// \brief Sets the attribute pointers of the currently bound vertex array object
+  ///        for the buffer currently bound to GL_ARRAY_BUFFER.
+  KR_ENGINE_API void applyVertexLayout(ezArrayPtr<const ResolvedVertexAttribute> attributes,
+                                       ezUInt32 stride);
+}
+
+/// \brief Declares the vertex attribute traits of \a Type.
+/// \note Use this in the global namespace.
+#define KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(Type, GlType, NumComponents, IsNormalized) \
+  namespace kr                                                                  \
+  {                                                                             \
+    template<>                                                                  \
+    struct VertexAttributeTraits<Type>                                          \
+    {                                                                           \
+      static const GLenum glType = GlType;                                      \
+      static const GLint numComponents = NumComponents;                         \
+      static const GLboolean isNormalized = IsNormalized;                       \
+    };                                                                          \
+  }
+
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(float,    GL_FLOAT,        1, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(ezVec2,   GL_FLOAT,        2, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(ezVec3,   GL_FLOAT,        3, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(ezVec4,   GL_FLOAT,        4, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(ezColor,  GL_FLOAT,        4, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(ezInt32,  GL_INT,          1, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(ezUInt32, GL_UNSIGNED_INT, 1, GL_FALSE);
+
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::UNorm8x4,        GL_UNSIGNED_BYTE,               4, GL_TRUE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::SNorm8x4,        GL_BYTE,                        4, GL_TRUE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::UNorm16x2,       GL_UNSIGNED_SHORT,              2, GL_TRUE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::SNorm16x2,       GL_SHORT,                       2, GL_TRUE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::Half2,           GL_HALF_FLOAT,                  2, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::Half4,           GL_HALF_FLOAT,                  4, GL_FALSE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::SNorm2_10_10_10, GL_INT_2_10_10_10_REV,          4, GL_TRUE);
+KR_DECLARE_VERTEX_ATTRIBUTE_TYPE(kr::UNorm2_10_10_10, GL_UNSIGNED_INT_2_10_10_10_REV, 4, GL_TRUE);
+
+/// \brief Begins the layout declaration of the vertex type \a VertexType.
+///
+/// Everything but the name hashes is known at compile time:
+/// \code
+///   KR_BEGIN_VERTEX_LAYOUT(MyVertex)
+///     KR_VERTEX_ATTRIBUTE("vs_position",  pos),
+///     KR_VERTEX_ATTRIBUTE("vs_texCoords", texCoords)
+///   KR_END_VERTEX_LAYOUT
+/// \endcode
+/// \note Use this in the global namespace, in a header if the layout is used in several files.
+#define KR_BEGIN_VERTEX_LAYOUT(VertexType)                                      \
+  template<>                                                                    \
+  inline const ::kr::VertexLayout& ::kr::vertexLayoutOf<VertexType>()           \
+  {                                                                             \
+    typedef VertexType Vertex;                                                  \
+    static const ::kr::VertexAttribute attributes[] =                           \
+    {
+
+/// \brief The member \a member of the vertex, bound to the shader attribute \a attributeName.
+#define KR_VERTEX_ATTRIBUTE(attributeName, member)                              \
+      {                                                                         \
+        attributeName,                                                          \
+        ::kr::VertexAttributeTraits<decltype(Vertex::member)>::glType,          \
+        ::kr::VertexAttributeTraits<decltype(Vertex::member)>::numComponents,   \
+        ::kr::VertexAttributeTraits<decltype(Vertex::member)>::isNormalized,    \
+        static_cast<ezUInt32>(offsetof(Vertex, member))                         \
+      }
+
+#define KR_END_VERTEX_LAYOUT                                                    \
+    };                                                                          \
+    static const ::kr::VertexLayout layout(ezMakeArrayPtr(attributes),          \
+                                           sizeof(Vertex));                     \
+    return layout;                                                              \
+  }
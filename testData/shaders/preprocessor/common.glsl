@@ -0,0 +1,12 @@
+#pragma once
+
+// Common
+// ======
+vec4 krTint(vec4 color)
+{
+#ifdef KR_TINT
+  return color * vec4(1.0, 0.5, 0.5, 1.0);
+#else
+  return color;
+#endif
+}
@@ -0,0 +1,37 @@
+#version 150
+
+#ifdef KR_MISSING
+#include "doesNotExist.glsl"
+#endif
+
+#if 0
+#include "doesNotExist.glsl"
+#elif defined(KR_TINT)
+#include "common.glsl"
+#else
+#include "doesNotExist.glsl"
+#endif
+
+#ifndef KR_TINT
+#include "doesNotExist.glsl"
+#endif
+
+#define KR_LOCAL
+#if !defined(KR_LOCAL)
+#include "doesNotExist.glsl"
+#endif
+
+// Input
+// =====
+in vec4 fs_color;
+
+// Output
+// ======
+out vec4 out_color;
+
+// Functions
+// =========
+void main()
+{
+  out_color = krTint(fs_color);
+}
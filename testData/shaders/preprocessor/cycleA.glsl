@@ -0,0 +1 @@
+#include "cycleB.glsl"
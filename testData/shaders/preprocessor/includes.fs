@@ -0,0 +1,19 @@
+#version 150
+
+#include "common.glsl"
+#include "common.glsl"
+
+// Input
+// =====
+in vec4 fs_color;
+
+// Output
+// ======
+out vec4 out_color;
+
+// Functions
+// =========
+void main()
+{
+  out_color = krTint(fs_color);
+}
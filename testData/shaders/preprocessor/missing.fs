@@ -0,0 +1,2 @@
+#version 150
+#include "doesNotExist.glsl"
@@ -3,12 +3,19 @@
 // Uniforms
 // ========
 uniform sampler2D u_texture;
+
+#ifndef KR_MULTI_DRAW
 uniform vec4 u_color;
+#endif
 
 // Input
 // =====
 in vec2 fs_texCoords;
 
+#ifdef KR_MULTI_DRAW
+in vec4 fs_color;
+#endif
+
 // Output
 // ======
 out vec4 out_color;
@@ -17,5 +24,11 @@ out vec4 out_color;
 // =========
 void main()
 {
-  out_color = texture(u_texture, fs_texCoords) * u_color;
+#ifdef KR_MULTI_DRAW
+  vec4 color = fs_color;
+#else
+  vec4 color = u_color;
+#endif
+
+  out_color = texture(u_texture, fs_texCoords) * color;
 }
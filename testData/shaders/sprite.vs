@@ -2,8 +2,11 @@
 
 // Uniforms
 // ========
+#ifndef KR_MULTI_DRAW
 uniform vec2 u_origin;
 uniform float u_rotation; // radians
+uniform float u_depth;    // [0, 1], 0 is in front.
+#endif
 uniform mat4 u_view;
 uniform mat4 u_projection;
 
@@ -12,19 +15,40 @@ uniform mat4 u_projection;
 in vec2 vs_position;
 in vec2 vs_texCoords;
 
+#ifdef KR_MULTI_DRAW
+// Sprites drawn with a single multi-draw call read their data per instance.
+in vec4 vs_drawTransform; // xy is the origin, z the rotation in radians, w the depth.
+in vec4 vs_drawColor;
+#endif
+
 // Output
 // ======
 out vec2 fs_texCoords;
 
+#ifdef KR_MULTI_DRAW
+out vec4 fs_color;
+#endif
+
 // Functions
 // =========
 void main()
 {
-  vec2 pos = u_origin + vs_position;
+#ifdef KR_MULTI_DRAW
+  vec2 origin = vs_drawTransform.xy;
+  float rotation = vs_drawTransform.z;
+  float depth = vs_drawTransform.w;
+  fs_color = vs_drawColor;
+#else
+  vec2 origin = u_origin;
+  float rotation = u_rotation;
+  float depth = u_depth;
+#endif
+
+  vec2 pos = origin + vs_position;
 
   vec4 transformedPos;
-  transformedPos.x = pos.x * cos(u_rotation) - pos.y * sin(u_rotation);
-  transformedPos.y = pos.x * sin(u_rotation) + pos.y * cos(u_rotation);
+  transformedPos.x = pos.x * cos(rotation) - pos.y * sin(rotation);
+  transformedPos.y = pos.x * sin(rotation) + pos.y * cos(rotation);
   transformedPos.z = 0.0;
   transformedPos.w = 1.0;
 
@@ -32,4 +56,7 @@ void main()
   gl_Position = u_projection
               * u_view
               * transformedPos;
+
+  // The draw order determines the depth, not the camera.
+  gl_Position.z = (depth * 2.0 - 1.0) * gl_Position.w;
 }
@@ -0,0 +1,21 @@
+#version 150
+
+// Uniforms
+// ========
+uniform sampler2DArray u_texture;
+
+// Input
+// =====
+in vec3 fs_texCoords;
+in vec4 fs_color;
+
+// Output
+// ======
+out vec4 out_color;
+
+// Functions
+// =========
+void main()
+{
+  out_color = texture(u_texture, fs_texCoords) * fs_color;
+}
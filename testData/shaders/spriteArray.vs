@@ -0,0 +1,50 @@
+#version 150
+
+// Uniforms
+// ========
+uniform mat4 u_view;
+uniform mat4 u_projection;
+
+// Input
+// =====
+in vec2 vs_corner; // Of the static quad, from (0, 0) to (1, 1).
+
+// Each sprite is an instance of the quad.
+in vec4 vs_transform;      // xy is the origin, z the rotation in radians, w the depth in [0, 1], 0 is in front.
+in vec4 vs_bounds;         // xy is the first vertex of the untransformed quad, zw the last.
+in vec2 vs_firstTexCoords;
+in vec2 vs_lastTexCoords;
+in float vs_layer;         // The layer of the texture array.
+in vec4 vs_color;
+
+// Output
+// ======
+out vec3 fs_texCoords;
+out vec4 fs_color;
+
+// Functions
+// =========
+void main()
+{
+  vec2 origin = vs_transform.xy;
+  float rotation = vs_transform.z;
+  float depth = vs_transform.w;
+
+  // Same transformation as sprite.vs.
+  vec2 pos = origin + mix(vs_bounds.xy, vs_bounds.zw, vs_corner);
+
+  vec4 transformedPos;
+  transformedPos.x = pos.x * cos(rotation) - pos.y * sin(rotation);
+  transformedPos.y = pos.x * sin(rotation) + pos.y * cos(rotation);
+  transformedPos.z = 0.0;
+  transformedPos.w = 1.0;
+
+  fs_texCoords = vec3(mix(vs_firstTexCoords, vs_lastTexCoords, vs_corner), vs_layer);
+  fs_color = vs_color;
+  gl_Position = u_projection
+              * u_view
+              * transformedPos;
+
+  // The draw order determines the depth, not the camera.
+  gl_Position.z = (depth * 2.0 - 1.0) * gl_Position.w;
+}
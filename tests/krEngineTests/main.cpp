@@ -13,6 +13,7 @@
 
 static ezString64 g_texturesDir;
 static ezString64 g_shadersDir;
+static ezStringBuilder g_outputDir;
 static bool g_initialized = false;
 
 EZ_ON_GLOBAL_EVENT(ezStartup_StartupCore_End)
@@ -41,6 +42,12 @@ EZ_ON_GLOBAL_EVENT(ezStartup_StartupCore_End)
                                  "testData",
                                  "shader"); // To be used as"<shader>Lighting.vs"
 
+  // Output dir, for tests that need to write files.
+  ezFileSystem::AddDataDirectory(g_outputDir.GetData(),
+                                 ezFileSystem::AllowWrites,
+                                 "testData",
+                                 "output"); // To be used as"<output>cooked.krtex"
+
   ezGlobalLog::AddLogWriter(ezLogWriter::VisualStudio::LogMessageHandler);
 
   g_initialized = true;
@@ -85,5 +92,13 @@ int main(int argc, char* argv[])
     g_shadersDir = shadersDir;
   }
 
+  // Output dir
+  {
+    g_outputDir = ezOSFile::GetApplicationDirectory();
+    g_outputDir.AppendPath("testOutput");
+    g_outputDir.MakeCleanPath();
+    ezOSFile::CreateDirectoryStructure(g_outputDir);
+  }
+
   return Catch::Session().run(argc, argv);
 }
@@ -0,0 +1,86 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/window.h>
+#include <krEngine/rendering/indexBuffer.h>
+
+namespace
+{
+  struct QuadVertex
+  {
+    ezVec2 pos;
+  };
+}
+
+KR_BEGIN_VERTEX_LAYOUT(QuadVertex)
+  KR_VERTEX_ATTRIBUTE("vs_position", pos)
+KR_END_VERTEX_LAYOUT
+
+TEST_CASE("Index Buffer", "[index-buffer]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  SECTION("Upload")
+  {
+    auto pIB = IndexBuffer::create(BufferUsage::StaticDraw, IndexType::UInt16);
+    REQUIRE(pIB != nullptr);
+    REQUIRE(pIB->getCount() == 0);
+
+    const ezUInt16 shortIndices[] = { 0, 1, 2, 2, 1, 3 };
+    REQUIRE(uploadData(pIB, ezMakeArrayPtr(shortIndices)).Succeeded());
+    REQUIRE(pIB->getCount() == 6);
+    REQUIRE(pIB->getType() == IndexType::UInt16);
+    REQUIRE(pIB->getIndexSize() == 2);
+
+    // Uploading 32 bit indices changes the type.
+    const ezUInt32 intIndices[] = { 0, 1, 2 };
+    REQUIRE(uploadData(pIB, ezMakeArrayPtr(intIndices)).Succeeded());
+    REQUIRE(pIB->getCount() == 3);
+    REQUIRE(pIB->getGlType() == GL_UNSIGNED_INT);
+  }
+
+  SECTION("Attach to Vertex Buffer")
+  {
+    auto shader = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+    auto pVB = VertexBuffer::create(BufferUsage::StaticDraw, PrimitiveType::Triangles);
+    auto pIB = IndexBuffer::create(BufferUsage::StaticDraw, IndexType::UInt16);
+
+    // Attaching before and after setting up the layout must both work.
+    REQUIRE(attachIndexBuffer(pVB, pIB).Succeeded());
+    setupLayout<QuadVertex>(pVB, shader);
+    REQUIRE(attachIndexBuffer(pVB, pIB).Succeeded());
+
+    KR_RAII_BIND_VERTEX_BUFFER(pVB, shader);
+    GLint hBound = 0;
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &hBound);
+    REQUIRE(static_cast<GLuint>(hBound) == pIB->getGlHandle());
+
+    // Detach again, so the index buffer is no longer borrowed when it is destroyed.
+    REQUIRE(attachIndexBuffer(pVB, nullptr).Succeeded());
+  }
+
+  SECTION("Shared Quads")
+  {
+    auto pQuads = IndexBuffer::getQuads(10);
+    REQUIRE(pQuads != nullptr);
+    REQUIRE(pQuads->getCount() >= 6 * 10);
+    REQUIRE(pQuads->getType() == IndexType::UInt16);
+
+    auto hQuads = pQuads->getGlHandle();
+
+    // Growing keeps the handle, but needs 32 bit indices at some point.
+    auto pMoreQuads = IndexBuffer::getQuads(20000);
+    REQUIRE(pMoreQuads->getGlHandle() == hQuads);
+    REQUIRE(pMoreQuads->getCount() >= 6 * 20000);
+    REQUIRE(pMoreQuads->getType() == IndexType::UInt32);
+
+    // Smaller requests are served by the existing buffer.
+    REQUIRE(IndexBuffer::getQuads(5)->getCount() == pMoreQuads->getCount());
+  }
+}
@@ -0,0 +1,111 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering.h>
+
+TEST_CASE("Renderer Stats Summary", "[renderer]")
+{
+  using namespace kr;
+
+  RendererFrameStats frames[100];
+  for (ezUInt32 i = 0; i < EZ_ARRAY_SIZE(frames); ++i)
+  {
+    // 1 to 100 draw calls, out of order.
+    frames[i].numDrawCalls = (i * 37) % 100 + 1;
+    frames[i].drawTime = ezTime::Milliseconds(2.0);
+  }
+
+  auto allFrames = ezArrayPtr<const RendererFrameStats>(frames, EZ_ARRAY_SIZE(frames));
+
+  auto summary = summarize(allFrames, RendererStat::DrawCalls);
+  REQUIRE(summary.numFrames == 100);
+  REQUIRE(summary.min == 1.0);
+  REQUIRE(summary.max == 100.0);
+  REQUIRE(summary.average == Approx(50.5));
+  REQUIRE(summary.percentile99 == 99.0);
+
+  auto timeSummary = summarize(allFrames, RendererStat::DrawTime);
+  REQUIRE(timeSummary.average == Approx(2.0));
+
+  auto empty = summarize(ezArrayPtr<const RendererFrameStats>(), RendererStat::DrawCalls);
+  REQUIRE(empty.numFrames == 0);
+
+  for (ezUInt32 i = 0; i < static_cast<ezUInt32>(RendererStat::Count); ++i)
+  {
+    REQUIRE(getName(static_cast<RendererStat>(i)) != nullptr);
+  }
+}
+
+TEST_CASE("Renderer Frame Stats", "[renderer]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  auto tex = Texture::load("<texture>test_4x4.bmp");
+  auto sampler = Sampler::create();
+  auto shader = Sprite::getDefaultShader();
+
+  Sprite sprites[4];
+  for (auto& sprite : sprites)
+  {
+    REQUIRE(initialize(sprite, tex, sampler, shader).Succeeded());
+  }
+
+  Renderer::ExtractionEventListener listener = [&sprites](Renderer::Extractor& e)
+  {
+    for (auto& sprite : sprites)
+    {
+      extract(e, sprite, Transform2D::zero());
+    }
+  };
+  Renderer::addExtractionListener(listener);
+  KR_ON_SCOPE_EXIT{ Renderer::removeExtractionListener(listener); };
+
+  Renderer::setStatsHistorySize(4);
+  REQUIRE(Renderer::getStatsHistoryCount() == 0);
+
+  const ezUInt32 numFrames = 6;
+  for (ezUInt32 frame = 0; frame < numFrames; ++frame)
+  {
+    Renderer::extract();
+    Renderer::update(ezTime(), pWindow);
+  }
+
+  SECTION("Last Frame")
+  {
+    auto stats = Renderer::getLastFrameStats();
+    REQUIRE(stats.numExtractedItems == EZ_ARRAY_SIZE(sprites));
+    REQUIRE(stats.numExtractedSprites == EZ_ARRAY_SIZE(sprites));
+    REQUIRE(stats.extractionByteCount > 0);
+
+    // Each sprite is a quad, however many draw calls it takes.
+    REQUIRE(stats.numDrawCalls > 0);
+    REQUIRE(stats.numPrimitives == 2 * EZ_ARRAY_SIZE(sprites));
+    REQUIRE(stats.numShaderChanges > 0);
+    REQUIRE(stats.getNumStateChanges() >= stats.numShaderChanges);
+  }
+
+  SECTION("History")
+  {
+    // Only the last 4 frames are kept.
+    REQUIRE(Renderer::getStatsHistoryCount() == 4);
+    REQUIRE(Renderer::getStatsHistory(0).numDrawCalls == Renderer::getLastFrameStats().numDrawCalls);
+
+    auto summary = Renderer::getStatSummary(RendererStat::ExtractedSprites);
+    REQUIRE(summary.numFrames == 4);
+    REQUIRE(summary.min == EZ_ARRAY_SIZE(sprites));
+    REQUIRE(summary.max == EZ_ARRAY_SIZE(sprites));
+
+    auto timeSummary = Renderer::getStatSummary(RendererStat::DrawTime);
+    REQUIRE(timeSummary.min <= timeSummary.average);
+    REQUIRE(timeSummary.average <= timeSummary.max);
+
+    Renderer::clearStatsHistory();
+    REQUIRE(Renderer::getStatsHistoryCount() == 0);
+  }
+}
@@ -0,0 +1,79 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/samplerCache.h>
+#include <krEngine/rendering/window.h>
+
+#include <limits>
+
+TEST_CASE("Sampler Caching", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  SamplerDesc desc;
+  desc.filtering = TextureFiltering::Linear;
+  desc.wrapping = TextureWrapping::ClampToEdge;
+
+  auto pSampler = SamplerCache::get(desc);
+  REQUIRE(pSampler != nullptr);
+  REQUIRE(pSampler->getDesc() == desc);
+  REQUIRE(SamplerCache::getCount() == 1u);
+
+  SECTION("Same State Is Shared")
+  {
+    auto pOther = SamplerCache::get(desc);
+    REQUIRE(pOther == pSampler);
+    REQUIRE(pOther->getGlHandle() == pSampler->getGlHandle());
+    REQUIRE(SamplerCache::getCount() == 1u);
+  }
+
+  SECTION("Different State Is Not Shared")
+  {
+    auto biasedDesc = desc;
+    biasedDesc.lodBias = -0.5f;
+    auto pBiased = SamplerCache::get(biasedDesc);
+    REQUIRE(pBiased != pSampler);
+    REQUIRE(pBiased->getLodBias() == -0.5f);
+
+    auto anisotropicDesc = desc;
+    anisotropicDesc.maxAnisotropy = 8.0f;
+    auto pAnisotropic = SamplerCache::get(anisotropicDesc);
+    REQUIRE(pAnisotropic != pSampler);
+    REQUIRE(pAnisotropic != pBiased);
+
+    REQUIRE(SamplerCache::getCount() == 3u);
+  }
+
+  SECTION("Equivalent States Are Shared")
+  {
+    // Anything below 1 disables anisotropic filtering, just like 1.
+    auto zeroDesc = desc;
+    zeroDesc.maxAnisotropy = 0.0f;
+    REQUIRE(SamplerCache::get(zeroDesc) == pSampler);
+
+    auto nanDesc = desc;
+    nanDesc.maxAnisotropy = std::numeric_limits<float>::quiet_NaN();
+    nanDesc.lodBias = std::numeric_limits<float>::quiet_NaN();
+    REQUIRE(SamplerCache::get(nanDesc) == pSampler);
+
+    auto negativeZeroDesc = desc;
+    negativeZeroDesc.lodBias = -0.0f;
+    REQUIRE(SamplerCache::get(negativeZeroDesc) == pSampler);
+
+    REQUIRE(SamplerCache::getCount() == 1u);
+  }
+
+  SECTION("Created Samplers Are Not Shared")
+  {
+    auto pOwned = Sampler::create(desc);
+    REQUIRE(pOwned != nullptr);
+    REQUIRE(pOwned->getGlHandle() != pSampler->getGlHandle());
+    REQUIRE(pOwned->getDesc() == desc);
+  }
+}
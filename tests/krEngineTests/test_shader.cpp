@@ -4,6 +4,10 @@
 #include <krEngine/rendering/window.h>
 #include <krEngine/rendering/shader.h>
 
+#include <Foundation/IO/FileSystem/FileReader.h>
+#include <Foundation/IO/FileSystem/FileWriter.h>
+#include <Foundation/Threading/ThreadUtils.h>
+
 TEST_CASE("Vertex Shader", "[shader]")
 {
   using namespace kr;
@@ -79,6 +83,153 @@ TEST_CASE("Shader Program", "[shader]")
     REQUIRE(shader != nullptr);
   }
 
+  SECTION("Reflection")
+  {
+    auto shader = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+    REQUIRE(shader != nullptr);
+
+    auto index = shader->findUniform("u_color");
+    REQUIRE(index != ezInvalidIndex);
+
+    auto& uniform = shader->m_uniforms[index];
+    REQUIRE(uniform.name == "u_color");
+    REQUIRE(uniform.glType == GL_FLOAT_VEC3);
+    REQUIRE(uniform.arraySize == 1);
+    REQUIRE(uniform.glLocation == glGetUniformLocation(shader->getGlHandle(), "u_color"));
+
+    REQUIRE(shader->findUniform("u_doesNotExist") == ezInvalidIndex);
+    REQUIRE(shader->findUniformBlock("u_doesNotExist") == nullptr);
+
+    auto uColor = shaderUniformOf(shader, "u_color");
+    REQUIRE(uColor.isValid());
+    REQUIRE(uColor.index == index);
+
+#if EZ_ENABLED(EZ_COMPILE_FOR_DEVELOPMENT)
+    // u_color is a vec3, so a color does not fit.
+    REQUIRE(uploadData(uColor, ezColor(1.0f, 0.0f, 0.0f)).Failed());
+#endif
+  }
+
+  SECTION("Program Binary Cache")
+  {
+    setProgramBinaryCacheDirectory("<output>shaderCache/");
+    KR_ON_SCOPE_EXIT{ setProgramBinaryCacheDirectory(""); };
+    resetProgramBinaryCacheStats();
+
+    // Either compiles and stores the binary, or finds it from a previous run.
+    auto first = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+    REQUIRE(first != nullptr);
+
+    auto stats = getProgramBinaryCacheStats();
+    if (stats.numStored + stats.numHits > 0)
+    {
+      auto second = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+      REQUIRE(second != nullptr);
+      REQUIRE(getProgramBinaryCacheStats().numHits == stats.numHits + 1);
+    }
+    else
+    {
+      WARN("The driver does not support program binaries.");
+    }
+  }
+
+  SECTION("Reload")
+  {
+    auto readFile = [](const char* fileName, ezStringBuilder& out_content)
+    {
+      ezFileReader reader;
+      REQUIRE(reader.Open(fileName).Succeeded());
+      out_content.ReadAll(reader);
+    };
+
+    auto writeFile = [](const char* fileName, const ezStringBuilder& content)
+    {
+      ezFileWriter writer;
+      REQUIRE(writer.Open(fileName).Succeeded());
+      REQUIRE(writer.WriteBytes(content.GetData(), content.GetElementCount()).Succeeded());
+    };
+
+    ezStringBuilder vsCode;
+    ezStringBuilder fsCode;
+    readFile("<shader>Valid.vs", vsCode);
+    readFile("<shader>Valid.fs", fsCode);
+    writeFile("<output>reload.vs", vsCode);
+    writeFile("<output>reload.fs", fsCode);
+
+    auto shader = ShaderProgram::loadAndLink("<output>reload.vs", "<output>reload.fs");
+    REQUIRE(shader != nullptr);
+    REQUIRE(shader->isReloadable());
+
+    auto uColor = shaderUniformOf(shader, "u_color");
+    REQUIRE(uColor.isValid());
+
+    // A new uniform declared before u_color is likely to shift its location.
+    fsCode.ReplaceAll("uniform vec3 u_color;", "uniform vec4 u_tint;\nuniform vec3 u_color;");
+    fsCode.ReplaceAll("+ fs_color;", "* u_tint + fs_color;");
+    writeFile("<output>reload.fs", fsCode);
+
+    auto hOldProgram = shader->getGlHandle();
+    REQUIRE(shader->reload().Succeeded());
+    REQUIRE(shader->getGlHandle() != hOldProgram);
+
+    REQUIRE(uColor.isValid());
+    REQUIRE(uColor.getGlLocation() == glGetUniformLocation(shader->getGlHandle(), "u_color"));
+    REQUIRE(shader->findUniform("u_tint") != ezInvalidIndex);
+
+    SECTION("Broken Sources Keep the Old Program")
+    {
+      ezStringBuilder invalidCode;
+      readFile("<shader>Invalid.fs", invalidCode);
+      writeFile("<output>reload.fs", invalidCode);
+
+      auto hProgram = shader->getGlHandle();
+      REQUIRE(shader->reload().Failed());
+      REQUIRE(shader->getGlHandle() == hProgram);
+    }
+  }
+
+  SECTION("Hot Reload")
+  {
+    auto writeFile = [](const char* fileName, const ezStringBuilder& content)
+    {
+      ezFileWriter writer;
+      REQUIRE(writer.Open(fileName).Succeeded());
+      REQUIRE(writer.WriteBytes(content.GetData(), content.GetElementCount()).Succeeded());
+    };
+
+    ezStringBuilder fsCode;
+    {
+      ezFileReader reader;
+      REQUIRE(reader.Open("<shader>Valid.fs").Succeeded());
+      fsCode.ReadAll(reader);
+    }
+    writeFile("<output>hotReload.fs", fsCode);
+
+    setShaderHotReloadEnabled(true);
+    KR_ON_SCOPE_EXIT{ setShaderHotReloadEnabled(false); };
+
+    auto shader = ShaderProgram::loadAndLink("<shader>Valid.vs", "<output>hotReload.fs");
+    REQUIRE(shader != nullptr);
+    auto hOldProgram = shader->getGlHandle();
+
+    // Let the watcher see the file first, and make sure the modification time changes.
+    ezThreadUtils::Sleep(1100);
+    REQUIRE(reloadChangedShaders() == 0);
+
+    fsCode.ReplaceAll("+ fs_color;", "* 0.5 + fs_color;");
+    writeFile("<output>hotReload.fs", fsCode);
+
+    ezUInt32 numReloaded = 0;
+    for (ezUInt32 attempt = 0; attempt < 50 && numReloaded == 0; ++attempt)
+    {
+      ezThreadUtils::Sleep(100);
+      numReloaded = reloadChangedShaders();
+    }
+
+    REQUIRE(numReloaded == 1);
+    REQUIRE(shader->getGlHandle() != hOldProgram);
+  }
+
   SECTION("Attributes")
   {
     auto vs = VertexShader::loadAndCompile("<shader>Valid.vs");
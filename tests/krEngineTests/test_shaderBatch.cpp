@@ -0,0 +1,54 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/shaderBatch.h>
+#include <krEngine/rendering/window.h>
+
+TEST_CASE("Shader Batch", "[shader]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  ShaderDefines tinted;
+  tinted.set("KR_TINT");
+
+  ShaderBatch batch;
+  auto valid   = batch.add("<shader>Valid.vs", "<shader>Valid.fs");
+  auto variant = batch.add("<shader>Valid.vs", "<shader>preprocessor/includes.fs", tinted);
+  auto invalid = batch.add("<shader>Valid.vs", "<shader>Invalid.fs");
+  auto missing = batch.add("<shader>Valid.vs", "<shader>doesNotExist.fs");
+  REQUIRE(batch.getCount() == 4u);
+
+  REQUIRE_FALSE(batch.isReady());
+  batch.submit();
+
+  SECTION("Polling")
+  {
+    // Never blocks, so the driver may still be busy. It has to finish eventually though.
+    for (int i = 0; i < 10000 && !batch.isReady(); ++i)
+    {
+    }
+
+    REQUIRE(batch.finish() == 2u);
+    REQUIRE(batch.isReady());
+  }
+
+  auto pValid = batch.take(valid);
+  REQUIRE(pValid != nullptr);
+  REQUIRE(pValid->findUniform("u_color") != ezInvalidIndex);
+
+  auto pVariant = batch.take(variant);
+  REQUIRE(pVariant != nullptr);
+  REQUIRE(pVariant->m_defines == tinted);
+
+  REQUIRE(batch.take(invalid) == nullptr);
+  REQUIRE(batch.take(missing) == nullptr);
+
+  // Programs are handed out only once.
+  REQUIRE(batch.take(valid) == nullptr);
+}
@@ -0,0 +1,197 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/shaderPreprocessor.h>
+#include <krEngine/rendering/shaderVariantCache.h>
+#include <krEngine/rendering/sprite.h>
+#include <krEngine/rendering/window.h>
+
+#include <Foundation/IO/FileSystem/FileReader.h>
+#include <Foundation/IO/FileSystem/FileWriter.h>
+
+TEST_CASE("Shader Defines", "[shader]")
+{
+  using namespace kr;
+
+  ShaderDefines a;
+  a.set("KR_TINT").set("KR_COUNT", "4");
+
+  ShaderDefines b;
+  b.set("KR_COUNT", "2").set("KR_TINT").set("KR_COUNT", "4");
+
+  // Order of definition does not matter.
+  REQUIRE(a.getCount() == 2u);
+  REQUIRE(a == b);
+  REQUIRE(a.getHash() == b.getHash());
+
+  b.set("KR_COUNT", "8");
+  REQUIRE(a != b);
+  REQUIRE(a.getHash() != b.getHash());
+}
+
+TEST_CASE("Shader Preprocessor", "[shader]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  ezStringBuilder source;
+  ezDynamicArray<ezString> files;
+
+  SECTION("Includes")
+  {
+    ShaderDefines defines;
+    defines.set("KR_TINT");
+
+    REQUIRE(preprocessShader("<shader>preprocessor/includes.fs", defines, source, &files).Succeeded());
+
+    REQUIRE(files.GetCount() == 2u);
+    REQUIRE(files[0] == "<shader>preprocessor/includes.fs");
+    REQUIRE(files[1] == "<shader>preprocessor/common.glsl");
+
+    // The version stays first, followed by the defines.
+    REQUIRE(source.StartsWith("#version 150\n#define KR_TINT 1\n"));
+
+    // "#pragma once" prevents the second include.
+    auto pFirst = source.FindSubString("vec4 krTint");
+    REQUIRE(pFirst != nullptr);
+    REQUIRE(source.FindSubString("vec4 krTint", pFirst + 1) == nullptr);
+
+    REQUIRE(source.FindSubString("#include") == nullptr);
+  }
+
+  SECTION("Includes in Inactive Branches")
+  {
+    ShaderDefines defines;
+    defines.set("KR_TINT");
+
+    REQUIRE(preprocessShader("<shader>preprocessor/conditional.fs", defines, source, &files).Succeeded());
+
+    REQUIRE(files.GetCount() == 2u);
+    REQUIRE(files[1] == "<shader>preprocessor/common.glsl");
+
+    // The conditionals themselves are left to the compiler.
+    REQUIRE(source.FindSubString("#ifdef KR_MISSING") != nullptr);
+
+    // Without the define, the #else and #ifndef branches are active.
+    REQUIRE(preprocessShader("<shader>preprocessor/conditional.fs", ShaderDefines(), source).Failed());
+  }
+
+  SECTION("Circular Includes")
+  {
+    REQUIRE(preprocessShader("<shader>preprocessor/cycleA.glsl", ShaderDefines(), source).Failed());
+  }
+
+  SECTION("Missing Include")
+  {
+    REQUIRE(preprocessShader("<shader>preprocessor/missing.fs", ShaderDefines(), source).Failed());
+  }
+}
+
+TEST_CASE("Shader Variant Caching", "[shader]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  ShaderVariantCache::resetStats();
+
+  const char* vs = "<shader>Valid.vs";
+  const char* fs = "<shader>preprocessor/includes.fs";
+
+  auto pPlain = ShaderVariantCache::get(vs, fs);
+  REQUIRE(pPlain != nullptr);
+  REQUIRE(ShaderVariantCache::getCount() == 1u);
+
+  ShaderDefines tinted;
+  tinted.set("KR_TINT");
+
+  auto pTinted = ShaderVariantCache::get(vs, fs, tinted);
+  REQUIRE(pTinted != nullptr);
+  REQUIRE(pTinted != pPlain);
+  REQUIRE(ShaderVariantCache::getCount() == 2u);
+
+  SECTION("Each Variant Is Built Once")
+  {
+    REQUIRE(ShaderVariantCache::get(vs, fs) == pPlain);
+    REQUIRE(ShaderVariantCache::get(vs, fs, tinted) == pTinted);
+    REQUIRE(ShaderVariantCache::getCount() == 2u);
+
+    auto stats = ShaderVariantCache::getStats();
+    REQUIRE(stats.numRequests == 4u);
+    REQUIRE(stats.numBuilds == 2u);
+    REQUIRE(stats.numNameHits == 2u);
+    REQUIRE(stats.getNumBuildsSaved() == 2u);
+  }
+
+  SECTION("Identical Sources Are Shared")
+  {
+    auto pValid = ShaderVariantCache::get(vs, "<shader>Valid.fs");
+    REQUIRE(pValid != nullptr);
+
+    // Same content under a different name.
+    auto pCopy = ShaderVariantCache::get(vs, "<shader>preprocessor/validCopy.fs");
+    REQUIRE(pCopy == pValid);
+    REQUIRE(ShaderVariantCache::getCount() == 3u);
+    REQUIRE(ShaderVariantCache::getStats().numSourceHits == 1u);
+
+    // Defines that are not present in the sources still change them.
+    ShaderDefines unused;
+    unused.set("KR_UNUSED");
+    REQUIRE(ShaderVariantCache::get(vs, "<shader>Valid.fs", unused) != pValid);
+  }
+
+  SECTION("Shared Programs Follow Their Sources")
+  {
+    auto writeFile = [](const char* fileName, const ezStringBuilder& content)
+    {
+      ezFileWriter writer;
+      REQUIRE(writer.Open(fileName).Succeeded());
+      REQUIRE(writer.WriteBytes(content.GetData(), content.GetElementCount()).Succeeded());
+    };
+
+    ezStringBuilder fsCode;
+    {
+      ezFileReader reader;
+      REQUIRE(reader.Open("<shader>Valid.fs").Succeeded());
+      fsCode.ReadAll(reader);
+    }
+    writeFile("<output>sharedA.fs", fsCode);
+    writeFile("<output>sharedB.fs", fsCode);
+
+    auto pShared = ShaderVariantCache::get(vs, "<output>sharedA.fs");
+    REQUIRE(pShared != nullptr);
+    REQUIRE(ShaderVariantCache::get(vs, "<output>sharedB.fs") == pShared);
+
+    // The shared program is built from A, so B no longer matches it.
+    fsCode.ReplaceAll("+ fs_color;", "* 0.5 + fs_color;");
+    writeFile("<output>sharedA.fs", fsCode);
+    REQUIRE(pShared->reload().Succeeded());
+
+    REQUIRE(ShaderVariantCache::get(vs, "<output>sharedA.fs") == pShared);
+
+    auto pSplit = ShaderVariantCache::get(vs, "<output>sharedB.fs");
+    REQUIRE(pSplit != nullptr);
+    REQUIRE(pSplit != pShared);
+
+    // The old sources must not be found under the reloaded program either.
+    REQUIRE(ShaderVariantCache::get(vs, "<shader>Valid.fs") == pSplit);
+  }
+
+  SECTION("Default Sprite Shader Is Shared")
+  {
+    auto pShader = Sprite::getDefaultShader();
+    REQUIRE(pShader != nullptr);
+    REQUIRE(Sprite::getDefaultShader() == pShader);
+  }
+
+  SECTION("Broken Variants Are Not Cached")
+  {
+    REQUIRE(ShaderVariantCache::get(vs, "<shader>Invalid.fs") == nullptr);
+    REQUIRE(ShaderVariantCache::getCount() == 2u);
+  }
+}
@@ -3,9 +3,13 @@
 
 #include <krEngine/transform2D.h>
 #include <krEngine/rendering.h>
+#include <krEngine/rendering/implementation/extractionDetails.h>
 
 #include <CoreUtils/Graphics/Camera.h>
 
+#include <Foundation/Threading/Thread.h>
+#include <Foundation/Threading/ThreadUtils.h>
+
 TEST_CASE("Workflow", "[sprite]")
 {
   using namespace kr;
@@ -33,7 +37,7 @@ TEST_CASE("Workflow", "[sprite]")
   REQUIRE_FALSE(canRender(sprite));
   sprite.setLocalBounds(ezRectFloat(0, 0, 128, 128));
   initialize(sprite, tex, sampler, shader);
-  sprite.getSampler()->setFiltering(TextureFiltering::Nearest);
+  sampler->setFiltering(TextureFiltering::Nearest);
 
   // Handle the close-event of the window.
   bool run = true;
@@ -66,3 +70,303 @@ TEST_CASE("Workflow", "[sprite]")
     Renderer::update(dt, pWindow);
   }
 }
+
+TEST_CASE("Deferred Updates", "[sprite]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  auto tex = Texture::load("<texture>test_4x4.bmp");
+  auto sampler = Sampler::create();
+  auto shader = Sprite::createDefaultShader();
+
+  Sprite sprite;
+  REQUIRE(initialize(sprite, tex, sampler, shader).Succeeded());
+
+  // Nothing happens before the next frame boundary.
+  REQUIRE(sprite.needsUpdate());
+  REQUIRE(sprite.getVertexBuffer() == nullptr);
+
+  Renderer::update(ezTime(), pWindow);
+
+  REQUIRE_FALSE(sprite.needsUpdate());
+  REQUIRE(sprite.getVertexBuffer() != nullptr);
+  REQUIRE(sprite.getCutout().width == 4u);
+  REQUIRE(sprite.getCutout().height == 4u);
+
+  SECTION("Copies get their own vertex buffer")
+  {
+    Sprite copy(sprite);
+    REQUIRE(copy.getVertexBuffer() == nullptr);
+
+    Renderer::update(ezTime(), pWindow);
+
+    REQUIRE(copy.getVertexBuffer() != nullptr);
+    REQUIRE(copy.getVertexBuffer() != sprite.getVertexBuffer());
+  }
+
+  SECTION("Failed textures leave the cutout alone")
+  {
+    auto pFailed = Texture::loadAsync("<GetOuttaHere!>I do not exist.nope");
+    REQUIRE(pFailed != nullptr);
+    sprite.setTexture(pFailed);
+
+    for (int frame = 0; frame < 1000 && pFailed->getLoadState() == TextureLoadState::Loading; ++frame)
+    {
+      ezThreadUtils::Sleep(1);
+      Renderer::update(ezTime(), pWindow);
+    }
+    REQUIRE(pFailed->getLoadState() == TextureLoadState::Failed);
+
+    Renderer::update(ezTime(), pWindow);
+
+    // The 0x0 texture is not used to compute texture coordinates.
+    REQUIRE(sprite.needsUpdate());
+    REQUIRE(sprite.getCutout().width == 4u);
+    REQUIRE(sprite.getCutout().height == 4u);
+
+    sprite.setTexture(tex);
+  }
+
+  SECTION("Mutating from another thread")
+  {
+    class BoundsChanger : public ezThread
+    {
+    public:
+      explicit BoundsChanger(Sprite& sprite) : ezThread("Bounds Changer"), m_sprite(sprite) {}
+
+      ezUInt32 Run() override
+      {
+        for (ezUInt32 i = 1; i <= 1000; ++i)
+        {
+          m_sprite.setLocalBounds(ezRectFloat(0.0f, 0.0f, float(i), float(i)));
+        }
+        return 0;
+      }
+
+      Sprite& m_sprite;
+    };
+
+    BoundsChanger changer(sprite);
+    changer.Start();
+
+    // Process the queue while the other thread keeps changing the sprite.
+    while (changer.IsRunning())
+    {
+      Renderer::update(ezTime(), pWindow);
+    }
+    changer.Join();
+
+    Renderer::update(ezTime(), pWindow);
+
+    REQUIRE_FALSE(sprite.needsUpdate());
+    REQUIRE(sprite.getLocalBounds().width == 1000.0f);
+    REQUIRE(sprite.getVertices()[3].pos == ezVec2(1000.0f, 1000.0f));
+  }
+}
+
+TEST_CASE("Draw Order", "[sprite]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  auto tex = Texture::load("<texture>test_4x4.bmp");
+  auto shader = Sprite::getDefaultShader();
+  auto samplerA = Sampler::create();
+  auto samplerB = Sampler::create();
+
+  Sprite sprites[4];
+  DrawOrder orders[4];
+  ezUInt32 numSprites = 0;
+
+  auto add = [&](bool isTranslucent, ezUInt8 layer, float depth, const Owned<Sampler>& sampler)
+  {
+    auto& sprite = sprites[numSprites];
+    REQUIRE(initialize(sprite, tex, sampler, shader).Succeeded());
+    sprite.setTranslucent(isTranslucent);
+    orders[numSprites] = DrawOrder(layer, depth);
+    ++numSprites;
+  };
+
+  Renderer::ExtractionEventListener listener = [&](Renderer::Extractor& e)
+  {
+    for (ezUInt32 i = 0; i < numSprites; ++i)
+    {
+      extract(e, sprites[i], Transform2D::zero(), orders[i]);
+    }
+  };
+  Renderer::addExtractionListener(listener);
+  KR_ON_SCOPE_EXIT{ Renderer::removeExtractionListener(listener); };
+
+  // Every run of sprites with the same state is a single multi-draw call.
+  auto countDrawCalls = [&pWindow]()
+  {
+    // Once to create the vertex buffers, once to draw with them.
+    for (int frame = 0; frame < 2; ++frame)
+    {
+      Renderer::extract();
+      Renderer::update(ezTime(), pWindow);
+    }
+
+    REQUIRE(glGetError() == GL_NO_ERROR);
+    return Renderer::getLastFrameStats().numDrawCalls;
+  };
+
+  SECTION("Layers Do Not Overlap")
+  {
+    REQUIRE(toNormalizedDepth(DrawOrder(1, 1.0f)) < toNormalizedDepth(DrawOrder(0, 0.0f)));
+    REQUIRE(toNormalizedDepth(DrawOrder(0, 1.0f)) < 1.0f);
+    REQUIRE(toNormalizedDepth(DrawOrder(255, 0.0f)) == 0.0f);
+  }
+
+  SECTION("Opaque Sprites Are Grouped by State")
+  {
+    // Alternating samplers, extracted front-to-back.
+    add(false, 0, 0.1f, samplerA);
+    add(false, 0, 0.3f, samplerB);
+    add(false, 0, 0.5f, samplerA);
+    add(false, 0, 0.7f, samplerB);
+
+    REQUIRE(countDrawCalls() == 2);
+  }
+
+  SECTION("Opaque Runs Are Not Split by Layers")
+  {
+    add(false, 1, 0.9f, samplerA);
+    add(false, 0, 0.1f, samplerA);
+
+    REQUIRE(countDrawCalls() == 1);
+  }
+
+  SECTION("Translucent Sprites Keep Their Order")
+  {
+    // Back-to-front this is B, A, A, B.
+    // Grouping them by state would need only two draw calls, but break the blending.
+    add(true, 1, 0.2f, samplerA);
+    add(true, 0, 0.8f, samplerB);
+    add(true, 1, 0.7f, samplerA);
+    add(true, 1, 0.2f, samplerB);
+
+    REQUIRE(countDrawCalls() == 3);
+  }
+}
+
+TEST_CASE("Texture Array Batches", "[sprite]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  const char* fileNames[] = { "<texture>test_4x4.bmp", "<texture>test_4x4.bmp" };
+  auto tex = Texture::loadArray(ezMakeArrayPtr(fileNames));
+  auto sampler = Sampler::create();
+  auto shader = Sprite::createDefaultArrayShader();
+  REQUIRE(shader != nullptr);
+
+  Sprite sprites[4];
+  for (ezUInt32 i = 0; i < EZ_ARRAY_SIZE(sprites); ++i)
+  {
+    REQUIRE(initialize(sprites[i], tex, sampler, shader).Succeeded());
+    sprites[i].setTextureLayer(i % 2);
+  }
+
+  REQUIRE(sprites[1].getTextureLayer() == 1u);
+
+  Sprite copy(sprites[1]);
+  REQUIRE(copy.getTextureLayer() == 1u);
+
+  Renderer::ExtractionEventListener listener = [&sprites](Renderer::Extractor& e)
+  {
+    for (ezUInt32 i = 0; i < EZ_ARRAY_SIZE(sprites); ++i)
+    {
+      auto t = Transform2D::zero();
+      t.position = ezVec2(float(i) * 8.0f, 0.0f);
+      extract(e, sprites[i], t);
+    }
+  };
+  Renderer::addExtractionListener(listener);
+  KR_ON_SCOPE_EXIT{ Renderer::removeExtractionListener(listener); };
+
+  // Once to create the vertex buffers, once to draw with them.
+  for (int frame = 0; frame < 2; ++frame)
+  {
+    Renderer::extract();
+    Renderer::update(ezTime(), pWindow);
+  }
+
+  REQUIRE(glGetError() == GL_NO_ERROR);
+
+  // Every sprite is an instance of the same quad, regardless of its layer.
+  auto stats = Renderer::getLastFrameStats();
+  REQUIRE(stats.numDrawCalls == 1);
+  REQUIRE(stats.numPrimitives == 2 * EZ_ARRAY_SIZE(sprites));
+}
+
+TEST_CASE("Multi-Draw", "[sprite]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  // Reads the same data per instance, so it is a different program.
+  auto shader = Sprite::getDefaultShader();
+  auto multiDrawShader = Sprite::getDefaultMultiDrawShader();
+  REQUIRE(multiDrawShader != nullptr);
+  REQUIRE(multiDrawShader->findAttribute(ShaderUniformName("vs_drawTransform")) != nullptr);
+  REQUIRE(multiDrawShader->findAttribute(ShaderUniformName("vs_drawColor")) != nullptr);
+
+  auto tex = Texture::load("<texture>test_4x4.bmp");
+  auto sampler = Sampler::create();
+
+  // Sprites sharing shader, texture and sampler form a single run.
+  Sprite sprites[8];
+  for (ezUInt32 i = 0; i < EZ_ARRAY_SIZE(sprites); ++i)
+  {
+    REQUIRE(initialize(sprites[i], tex, sampler, shader).Succeeded());
+    sprites[i].setColor(ezColor(1.0f, float(i) / 8.0f, 0.0f));
+  }
+
+  Renderer::ExtractionEventListener listener = [&sprites](Renderer::Extractor& e)
+  {
+    for (ezUInt32 i = 0; i < EZ_ARRAY_SIZE(sprites); ++i)
+    {
+      auto t = Transform2D::zero();
+      t.position = ezVec2(float(i) * 8.0f, 0.0f);
+      extract(e, sprites[i], t);
+    }
+  };
+  Renderer::addExtractionListener(listener);
+  KR_ON_SCOPE_EXIT{ Renderer::removeExtractionListener(listener); };
+
+  // Once to create the vertex buffers, once to draw with them.
+  for (int frame = 0; frame < 2; ++frame)
+  {
+    Renderer::extract();
+    Renderer::update(ezTime(), pWindow);
+  }
+
+  REQUIRE(glGetError() == GL_NO_ERROR);
+
+  // All quads live in the same pooled page, so a single call draws them all.
+  auto stats = Renderer::getLastFrameStats();
+  REQUIRE(stats.numDrawCalls == 1);
+  REQUIRE(stats.numPrimitives == 2 * EZ_ARRAY_SIZE(sprites));
+}
@@ -3,6 +3,9 @@
 
 #include <krEngine/rendering/texture.h>
 #include <krEngine/rendering/window.h>
+#include <krEngine/rendering/renderer.h>
+
+#include <Foundation/Threading/ThreadUtils.h>
 
 TEST_CASE("Loading", "[texture]")
 {
@@ -57,3 +60,404 @@ TEST_CASE("Data Access", "[texture]")
     REQUIRE(pTex->getHeight() == 4u);
   }
 }
+
+TEST_CASE("Residency", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  TextureLoadOptions options;
+
+  SECTION("Keep")
+  {
+    options.residency = TextureResidency::Keep;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetDataSize() == pTex->getByteCount());
+  }
+
+  SECTION("Drop After Upload")
+  {
+    options.residency = TextureResidency::DropAfterUpload;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetWidth() == 0u);
+
+    // Metadata is still there.
+    REQUIRE(pTex->getWidth() == 512u);
+    REQUIRE(pTex->getHeight() == 512u);
+    REQUIRE(pTex->getNumMipLevels() == 1u);
+    REQUIRE(pTex->getByteCount() == 512u * 512u * 4u);
+  }
+
+  SECTION("Metadata Only")
+  {
+    options.residency = TextureResidency::MetadataOnly;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetWidth() == 512u);
+    REQUIRE(pTex->getImage().GetImageFormat() == pTex->getFormat());
+    REQUIRE(pTex->getWidth() == 512u);
+  }
+}
+
+TEST_CASE("Formats", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  SECTION("Uncompressed DDS")
+  {
+    auto pTex = Texture::load("<texture>kitten.dds");
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getWidth() == 512u);
+    REQUIRE(pTex->getHeight() == 512u);
+  }
+
+  SECTION("BC1 With Mip Chain")
+  {
+    auto pTex = Texture::load("<texture>test_8x8_bc1_mips.dds");
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetNumMipLevels() == 4u);
+
+    // All levels must have been uploaded.
+    Borrowed<const Texture> pBound = borrow(pTex);
+    KR_RAII_BIND_TEXTURE_2D(pBound, TextureSlot(0));
+
+    GLint maxLevel = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    REQUIRE(maxLevel == 3);
+
+    GLint smallestWidth = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 3, GL_TEXTURE_WIDTH, &smallestWidth);
+    REQUIRE(smallestWidth == 1);
+  }
+}
+
+TEST_CASE("Texture Arrays", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  SECTION("Same-Sized Layers")
+  {
+    const char* fileNames[] = { "<texture>test_4x4.bmp", "<texture>test_4x4.bmp" };
+    auto pTex = Texture::loadArray(ezMakeArrayPtr(fileNames));
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->isArray());
+    REQUIRE(pTex->getNumLayers() == 2u);
+    REQUIRE(pTex->getWidth() == 4u);
+    REQUIRE(pTex->getHeight() == 4u);
+  }
+
+  SECTION("Mismatching Layers")
+  {
+    const char* fileNames[] = { "<texture>test_4x4.bmp", "<texture>kitten.dds" };
+    auto pTex = Texture::loadArray(ezMakeArrayPtr(fileNames));
+    REQUIRE(pTex == nullptr);
+  }
+
+  SECTION("Regular Textures Are No Arrays")
+  {
+    auto pTex = Texture::load("<texture>test_4x4.bmp");
+    REQUIRE(pTex != nullptr);
+    REQUIRE_FALSE(pTex->isArray());
+    REQUIRE(pTex->getNumLayers() == 1u);
+  }
+}
+
+TEST_CASE("Mip Generation", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  auto getMaxLevel = [](Owned<Texture>& pTex)
+  {
+    Borrowed<const Texture> pBound = borrow(pTex);
+    KR_RAII_BIND_TEXTURE_2D(pBound, TextureSlot(0));
+
+    GLint maxLevel = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    return maxLevel;
+  };
+
+  TextureLoadOptions options;
+
+  SECTION("None")
+  {
+    options.mipGeneration = TextureMipGeneration::None;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetNumMipLevels() == 1u);
+    REQUIRE(getMaxLevel(pTex) == 0);
+  }
+
+  SECTION("GPU")
+  {
+    options.mipGeneration = TextureMipGeneration::Gpu;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+
+    // 512x512 down to 1x1.
+    REQUIRE(pTex->getImage().GetNumMipLevels() == 1u);
+    REQUIRE(getMaxLevel(pTex) == 9);
+  }
+
+  SECTION("Box")
+  {
+    options.mipGeneration = TextureMipGeneration::Box;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetNumMipLevels() == 10u);
+    REQUIRE(pTex->getImage().GetWidth(9) == 1u);
+    REQUIRE(getMaxLevel(pTex) == 9);
+  }
+
+  SECTION("Kaiser")
+  {
+    options.mipGeneration = TextureMipGeneration::Kaiser;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetNumMipLevels() == 10u);
+    REQUIRE(getMaxLevel(pTex) == 9);
+  }
+
+  SECTION("Mip Levels From File Are Kept")
+  {
+    options.mipGeneration = TextureMipGeneration::Box;
+    auto pTex = Texture::load("<texture>test_8x8_bc1_mips.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getImage().GetNumMipLevels() == 4u);
+  }
+}
+
+TEST_CASE("Asynchronous Loading", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  // Renders frames until the texture is no longer loading or we give up.
+  auto waitFor = [&](const Texture& tex)
+  {
+    for (int frame = 0; frame < 1000 && tex.getLoadState() == TextureLoadState::Loading; ++frame)
+    {
+      ezThreadUtils::Sleep(1);
+      Renderer::update(ezTime(), pWindow);
+    }
+  };
+
+  SECTION("Existing Texture File")
+  {
+    int numCallbacks = 0;
+    ezResult callbackResult = EZ_FAILURE;
+    auto onLoaded = [&](const Texture&, ezResult result)
+    {
+      ++numCallbacks;
+      callbackResult = result;
+    };
+
+    auto pTex = Texture::loadAsync("<texture>test_4x4.bmp", TextureLoadOptions(), onLoaded);
+    REQUIRE(pTex != nullptr);
+
+    waitFor(*pTex);
+
+    REQUIRE(pTex->getLoadState() == TextureLoadState::Loaded);
+    REQUIRE(pTex->getWidth() == 4u);
+    REQUIRE(pTex->getHeight() == 4u);
+    REQUIRE(pTex->getGlHandle() != 0);
+    REQUIRE(numCallbacks == 1);
+    REQUIRE(callbackResult.Succeeded());
+  }
+
+  SECTION("Non-existant Texture File")
+  {
+    auto pTex = Texture::loadAsync("<GetOuttaHere!>I do not exist.nope");
+    REQUIRE(pTex != nullptr);
+
+    waitFor(*pTex);
+
+    REQUIRE(pTex->getLoadState() == TextureLoadState::Failed);
+  }
+
+  SECTION("Release While Loading")
+  {
+    auto pTex = Texture::loadAsync("<texture>test_4x4.bmp");
+    REQUIRE(pTex != nullptr);
+    pTex = nullptr;
+
+    // Must not touch the released texture.
+    Renderer::update(ezTime(), pWindow);
+  }
+}
+
+TEST_CASE("Memory Budget", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  auto pKitten = Texture::load("<texture>kitten.dds");
+  auto pSmall = Texture::load("<texture>test_4x4.bmp");
+  REQUIRE(pKitten != nullptr);
+  REQUIRE(pSmall != nullptr);
+
+  // 512x512 pixels with 4 bytes each and a single mip level.
+  REQUIRE(pKitten->getGpuByteCount() == 512u * 512u * 4u);
+  REQUIRE(pKitten->isResident());
+
+  SECTION("No Budget")
+  {
+    Renderer::update(ezTime(), pWindow);
+    Renderer::update(ezTime(), pWindow);
+
+    REQUIRE(pKitten->isResident());
+    REQUIRE(pSmall->isResident());
+
+    auto stats = getTextureMemoryStats();
+    REQUIRE(stats.numTextures == 2u);
+    REQUIRE(stats.numResident == 2u);
+    REQUIRE(stats.residentBytes == stats.totalBytes);
+    REQUIRE(stats.evictedBytes == 0u);
+  }
+
+  SECTION("Evict and Reload")
+  {
+    setTextureMemoryBudget(1);
+    KR_ON_SCOPE_EXIT{ setTextureMemoryBudget(0); };
+
+    // Freshly loaded textures count as used in the frame they were loaded in.
+    Renderer::update(ezTime(), pWindow);
+    REQUIRE(pKitten->isResident());
+
+    Renderer::update(ezTime(), pWindow);
+    REQUIRE_FALSE(pKitten->isResident());
+    REQUIRE_FALSE(pSmall->isResident());
+    REQUIRE(pKitten->getWidth() == 512u);
+
+    {
+      Borrowed<const Texture> pBound = borrow(pKitten);
+      KR_RAII_BIND_TEXTURE_2D(pBound, TextureSlot(0));
+      REQUIRE(pKitten->isResident());
+    }
+
+    setTextureMemoryBudget(0);
+    Renderer::update(ezTime(), pWindow);
+
+    auto stats = getTextureMemoryStats();
+    REQUIRE(stats.numEvicted == 2u);
+    REQUIRE(stats.evictedBytes == pKitten->getGpuByteCount() + pSmall->getGpuByteCount());
+    REQUIRE(stats.numReloaded == 1u);
+    REQUIRE(stats.reloadedBytes == pKitten->getGpuByteCount());
+    REQUIRE(stats.residentBytes == pKitten->getGpuByteCount());
+    REQUIRE(stats.totalBytes == stats.evictedBytes);
+  }
+
+  SECTION("Reload From Disk in the Background")
+  {
+    TextureLoadOptions options;
+    options.residency = TextureResidency::DropAfterUpload;
+    auto pDropped = Texture::load("<texture>test_4x4.bmp", options);
+    REQUIRE(pDropped != nullptr);
+
+    setTextureMemoryBudget(1);
+    KR_ON_SCOPE_EXIT{ setTextureMemoryBudget(0); };
+
+    Renderer::update(ezTime(), pWindow);
+    Renderer::update(ezTime(), pWindow);
+    REQUIRE_FALSE(pDropped->isResident());
+
+    {
+      Borrowed<const Texture> pBound = borrow(pDropped);
+      KR_RAII_BIND_TEXTURE_2D(pBound, TextureSlot(0));
+
+      // The image is gone, so the placeholder is bound until the file is decoded again.
+      REQUIRE_FALSE(pDropped->isResident());
+      REQUIRE(pDropped->getLoadState() == TextureLoadState::Loaded);
+    }
+
+    setTextureMemoryBudget(0);
+
+    ezUInt32 numReloaded = 0;
+    for (int frame = 0; frame < 1000 && !pDropped->isResident(); ++frame)
+    {
+      ezThreadUtils::Sleep(1);
+      Renderer::update(ezTime(), pWindow);
+      numReloaded += getTextureMemoryStats().numReloaded;
+    }
+
+    REQUIRE(pDropped->isResident());
+    REQUIRE(numReloaded == 1u);
+    REQUIRE(pDropped->getWidth() == 4u);
+  }
+
+  SECTION("Evicted Arrays Bind the Array Placeholder")
+  {
+    TextureLoadOptions options;
+    options.residency = TextureResidency::DropAfterUpload;
+    const char* fileNames[] = { "<texture>test_4x4.bmp", "<texture>test_4x4.bmp" };
+    auto pArray = Texture::loadArray(ezMakeArrayPtr(fileNames), options);
+    REQUIRE(pArray != nullptr);
+
+    setTextureMemoryBudget(1);
+    KR_ON_SCOPE_EXIT{ setTextureMemoryBudget(0); };
+
+    Renderer::update(ezTime(), pWindow);
+    Renderer::update(ezTime(), pWindow);
+    REQUIRE_FALSE(pArray->isResident());
+    REQUIRE(pArray->isArray());
+
+    {
+      Borrowed<const Texture> pBound = borrow(pArray);
+      KR_RAII_BIND_TEXTURE_2D(pBound, TextureSlot(0));
+
+      GLint hBound = 0;
+      glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &hBound);
+      REQUIRE(hBound != 0);
+      REQUIRE(static_cast<ezUInt32>(hBound) == pArray->getGlHandle());
+      REQUIRE(glGetError() == GL_NO_ERROR);
+    }
+
+    GLint hBound = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &hBound);
+    REQUIRE(hBound == 0);
+
+    setTextureMemoryBudget(0);
+
+    // Don't leave the reload running.
+    for (int frame = 0; frame < 1000 && !pArray->isResident(); ++frame)
+    {
+      ezThreadUtils::Sleep(1);
+      Renderer::update(ezTime(), pWindow);
+    }
+    REQUIRE(pArray->isArray());
+  }
+}
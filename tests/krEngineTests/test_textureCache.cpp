@@ -0,0 +1,140 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/textureCache.h>
+#include <krEngine/rendering/window.h>
+#include <krEngine/rendering/renderer.h>
+
+#include <Foundation/Threading/ThreadUtils.h>
+
+TEST_CASE("Caching", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  TextureCache::unloadUnused();
+  TextureCache::resetStats();
+
+  SECTION("Non-existant Texture File")
+  {
+    auto pTex = TextureCache::load("<GetOuttaHere!>I do not exist.nope");
+    REQUIRE(pTex == nullptr);
+    REQUIRE_FALSE(TextureCache::contains("<GetOuttaHere!>I do not exist.nope"));
+    REQUIRE(TextureCache::getStats().numMisses == 1);
+  }
+
+  SECTION("Failed Asynchronous Loads Are Retried")
+  {
+    const char* fileName = "<GetOuttaHere!>I do not exist.nope";
+
+    {
+      auto pTex = TextureCache::loadAsync(fileName);
+      REQUIRE(pTex != nullptr);
+
+      for (int frame = 0; frame < 1000 && pTex->getLoadState() == TextureLoadState::Loading; ++frame)
+      {
+        ezThreadUtils::Sleep(1);
+        Renderer::update(ezTime(), pWindow);
+      }
+      REQUIRE(pTex->getLoadState() == TextureLoadState::Failed);
+
+      // Still borrowed, so the failed texture is handed out again.
+      auto pSame = TextureCache::loadAsync(fileName);
+      REQUIRE(pSame.pData == pTex.pData);
+      REQUIRE(TextureCache::getStats().numHits == 1);
+    }
+
+    auto pRetry = TextureCache::loadAsync(fileName);
+    REQUIRE(pRetry != nullptr);
+    REQUIRE(pRetry->getLoadState() == TextureLoadState::Loading);
+
+    auto stats = TextureCache::getStats();
+    REQUIRE(stats.numMisses == 2);
+    REQUIRE(stats.numTextures == 1);
+
+    // Don't leave the load running.
+    for (int frame = 0; frame < 1000 && pRetry->getLoadState() == TextureLoadState::Loading; ++frame)
+    {
+      ezThreadUtils::Sleep(1);
+      Renderer::update(ezTime(), pWindow);
+    }
+  }
+
+  SECTION("Same Name Yields Same Texture")
+  {
+    auto pTex1 = TextureCache::load("<texture>test_4x4.bmp");
+    REQUIRE(pTex1 != nullptr);
+    auto pTex2 = TextureCache::load("<texture>test_4x4.bmp");
+    REQUIRE(pTex2 != nullptr);
+
+    REQUIRE(pTex1.pData == pTex2.pData);
+    REQUIRE(pTex1->getGlHandle() == pTex2->getGlHandle());
+
+    auto stats = TextureCache::getStats();
+    REQUIRE(stats.numHits == 1);
+    REQUIRE(stats.numMisses == 1);
+    REQUIRE(stats.numTextures == 1);
+    REQUIRE(stats.getHitRate() == 0.5f);
+  }
+
+  SECTION("Different Options Yield Different Textures")
+  {
+    auto pPlain = TextureCache::load("<texture>test_4x4.bmp");
+    REQUIRE(pPlain != nullptr);
+
+    TextureLoadOptions options;
+    options.mipGeneration = TextureMipGeneration::Box;
+    auto pMipped = TextureCache::load("<texture>test_4x4.bmp", options);
+    REQUIRE(pMipped != nullptr);
+
+    REQUIRE(pPlain.pData != pMipped.pData);
+    REQUIRE(pPlain->getGlHandle() != pMipped->getGlHandle());
+
+    // The priority does not change the content, so it is served from the cache.
+    options.priority = TextureLoadPriority::High;
+    auto pMippedAgain = TextureCache::load("<texture>test_4x4.bmp", options);
+    REQUIRE(pMippedAgain.pData == pMipped.pData);
+
+    auto stats = TextureCache::getStats();
+    REQUIRE(stats.numHits == 1);
+    REQUIRE(stats.numMisses == 2);
+    REQUIRE(stats.numTextures == 2);
+  }
+
+  SECTION("Unused Textures Are Evicted When Over Budget")
+  {
+    auto budget = TextureCache::getBudget();
+    KR_ON_SCOPE_EXIT{ TextureCache::setBudget(budget); };
+
+    {
+      auto pTex = TextureCache::load("<texture>test_4x4.bmp");
+      REQUIRE(pTex != nullptr);
+
+      // Still in use, so it must stay.
+      TextureCache::setBudget(0);
+      REQUIRE(TextureCache::contains("<texture>test_4x4.bmp"));
+    }
+
+    // Unused and over budget.
+    TextureCache::setBudget(0);
+    REQUIRE_FALSE(TextureCache::contains("<texture>test_4x4.bmp"));
+    REQUIRE(TextureCache::getStats().numEvictions == 1);
+  }
+
+  SECTION("Unused Textures Stay Within Budget")
+  {
+    {
+      auto pTex = TextureCache::load("<texture>test_4x4.bmp");
+      REQUIRE(pTex != nullptr);
+    }
+
+    REQUIRE(TextureCache::contains("<texture>test_4x4.bmp"));
+    REQUIRE(TextureCache::unloadUnused() == 1);
+    REQUIRE_FALSE(TextureCache::contains("<texture>test_4x4.bmp"));
+  }
+}
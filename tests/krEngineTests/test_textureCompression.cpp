@@ -0,0 +1,240 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/textureCompression.h>
+#include <krEngine/rendering/window.h>
+
+static ezImage createSolidImage(ezUInt32 width, ezUInt32 height, ezUInt8 r, ezUInt8 g, ezUInt8 b, ezUInt8 a)
+{
+  ezImage image;
+  image.SetWidth(width);
+  image.SetHeight(height);
+  image.SetImageFormat(ezImageFormat::R8G8B8A8_UNORM);
+  image.AllocateImageData();
+
+  auto pPixels = image.GetDataPointer<ezUInt8>();
+  for (ezUInt32 i = 0; i < width * height; ++i)
+  {
+    pPixels[4 * i + 0] = r;
+    pPixels[4 * i + 1] = g;
+    pPixels[4 * i + 2] = b;
+    pPixels[4 * i + 3] = a;
+  }
+
+  return image;
+}
+
+/// \brief Smooth gradients in all channels with a little noise on top.
+static ezImage createGradientImage(ezUInt32 width, ezUInt32 height)
+{
+  auto image = createSolidImage(width, height, 0, 0, 0, 0);
+  auto pPixels = image.GetDataPointer<ezUInt8>();
+
+  // A fixed seed, so failures are reproducible.
+  ezUInt32 seed = 12345;
+  auto noise = [&seed]()
+  {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<int>((seed >> 16) % 17) - 8;
+  };
+
+  auto toByte = [](int value){ return static_cast<ezUInt8>(ezMath::Clamp(value, 0, 255)); };
+
+  for (ezUInt32 y = 0; y < height; ++y)
+  {
+    for (ezUInt32 x = 0; x < width; ++x)
+    {
+      auto pPixel = pPixels + 4 * (y * width + x);
+      const int u = static_cast<int>(x * 255 / (width - 1));
+      const int v = static_cast<int>(y * 255 / (height - 1));
+      pPixel[0] = toByte(u + noise());
+      pPixel[1] = toByte(v + noise());
+      pPixel[2] = toByte((u + v) / 2 + noise());
+      pPixel[3] = toByte(255 - u);
+    }
+  }
+
+  return image;
+}
+
+/// \brief Lets the driver decode \a image, so the encoder is checked against an independent decoder.
+static void decodeOnGpu(const ezImage& image, GLenum glFormat, ezDynamicArray<ezUInt8>& out_pixels)
+{
+  const auto width = image.GetWidth();
+  const auto height = image.GetHeight();
+
+  GLuint hTexture = 0;
+  glGenTextures(1, &hTexture);
+  glBindTexture(GL_TEXTURE_2D, hTexture);
+  glCompressedTexImage2D(GL_TEXTURE_2D, 0, glFormat, width, height, 0,
+                         static_cast<GLsizei>(image.GetDepthPitch(0)), image.GetDataPointer<ezUInt8>());
+
+  out_pixels.SetCount(4 * width * height);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, out_pixels.GetData());
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glDeleteTextures(1, &hTexture);
+}
+
+/// \brief Root mean square error of the channels [firstChannel, firstChannel + numChannels).
+static double rootMeanSquareError(const ezImage& original,
+                                  const ezDynamicArray<ezUInt8>& decoded,
+                                  ezUInt32 firstChannel,
+                                  ezUInt32 numChannels)
+{
+  auto pOriginal = original.GetDataPointer<ezUInt8>();
+  const auto numPixels = original.GetWidth() * original.GetHeight();
+
+  double sum = 0.0;
+  for (ezUInt32 i = 0; i < numPixels; ++i)
+  {
+    for (ezUInt32 c = firstChannel; c < firstChannel + numChannels; ++c)
+    {
+      const double error = double(pOriginal[4 * i + c]) - double(decoded[4 * i + c]);
+      sum += error * error;
+    }
+  }
+
+  return ezMath::Sqrt(sum / (numPixels * numChannels));
+}
+
+TEST_CASE("Block Compression", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  SECTION("BC1 Solid Color")
+  {
+    auto image = createSolidImage(8, 8, 255, 0, 0, 255);
+    REQUIRE(compressImage(image, TextureCompression::BC1, TextureCompressionQuality::Fast).Succeeded());
+    REQUIRE(image.GetImageFormat() == ezImageFormat::BC1_UNORM);
+    REQUIRE(image.GetWidth() == 8u);
+
+    // Both endpoints are pure red in 5:6:5 and all indices select the first one.
+    auto pBlock = image.GetDataPointer<ezUInt8>();
+    REQUIRE(pBlock[0] == 0x00);
+    REQUIRE(pBlock[1] == 0xF8);
+    REQUIRE(pBlock[2] == 0x00);
+    REQUIRE(pBlock[3] == 0xF8);
+    REQUIRE(pBlock[4] == 0);
+    REQUIRE(pBlock[7] == 0);
+  }
+
+  SECTION("BC3 Keeps Alpha")
+  {
+    auto image = createSolidImage(4, 4, 0, 255, 0, 128);
+    REQUIRE(compressImage(image, TextureCompression::BC3).Succeeded());
+    REQUIRE(image.GetImageFormat() == ezImageFormat::BC3_UNORM);
+
+    auto pBlock = image.GetDataPointer<ezUInt8>();
+    REQUIRE(pBlock[0] == 128);
+    REQUIRE(pBlock[1] == 128);
+  }
+
+  SECTION("BC7 Uses Mode 6")
+  {
+    auto image = createSolidImage(4, 4, 10, 20, 30, 255);
+    REQUIRE(compressImage(image, TextureCompression::BC7, TextureCompressionQuality::High).Succeeded());
+    REQUIRE(image.GetImageFormat() == ezImageFormat::BC7_UNORM);
+
+    auto pBlock = image.GetDataPointer<ezUInt8>();
+    REQUIRE((pBlock[0] & 0x7F) == 0x40);
+  }
+
+  SECTION("Unsupported Format")
+  {
+    ezImage image;
+    image.SetWidth(4);
+    image.SetHeight(4);
+    image.SetImageFormat(ezImageFormat::R32G32B32A32_FLOAT);
+    image.AllocateImageData();
+
+    REQUIRE(compressImage(image, TextureCompression::BC1).Failed());
+    REQUIRE(image.GetImageFormat() == ezImageFormat::R32G32B32A32_FLOAT);
+  }
+}
+
+TEST_CASE("Compressed Loading", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  TextureLoadOptions options;
+  options.compression = TextureCompression::BC1;
+
+  SECTION("Base Level Only")
+  {
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getFormat() == ezImageFormat::BC1_UNORM);
+
+    // 4 bits per pixel instead of 32.
+    REQUIRE(pTex->getByteCount() == 512u * 512u / 2u);
+  }
+
+  SECTION("With GPU Mip Generation")
+  {
+    // Compressed textures get their mip levels from the CPU instead.
+    options.mipGeneration = TextureMipGeneration::Gpu;
+    auto pTex = Texture::load("<texture>kitten.dds", options);
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getFormat() == ezImageFormat::BC1_UNORM);
+    REQUIRE(pTex->getImage().GetNumMipLevels() == 10u);
+  }
+}
+
+TEST_CASE("Block Compression Round Trip", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  // Several chunks, so the blocks are compressed by multiple tasks.
+  const auto original = createGradientImage(64, 64);
+  ezDynamicArray<ezUInt8> decoded;
+
+  // The noise alone has a root mean square of about 5, which no 4x4 block format can keep.
+  SECTION("BC1")
+  {
+    auto image = original;
+    REQUIRE(compressImage(image, TextureCompression::BC1).Succeeded());
+    decodeOnGpu(image, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, decoded);
+    REQUIRE(glGetError() == GL_NO_ERROR);
+
+    REQUIRE(rootMeanSquareError(original, decoded, 0, 3) < 10.0);
+  }
+
+  SECTION("BC3")
+  {
+    auto image = original;
+    REQUIRE(compressImage(image, TextureCompression::BC3).Succeeded());
+    decodeOnGpu(image, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, decoded);
+    REQUIRE(glGetError() == GL_NO_ERROR);
+
+    REQUIRE(rootMeanSquareError(original, decoded, 0, 3) < 10.0);
+
+    // The alpha gradient has no noise and 8 interpolated values per block.
+    REQUIRE(rootMeanSquareError(original, decoded, 3, 1) < 2.0);
+  }
+
+  SECTION("BC7")
+  {
+    auto image = original;
+    REQUIRE(compressImage(image, TextureCompression::BC7).Succeeded());
+    decodeOnGpu(image, GL_COMPRESSED_RGBA_BPTC_UNORM, decoded);
+    REQUIRE(glGetError() == GL_NO_ERROR);
+
+    REQUIRE(rootMeanSquareError(original, decoded, 0, 4) < 8.0);
+  }
+}
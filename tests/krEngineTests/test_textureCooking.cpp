@@ -0,0 +1,149 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/textureCooking.h>
+#include <krEngine/rendering/window.h>
+#include <krEngine/rendering/implementation/cookedTexture.h>
+
+#include <Foundation/Time/Time.h>
+#include <Foundation/IO/FileSystem/FileReader.h>
+#include <Foundation/IO/FileSystem/FileWriter.h>
+
+static void readBytes(const char* fileName, ezDynamicArray<ezUInt8>& out_bytes)
+{
+  ezFileReader reader;
+  REQUIRE(reader.Open(fileName).Succeeded());
+
+  ezUInt8 chunk[4096];
+  ezUInt64 numRead = 0;
+  while ((numRead = reader.ReadBytes(chunk, sizeof(chunk))) > 0)
+  {
+    out_bytes.PushBackRange(ezArrayPtr<const ezUInt8>(chunk, static_cast<ezUInt32>(numRead)));
+  }
+}
+
+static void writeBytes(const char* fileName, const ezDynamicArray<ezUInt8>& bytes, ezUInt32 byteCount)
+{
+  ezFileWriter writer;
+  REQUIRE(writer.Open(fileName).Succeeded());
+  REQUIRE(writer.WriteBytes(bytes.GetData(), byteCount).Succeeded());
+}
+
+TEST_CASE("Cooking", "[texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  SECTION("Non-existant Source File")
+  {
+    REQUIRE(cookTexture("<GetOuttaHere!>I do not exist.nope", "<output>nope.krtex").Failed());
+  }
+
+  SECTION("Uncompressed With Generated Mip Chain")
+  {
+    TextureCookOptions options;
+    options.mipGeneration = TextureMipGeneration::Box;
+    REQUIRE(cookTexture("<texture>kitten.dds", "<output>kitten.krtex", options).Succeeded());
+
+    auto pTex = Texture::load("<output>kitten.krtex");
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getWidth() == 512u);
+    REQUIRE(pTex->getHeight() == 512u);
+    REQUIRE(pTex->getNumMipLevels() == 10u);
+
+    // Cooked textures are never decoded.
+    REQUIRE(pTex->getImage().GetWidth() == 0u);
+  }
+
+  SECTION("Compressed With Mip Chain From File")
+  {
+    REQUIRE(cookTexture("<texture>test_8x8_bc1_mips.dds", "<output>test_8x8_bc1_mips.krtex").Succeeded());
+
+    auto pTex = Texture::load("<output>test_8x8_bc1_mips.krtex");
+    REQUIRE(pTex != nullptr);
+    REQUIRE(pTex->getWidth() == 8u);
+    REQUIRE(pTex->getNumMipLevels() == 4u);
+  }
+
+  SECTION("Corrupt Files")
+  {
+    REQUIRE(cookTexture("<texture>test_8x8_bc1_mips.dds", "<output>corrupt.krtex").Succeeded());
+
+    ezDynamicArray<ezUInt8> original;
+    readBytes("<output>corrupt.krtex", original);
+    REQUIRE(Texture::load("<output>corrupt.krtex") != nullptr);
+
+    auto loadCorrupted = [&original](ezUInt32 byteCount, void (*corrupt)(ezUInt8* pData))
+    {
+      auto bytes = original;
+      corrupt(bytes.GetData());
+      writeBytes("<output>corrupt.krtex", bytes, byteCount);
+      return Texture::load("<output>corrupt.krtex");
+    };
+
+    // Truncated pixel data.
+    REQUIRE(loadCorrupted(original.GetCount() - 1, [](ezUInt8*) {}) == nullptr);
+
+    // An offset that wraps around when the byte count is added.
+    REQUIRE(loadCorrupted(original.GetCount(), [](ezUInt8* pData)
+    {
+      reinterpret_cast<CookedSubImage*>(pData + sizeof(CookedTextureHeader))->offset = ~ezUInt64(0) - 4;
+    }) == nullptr);
+
+    // Too few bytes for the dimensions of the sub-image.
+    REQUIRE(loadCorrupted(original.GetCount(), [](ezUInt8* pData)
+    {
+      reinterpret_cast<CookedSubImage*>(pData + sizeof(CookedTextureHeader))->byteCount = 8;
+    }) == nullptr);
+
+    // GL enums that don't belong to the image format.
+    REQUIRE(loadCorrupted(original.GetCount(), [](ezUInt8* pData)
+    {
+      reinterpret_cast<CookedTextureHeader*>(pData)->glInternalFormat = GL_RGBA32F;
+    }) == nullptr);
+    REQUIRE(loadCorrupted(original.GetCount(), [](ezUInt8* pData)
+    {
+      reinterpret_cast<CookedTextureHeader*>(pData)->glTarget = GL_TEXTURE_3D;
+    }) == nullptr);
+  }
+}
+
+TEST_CASE("Cooked Loading Benchmark", "[.][benchmark][texture]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  TextureCookOptions cookOptions;
+  cookOptions.mipGeneration = TextureMipGeneration::None;
+  REQUIRE(cookTexture("<texture>kitten.dds", "<output>kitten_benchmark.krtex", cookOptions).Succeeded());
+
+  const int numIterations = 50;
+
+  auto measure = [&](const char* fileName)
+  {
+    auto start = ezTime::Now();
+    for (int i = 0; i < numIterations; ++i)
+    {
+      auto pTex = Texture::load(fileName);
+      REQUIRE(pTex != nullptr);
+    }
+    glFinish();
+    return (ezTime::Now() - start) / numIterations;
+  };
+
+  auto decoded = measure("<texture>kitten.dds");
+  auto cooked = measure("<output>kitten_benchmark.krtex");
+
+  ezLog::Info("Texture::load of a 512x512 texture: %.3f ms decoded, %.3f ms cooked",
+              decoded.GetMilliseconds(), cooked.GetMilliseconds());
+}
@@ -0,0 +1,86 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/window.h>
+#include <krEngine/rendering/vertexArrayCache.h>
+#include <krEngine/rendering/vertexBufferPool.h>
+
+namespace
+{
+  struct SharedVertex
+  {
+    ezVec2 pos;
+  };
+}
+
+KR_BEGIN_VERTEX_LAYOUT(SharedVertex)
+  KR_VERTEX_ATTRIBUTE("vs_position", pos)
+KR_END_VERTEX_LAYOUT
+
+TEST_CASE("Vertex Array Cache", "[vertex-buffer]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  auto shader = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+  REQUIRE(shader != nullptr);
+
+  SECTION("Pooled Buffers")
+  {
+    auto pFirst = VertexBufferPool::allocate(4 * sizeof(SharedVertex), sizeof(SharedVertex), PrimitiveType::TriangleStrip);
+    auto pSecond = VertexBufferPool::allocate(4 * sizeof(SharedVertex), sizeof(SharedVertex), PrimitiveType::TriangleStrip);
+    REQUIRE(setupLayout<SharedVertex>(pFirst, shader).Succeeded());
+    REQUIRE(setupLayout<SharedVertex>(pSecond, shader).Succeeded());
+
+    REQUIRE(pFirst->m_layoutId != 0);
+    REQUIRE(pFirst->m_layoutId == pSecond->m_layoutId);
+    REQUIRE(pFirst->m_stride == sizeof(SharedVertex));
+    REQUIRE(VertexArrayCache::getCount() == 1);
+
+    // Setting up the same layout again does not create another one.
+    REQUIRE(setupLayout<SharedVertex>(pFirst, shader).Succeeded());
+    REQUIRE(pFirst->m_layoutId == pSecond->m_layoutId);
+    REQUIRE(VertexArrayCache::getCount() == 1);
+  }
+
+  SECTION("Separate Buffers")
+  {
+    auto pFirst = VertexBuffer::create(BufferUsage::StaticDraw, PrimitiveType::Triangles);
+    auto pSecond = VertexBuffer::create(BufferUsage::StaticDraw, PrimitiveType::Triangles);
+    REQUIRE(setupLayout<SharedVertex>(pFirst, shader).Succeeded());
+    REQUIRE(setupLayout<SharedVertex>(pSecond, shader).Succeeded());
+
+    REQUIRE(VertexArrayCache::get(pFirst->m_layoutId, shader) == VertexArrayCache::get(pSecond->m_layoutId, shader));
+    REQUIRE(VertexArrayCache::getCount() == 1);
+
+    // Binding attaches the buffer to the shared vertex array object.
+    KR_RAII_BIND_VERTEX_BUFFER(pSecond, shader);
+    GLint hBound = 0;
+    glGetIntegeri_v(GL_VERTEX_BINDING_BUFFER, 0, &hBound);
+    REQUIRE(static_cast<GLuint>(hBound) == pSecond->m_glHandle);
+  }
+
+  SECTION("Resolved Once per Program")
+  {
+    auto pBuffer = VertexBuffer::create(BufferUsage::StaticDraw, PrimitiveType::Triangles);
+    REQUIRE(setupLayout<SharedVertex>(pBuffer, shader).Succeeded());
+
+    // A program that was not used in setupLayout() resolves the layout on its first bind.
+    auto otherShader = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+    REQUIRE(otherShader != nullptr);
+    {
+      KR_RAII_BIND_VERTEX_BUFFER(pBuffer, otherShader);
+      GLint hBound = 0;
+      glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &hBound);
+      REQUIRE(static_cast<GLuint>(hBound) == VertexArrayCache::get(pBuffer->m_layoutId, shader));
+    }
+
+    // Both programs have the same attribute locations, so they share the vertex array object.
+    REQUIRE(VertexArrayCache::getCount() == 1);
+  }
+}
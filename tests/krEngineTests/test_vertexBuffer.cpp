@@ -14,6 +14,14 @@ namespace
     ezColor color = ezColor::White;
     ezVec2 texCoords = ezVec2::ZeroVector();
   };
+
+  /// \brief Same attributes as TestLayout in 12 instead of 32 bytes.
+  struct CompactTestLayout
+  {
+    kr::Half2 pos;
+    kr::UNorm8x4 color;
+    kr::UNorm16x2 texCoords;
+  };
 }
 
 EZ_DECLARE_REFLECTABLE_TYPE(EZ_NO_LINKAGE, TestLayout);
@@ -27,6 +35,18 @@ EZ_BEGIN_STATIC_REFLECTED_TYPE(TestLayout, ezNoBase, 1, ezRTTINoAllocator);
   EZ_END_PROPERTIES
 EZ_END_STATIC_REFLECTED_TYPE();
 
+KR_BEGIN_VERTEX_LAYOUT(TestLayout)
+  KR_VERTEX_ATTRIBUTE("vs_position",  pos),
+  KR_VERTEX_ATTRIBUTE("vs_color",     color),
+  KR_VERTEX_ATTRIBUTE("vs_texCoords", texCoords)
+KR_END_VERTEX_LAYOUT
+
+KR_BEGIN_VERTEX_LAYOUT(CompactTestLayout)
+  KR_VERTEX_ATTRIBUTE("vs_position",  pos),
+  KR_VERTEX_ATTRIBUTE("vs_color",     color),
+  KR_VERTEX_ATTRIBUTE("vs_texCoords", texCoords)
+KR_END_VERTEX_LAYOUT
+
 TEST_CASE("Basics", "[vertex-buffer]")
 {
   using namespace kr;
@@ -62,4 +82,78 @@ TEST_CASE("Basics", "[vertex-buffer]")
     uploadData(vb, ezMakeArrayPtr(data));
     REQUIRE(uploadData(vb, ezMakeArrayPtr(data)).Succeeded());
   }
+
+  SECTION("Compile-Time Layout")
+  {
+    auto& layout = vertexLayoutOf<TestLayout>();
+    REQUIRE(layout.getStride() == sizeof(TestLayout));
+    REQUIRE(layout.getAttributes().GetCount() == 3);
+
+    auto& color = layout.getAttributes()[1];
+    REQUIRE(ezStringUtils::IsEqual(color.name, "vs_color"));
+    REQUIRE(color.glType == GL_FLOAT);
+    REQUIRE(color.numComponents == 4);
+    REQUIRE(color.isNormalized == GL_FALSE);
+    REQUIRE(color.offset == offsetof(TestLayout, color));
+
+    // The layout is built only once.
+    REQUIRE(&vertexLayoutOf<TestLayout>() == &layout);
+
+    auto shader = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+    REQUIRE(shader->findAttribute("vs_color") != nullptr);
+    REQUIRE(shader->findAttribute("vs_doesNotExist") == nullptr);
+
+    auto vb = VertexBuffer::create(BufferUsage::StaticDraw, PrimitiveType::Triangles);
+    REQUIRE(setupLayout<TestLayout>(vb, shader).Succeeded());
+    REQUIRE(bind(vb, shader).Succeeded());
+    REQUIRE(restoreLastVertexBuffer(shader).Succeeded());
+  }
+
+  SECTION("Compact Formats")
+  {
+    REQUIRE(sizeof(CompactTestLayout) == 12);
+
+    REQUIRE(toUNorm8(1.0f) == 255);
+    REQUIRE(toUNorm8(2.0f) == 255);
+    REQUIRE(toSNorm8(-1.0f) == -127);
+    REQUIRE(toUNorm16(0.5f) == 32768);
+    REQUIRE(fromSNorm16(toSNorm16(-0.25f)) == Approx(-0.25f).epsilon(0.0001f));
+
+    REQUIRE(toHalf(1.0f) == 0x3C00);
+    REQUIRE(toHalf(-2.0f) == 0xC000);
+    REQUIRE(toHalf(100000.0f) == 0x7C00); // Infinity.
+    REQUIRE(fromHalf(toHalf(2048.0f)) == 2048.0f);
+    REQUIRE(fromHalf(toHalf(0.1f)) == Approx(0.1f).epsilon(0.001f));
+
+    SNorm2_10_10_10 normal;
+    normal.set(1.0f, -1.0f, 0.5f, -1.0f);
+    auto unpacked = normal.get();
+    REQUIRE(unpacked.x == 1.0f);
+    REQUIRE(unpacked.y == -1.0f);
+    REQUIRE(unpacked.z == Approx(0.5f).epsilon(0.002f));
+    REQUIRE(unpacked.w == -1.0f);
+
+    auto& layout = vertexLayoutOf<CompactTestLayout>();
+    auto& pos = layout.getAttributes()[0];
+    REQUIRE(pos.glType == GL_HALF_FLOAT);
+    REQUIRE(pos.numComponents == 2);
+    auto& color = layout.getAttributes()[1];
+    REQUIRE(color.glType == GL_UNSIGNED_BYTE);
+    REQUIRE(color.isNormalized == GL_TRUE);
+    REQUIRE(color.offset == 4);
+
+    auto shader = ShaderProgram::loadAndLink("<shader>Valid.vs", "<shader>Valid.fs");
+    auto vb = VertexBuffer::create(BufferUsage::StaticDraw, PrimitiveType::Triangles);
+    REQUIRE(setupLayout<CompactTestLayout>(vb, shader).Succeeded());
+
+    CompactTestLayout data[3];
+    data[0].pos.set(-1.0f, -1.0f);
+    data[1].pos.set( 1.0f, -1.0f);
+    data[2].pos.set( 0.0f,  1.0f);
+    for (auto& vertex : data)
+    {
+      vertex.color.set(ezColor::White);
+    }
+    REQUIRE(uploadData(vb, ezMakeArrayPtr(data)).Succeeded());
+  }
 }
@@ -0,0 +1,121 @@
+#include <krEngineTests/pch.h>
+#include <catch.hpp>
+
+#include <krEngine/rendering/window.h>
+#include <krEngine/rendering/vertexBufferPool.h>
+
+static ezUInt32 readFirstWord(kr::Borrowed<const kr::VertexBuffer> pVB)
+{
+  ezUInt32 word = 0;
+  glBindBuffer(GL_COPY_READ_BUFFER, pVB->m_glHandle);
+  glGetBufferSubData(GL_COPY_READ_BUFFER, pVB->m_byteOffset, sizeof(word), &word);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  return word;
+}
+
+TEST_CASE("Vertex Buffer Pool", "[vertex-buffer]")
+{
+  using namespace kr;
+
+  KR_TESTS_RAII_CORE_STARTUP;
+
+  auto pWindow = Window::createAndOpen();
+
+  KR_TESTS_RAII_ENGINE_STARTUP;
+
+  const ezUInt32 pageSize = 1024;
+  VertexBufferPool::setPageSize(pageSize);
+
+  SECTION("Allocate")
+  {
+    auto pFirst = VertexBufferPool::allocate(48, 12, PrimitiveType::TriangleStrip);
+    auto pSecond = VertexBufferPool::allocate(48, 12, PrimitiveType::TriangleStrip);
+    REQUIRE(pFirst != nullptr);
+    REQUIRE(pSecond != nullptr);
+    REQUIRE(pFirst->isPooled());
+
+    // Both live in the same GL buffer.
+    REQUIRE(pFirst->m_glHandle == pSecond->m_glHandle);
+    REQUIRE(pFirst->m_byteOffset == 0);
+    REQUIRE(pSecond->m_byteOffset == 48);
+    REQUIRE(pSecond->getBaseVertex(12) == 4);
+
+    // Offsets are aligned to the stride.
+    auto pAligned = VertexBufferPool::allocate(32, 32, PrimitiveType::Triangles);
+    REQUIRE(pAligned->m_byteOffset % 32 == 0);
+
+    // Too large for a page.
+    auto pLarge = VertexBufferPool::allocate(2 * pageSize, 16, PrimitiveType::Triangles);
+    REQUIRE(pLarge != nullptr);
+    REQUIRE_FALSE(pLarge->isPooled());
+
+    auto stats = VertexBufferPool::getStats();
+    REQUIRE(stats.numPages == 1);
+    REQUIRE(stats.numAllocations == 3);
+    REQUIRE(stats.usedByteCount == 48 + 48 + 32);
+  }
+
+  SECTION("Upload")
+  {
+    auto pFirst = VertexBufferPool::allocate(16, 4, PrimitiveType::Points);
+    auto pSecond = VertexBufferPool::allocate(16, 4, PrimitiveType::Points);
+
+    const ezUInt32 first[] = { 1, 2, 3, 4 };
+    const ezUInt32 second[] = { 5, 6, 7, 8 };
+    REQUIRE(uploadData(pFirst, ezMakeArrayPtr(first)).Succeeded());
+    REQUIRE(uploadData(pSecond, ezMakeArrayPtr(second)).Succeeded());
+
+    // Neither upload overwrites the other buffer.
+    REQUIRE(readFirstWord(pFirst) == 1);
+    REQUIRE(readFirstWord(pSecond) == 5);
+
+    // Pooled buffers cannot grow.
+    const ezUInt32 tooMuch[] = { 1, 2, 3, 4, 5 };
+    REQUIRE(uploadData(pFirst, ezMakeArrayPtr(tooMuch)).Failed());
+  }
+
+  SECTION("Fragmentation and Compaction")
+  {
+    Owned<VertexBuffer> buffers[8];
+    for (ezUInt32 i = 0; i < EZ_ARRAY_SIZE(buffers); ++i)
+    {
+      buffers[i] = VertexBufferPool::allocate(64, 4, PrimitiveType::Points);
+      uploadData(buffers[i], sizeof(i), &i);
+    }
+
+    REQUIRE(VertexBufferPool::getStats().getFragmentation() == 0.0f);
+
+    // Free every other buffer.
+    for (ezUInt32 i = 0; i < EZ_ARRAY_SIZE(buffers); i += 2)
+    {
+      buffers[i] = nullptr;
+    }
+
+    auto stats = VertexBufferPool::getStats();
+    REQUIRE(stats.numAllocations == 4);
+    REQUIRE(stats.numFreeRanges == 5);
+    REQUIRE(stats.getFragmentation() > 0.0f);
+
+    REQUIRE(VertexBufferPool::compact() == 4);
+
+    stats = VertexBufferPool::getStats();
+    REQUIRE(stats.numFreeRanges == 1);
+    REQUIRE(stats.largestFreeRange == pageSize - 4 * 64);
+    REQUIRE(stats.getFragmentation() == 0.0f);
+
+    // The data moved along.
+    for (ezUInt32 i = 1; i < EZ_ARRAY_SIZE(buffers); i += 2)
+    {
+      REQUIRE(buffers[i]->m_byteOffset == (i / 2) * 64);
+      REQUIRE(readFirstWord(buffers[i]) == i);
+    }
+
+    // Empty pages are released.
+    for (auto& pVB : buffers)
+    {
+      pVB = nullptr;
+    }
+    VertexBufferPool::compact();
+    REQUIRE(VertexBufferPool::getStats().numPages == 0);
+  }
+}